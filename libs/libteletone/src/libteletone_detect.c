@@ -102,20 +102,17 @@
 
 #define LOW_ENG 10000000
 #define ZC 2
-static teletone_detection_descriptor_t dtmf_detect_row[GRID_FACTOR];
-static teletone_detection_descriptor_t dtmf_detect_col[GRID_FACTOR];
-static teletone_detection_descriptor_t dtmf_detect_row_2nd[GRID_FACTOR];
-static teletone_detection_descriptor_t dtmf_detect_col_2nd[GRID_FACTOR];
 
 static float dtmf_row[] = {697.0f,	770.0f,	 852.0f,  941.0f};
 static float dtmf_col[] = {1209.0f, 1336.0f, 1477.0f, 1633.0f};
 
 static char dtmf_positions[] = "123A" "456B" "789C" "*0#D";
 
-static void goertzel_init(teletone_goertzel_state_t *goertzel_state, teletone_detection_descriptor_t *tdesc) {
-	goertzel_state->v2 = goertzel_state->v3 = 0.0;
-	goertzel_state->fac = tdesc->fac;
-}
+#define DTMF_ROW(i) (i)
+#define DTMF_COL(i) (GRID_FACTOR + (i))
+#define DTMF_ROW_2ND(i) (2 * GRID_FACTOR + (i))
+#define DTMF_COL_2ND(i) (3 * GRID_FACTOR + (i))
+#define DTMF_FAX(i) (4 * GRID_FACTOR + (i))
 
 TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_state,
 							  int16_t sample_buffer[],
@@ -134,12 +131,73 @@ TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_
 #pragma warning(disable:4244)
 #endif
 
-#define teletone_goertzel_result(gs) (double)(((gs)->v3 * (gs)->v3 + (gs)->v2 * (gs)->v2 - (gs)->v2 * (gs)->v3 * (gs)->fac))
+#define teletone_goertzel_bank_energy(b, x) (double)(((b)->v3[x] * (b)->v3[x] + (b)->v2[x] * (b)->v2[x] - (b)->v2[x] * (b)->v3[x] * (double)(b)->fac[x]))
+
+TELETONE_API(void) teletone_goertzel_bank_init(teletone_goertzel_bank_t *bank)
+{
+	memset(bank, 0, sizeof(*bank));
+}
+
+TELETONE_API(int) teletone_goertzel_bank_add(teletone_goertzel_bank_t *bank, float freq, int sample_rate)
+{
+	float theta;
+
+	if (bank->bins >= TELETONE_MAX_BANK_BINS) {
+		return -1;
+	}
+
+	if (!sample_rate) {
+		sample_rate = 8000;
+	}
+
+	theta = (float)(M_TWO_PI*(freq/(float)sample_rate));
+	bank->fac[bank->bins] = (float)(2.0*cos(theta));
+	bank->v2[bank->bins] = bank->v3[bank->bins] = 0.0;
+
+	return bank->bins++;
+}
+
+TELETONE_API(void) teletone_goertzel_bank_reset(teletone_goertzel_bank_t *bank)
+{
+	memset(bank->v2, 0, sizeof(bank->v2));
+	memset(bank->v3, 0, sizeof(bank->v3));
+}
+
+TELETONE_API(void) teletone_goertzel_bank_update(teletone_goertzel_bank_t *bank,
+									   int16_t sample_buffer[],
+									   int samples)
+{
+	float *fac = bank->fac, *v2 = bank->v2, *v3 = bank->v3;
+	float famp, v1;
+	int i, x, lanes;
+
+	/* Round up to whole vector lanes, the unused tail bins have a zero
+	   coefficient and are never read back so stepping them is harmless. */
+	lanes = (bank->bins + TELETONE_BANK_LANES - 1) & ~(TELETONE_BANK_LANES - 1);
+
+	for (i = 0;	 i < samples;  i++) {
+		famp = sample_buffer[i];
+
+		for (x = 0; x < lanes; x++) {
+			v1 = v2[x];
+			v2[x] = v3[x];
+			v3[x] = fac[x]*v3[x] - v1 + famp;
+		}
+	}
+}
+
+TELETONE_API(double) teletone_goertzel_bank_result(teletone_goertzel_bank_t *bank, int bin)
+{
+	if (bin < 0 || bin >= bank->bins) {
+		return 0.0;
+	}
+
+	return teletone_goertzel_bank_energy(bank, bin);
+}
 
 TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf_detect_state, int sample_rate)
 {
 	int i;
-	float theta;
 
 	if (!sample_rate) {
 		sample_rate = 8000;
@@ -147,26 +205,28 @@ TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf
 
 	dtmf_detect_state->hit1 = dtmf_detect_state->hit2 = 0;
 
+	teletone_goertzel_bank_init(&dtmf_detect_state->bank);
+
+	for (i = 0;	 i < GRID_FACTOR;  i++) {
+		teletone_goertzel_bank_add(&dtmf_detect_state->bank, dtmf_row[i], sample_rate);
+	}
 	for (i = 0;	 i < GRID_FACTOR;  i++) {
-		theta = (float)(M_TWO_PI*(dtmf_row[i]/(float)sample_rate));
-		dtmf_detect_row[i].fac = (float)(2.0*cos(theta));
+		teletone_goertzel_bank_add(&dtmf_detect_state->bank, dtmf_col[i], sample_rate);
+	}
+	for (i = 0;	 i < GRID_FACTOR;  i++) {
+		teletone_goertzel_bank_add(&dtmf_detect_state->bank, dtmf_row[i] * 2.0f, sample_rate);
+	}
+	for (i = 0;	 i < GRID_FACTOR;  i++) {
+		teletone_goertzel_bank_add(&dtmf_detect_state->bank, dtmf_col[i] * 2.0f, sample_rate);
+	}
+	teletone_goertzel_bank_add(&dtmf_detect_state->bank, TELETONE_FAX_CNG_HZ, sample_rate);
+	teletone_goertzel_bank_add(&dtmf_detect_state->bank, TELETONE_FAX_CED_HZ, sample_rate);
 
-		theta = (float)(M_TWO_PI*(dtmf_col[i]/(float)sample_rate));
-		dtmf_detect_col[i].fac = (float)(2.0*cos(theta));
-	
-		theta = (float)(M_TWO_PI*(dtmf_row[i]*2.0/(float)sample_rate));
-		dtmf_detect_row_2nd[i].fac = (float)(2.0*cos(theta));
+	dtmf_detect_state->fax_blocks[0] = dtmf_detect_state->fax_blocks[1] = 0;
+	dtmf_detect_state->fax_min_blocks = TELETONE_FAX_TONE_MS * (sample_rate / 1000) / BLOCK_LEN;
+	dtmf_detect_state->fax_tone = TT_FAX_NONE;
 
-		theta = (float)(M_TWO_PI*(dtmf_col[i]*2.0/(float)sample_rate));
-		dtmf_detect_col_2nd[i].fac = (float)(2.0*cos(theta));
-	
-		goertzel_init (&dtmf_detect_state->row_out[i], &dtmf_detect_row[i]);
-		goertzel_init (&dtmf_detect_state->col_out[i], &dtmf_detect_col[i]);
-		goertzel_init (&dtmf_detect_state->row_out2nd[i], &dtmf_detect_row_2nd[i]);
-		goertzel_init (&dtmf_detect_state->col_out2nd[i], &dtmf_detect_col_2nd[i]);
-	
-		dtmf_detect_state->energy = 0.0;
-	}
+	dtmf_detect_state->energy = 0.0;
 	dtmf_detect_state->current_sample = 0;
 	dtmf_detect_state->detected_digits = 0;
 	dtmf_detect_state->lost_digits = 0;
@@ -176,7 +236,6 @@ TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf
 
 TELETONE_API(void) teletone_multi_tone_init(teletone_multi_tone_t *mt, teletone_tone_map_t *map)
 {
-	float theta = 0;
 	int x = 0;
 
 	if (!mt->sample_rate) {
@@ -201,15 +260,15 @@ TELETONE_API(void) teletone_multi_tone_init(teletone_multi_tone_t *mt, teletone_
 		mt->hit_factor = 2;
 	}
 
+	teletone_goertzel_bank_init(&mt->bank);
+
 	for(x = 0; x < TELETONE_MAX_TONES; x++) {
 		if ((int) map->freqs[x] == 0) {
 			break;
 		}
 		mt->tone_count++;
-		theta = (float)(M_TWO_PI*(map->freqs[x]/(float)mt->sample_rate));
-		mt->tdd[x].fac = (float)(2.0 * cos(theta));
-		goertzel_init (&mt->gs[x], &mt->tdd[x]);
-		goertzel_init (&mt->gs2[x], &mt->tdd[x]);
+		teletone_goertzel_bank_add(&mt->bank, (float) map->freqs[x], mt->sample_rate);
+		mt->tdd[x].fac = mt->bank.fac[x];
 	}
 
 }
@@ -219,7 +278,7 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 								int samples)
 {
 	int sample, limit = 0, j, x = 0;
-	float v1, famp;
+	float famp;
 	float eng_sum = 0, eng_all[TELETONE_MAX_TONES] = {0.0};
 	int gtest = 0, see_hit = 0;
 
@@ -239,18 +298,10 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 			famp = sample_buffer[j];
 			
 			mt->energy += famp*famp;
-
-			for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-				v1 = mt->gs[x].v2;
-				mt->gs[x].v2 = mt->gs[x].v3;
-				mt->gs[x].v3 = (float)(mt->gs[x].fac * mt->gs[x].v2 - v1 + famp);
-	
-				v1 = mt->gs2[x].v2;
-				mt->gs2[x].v2 = mt->gs2[x].v3;
-				mt->gs2[x].v3 = (float)(mt->gs2[x].fac*mt->gs2[x].v2 - v1 + famp);
-			}
 		}
 
+		teletone_goertzel_bank_update(&mt->bank, sample_buffer + sample, limit - sample);
+
 		mt->current_sample += (limit - sample);
 		if (mt->current_sample < mt->min_samples) {
 			continue;
@@ -258,13 +309,13 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 
 		eng_sum = 0;
 		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			eng_all[x] = (float)(teletone_goertzel_result (&mt->gs[x]));
+			eng_all[x] = (float)(teletone_goertzel_bank_energy (&mt->bank, x));
 			eng_sum += eng_all[x];
 		}
 
 		gtest = 0;
 		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			gtest += teletone_goertzel_result (&mt->gs2[x]) < eng_all[x] ? 1 : 0;
+			gtest += teletone_goertzel_bank_energy (&mt->bank, x) < eng_all[x] ? 1 : 0;
 		}
 
 		if ((gtest >= 2 || gtest == mt->tone_count) && eng_sum > 42.0 * mt->energy) {
@@ -291,10 +342,7 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 		}
 
 		/* Reinitialise the detector for the next block */
-		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			goertzel_init (&mt->gs[x], &mt->tdd[x]);
-			goertzel_init (&mt->gs2[x], &mt->tdd[x]);
-		}
+		teletone_goertzel_bank_reset(&mt->bank);
 
 		mt->energy = 0.0;
 		mt->current_sample = 0;
@@ -311,7 +359,6 @@ TELETONE_API(teletone_hit_type_t) teletone_dtmf_detect (teletone_dtmf_detect_sta
 	float row_energy[GRID_FACTOR];
 	float col_energy[GRID_FACTOR];
 	float famp;
-	float v1;
 	int i;
 	int j;
 	int sample;
@@ -330,42 +377,19 @@ TELETONE_API(teletone_hit_type_t) teletone_dtmf_detect (teletone_dtmf_detect_sta
 		}
 
 		for (j = sample;  j < limit;  j++) {
-			int x = 0;
 			famp = sample_buffer[j];
 			
 			dtmf_detect_state->energy += famp*famp;
-
-			for(x = 0; x < GRID_FACTOR; x++) {
-				v1 = dtmf_detect_state->row_out[x].v2;
-				dtmf_detect_state->row_out[x].v2 = dtmf_detect_state->row_out[x].v3;
-				dtmf_detect_state->row_out[x].v3 = (float)(dtmf_detect_state->row_out[x].fac*dtmf_detect_state->row_out[x].v2 - v1 + famp);
-	
-				v1 = dtmf_detect_state->col_out[x].v2;
-				dtmf_detect_state->col_out[x].v2 = dtmf_detect_state->col_out[x].v3;
-				dtmf_detect_state->col_out[x].v3 = (float)(dtmf_detect_state->col_out[x].fac*dtmf_detect_state->col_out[x].v2 - v1 + famp);
-
-				v1 = dtmf_detect_state->col_out2nd[x].v2;
-				dtmf_detect_state->col_out2nd[x].v2 = dtmf_detect_state->col_out2nd[x].v3;
-				dtmf_detect_state->col_out2nd[x].v3 = (float)(dtmf_detect_state->col_out2nd[x].fac*dtmf_detect_state->col_out2nd[x].v2 - v1 + famp);
-		
-				v1 = dtmf_detect_state->row_out2nd[x].v2;
-				dtmf_detect_state->row_out2nd[x].v2 = dtmf_detect_state->row_out2nd[x].v3;
-				dtmf_detect_state->row_out2nd[x].v3 = (float)(dtmf_detect_state->row_out2nd[x].fac*dtmf_detect_state->row_out2nd[x].v2 - v1 + famp);
-			}
-
 		}
 
+		teletone_goertzel_bank_update(&dtmf_detect_state->bank, sample_buffer + sample, limit - sample);
+
 		if (dtmf_detect_state->zc > 0) {
 			if (dtmf_detect_state->energy < LOW_ENG && dtmf_detect_state->lenergy < LOW_ENG) {
 				if (!--dtmf_detect_state->zc) {
 					/* Reinitialise the detector for the next block */
 					dtmf_detect_state->hit1 = dtmf_detect_state->hit2 = 0;
-					for (i = 0;	 i < GRID_FACTOR;  i++) {
-						goertzel_init (&dtmf_detect_state->row_out[i], &dtmf_detect_row[i]);
-						goertzel_init (&dtmf_detect_state->col_out[i], &dtmf_detect_col[i]);
-						goertzel_init (&dtmf_detect_state->row_out2nd[i], &dtmf_detect_row_2nd[i]);
-						goertzel_init (&dtmf_detect_state->col_out2nd[i], &dtmf_detect_col_2nd[i]);
-					}
+					teletone_goertzel_bank_reset(&dtmf_detect_state->bank);
 					dtmf_detect_state->dur -= samples;
 					return TT_HIT_END;
 				}
@@ -386,16 +410,31 @@ TELETONE_API(teletone_hit_type_t) teletone_dtmf_detect (teletone_dtmf_detect_sta
 			continue;
 		}
 		/* We are at the end of a DTMF detection block */
+		/* A fax tone is a single tone carrying most of the block's energy, its bins restart every block */
+		for (i = 0;	 i < 2;	 i++) {
+			double fax_energy = teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_FAX(i));
+
+			if (fax_energy >= DTMF_THRESHOLD && fax_energy > 21.0*dtmf_detect_state->energy) {
+				if (++dtmf_detect_state->fax_blocks[i] == dtmf_detect_state->fax_min_blocks) {
+					dtmf_detect_state->fax_tone = i ? TT_FAX_CED : TT_FAX_CNG;
+				}
+			} else {
+				dtmf_detect_state->fax_blocks[i] = 0;
+			}
+
+			dtmf_detect_state->bank.v2[DTMF_FAX(i)] = dtmf_detect_state->bank.v3[DTMF_FAX(i)] = 0.0;
+		}
+
 		/* Find the peak row and the peak column */
-		row_energy[0] = teletone_goertzel_result (&dtmf_detect_state->row_out[0]);
-		col_energy[0] = teletone_goertzel_result (&dtmf_detect_state->col_out[0]);
+		row_energy[0] = teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_ROW(0));
+		col_energy[0] = teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_COL(0));
 
 		for (best_row = best_col = 0, i = 1;  i < GRID_FACTOR;	i++) {
-			row_energy[i] = teletone_goertzel_result (&dtmf_detect_state->row_out[i]);
+			row_energy[i] = teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_ROW(i));
 			if (row_energy[i] > row_energy[best_row]) {
 				best_row = i;
 			}
-			col_energy[i] = teletone_goertzel_result (&dtmf_detect_state->col_out[i]);
+			col_energy[i] = teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_COL(i));
 			if (col_energy[i] > col_energy[best_col]) {
 				best_col = i;
 			}
@@ -415,8 +454,8 @@ TELETONE_API(teletone_hit_type_t) teletone_dtmf_detect (teletone_dtmf_detect_sta
 			}
 			/* ... and second harmonic test */
 			if (i >= GRID_FACTOR && (row_energy[best_row] + col_energy[best_col]) > 42.0*dtmf_detect_state->energy &&
-				teletone_goertzel_result (&dtmf_detect_state->col_out2nd[best_col])*DTMF_2ND_HARMONIC_COL < col_energy[best_col] &&
-				teletone_goertzel_result (&dtmf_detect_state->row_out2nd[best_row])*DTMF_2ND_HARMONIC_ROW < row_energy[best_row]) {
+				teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_COL_2ND(best_col))*DTMF_2ND_HARMONIC_COL < col_energy[best_col] &&
+				teletone_goertzel_bank_energy (&dtmf_detect_state->bank, DTMF_ROW_2ND(best_row))*DTMF_2ND_HARMONIC_ROW < row_energy[best_row]) {
 				hit = dtmf_positions[(best_row << 2) + best_col];
 				/* Look for two successive similar results */
 				/* The logic in the next test is:
@@ -476,6 +515,15 @@ TELETONE_API(int) teletone_dtmf_get (teletone_dtmf_detect_state_t *dtmf_detect_s
 	return 1;
 }
 
+TELETONE_API(teletone_fax_tone_t) teletone_dtmf_get_fax_tone (teletone_dtmf_detect_state_t *dtmf_detect_state)
+{
+	teletone_fax_tone_t tone = dtmf_detect_state->fax_tone;
+
+	dtmf_detect_state->fax_tone = TT_FAX_NONE;
+
+	return tone;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -132,6 +132,11 @@ extern "C" {
 #define DTMF_2ND_HARMONIC_COL		63.1	/* 18dB */
 #define GRID_FACTOR 4
 #define BLOCK_LEN 102
+#define TELETONE_FAX_CNG_HZ 1100.0f
+#define TELETONE_FAX_CED_HZ 2100.0f
+#define TELETONE_FAX_TONE_MS 400
+#define TELETONE_MAX_BANK_BINS 32
+#define TELETONE_BANK_LANES 4
 #define M_TWO_PI 2.0*M_PI
 
 	typedef enum {
@@ -141,6 +146,12 @@ extern "C" {
 		TT_HIT_END = 3
 	} teletone_hit_type_t;
 
+	typedef enum {
+		TT_FAX_NONE = 0,
+		TT_FAX_CNG = 1,
+		TT_FAX_CED = 2
+	} teletone_fax_tone_t;
+
 
 	/*! \brief A continer for the elements of a Goertzel Algorithm (The names are from his formula) */
 	typedef struct {
@@ -148,6 +159,17 @@ extern "C" {
 		float v3;
 		double fac;
 	} teletone_goertzel_state_t;
+
+	/*! \brief A bank of Goertzel filters stepped over the same samples in one pass.
+	  The filter state is kept one array per term so the per-sample update runs
+	  across every bin at once and can be vectorized by the compiler.
+	*/
+	typedef struct {
+		float fac[TELETONE_MAX_BANK_BINS];
+		float v2[TELETONE_MAX_BANK_BINS];
+		float v3[TELETONE_MAX_BANK_BINS];
+		int bins;
+	} teletone_goertzel_bank_t;
 	
 	/*! \brief A container for a DTMF detection state.*/
 	typedef struct {
@@ -159,10 +181,8 @@ extern "C" {
 		int zc;
 		
 
-		teletone_goertzel_state_t row_out[GRID_FACTOR];
-		teletone_goertzel_state_t col_out[GRID_FACTOR];
-		teletone_goertzel_state_t row_out2nd[GRID_FACTOR];
-		teletone_goertzel_state_t col_out2nd[GRID_FACTOR];
+		/* rows, columns, row 2nd harmonics and column 2nd harmonics, GRID_FACTOR bins each, then the CNG and CED bins */
+		teletone_goertzel_bank_t bank;
 		float energy;
 		float lenergy;
 	
@@ -172,6 +192,11 @@ extern "C" {
 		int detected_digits;
 		int lost_digits;
 		int digit_hits[16];
+
+		/* blocks in a row carrying the CNG or CED tone, and the tone to report */
+		int fax_blocks[2];
+		int fax_min_blocks;
+		teletone_fax_tone_t fax_tone;
 	} teletone_dtmf_detect_state_t;
 
 	/*! \brief An abstraction to store the coefficient of a tone frequency */
@@ -187,8 +212,7 @@ extern "C" {
 		int sample_rate;
 
 		teletone_detection_descriptor_t tdd[TELETONE_MAX_TONES];
-		teletone_goertzel_state_t gs[TELETONE_MAX_TONES];
-		teletone_goertzel_state_t gs2[TELETONE_MAX_TONES];
+		teletone_goertzel_bank_t bank;
 		int tone_count;
 
 		float energy;
@@ -252,6 +276,15 @@ TELETONE_API(teletone_hit_type_t) teletone_dtmf_detect (teletone_dtmf_detect_sta
 	*/
 TELETONE_API(int) teletone_dtmf_get (teletone_dtmf_detect_state_t *dtmf_detect_state, char *buf, unsigned int *dur);
 
+	/*! 
+	  \brief retrieve a fax calling (CNG, 1100Hz) or answer (CED, 2100Hz) tone heard by a DTMF detector
+	  The tones are measured by the same filter bank pass as the digits, a tone is reported once
+	  after TELETONE_FAX_TONE_MS of it and again only after it stopped.
+	  \param dtmf_detect_state the detection state object to check
+	  \return the tone heard since the last call or TT_FAX_NONE
+	*/
+TELETONE_API(teletone_fax_tone_t) teletone_dtmf_get_fax_tone (teletone_dtmf_detect_state_t *dtmf_detect_state);
+
 	/*! 
 	  \brief Step through the Goertzel Algorithm for each sample in a buffer
 	  \param goertzel_state the goertzel state to step the samples through
@@ -262,6 +295,45 @@ TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_
 								  int16_t sample_buffer[],
 								  int samples);
 
+	/*! 
+	  \brief Initialize an empty Goertzel filter bank
+	  \param bank the bank to initialize
+	*/
+TELETONE_API(void) teletone_goertzel_bank_init(teletone_goertzel_bank_t *bank);
+
+	/*! 
+	  \brief Add a frequency bin to a Goertzel filter bank
+	  \param bank the bank to add the bin to
+	  \param freq the frequency of the bin in Hz
+	  \param sample_rate the sample rate of the audio the bank will see
+	  \return the index of the new bin or -1 when the bank is full
+	*/
+TELETONE_API(int) teletone_goertzel_bank_add(teletone_goertzel_bank_t *bank, float freq, int sample_rate);
+
+	/*! 
+	  \brief Clear the accumulated state of every bin in a Goertzel filter bank
+	  \param bank the bank to reset
+	*/
+TELETONE_API(void) teletone_goertzel_bank_reset(teletone_goertzel_bank_t *bank);
+
+	/*! 
+	  \brief Step every bin of a Goertzel filter bank through a sample buffer in a single pass
+	  \param bank the bank to step the samples through
+	  \param sample_buffer an array of 16 bit signed linear samples
+	  \param samples the number of samples present in sample_buffer
+	*/
+TELETONE_API(void) teletone_goertzel_bank_update(teletone_goertzel_bank_t *bank,
+									   int16_t sample_buffer[],
+									   int samples);
+
+	/*! 
+	  \brief Retrieve the energy accumulated in one bin of a Goertzel filter bank
+	  \param bank the bank to check
+	  \param bin the index of the bin
+	  \return the energy of the bin
+	*/
+TELETONE_API(double) teletone_goertzel_bank_result(teletone_goertzel_bank_t *bank, int bin);
+
 
 
 #ifdef __cplusplus
@@ -471,6 +471,39 @@ srtp_err_status_t srtp_protect_mki(srtp_ctx_t *ctx,
                                    unsigned int use_mki,
                                    unsigned int mki_index);
 
+/**
+ * @brief srtp_protect_batch() applies srtp_protect_mki() to a batch of
+ * RTP packets that belong to the same SRTP session.
+ *
+ * This is a convenience loop over srtp_protect_mki(); each packet is
+ * processed on its own and costs the same as a single call.  Packets
+ * that share an ssrc find their stream through the session's stream
+ * cache either way.
+ *
+ * @param ctx is the SRTP context to use in processing the packets.
+ *
+ * @param rtp_hdr is an array of count pointers to the RTP packets; each
+ * must have room for the trailer as described for srtp_protect().
+ *
+ * @param pkt_octet_len is an array of count packet lengths, updated in
+ * place as srtp_protect() updates its length argument.
+ *
+ * @param status is an array of count results, one per packet.
+ *
+ * @param count is the number of packets in the batch.
+ *
+ * @param use_mki and mki_index are passed to srtp_protect_mki().
+ *
+ * @return the number of packets for which srtp_err_status_ok was returned.
+ */
+int srtp_protect_batch(srtp_ctx_t *ctx,
+                       void *rtp_hdr[],
+                       int pkt_octet_len[],
+                       srtp_err_status_t status[],
+                       int count,
+                       unsigned int use_mki,
+                       unsigned int mki_index);
+
 /**
  * @brief srtp_unprotect() is the Secure RTP receiver-side packet
  * processing function.
@@ -564,6 +597,37 @@ srtp_err_status_t srtp_unprotect_mki(srtp_t ctx,
                                      int *len_ptr,
                                      unsigned int use_mki);
 
+/**
+ * @brief srtp_unprotect_batch() applies srtp_unprotect_mki() to a batch
+ * of SRTP packets that belong to the same SRTP session.
+ *
+ * This is the receiver-side counterpart of srtp_protect_batch(), a
+ * convenience loop over srtp_unprotect_mki().  A failure on one packet
+ * does not stop the rest of the batch from being processed; check
+ * status[i] before using packet i.
+ *
+ * @param ctx is the SRTP session which applies to the packets.
+ *
+ * @param srtp_hdr is an array of count pointers to the SRTP packets.
+ *
+ * @param pkt_octet_len is an array of count packet lengths, updated in
+ * place as srtp_unprotect() updates its length argument.
+ *
+ * @param status is an array of count results, one per packet.
+ *
+ * @param count is the number of packets in the batch.
+ *
+ * @param use_mki is passed to srtp_unprotect_mki().
+ *
+ * @return the number of packets for which srtp_err_status_ok was returned.
+ */
+int srtp_unprotect_batch(srtp_t ctx,
+                         void *srtp_hdr[],
+                         int pkt_octet_len[],
+                         srtp_err_status_t status[],
+                         int count,
+                         unsigned int use_mki);
+
 /**
  * @brief srtp_create() allocates and initializes an SRTP session.
 
@@ -159,6 +159,7 @@ typedef struct srtp_stream_ctx_t_ {
  */
 typedef struct srtp_ctx_t_ {
     struct srtp_stream_ctx_t_ *stream_list;     /* linked list of streams     */
+    struct srtp_stream_ctx_t_ *stream_cache;    /* last stream looked up      */
     struct srtp_stream_ctx_t_ *stream_template; /* act as template for other  */
                                                 /* streams                    */
     void *user_data;                            /* user custom data           */
@@ -2359,6 +2359,26 @@ srtp_err_status_t srtp_protect_mki(srtp_ctx_t *ctx,
     return srtp_err_status_ok;
 }
 
+int srtp_protect_batch(srtp_ctx_t *ctx,
+                       void *rtp_hdr[],
+                       int pkt_octet_len[],
+                       srtp_err_status_t status[],
+                       int count,
+                       unsigned int use_mki,
+                       unsigned int mki_index)
+{
+    int i, ok = 0;
+
+    for (i = 0; i < count; i++) {
+        status[i] = srtp_protect_mki(ctx, rtp_hdr[i], &pkt_octet_len[i],
+                                     use_mki, mki_index);
+        if (status[i] == srtp_err_status_ok)
+            ok++;
+    }
+
+    return ok;
+}
+
 srtp_err_status_t srtp_unprotect(srtp_ctx_t *ctx,
                                  void *srtp_hdr,
                                  int *pkt_octet_len)
@@ -2720,6 +2740,25 @@ srtp_err_status_t srtp_unprotect_mki(srtp_ctx_t *ctx,
     return srtp_err_status_ok;
 }
 
+int srtp_unprotect_batch(srtp_ctx_t *ctx,
+                         void *srtp_hdr[],
+                         int pkt_octet_len[],
+                         srtp_err_status_t status[],
+                         int count,
+                         unsigned int use_mki)
+{
+    int i, ok = 0;
+
+    for (i = 0; i < count; i++) {
+        status[i] =
+            srtp_unprotect_mki(ctx, srtp_hdr[i], &pkt_octet_len[i], use_mki);
+        if (status[i] == srtp_err_status_ok)
+            ok++;
+    }
+
+    return ok;
+}
+
 srtp_err_status_t srtp_init()
 {
     srtp_err_status_t status;
@@ -2781,11 +2820,18 @@ srtp_stream_ctx_t *srtp_get_stream(srtp_t srtp, uint32_t ssrc)
 {
     srtp_stream_ctx_t *stream;
 
+    /* packets for one session almost always carry the same ssrc */
+    stream = srtp->stream_cache;
+    if (stream != NULL && stream->ssrc == ssrc)
+        return stream;
+
     /* walk down list until ssrc is found */
     stream = srtp->stream_list;
     while (stream != NULL) {
-        if (stream->ssrc == ssrc)
+        if (stream->ssrc == ssrc) {
+            srtp->stream_cache = stream;
             return stream;
+        }
         stream = stream->next;
     }
 
@@ -2910,6 +2956,7 @@ srtp_err_status_t srtp_create(srtp_t *session, /* handle for session     */
      */
     ctx->stream_template = NULL;
     ctx->stream_list = NULL;
+    ctx->stream_cache = NULL;
     ctx->user_data = NULL;
     while (policy != NULL) {
         stat = srtp_add_stream(ctx, policy);
@@ -2952,6 +2999,9 @@ srtp_err_status_t srtp_remove_stream(srtp_t session, uint32_t ssrc)
     else
         last_stream->next = stream->next;
 
+    if (session->stream_cache == stream)
+        session->stream_cache = NULL;
+
     /* deallocate the stream */
     status = srtp_stream_dealloc(stream, session->stream_template);
     if (status)
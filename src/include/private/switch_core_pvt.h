@@ -137,6 +137,7 @@ struct switch_core_session {
 	switch_mutex_t *video_codec_read_mutex;
 	switch_mutex_t *video_codec_write_mutex;
 	switch_thread_cond_t *cond;
+	switch_time_t wake_time;
 	switch_mutex_t *frame_read_mutex;
 
 	switch_thread_rwlock_t *rwlock;
@@ -189,6 +190,9 @@ struct switch_core_session {
 
 	switch_media_handle_t *media_handle;
 	uint32_t decoder_errors;
+	/* last metadata written to the recovery table, guarded by recovery_mutex */
+	char *recovery_metadata;
+	switch_mutex_t *recovery_mutex;
 	switch_core_video_thread_callback_func_t video_read_callback;
 	void *video_read_user_data;
 	switch_core_video_thread_callback_func_t text_read_callback;
@@ -311,6 +315,11 @@ struct switch_runtime {
 	char *core_db_post_trans_execute;
 	char *core_db_inner_pre_trans_execute;
 	char *core_db_inner_post_trans_execute;
+	uint32_t core_db_writers;
+	uint32_t recovery_threads;
+	int memory_accounting;
+	uint32_t core_db_queue_len;
+	int core_db_queue_drop;
 	int events_use_dispatch;
 	uint32_t port_alloc_flags;
 	char *event_channel_key_separator;
@@ -330,6 +339,9 @@ struct switch_session_manager {
 	switch_thread_cond_t *cond;
 	int running;
 	int busy;
+	uint32_t wakes;
+	switch_time_t wake_latency_total;
+	switch_time_t wake_latency_max;
 };
 
 extern struct switch_session_manager session_manager;
@@ -341,7 +353,10 @@ void switch_core_sqldb_destroy();
 switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_t manage);
 void switch_core_sqldb_stop(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
+void switch_core_session_account_wake(switch_core_session_t *session);
 void switch_core_session_uninit(void);
+void switch_core_prompt_cache_init(switch_memory_pool_t *pool);
+void switch_core_prompt_cache_uninit(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
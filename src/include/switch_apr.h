@@ -424,6 +424,16 @@ SWITCH_DECLARE(void) switch_atomic_inc(volatile switch_atomic_t *mem);
  */
 SWITCH_DECLARE(int)  switch_atomic_dec(volatile switch_atomic_t *mem);
 
+/**
+ * Compare the pointer's value with cmp. If they are the same swap the value
+ * with 'with'. Acts as a full memory barrier.
+ * @param mem The pointer to swap.
+ * @param with What to swap it with.
+ * @param cmp The value to compare it to.
+ * @return The old value of the pointer.
+ */
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp);
+
 /** @} */
 
 /**
@@ -1329,6 +1339,11 @@ SWITCH_DECLARE(switch_status_t) switch_mcast_interface(switch_socket_t *sock, sw
 #define SWITCH_POLLHUP 0x020			/**< Hangup occurred */
 #define SWITCH_POLLNVAL 0x040		/**< Descriptior invalid */
 
+/**
+ * Pollset options
+ */
+#define SWITCH_POLLSET_THREADSAFE 0x001	/**< Adding and removing descriptors is safe while another thread polls */
+
 /**
  * Setup a pollset object
  * @param pollset  The pointer in which to return the newly created object
@@ -675,6 +675,20 @@ SWITCH_DECLARE(void) switch_channel_perform_set_callstate(switch_channel_t *chan
 														  const char *file, const char *func, int line);
 #define switch_channel_set_callstate(channel, state) switch_channel_perform_set_callstate(channel, state, __FILE__, __SWITCH_FUNC__, __LINE__)
 SWITCH_DECLARE(switch_channel_callstate_t) switch_channel_get_callstate(switch_channel_t *channel);
+
+/*! \brief Signalled with seq incremented whenever a watched channel changes state or call state */
+typedef struct switch_state_notify_s {
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	uint32_t seq;
+} switch_state_notify_t;
+
+/*!
+  \brief Wake a waiter whenever the channel's running state or call state changes or it hangs up
+  \param channel the channel to watch
+  \param notify the notifier to signal, NULL to stop; it must stay valid until it is removed
+*/
+SWITCH_DECLARE(void) switch_channel_set_state_notify(switch_channel_t *channel, switch_state_notify_t *notify);
 SWITCH_DECLARE(const char *) switch_channel_callstate2str(switch_channel_callstate_t callstate);
 SWITCH_DECLARE(switch_channel_callstate_t) switch_channel_str2callstate(const char *str);
 SWITCH_DECLARE(void) switch_channel_mark_hold(switch_channel_t *channel, switch_bool_t on);
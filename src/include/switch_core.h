@@ -1263,6 +1263,14 @@ SWITCH_DECLARE(uint32_t) switch_core_session_event_count(_In_ switch_core_sessio
  */
 SWITCH_DECLARE(uint32_t) switch_core_session_messages_waiting(switch_core_session_t *session);
 
+/*!
+  \brief Report how long sleeping session threads took to run after being woken for queued work
+  \param wakes the number of wakeups measured
+  \param avg the average latency in microseconds
+  \param max the longest latency in microseconds
+*/
+SWITCH_DECLARE(void) switch_core_session_wake_stats(uint32_t *wakes, switch_time_t *avg, switch_time_t *max);
+
 /*!
   \brief DE-Queue an event on a given session
   \param session the session to de-queue the message on
@@ -1321,6 +1329,24 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_read_frame(_In_ switch_core_
 SWITCH_DECLARE(switch_bool_t) switch_core_session_transcoding(switch_core_session_t *session_a, switch_core_session_t *session_b, switch_media_type_t type);
 SWITCH_DECLARE(void) switch_core_session_passthru(switch_core_session_t *session, switch_media_type_t type, switch_bool_t on);
 
+/*!
+  \brief Relay audio RTP from one session straight to another without running either session's read and write path
+  \param session the session to read audio from
+  \param peer_session the session to send it out of
+  \return SWITCH_STATUS_SUCCESS if the relay is running
+  \note The bridge uses it when bridge_rtp_relay=true is set on the a-leg: plain audio between two answered legs
+        sharing one codec, with or without SDES-SRTP. It is refused while either session is transcoding, has media
+        bugs or frame hooks, uses ICE, DTLS or ZRTP, or has a media timeout or RTCP enabled.
+        Anything enabled mid-call that needs the read path (a media bug, DTMF, RTCP, a media timeout, hold, a new key)
+        suspends it. The packets it already read are sent first and the rest stay queued on the socket for the
+        session's read path, so falling back drops nothing.
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_media_relay_start(switch_core_session_t *session, switch_core_session_t *peer_session);
+SWITCH_DECLARE(void) switch_core_media_relay_stop(switch_core_session_t *session);
+SWITCH_DECLARE(void) switch_core_media_relay_suspend(switch_core_session_t *session);
+SWITCH_DECLARE(switch_bool_t) switch_core_media_relay_running(switch_core_session_t *session);
+SWITCH_DECLARE(switch_status_t) switch_core_media_relay_wait(switch_core_session_t *session, uint32_t ms);
+
 /*!
   \brief Read a video frame from a session
   \param session the session to read from
@@ -1985,6 +2011,35 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 SWITCH_DECLARE(switch_status_t) switch_core_file_truncate(switch_file_handle_t *fh, int64_t offset);
 SWITCH_DECLARE(switch_bool_t) switch_core_file_has_video(switch_file_handle_t *fh, switch_bool_t CHECK_OPEN);
 
+/*!
+  \brief Set the size of the shared prompt cache
+  \param bytes the maximum amount of decoded audio to keep in memory (0 to disable)
+  \note read-only opens of local files are served from the cache once it is enabled
+*/
+SWITCH_DECLARE(void) switch_core_prompt_cache_set_size(switch_size_t bytes);
+
+/*!
+  \brief Decode a file into the prompt cache ahead of playback
+  \param file_path the full path to the file as it will be played
+  \param rate the sample rate to cache the file at
+  \param channels the number of channels to cache the file at
+  \return SWITCH_STATUS_SUCCESS if the file is cached
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_prompt_cache_preload(const char *file_path, uint32_t rate, uint32_t channels);
+
+/*!
+  \brief Remove files from the prompt cache
+  \param file_path the full path to remove (NULL for all)
+  \return the number of cache entries removed
+*/
+SWITCH_DECLARE(uint32_t) switch_core_prompt_cache_flush(const char *file_path);
+
+/*!
+  \brief Write the prompt cache statistics to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_core_prompt_cache_stats(switch_stream_handle_t *stream);
+
 
 ///\}
 
@@ -2479,6 +2534,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_chat_deliver(const char *dest_proto,
 SWITCH_DECLARE(switch_status_t) switch_ivr_preprocess_session(switch_core_session_t *session, const char *cmds);
 SWITCH_DECLARE(void) switch_core_sqldb_pause(void);
 SWITCH_DECLARE(void) switch_core_sqldb_resume(void);
+/*!
+  \brief The queue manager writing the core db (channels, calls, tasks ...), NULL when the core db is not managed
+*/
+SWITCH_DECLARE(switch_sql_queue_manager_t *) switch_core_sqldb_queue_manager(void);
 
 
 ///\}
@@ -2535,6 +2594,8 @@ typedef union {
 
 struct switch_cache_db_handle;
 typedef struct switch_cache_db_handle switch_cache_db_handle_t;
+struct switch_cache_db_stmt;
+typedef struct switch_cache_db_stmt switch_cache_db_stmt_t;
 
 static inline const char *switch_cache_db_type_name(switch_cache_db_handle_type_t type)
 {
@@ -2643,6 +2704,43 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_callback_err(switch_
 																	 switch_core_db_err_callback_func_t err_callback,
 																	 void *pdata, char **err);
 
+/*!
+ \brief Prepares a statement with ? placeholders on a handle.
+        Statements are cached on the handle by their sql text so preparing the same sql again is a hash lookup.
+        A statement stays valid for as long as the handle is held, the least recently used statements beyond
+        the cache limit are finalized when the last holder releases the handle.
+        The core db and ODBC keep them prepared on the server, database interfaces with exec_params_detailed (pgsql)
+        bind the values as parameters, the other database interfaces (mariadb) get the bound values quoted into the sql.
+ \param [in] dbh The handle
+ \param [in] sql - sql to prepare
+ \param [out] stmt - the prepared statement
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_prepare(switch_cache_db_handle_t *dbh, const char *sql, switch_cache_db_stmt_t **stmt);
+/*!
+ \brief Binds a value to a placeholder of a prepared statement, idx starts at 1.  A NULL text value binds SQL NULL.
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_text(switch_cache_db_stmt_t *stmt, int idx, const char *value);
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_int(switch_cache_db_stmt_t *stmt, int idx, int64_t value);
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_null(switch_cache_db_stmt_t *stmt, int idx);
+/*!
+ \brief Executes a prepared statement with the current bindings, bindings are kept for the next execution
+ \param [in] stmt The statement
+ \param [in] callback - optional function pointer called for each row
+ \param [in] pdata - data to pass to callback
+ \param [out] err - Error if it exists
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_execute(switch_cache_db_stmt_t *stmt, switch_core_db_callback_func_t callback, void *pdata, char **err);
+/*!
+ \brief Executes one prepared statement for many rows of bindings inside a single transaction
+ \param [in] dbh The handle
+ \param [in] sql - sql with ? placeholders
+ \param [in] values - rows * placeholder count text values, row by row, NULL entries bind SQL NULL
+ \param [in] rows - number of rows in values
+ \param [out] err - Error if it exists
+*/
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_batch(switch_cache_db_handle_t *dbh, const char *sql,
+															  const char **values, uint32_t rows, char **err);
+
 /*!
  \brief Get the affected rows of the last performed query
  \param [in] dbh The handle
@@ -2774,6 +2872,26 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Queue SQL on the writer selected by hashing key, statements sharing a key are written in order
+  \param qm the queue manager
+  \param key the shard key (uuid, table name ...), NULL uses the same writer as switch_sql_queue_manager_push
+  \param sql the statement
+  \param pos the priority queue index
+  \param dup SWITCH_TRUE to copy sql, SWITCH_FALSE to take ownership of it
+  \return SWITCH_STATUS_FALSE if the statement was dropped because the queue is full
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_key(switch_sql_queue_manager_t *qm, const char *key, const char *sql, uint32_t pos, switch_bool_t dup);
+/*!
+  \brief Prepare to queue statements that used from_key under to_key instead
+  \param qm the queue manager
+  \param from_key the key the statements were queued with so far
+  \param to_key the key they will be queued with from now on
+  \return SWITCH_FALSE if the writer of from_key did not catch up in time, the statements are reordered then
+  \note When the keys hash to different writers this waits until everything already queued on from_key's writer
+  has been written, so the next statement queued under to_key cannot overtake them.
+*/
+SWITCH_DECLARE(switch_bool_t) switch_sql_queue_manager_move_key(switch_sql_queue_manager_t *qm, const char *from_key, const char *to_key);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queue_manager_t **qmp);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *name,
 																   switch_sql_queue_manager_t **qmp,
@@ -2785,6 +2903,23 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 
 #define switch_sql_queue_manager_init(_q, _n, _d, _m, _p1, _p2, _ip1, _ip2) switch_sql_queue_manager_init_name(__FILE__, _q, _n, _d, _m, _p1, _p2, _ip1, _ip2)
 
+typedef enum {
+	SWITCH_SQL_QUEUE_POLICY_BLOCK,
+	SWITCH_SQL_QUEUE_POLICY_DROP
+} switch_sql_queue_policy_t;
+
+/*!
+  \brief Configure the writer threads of a queue manager, must be called before switch_sql_queue_manager_start
+  \param qm the queue manager
+  \param writers number of writer threads each with its own db handle and queues
+  \param queue_len maximum statements per queue (0 for the default)
+  \param policy what to do when a queue is full, block the caller or drop the statement
+  \return SWITCH_STATUS_SUCCESS if the writers were configured
+*/
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_set_writers(switch_sql_queue_manager_t *qm, uint32_t writers,
+																	 uint32_t queue_len, switch_sql_queue_policy_t policy);
+SWITCH_DECLARE(void) switch_sql_queue_manager_stats(switch_sql_queue_manager_t *qm, switch_stream_handle_t *stream);
+
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_start(switch_sql_queue_manager_t *qm);
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_stop(switch_sql_queue_manager_t *qm);
 SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_event_callback(switch_cache_db_handle_t *dbh,
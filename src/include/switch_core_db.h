@@ -261,6 +261,13 @@ SWITCH_DECLARE(int) switch_core_db_finalize(switch_core_db_stmt_t *pStmt);
  */
 SWITCH_DECLARE(int) switch_core_db_prepare(switch_core_db_t *db, const char *zSql, int nBytes, switch_core_db_stmt_t **ppStmt, const char **pzTail);
 
+/**
+ * Same as switch_core_db_prepare() but the statement keeps the SQL text, is
+ * recompiled transparently when the schema changes and switch_core_db_step()
+ * returns the specific error code directly.  Use this for long lived statements.
+ */
+SWITCH_DECLARE(int) switch_core_db_prepare_v2(switch_core_db_t *db, const char *zSql, int nBytes, switch_core_db_stmt_t **ppStmt, const char **pzTail);
+
 /**
  * After an SQL query has been compiled with a call to either
  * switch_core_db_prepare(), then this function must be
@@ -400,6 +407,11 @@ SWITCH_DECLARE(int) switch_core_db_bind_text(switch_core_db_stmt_t *pStmt, int i
  */
 SWITCH_DECLARE(int) switch_core_db_bind_double(switch_core_db_stmt_t *pStmt, int i, double dValue);
 
+/**
+ * Bind SQL NULL to a parameter of a prepared statement.
+ */
+SWITCH_DECLARE(int) switch_core_db_bind_null(switch_core_db_stmt_t *pStmt, int i);
+
 /**
  * Each entry in a table has a unique integer key.  (The key is
  * the value of the INTEGER PRIMARY KEY column if there is such a column,
@@ -292,6 +292,18 @@ SWITCH_DECLARE(int) switch_loadable_module_get_codecs(const switch_codec_impleme
 */
 SWITCH_DECLARE(int) switch_loadable_module_get_codecs_sorted(const switch_codec_implementation_t **array, char fmtp_array[SWITCH_MAX_CODECS][MAX_FMTP_LEN], int arraylen, char **prefs, int preflen);
 
+/*!
+  \brief Retrieve the codecs for a comma separated codec string, resolved once and cached until the next codec load or unload
+  \param codec_string the codec string e.g. "PCMU@20i,PCMA@20i"
+  \param array the array to populate
+  \param fmtp_array the fmtp of each element, only set when the codec string has one
+  \param name_mask optional, bit j of element i is set when array[i] and array[j] share an iana name
+  \param arraylen the max size in elements of the array
+  \return the number of elements added to the array
+*/
+SWITCH_DECLARE(int) switch_loadable_module_get_codecs_cached(const char *codec_string, const switch_codec_implementation_t **array,
+															 char fmtp_array[SWITCH_MAX_CODECS][MAX_FMTP_LEN], uint64_t *name_mask, int arraylen);
+
 /*!
   \brief Execute a registered API command
   \param cmd the name of the API command to execute
@@ -383,6 +383,8 @@ struct switch_file_handle {
 	int64_t vpos;
 	void *muxbuf;
 	switch_size_t muxlen;
+	/*! the shared prompt cache entry serving this handle */
+	struct switch_prompt_cache_entry *prompt_cache;
 };
 
 /*! \brief Abstract interface to an asr module */
@@ -633,6 +635,9 @@ struct switch_database_interface {
 	switch_status_t(*callback_exec_detailed)(const char *file, const char *func, int line,
 		switch_database_interface_handle_t *dih, const char *sql, switch_core_db_callback_func_t callback, void *pdata, char **err);
 	switch_status_t(*affected_rows)(switch_database_interface_handle_t *dih, int *affected_rows);
+	/*! optional, executes sql with ? placeholders bound to argv (NULL entries are SQL NULL), callback may be NULL */
+	switch_status_t(*exec_params_detailed)(const char *file, const char *func, int line,
+		switch_database_interface_handle_t *dih, const char *sql, int argc, char **argv, switch_core_db_callback_func_t callback, void *pdata, char **err);
 
 	/*! list of supported dsn prefixes */
 	char **prefixes;
@@ -93,6 +93,32 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(c
 		switch_odbc_handle_callback_exec_detailed(__FILE__, (char * )__SWITCH_FUNC__, __LINE__, \
 												  handle, sql, callback, pdata, err)
 
+/* a statement kept prepared on the server between executions */
+typedef struct {
+	switch_odbc_statement_handle_t stmt;
+	uint32_t generation;
+} switch_odbc_prepared_t;
+
+/*!
+  \brief Execute the sql query with its ? placeholders bound to parameters and issue a callback for each row returned
+  \param handle the ODBC handle
+  \param prepared optional statement kept prepared across calls, it is prepared on first use and after a reconnect
+  \param sql the sql string to execute
+  \param argc the number of placeholders
+  \param argv the text value of each placeholder, NULL binds SQL NULL
+  \param is_int optional array marking the placeholders to bind as integers
+  \param callback the optional callback function to execute
+  \param pdata the state data passed on each callback invocation
+  \return SWITCH_STATUS_SUCCESS if the operation was successful
+*/
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_exec_params(switch_odbc_handle_t *handle, switch_odbc_prepared_t *prepared,
+																	const char *sql, int argc, char **argv,
+																	const switch_bool_t *is_int, switch_core_db_callback_func_t callback,
+																	void *pdata, char **err);
+/*!
+  \brief Free a statement kept prepared by switch_odbc_handle_exec_params
+*/
+SWITCH_DECLARE(void) switch_odbc_prepared_free(switch_odbc_handle_t *handle, switch_odbc_prepared_t *prepared);
 
 SWITCH_DECLARE(char *) switch_odbc_handle_get_error(switch_odbc_handle_t *handle, switch_odbc_statement_handle_t stmt);
 
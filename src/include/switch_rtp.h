@@ -303,6 +303,43 @@ SWITCH_DECLARE(void) switch_rtp_kill_socket(switch_rtp_t *rtp_session);
 SWITCH_DECLARE(void) switch_rtp_break(switch_rtp_t *rtp_session);
 SWITCH_DECLARE(void) switch_rtp_flush(switch_rtp_t *rtp_session);
 
+/*!
+  \brief Forward audio arriving on one RTP session out of another from one of the relay I/O threads
+  \param rtp_session the RTP session to read packets from
+  \param peer_rtp_session the RTP session to write them to
+  \param recv_pt the audio payload type expected on rtp_session
+  \return SWITCH_STATUS_SUCCESS if the relay is running
+  \note Any packet the relay can not forward as-is is handed back to the normal read path and the relay suspends itself.
+*/
+SWITCH_DECLARE(switch_status_t) switch_rtp_relay_start(switch_rtp_t *rtp_session, switch_rtp_t *peer_rtp_session, switch_payload_t recv_pt);
+
+/*!
+  \brief Stop and release the relay reading from an RTP session
+  \param rtp_session the RTP session the relay reads from
+*/
+SWITCH_DECLARE(void) switch_rtp_relay_stop(switch_rtp_t *rtp_session);
+
+/*!
+  \brief Suspend any relay reading from or writing to an RTP session so the normal media path takes over
+  \param rtp_session the RTP session
+*/
+SWITCH_DECLARE(void) switch_rtp_relay_suspend(switch_rtp_t *rtp_session);
+
+/*!
+  \brief Test if the relay reading from an RTP session is forwarding packets
+  \param rtp_session the RTP session
+  \return SWITCH_TRUE while the relay is running
+*/
+SWITCH_DECLARE(switch_bool_t) switch_rtp_relay_running(switch_rtp_t *rtp_session);
+
+/*!
+  \brief Wait for the relay reading from an RTP session to suspend
+  \param rtp_session the RTP session
+  \param ms the longest time to wait in milliseconds
+  \return SWITCH_STATUS_SUCCESS if the relay is still running
+*/
+SWITCH_DECLARE(switch_status_t) switch_rtp_relay_wait(switch_rtp_t *rtp_session, uint32_t ms);
+
 /*!
   \brief Test if an RTP session is ready
   \param rtp_session an RTP session to test
@@ -588,6 +625,19 @@ SWITCH_DECLARE(dtls_state_t) switch_rtp_dtls_state(switch_rtp_t *rtp_session, dt
 
 SWITCH_DECLARE(int) switch_rtp_has_dtls(void);
 
+/*!
+  \brief Set the number of threads DTLS handshakes are run on
+  \param workers the number of worker threads (0 runs handshakes on the media thread)
+  \note takes effect when the first DTLS session starts
+*/
+SWITCH_DECLARE(void) switch_rtp_set_dtls_workers(uint32_t workers);
+
+/*!
+  \brief Write DTLS handshake counters and the handshake latency histogram to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_rtp_dtls_stats(switch_stream_handle_t *stream);
+
 SWITCH_DECLARE(switch_status_t) switch_rtp_req_bitrate(switch_rtp_t *rtp_session, uint32_t bps);
 SWITCH_DECLARE(switch_status_t) switch_rtp_ack_bitrate(switch_rtp_t *rtp_session, uint32_t bps);
 SWITCH_DECLARE(void) switch_rtp_video_refresh(switch_rtp_t *rtp_session);
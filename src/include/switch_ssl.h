@@ -50,6 +50,16 @@
 
 SWITCH_DECLARE(int) switch_core_cert_extract_fingerprint(X509* x509, dtls_fingerprint_t *fp);
 
+/*!
+  \brief Get the shared DTLS-SRTP context for a certificate
+  \param prefix the certificate name in the certs dir (see DTLS_SRTP_FNAME)
+  \param server non-zero for the accepting side of the handshake
+  \param want_DTLSv1_2 non-zero to prefer DTLS 1.2 on OpenSSL builds that pick the version per method
+  \return a referenced SSL_CTX to release with SSL_CTX_free, or NULL if the certificate can't be loaded
+  \note the context is built once and rebuilt when the certificate file changes
+*/
+SWITCH_DECLARE(SSL_CTX *) switch_core_cert_dtls_ctx(const char *prefix, int server, int want_DTLSv1_2);
+
 #else
 static inline int switch_core_cert_extract_fingerprint(void* x509, dtls_fingerprint_t *fp) { return 0; }
 #endif
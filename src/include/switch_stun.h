@@ -240,6 +240,28 @@ SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_binded_address(switch_s
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_xor_binded_address(switch_stun_packet_t *packet, char *ipstr, uint16_t port, int family);
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_integrity(switch_stun_packet_t *packet, const char *pass);
 SWITCH_DECLARE(uint32_t) switch_crc32_8bytes(const void* data, size_t length);
+
+typedef struct switch_stun_hmac_s switch_stun_hmac_t;
+
+/*!
+  \brief Precompute an HMAC-SHA1 key (an ICE password) for repeated signing
+  \param key the key
+  \param pool the memory pool to allocate from
+  \return the key context, valid for the life of the pool
+*/
+SWITCH_DECLARE(switch_stun_hmac_t *) switch_stun_hmac_create(const char *key, switch_memory_pool_t *pool);
+SWITCH_DECLARE(void) switch_stun_hmac_digest(switch_stun_hmac_t *hmac, const void *data, switch_size_t len, uint8_t digest[20]);
+SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_integrity_hmac(switch_stun_packet_t *packet, switch_stun_hmac_t *hmac);
+
+/*!
+  \brief Check the MESSAGE-INTEGRITY attribute of a raw (unparsed) packet
+  \param buf the packet as received
+  \param len the length of the packet
+  \param hmac the key the peer should have signed with
+  \return 1 if it matches, 0 if it does not, -1 if the packet has no integrity attribute; only 1 authenticates the packet
+*/
+SWITCH_DECLARE(int) switch_stun_packet_verify_integrity(const uint8_t *buf, switch_size_t len, switch_stun_hmac_t *hmac);
+
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_fingerprint(switch_stun_packet_t *packet);
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_use_candidate(switch_stun_packet_t *packet);
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_controlling(switch_stun_packet_t *packet);
@@ -1939,7 +1939,8 @@ typedef enum {
 	SWITCH_FILE_BREAK_ON_CHANGE = (1 << 18),
 	SWITCH_FILE_FLAG_VIDEO = (1 << 19),
 	SWITCH_FILE_FLAG_VIDEO_EOF = (1 << 20),
-	SWITCH_FILE_PRE_CLOSED = (1 << 21)
+	SWITCH_FILE_PRE_CLOSED = (1 << 21),
+	SWITCH_FILE_NOCACHE = (1 << 22)
 } switch_file_flag_enum_t;
 typedef uint32_t switch_file_flag_t;
 
@@ -2276,7 +2277,8 @@ typedef enum {
 	SCSC_SPS_PEAK,
 	SCSC_SPS_PEAK_FIVEMIN,
 	SCSC_SESSIONS_PEAK,
-	SCSC_SESSIONS_PEAK_FIVEMIN
+	SCSC_SESSIONS_PEAK_FIVEMIN,
+	SCSC_MEMORY_ACCOUNTING
 } switch_session_ctl_t;
 
 typedef enum {
@@ -1211,6 +1211,23 @@ SWITCH_DECLARE(switch_bool_t) switch_simple_email(const char *to,
 												  const char *body, const char *file, const char *convert_cmd, const char *convert_ext);
 SWITCH_DECLARE(char *) switch_find_end_paren(const char *s, char open, char close);
 
+/*! \brief Called for each spooled file; name is the file name without the suffix, return SWITCH_TRUE once the data is delivered */
+typedef switch_bool_t (*switch_spool_callback_t) (const char *name, char *data, switch_size_t len, void *pdata);
+
+/*!
+  \brief Hand the files in a spool directory to a callback and delete each one it accepts
+  \param dir_path the spool directory
+  \param suffix only files ending in this suffix are read
+  \param max stop after this many files have been accepted
+  \param min_age skip files modified less than this many seconds ago, they may still be being written
+  \param callback the delivery callback
+  \param pdata user data for the callback
+  \param failed set to SWITCH_TRUE when the callback refused a file, the walk stops there
+  \return the number of files accepted and removed
+*/
+SWITCH_DECLARE(uint32_t) switch_spool_replay(const char *dir_path, const char *suffix, uint32_t max, uint32_t min_age,
+											 switch_spool_callback_t callback, void *pdata, switch_bool_t *failed);
+
 static inline void switch_separate_file_params(const char *file, char **file_portion, char **params_portion)
 {
 	char *e = NULL;
@@ -1440,6 +1457,8 @@ SWITCH_DECLARE(switch_status_t) switch_frame_buffer_trypush(switch_frame_buffer_
 SWITCH_DECLARE(switch_status_t) switch_frame_buffer_pop(switch_frame_buffer_t *fb, void **ptr);
 SWITCH_DECLARE(switch_status_t) switch_frame_buffer_trypop(switch_frame_buffer_t *fb, void **ptr);
 SWITCH_DECLARE(int) switch_frame_buffer_size(switch_frame_buffer_t *fb);
+/*! \brief Write the node and image reuse counters of all frame buffers, per frame kind, to a stream */
+SWITCH_DECLARE(void) switch_frame_buffer_stats(switch_stream_handle_t *stream);
 								
 typedef struct {
 	int64_t userms;
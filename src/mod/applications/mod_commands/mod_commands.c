@@ -691,6 +691,63 @@ SWITCH_STANDARD_API(pool_stats_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define PROMPT_CACHE_SYNTAX "stats|flush [<file>]|preload <file> [<rate>] [<channels>]"
+SWITCH_STANDARD_API(prompt_cache_function)
+{
+	int argc;
+	char *mydata = NULL, *argv[4];
+	char *path = NULL;
+
+	if (zstr(cmd)) {
+		goto error;
+	}
+
+	mydata = strdup(cmd);
+	switch_assert(mydata);
+
+	argc = switch_separate_string(mydata, ' ', argv, (sizeof(argv) / sizeof(argv[0])));
+
+	if (argc > 1) {
+		if (switch_is_file_path(argv[1])) {
+			path = strdup(argv[1]);
+		} else {
+			path = switch_mprintf("%s%s%s", SWITCH_GLOBAL_dirs.sounds_dir, SWITCH_PATH_SEPARATOR, argv[1]);
+		}
+	}
+
+	if (!strcasecmp(argv[0], "stats")) {
+		switch_core_prompt_cache_stats(stream);
+	} else if (!strcasecmp(argv[0], "flush")) {
+		stream->write_function(stream, "+OK %u flushed\n", switch_core_prompt_cache_flush(path));
+	} else if (!strcasecmp(argv[0], "preload") && path) {
+		uint32_t rate = argc > 2 ? atoi(argv[2]) : 8000;
+		uint32_t channels = argc > 3 ? atoi(argv[3]) : 1;
+
+		if (switch_core_prompt_cache_preload(path, rate, channels) == SWITCH_STATUS_SUCCESS) {
+			stream->write_function(stream, "+OK\n");
+		} else {
+			stream->write_function(stream, "-ERR unable to cache %s\n", path);
+		}
+	} else {
+		goto error;
+	}
+
+	goto ok;
+
+  error:
+	stream->write_function(stream, "-USAGE: %s\n", PROMPT_CACHE_SYNTAX);
+  ok:
+	switch_safe_free(path);
+	switch_safe_free(mydata);
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_STANDARD_API(dtls_stats_function)
+{
+	switch_rtp_dtls_stats(stream);
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(db_cache_function)
 {
 	int argc;
@@ -2326,6 +2383,8 @@ SWITCH_STANDARD_API(status_function)
 	char * nl = "\n";					/* shortcut to format.nl	*/
 	stream_format format = { 0 };
 	switch_size_t cur = 0, max = 0;
+	uint32_t wakes = 0;
+	switch_time_t wake_avg = 0, wake_max = 0;
 
 	set_format(&format, stream);
 
@@ -2375,6 +2434,8 @@ SWITCH_STANDARD_API(status_function)
 	stream->write_function(stream, "%d session(s) per Sec out of max %d, peak %d, last 5min %d %s", last_sps, sps, max_sps, max_sps_fivemin, nl);
 	stream->write_function(stream, "%d session(s) max%s", switch_core_session_limit(0), nl);
 	stream->write_function(stream, "min idle cpu %0.2f/%0.2f%s", switch_core_min_idle_cpu(-1.0), switch_core_idle_cpu(), nl);
+	switch_core_session_wake_stats(&wakes, &wake_avg, &wake_max);
+	stream->write_function(stream, "%u session thread wake(s), avg %" SWITCH_TIME_T_FMT "us, max %" SWITCH_TIME_T_FMT "us%s", wakes, wake_avg, wake_max, nl);
 
 	if (switch_core_get_stacksizes(&cur, &max) == SWITCH_STATUS_SUCCESS) {		stream->write_function(stream, "Current Stack Size/Max %ldK/%ldK\n", cur / 1024, max / 1024);
 	}
@@ -2498,6 +2559,15 @@ SWITCH_STANDARD_API(ctl_function)
 			switch_core_session_ctl(SCSC_API_EXPANSION, &arg);
 
 			stream->write_function(stream, "+OK api_expansion is %s \n", arg ? "on" : "off");
+		} else if (!strcasecmp(argv[0], "memory_accounting")) {
+			arg = -1;
+			if (argv[1]) {
+				arg = switch_true(argv[1]);
+			}
+
+			switch_core_session_ctl(SCSC_MEMORY_ACCOUNTING, &arg);
+
+			stream->write_function(stream, "+OK memory_accounting is %s \n", arg ? "on" : "off");
 		} else if (!strcasecmp(argv[0], "threaded_system_exec")) {
 			arg = -1;
 			if (argv[1]) {
@@ -7469,6 +7539,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "console_complete_xml", "", console_complete_xml_function, "<line>");
 	SWITCH_ADD_API(commands_api_interface, "create_uuid", "Create a uuid", uuid_function, UUID_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "db_cache", "Manage db cache", db_cache_function, "status");
+	SWITCH_ADD_API(commands_api_interface, "prompt_cache", "Manage the prompt cache", prompt_cache_function, PROMPT_CACHE_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "dtls_stats", "Show DTLS handshake statistics", dtls_stats_function, "");
 	SWITCH_ADD_API(commands_api_interface, "domain_data", "Find domain data", domain_data_function, "<domain> [var|param|attr] <name>");
 	SWITCH_ADD_API(commands_api_interface, "domain_exists", "Check if a domain exists", domain_exists_function, "<domain>");
 	SWITCH_ADD_API(commands_api_interface, "echo", "Echo", echo_function, "<data>");
@@ -7619,6 +7691,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add complete add");
 	switch_console_set_complete("add complete del");
 	switch_console_set_complete("add db_cache status");
+	switch_console_set_complete("add prompt_cache stats");
+	switch_console_set_complete("add prompt_cache flush");
+	switch_console_set_complete("add prompt_cache preload");
 	switch_console_set_complete("add fsctl debug_level");
 	switch_console_set_complete("add fsctl debug_pool");
 	switch_console_set_complete("add fsctl debug_sql");
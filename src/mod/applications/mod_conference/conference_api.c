@@ -115,11 +115,13 @@ api_command_t conference_api_sub_commands[] = {
 	{"vid-codec-group", (void_fn_t) & conference_api_sub_vid_codec_group, CONF_API_SUB_MEMBER_TARGET, "vid-codec-group", "<member_id|last> [<group>|clear]"},
 	{"vid-res-id", (void_fn_t) & conference_api_sub_vid_res_id, CONF_API_SUB_ARGS_SPLIT, "vid-res-id", "<member_id>|all <val>|clear [force]"},
 	{"vid-role-id", (void_fn_t) & conference_api_sub_vid_role_id, CONF_API_SUB_MEMBER_TARGET, "vid-role-id", "<member_id|last> <val>|clear"},
+	{"vid-source", (void_fn_t) & conference_api_sub_vid_source, CONF_API_SUB_MEMBER_TARGET, "vid-source", "<member_id|last> [<source_member_id>|floor]"},
 	{"get-uuid", (void_fn_t) & conference_api_sub_get_uuid, CONF_API_SUB_MEMBER_TARGET, "get-uuid", "<member_id|last>"},
 	{"clear-vid-floor", (void_fn_t) & conference_api_sub_clear_vid_floor, CONF_API_SUB_ARGS_AS_ONE, "clear-vid-floor", ""},
 	{"vid-layout", (void_fn_t) & conference_api_sub_vid_layout, CONF_API_SUB_ARGS_SPLIT, "vid-layout", "<layout name>|group <group name> [<canvas id>]"},
 	{"vid-write-png", (void_fn_t) & conference_api_sub_write_png, CONF_API_SUB_ARGS_SPLIT, "vid-write-png", "<path>"},
 	{"vid-fps", (void_fn_t) & conference_api_sub_vid_fps, CONF_API_SUB_ARGS_SPLIT, "vid-fps", "<fps>"},
+	{"vid-stats", (void_fn_t) & conference_api_sub_vid_stats, CONF_API_SUB_ARGS_SPLIT, "vid-stats", ""},
 	{"vid-res", (void_fn_t) & conference_api_sub_vid_res, CONF_API_SUB_ARGS_SPLIT, "vid-res", "<WxH>"},
 	{"vid-fgimg", (void_fn_t) & conference_api_sub_canvas_fgimg, CONF_API_SUB_ARGS_SPLIT, "vid-fgimg", "<file> | clear [<canvas-id>]"},
 	{"vid-bgimg", (void_fn_t) & conference_api_sub_canvas_bgimg, CONF_API_SUB_ARGS_SPLIT, "vid-bgimg", "<file> | clear [<canvas-id>]"},
@@ -1967,6 +1969,48 @@ switch_status_t conference_api_sub_vid_fps(conference_obj_t *conference, switch_
 
 }
 
+static void conference_api_write_stage_stats(switch_stream_handle_t *stream, const char *name, video_stage_stats_t *stats)
+{
+	stream->write_function(stream, "  %-16s last: %6" SWITCH_TIME_T_FMT "us avg: %6" SWITCH_TIME_T_FMT "us max: %6" SWITCH_TIME_T_FMT "us frames: %u\n",
+						   name, stats->last, stats->count ? stats->total / stats->count : 0, stats->max, stats->count);
+}
+
+switch_status_t conference_api_sub_vid_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
+{
+	int i, j;
+
+	if (!conference->canvases[0]) {
+		stream->write_function(stream, "-ERR Conference is not in mixing mode\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_mutex_lock(conference->canvas_mutex);
+	for (i = 0; i <= conference->canvas_count; i++) {
+		mcu_canvas_t *canvas = conference->canvases[i];
+
+		if (!canvas) continue;
+
+		stream->write_function(stream, "Canvas %d (%dx%d) layers: %d\n", i + 1, canvas->width, canvas->height, canvas->layers_used);
+		conference_api_write_stage_stats(stream, "patch", &canvas->patch_stats);
+		conference_api_write_stage_stats(stream, "encode", &canvas->encode_stats);
+
+		for (j = 0; j < MAX_MUX_CODECS && canvas->write_codecs[j]; j++) {
+			codec_set_t *codec_set = canvas->write_codecs[j];
+			char name[64];
+
+			if (!switch_core_codec_ready(&codec_set->codec)) continue;
+
+			switch_snprintf(name, sizeof(name), "encode[%s%s%s]%s", codec_set->codec.implementation->iananame,
+							codec_set->video_codec_group ? "/" : "", switch_str_nil(codec_set->video_codec_group),
+							codec_set->encode_thread ? "*" : "");
+			conference_api_write_stage_stats(stream, name, &codec_set->encode_stats);
+		}
+	}
+	switch_mutex_unlock(conference->canvas_mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 switch_status_t conference_api_sub_write_png(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
@@ -2477,6 +2521,67 @@ switch_status_t conference_api_sub_vid_codec_group(conference_member_t *member,
 
 }
 
+switch_status_t conference_api_sub_vid_source(conference_member_t *member, switch_stream_handle_t *stream, void *data)
+{
+	char *text = (char *) data;
+	conference_obj_t *conference;
+	conference_member_t *source = NULL;
+	uint32_t source_id = 0;
+
+	if (member == NULL)
+		return SWITCH_STATUS_GENERR;
+
+	if (!switch_channel_test_flag(member->channel, CF_VIDEO)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	conference = member->conference;
+
+	if (zstr(text)) {
+		if (member->video_source_id) {
+			stream->write_function(stream, "+OK Video source is member %u\n", member->video_source_id);
+		} else {
+			stream->write_function(stream, "+OK Video source is floor\n");
+		}
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (conference_utils_test_flag(conference, CFLAG_VIDEO_MUXING)) {
+		stream->write_function(stream, "-ERR Conference is in mixing mode\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (strcasecmp(text, "floor") && strcasecmp(text, "clear")) {
+		source_id = atoi(text);
+
+		if (!source_id || source_id == member->id || !(source = conference_member_get(conference, source_id))) {
+			stream->write_function(stream, "-ERR Invalid source member %s\n", text);
+			return SWITCH_STATUS_SUCCESS;
+		}
+	}
+
+	switch_mutex_lock(conference->member_mutex);
+	if (member->video_source_id && !source_id) {
+		conference->video_source_pins--;
+	} else if (!member->video_source_id && source_id) {
+		conference->video_source_pins++;
+	}
+	member->video_source_id = source_id;
+	switch_mutex_unlock(conference->member_mutex);
+
+	if (source) {
+		if (source->session) {
+			switch_core_session_request_video_refresh(source->session);
+		}
+		switch_thread_rwlock_unlock(source->rwlock);
+		stream->write_function(stream, "+OK Video source set to member %u\n", source_id);
+	} else {
+		stream->write_function(stream, "+OK Video source set to floor\n");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 switch_status_t conference_api_sub_get_uuid(conference_member_t *member, switch_stream_handle_t *stream, void *data)
 {
 	if (member->session) {
@@ -1233,6 +1233,21 @@ switch_status_t conference_member_del(conference_obj_t *conference, conference_m
 		last = imember;
 	}
 
+	if (conference->video_source_pins) {
+		if (member->video_source_id) {
+			member->video_source_id = 0;
+			conference->video_source_pins--;
+		}
+
+		/* anyone forwarded this member's video goes back to following the floor */
+		for (imember = conference->members; imember; imember = imember->next) {
+			if (imember->video_source_id == member->id) {
+				imember->video_source_id = 0;
+				conference->video_source_pins--;
+			}
+		}
+	}
+
 	switch_mutex_lock(member->flag_mutex);
 	switch_img_free(&member->avatar_png_img);
 	switch_img_free(&member->video_mute_img);
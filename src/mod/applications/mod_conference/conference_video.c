@@ -1866,6 +1866,7 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 	switch_frame_t write_frame = { 0 }, *frame = NULL;
 	switch_status_t encode_status = SWITCH_STATUS_FALSE;
 	switch_image_t *scaled_img = codec_set->scaled_img;
+	switch_time_t start;
 
 	write_frame = codec_set->frame;
 	frame = &write_frame;
@@ -1893,8 +1894,11 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 			return;
 		}
 
+		start = switch_micro_time_now();
 		switch_img_scale(frame->img, &scaled_img, scaled_img->d_w, scaled_img->d_h);
 		frame->img = scaled_img;
+	} else {
+		start = switch_micro_time_now();
 	}
 
 	do {
@@ -1979,6 +1983,187 @@ void conference_video_write_canvas_image_to_codec_group(conference_obj_t *confer
 		}
 
 	} while(encode_status == SWITCH_STATUS_MORE_DATA);
+
+	conference_video_stage_stats_add(&codec_set->encode_stats, switch_micro_time_now() - start);
+}
+
+void conference_video_stage_stats_add(video_stage_stats_t *stats, switch_time_t usec)
+{
+	stats->last = usec;
+	stats->total += usec;
+	stats->count++;
+
+	if (usec > stats->max) {
+		stats->max = usec;
+	}
+}
+
+/* how long the canvas thread waits on its codec group encoders before logging that one is stuck */
+#define CODEC_GROUP_WAIT_TIMEOUT 500000
+
+static void codec_group_done(mcu_canvas_t *canvas)
+{
+	switch_mutex_lock(canvas->encode_done_mutex);
+	if (--canvas->encode_busy <= 0) {
+		canvas->encode_busy = 0;
+		switch_thread_cond_signal(canvas->encode_done_cond);
+	}
+	switch_mutex_unlock(canvas->encode_done_mutex);
+}
+
+void *SWITCH_THREAD_FUNC conference_video_codec_group_thread_run(switch_thread_t *thread, void *obj)
+{
+	codec_set_t *codec_set = (codec_set_t *) obj;
+	mcu_canvas_t *canvas = codec_set->canvas;
+
+	switch_mutex_lock(codec_set->encode_cond_mutex);
+
+	while(codec_set->encode_thread_running) {
+		while (codec_set->encode_thread_running && !codec_set->encode_pending) {
+			switch_thread_cond_wait(codec_set->encode_cond, codec_set->encode_cond_mutex);
+		}
+
+		if (!codec_set->encode_thread_running) {
+			break;
+		}
+
+		conference_video_write_canvas_image_to_codec_group(canvas->conference, canvas, codec_set, codec_set->codec_index,
+														   codec_set->encode_timestamp, codec_set->encode_need_refresh,
+														   codec_set->encode_send_keyframe, codec_set->encode_need_reset);
+		codec_set->encode_pending = 0;
+		codec_group_done(canvas);
+	}
+
+	if (codec_set->encode_pending) {
+		codec_set->encode_pending = 0;
+		codec_group_done(canvas);
+	}
+
+	switch_mutex_unlock(codec_set->encode_cond_mutex);
+
+	return NULL;
+}
+
+/* Hand the current canvas to a group's encoder thread, the canvas thread collects it in wait_for_codec_groups() */
+static void dispatch_codec_group(mcu_canvas_t *canvas, codec_set_t *codec_set)
+{
+	switch_mutex_lock(canvas->encode_done_mutex);
+	canvas->encode_busy++;
+	switch_mutex_unlock(canvas->encode_done_mutex);
+
+	switch_mutex_lock(codec_set->encode_cond_mutex);
+	codec_set->encode_pending = 1;
+	switch_thread_cond_signal(codec_set->encode_cond);
+	switch_mutex_unlock(codec_set->encode_cond_mutex);
+}
+
+static switch_bool_t launch_codec_group_thread(mcu_canvas_t *canvas, codec_set_t *codec_set, int codec_index)
+{
+	switch_threadattr_t *thd_attr = NULL;
+
+	if (codec_set->encode_thread) {
+		return SWITCH_TRUE;
+	}
+
+	codec_set->canvas = canvas;
+	codec_set->codec_index = codec_index;
+
+	if (!canvas->encode_done_cond) {
+		switch_thread_cond_create(&canvas->encode_done_cond, canvas->pool);
+		switch_mutex_init(&canvas->encode_done_mutex, SWITCH_MUTEX_NESTED, canvas->pool);
+	}
+
+	if (!codec_set->encode_cond) {
+		switch_thread_cond_create(&codec_set->encode_cond, canvas->pool);
+		switch_mutex_init(&codec_set->encode_cond_mutex, SWITCH_MUTEX_NESTED, canvas->pool);
+	}
+
+	codec_set->encode_thread_running = 1;
+	switch_threadattr_create(&thd_attr, canvas->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	if (switch_thread_create(&codec_set->encode_thread, thd_attr, conference_video_codec_group_thread_run, codec_set, canvas->pool) != SWITCH_STATUS_SUCCESS) {
+		codec_set->encode_thread_running = 0;
+		codec_set->encode_thread = NULL;
+		return SWITCH_FALSE;
+	}
+
+	return SWITCH_TRUE;
+}
+
+static void stop_codec_group_threads(mcu_canvas_t *canvas)
+{
+	int i;
+
+	for (i = 0; i < MAX_MUX_CODECS; i++) {
+		codec_set_t *codec_set = canvas->write_codecs[i];
+		switch_status_t st;
+
+		if (!codec_set || !codec_set->encode_thread) {
+			continue;
+		}
+
+		codec_set->encode_thread_running = 0;
+		switch_mutex_lock(codec_set->encode_cond_mutex);
+		switch_thread_cond_signal(codec_set->encode_cond);
+		switch_mutex_unlock(codec_set->encode_cond_mutex);
+		switch_thread_join(&st, codec_set->encode_thread);
+		codec_set->encode_thread = NULL;
+	}
+}
+
+/* Block until every dispatched group has encoded the canvas. The groups still read the canvas image, so there
+   is nothing to give up on; the timeout only makes a stuck encoder show up in the log. */
+static void wait_for_codec_groups(mcu_canvas_t *canvas)
+{
+	if (!canvas->encode_done_mutex) {
+		return;
+	}
+
+	switch_mutex_lock(canvas->encode_done_mutex);
+
+	while (canvas->encode_busy > 0) {
+		if (switch_thread_cond_timedwait(canvas->encode_done_cond, canvas->encode_done_mutex, CODEC_GROUP_WAIT_TIMEOUT) == SWITCH_STATUS_TIMEOUT) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Canvas %d still waiting on %d codec group encoder(s)\n",
+							  canvas->canvas_id, canvas->encode_busy);
+		}
+	}
+
+	switch_mutex_unlock(canvas->encode_done_mutex);
+}
+
+/* Encode the finished canvas once per codec group.  With more than one group and enough cores each group
+   gets its own encoder thread; they all read the same canvas image, which is not touched again until every
+   group is done with it. */
+static void write_canvas_image_to_codec_groups(conference_obj_t *conference, mcu_canvas_t *canvas, switch_image_t *write_img,
+											   uint32_t timestamp, switch_bool_t need_refresh,
+											   switch_bool_t send_keyframe, switch_bool_t need_reset)
+{
+	int i;
+	int parallel = canvas->write_codecs_count > 1 && switch_core_cpu_count() > 2;
+	switch_time_t start = switch_micro_time_now();
+
+	for (i = 0; i < MAX_MUX_CODECS && canvas->write_codecs[i] && switch_core_codec_ready(&canvas->write_codecs[i]->codec); i++) {
+		codec_set_t *codec_set = canvas->write_codecs[i];
+
+		codec_set->frame.img = write_img;
+
+		if (parallel && launch_codec_group_thread(canvas, codec_set, i)) {
+			codec_set->encode_timestamp = timestamp;
+			codec_set->encode_need_refresh = need_refresh;
+			codec_set->encode_send_keyframe = send_keyframe;
+			codec_set->encode_need_reset = need_reset;
+			dispatch_codec_group(canvas, codec_set);
+		} else {
+			conference_video_write_canvas_image_to_codec_group(conference, canvas, codec_set, i, timestamp, need_refresh, send_keyframe, need_reset);
+		}
+	}
+
+	if (parallel) {
+		wait_for_codec_groups(canvas);
+	}
+
+	conference_video_stage_stats_add(&canvas->encode_stats, switch_micro_time_now() - start);
 }
 
 video_layout_t *conference_video_find_best_layout(conference_obj_t *conference, layout_group_t *lg, uint32_t count, uint32_t file_count)
@@ -3161,6 +3346,7 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 		switch_frame_t file_frame = { 0 };
 		int j = 0, personal = conference_utils_test_flag(conference, CFLAG_PERSONAL_CANVAS) ? 1 : 0;
 		int video_count = 0;
+		switch_time_t patch_start = 0, patch_usec = 0;
 
 		if (!personal) {
 			if (canvas->new_vlayout && switch_mutex_trylock(conference->canvas_mutex) == SWITCH_STATUS_SUCCESS) {
@@ -3998,6 +4184,8 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 			switch_mutex_unlock(conference->file_mutex);
 
 			if (!canvas->playing_video_file) {
+				patch_start = switch_micro_time_now();
+
 				for (i = 0; i < canvas->total_layers; i++) {
 					mcu_layer_t *layer = &canvas->layers[i];
 
@@ -4018,7 +4206,10 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 					}
 				}
 
+				/* time spent blocked on patching, the timer sleep does not count */
+				patch_usec = switch_micro_time_now() - patch_start;
 				switch_core_timer_next(&canvas->timer);
+				patch_start = switch_micro_time_now();
 				wait_for_canvas(canvas);
 				
 				for (i = 0; i < canvas->total_layers; i++) {
@@ -4143,6 +4334,10 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 				wait_for_canvas(canvas);
 			}
 
+			if (patch_start) {
+				conference_video_stage_stats_add(&canvas->patch_stats, patch_usec + switch_micro_time_now() - patch_start);
+			}
+
 			if (canvas->fgimg) {
 				conference_video_set_canvas_fgimg(canvas, NULL);
 			}
@@ -4162,11 +4357,7 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 			}
 
 			if (min_members && conference_utils_test_flag(conference, CFLAG_MINIMIZE_VIDEO_ENCODING)) {
-				for (i = 0; canvas->write_codecs[i] && switch_core_codec_ready(&canvas->write_codecs[i]->codec) && i < MAX_MUX_CODECS; i++) {
-					canvas->write_codecs[i]->frame.img = write_img;
-					conference_video_write_canvas_image_to_codec_group(conference, canvas, canvas->write_codecs[i], i,
-																	   timestamp, need_refresh, send_keyframe, need_reset);
-				}
+				write_canvas_image_to_codec_groups(conference, canvas, write_img, timestamp, need_refresh, send_keyframe, need_reset);
 			}
 
 			switch_mutex_lock(conference->member_mutex);
@@ -4255,6 +4446,8 @@ void *SWITCH_THREAD_FUNC conference_video_muxing_thread_run(switch_thread_t *thr
 		}
 	}
 
+	stop_codec_group_threads(canvas);
+
 	for (i = 0; i < MAX_MUX_CODECS; i++) {
 		if (canvas->write_codecs[i] && switch_core_codec_ready(&canvas->write_codecs[i]->codec)) {
 			switch_core_codec_destroy(&canvas->write_codecs[i]->codec);
@@ -4547,10 +4740,7 @@ void *SWITCH_THREAD_FUNC conference_video_super_muxing_thread_run(switch_thread_
 		}
 
 		if (min_members && conference_utils_test_flag(conference, CFLAG_MINIMIZE_VIDEO_ENCODING)) {
-			for (i = 0; canvas->write_codecs[i] && switch_core_codec_ready(&canvas->write_codecs[i]->codec) && i < MAX_MUX_CODECS; i++) {
-				canvas->write_codecs[i]->frame.img = write_img;
-				conference_video_write_canvas_image_to_codec_group(conference, canvas, canvas->write_codecs[i], i, timestamp, need_refresh, send_keyframe, need_reset);
-			}
+			write_canvas_image_to_codec_groups(conference, canvas, write_img, timestamp, need_refresh, send_keyframe, need_reset);
 		}
 
 		switch_mutex_lock(conference->member_mutex);
@@ -4630,6 +4820,8 @@ void *SWITCH_THREAD_FUNC conference_video_super_muxing_thread_run(switch_thread_
 		}
 	}
 
+	stop_codec_group_threads(canvas);
+
 	for (i = 0; i < MAX_MUX_CODECS; i++) {
 		if (canvas->write_codecs[i] && switch_core_codec_ready(&canvas->write_codecs[i]->codec)) {
 			switch_core_codec_destroy(&canvas->write_codecs[i]->codec);
@@ -4877,6 +5069,12 @@ void conference_video_write_frame(conference_obj_t *conference, conference_membe
 			continue;
 		}
 
+		if (imember->video_source_id && !conference_utils_test_flag(conference, CFLAG_VIDEO_MUXING)) {
+			/* pinned to a specific source, see conference_video_forward_frame */
+			switch_core_session_rwunlock(isession);
+			continue;
+		}
+
 		if (switch_channel_test_flag(imember->channel, CF_VIDEO_REFRESH_REQ)) {
 			want_refresh++;
 			switch_channel_clear_flag(imember->channel, CF_VIDEO_REFRESH_REQ);
@@ -4955,6 +5153,56 @@ void conference_video_write_frame(conference_obj_t *conference, conference_membe
 	switch_img_free(&tmp_frame.img);
 }
 
+/* Selective forwarding: relay a member's encoded video untouched to every member pinned to it with vid-source.
+   The RTP stack of each receiving leg rewrites SSRC, sequence and timestamp, and keyframe requests from the
+   receivers are sent to this source only instead of to the whole conference. */
+void conference_video_forward_frame(conference_member_t *member, switch_frame_t *frame)
+{
+	conference_obj_t *conference = member->conference;
+	conference_member_t *imember;
+	unsigned char buf[SWITCH_RTP_MAX_BUF_LEN] = "";
+	switch_frame_t tmp_frame = { 0 };
+	int want_refresh = 0;
+
+	if (switch_test_flag(frame, SFF_CNG) || !frame->packet || frame->packetlen > SWITCH_RTP_MAX_BUF_LEN) {
+		return;
+	}
+
+	switch_mutex_lock(conference->member_mutex);
+	for (imember = conference->members; imember; imember = imember->next) {
+		switch_core_session_t *isession = imember->session;
+
+		if (imember == member || imember->video_source_id != member->id) {
+			continue;
+		}
+
+		if (!isession || switch_core_session_read_lock(isession) != SWITCH_STATUS_SUCCESS) {
+			continue;
+		}
+
+		if (switch_channel_test_flag(imember->channel, CF_VIDEO_REFRESH_REQ)) {
+			want_refresh++;
+			switch_channel_clear_flag(imember->channel, CF_VIDEO_REFRESH_REQ);
+		}
+
+		if (conference_utils_member_test_flag(imember, MFLAG_CAN_SEE) && !conference_utils_member_test_flag(imember, MFLAG_RECEIVING_VIDEO) &&
+			switch_channel_test_flag(imember->channel, CF_VIDEO_READY)) {
+			tmp_frame = *frame;
+			tmp_frame.packet = buf;
+			tmp_frame.data = buf + 12;
+			memcpy(tmp_frame.packet, frame->packet, frame->packetlen);
+			switch_core_session_write_video_frame(isession, &tmp_frame, SWITCH_IO_FLAG_NONE, 0);
+		}
+
+		switch_core_session_rwunlock(isession);
+	}
+	switch_mutex_unlock(conference->member_mutex);
+
+	if (want_refresh && member->session) {
+		switch_core_session_request_video_refresh(member->session);
+	}
+}
+
 switch_status_t conference_video_thread_callback(switch_core_session_t *session, switch_frame_t *frame, void *user_data)
 {
 	//switch_channel_t *channel = switch_core_session_get_channel(session);
@@ -5066,6 +5314,9 @@ switch_status_t conference_video_thread_callback(switch_core_session_t *session,
 		last = rel;
 	}
 
+	if (member->conference->video_source_pins) {
+		conference_video_forward_frame(member, frame);
+	}
 
 	if (member->id == member->conference->video_floor_holder) {
 		conference_video_write_frame(member->conference, member, frame);
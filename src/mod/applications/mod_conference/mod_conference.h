@@ -523,6 +523,13 @@ typedef struct layout_group_s {
 	video_layout_node_t *layouts;
 } layout_group_t;
 
+typedef struct video_stage_stats_s {
+	switch_time_t last;
+	switch_time_t max;
+	switch_time_t total;
+	uint32_t count;
+} video_stage_stats_t;
+
 typedef struct codec_set_s {
 	switch_codec_t codec;
 	switch_frame_t frame;
@@ -531,6 +538,18 @@ typedef struct codec_set_s {
 	uint8_t fps_divisor;
 	uint32_t frame_count;
 	char *video_codec_group;
+	int codec_index;
+	struct mcu_canvas_s *canvas;
+	switch_thread_t *encode_thread;
+	switch_thread_cond_t *encode_cond;
+	switch_mutex_t *encode_cond_mutex;
+	int encode_thread_running;
+	int encode_pending;
+	uint32_t encode_timestamp;
+	switch_bool_t encode_need_refresh;
+	switch_bool_t encode_send_keyframe;
+	switch_bool_t encode_need_reset;
+	video_stage_stats_t encode_stats;
 } codec_set_t;
 
 
@@ -571,6 +590,11 @@ typedef struct mcu_canvas_s {
 	codec_set_t *write_codecs[MAX_MUX_CODECS];
 	int write_codecs_count;
 	switch_bool_t disable_auto_clear;
+	video_stage_stats_t patch_stats;
+	video_stage_stats_t encode_stats;
+	switch_mutex_t *encode_done_mutex;
+	switch_thread_cond_t *encode_done_cond;
+	int encode_busy;
 } mcu_canvas_t;
 
 /* Record Node */
@@ -718,6 +742,7 @@ typedef struct conference_obj {
 	int endconference_grace_time;
 
 	uint32_t relationship_total;
+	uint32_t video_source_pins;
 	uint32_t score;
 	int mux_loop_count;
 	int member_loop_count;
@@ -872,6 +897,7 @@ struct conference_member {
 	char *video_reservation_id;
 	char *video_role_id;
 	char *video_codec_group;
+	uint32_t video_source_id;
 	switch_vid_params_t vid_params;
 	uint32_t auto_kps_debounce_ticks;
 	uint32_t layer_loops;
@@ -1066,6 +1092,7 @@ void conference_video_check_flush(conference_member_t *member, switch_bool_t for
 void conference_video_set_canvas_letterbox_bgcolor(mcu_canvas_t *canvas, char *color);
 void conference_video_set_canvas_bgcolor(mcu_canvas_t *canvas, char *color);
 void conference_video_scale_and_patch(mcu_layer_t *layer, switch_image_t *ximg, switch_bool_t freeze);
+void conference_video_stage_stats_add(video_stage_stats_t *stats, switch_time_t usec);
 void conference_video_reset_layer(mcu_layer_t *layer);
 void conference_video_reset_layer_cam(mcu_layer_t *layer);
 void conference_video_clear_layer(mcu_layer_t *layer);
@@ -1081,6 +1108,7 @@ switch_status_t conference_video_set_canvas_bgimg(mcu_canvas_t *canvas, const ch
 switch_status_t conference_video_set_canvas_fgimg(mcu_canvas_t *canvas, const char *img_path);
 switch_status_t conference_al_parse_position(al_handle_t *al, const char *data);
 switch_status_t conference_video_thread_callback(switch_core_session_t *session, switch_frame_t *frame, void *user_data);
+void conference_video_forward_frame(conference_member_t *member, switch_frame_t *frame);
 switch_status_t conference_text_thread_callback(switch_core_session_t *session, switch_frame_t *frame, void *user_data);
 void *SWITCH_THREAD_FUNC conference_video_muxing_write_thread_run(switch_thread_t *thread, void *obj);
 void conference_video_launch_layer_thread(conference_member_t *member);
@@ -1229,8 +1257,10 @@ switch_status_t conference_api_sub_get_uuid(conference_member_t *member, switch_
 switch_status_t conference_api_sub_get(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_vid_mute_img(conference_member_t *member, switch_stream_handle_t *stream, void *data);
 switch_status_t conference_api_sub_vid_codec_group(conference_member_t *member, switch_stream_handle_t *stream, void *data);
+switch_status_t conference_api_sub_vid_source(conference_member_t *member, switch_stream_handle_t *stream, void *data);
 switch_status_t conference_api_sub_vid_logo_img(conference_member_t *member, switch_stream_handle_t *stream, void *data);
 switch_status_t conference_api_sub_vid_fps(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
+switch_status_t conference_api_sub_vid_stats(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_vid_res(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_canvas_fgimg(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
 switch_status_t conference_api_sub_canvas_bgimg(conference_obj_t *conference, switch_stream_handle_t *stream, int argc, char **argv);
@@ -39,8 +39,14 @@
 
 #define SWITCH_OPUS_MIN_FEC_BITRATE 12400
 
+/* libopus' own default when no complexity is configured */
+#define SWITCH_OPUS_DEFAULT_COMPLEXITY 9
+#define SWITCH_OPUS_STATE_POOL_SIZE 64
+#define SWITCH_OPUS_AUTO_COMPLEXITY_INTERVAL 5
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_opus_load);
-SWITCH_MODULE_DEFINITION(mod_opus, mod_opus_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_opus_shutdown);
+SWITCH_MODULE_DEFINITION(mod_opus, mod_opus_load, mod_opus_shutdown, NULL);
 
 /*! \brief Various codec settings */
 struct opus_codec_settings {
@@ -108,6 +114,8 @@ struct dec_stats {
 	uint32_t fec_counter;
 	uint32_t plc_counter;
 	uint32_t frame_counter;
+	switch_time_t decode_usec;
+	switch_time_t max_decode_usec;
 };
 typedef struct dec_stats dec_stats_t;
 
@@ -116,6 +124,8 @@ struct enc_stats {
 	uint32_t encoded_bytes;
 	uint32_t encoded_msec;
 	uint32_t fec_counter;
+	switch_time_t encode_usec;
+	switch_time_t max_encode_usec;
 };
 typedef struct enc_stats enc_stats_t;
 
@@ -142,9 +152,13 @@ struct opus_context {
 	dec_stats_t decoder_stats;
 	enc_stats_t encoder_stats;
 	codec_control_state_t control_state;
+	int enc_channels;
+	int dec_channels;
+	uint32_t complexity_gen;
+	char stats_str[256];
 };
 
-struct {
+typedef struct {
 	int use_vbr;
 	int use_dtx;
 	int complexity;
@@ -159,13 +173,203 @@ struct {
 	int adjust_bitrate;
 	int debuginfo;
 	uint32_t use_jb_lookahead;
+	uint32_t state_pool_size;
+	int auto_complexity;
+	int auto_complexity_min;
+	double auto_complexity_idle_low;
+	double auto_complexity_idle_high;
 	switch_mutex_t *mutex;
-} opus_prefs;
+} opus_prefs_t;
+
+static opus_prefs_t opus_prefs;
+
+typedef struct opus_state_node_s {
+	struct opus_state_node_s *next;
+} opus_state_node_t;
 
 static struct {
 	int debug;
+	switch_mutex_t *mutex;
+	/* released encoder/decoder state, indexed by channels - 1, reinitialised in place on the next init */
+	opus_state_node_t *free_enc[2];
+	opus_state_node_t *free_dec[2];
+	uint32_t free_enc_count[2];
+	uint32_t free_dec_count[2];
+	uint64_t enc_created;
+	uint64_t enc_reused;
+	uint64_t dec_created;
+	uint64_t dec_reused;
+	/* complexity currently handed to every encoder, and a generation bumped each time it moves */
+	int complexity;
+	uint32_t complexity_gen;
+	uint32_t complexity_task_id;
+	switch_event_node_t *reload_node;
 } globals;
 
+static OpusEncoder *opus_state_encoder_get(opus_int32 samplerate, int channels, int application, int *err)
+{
+	OpusEncoder *enc = NULL;
+	int idx = channels - 1;
+
+	if (channels < 1 || channels > 2) {
+		*err = OPUS_BAD_ARG;
+		return NULL;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.free_enc[idx]) {
+		enc = (OpusEncoder *) globals.free_enc[idx];
+		globals.free_enc[idx] = globals.free_enc[idx]->next;
+		globals.free_enc_count[idx]--;
+		globals.enc_reused++;
+	} else {
+		globals.enc_created++;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	if (!enc && !(enc = malloc(opus_encoder_get_size(channels)))) {
+		*err = OPUS_ALLOC_FAIL;
+		return NULL;
+	}
+
+	if ((*err = opus_encoder_init(enc, samplerate, channels, application)) != OPUS_OK) {
+		free(enc);
+		return NULL;
+	}
+
+	return enc;
+}
+
+static void opus_state_encoder_put(OpusEncoder *enc, int channels)
+{
+	opus_state_node_t *node = (opus_state_node_t *) enc;
+	int idx = channels - 1;
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.free_enc_count[idx] < opus_prefs.state_pool_size) {
+		node->next = globals.free_enc[idx];
+		globals.free_enc[idx] = node;
+		globals.free_enc_count[idx]++;
+		node = NULL;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	free(node);
+}
+
+static OpusDecoder *opus_state_decoder_get(opus_int32 samplerate, int channels, int *err)
+{
+	OpusDecoder *dec = NULL;
+	int idx = channels - 1;
+
+	if (channels < 1 || channels > 2) {
+		*err = OPUS_BAD_ARG;
+		return NULL;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.free_dec[idx]) {
+		dec = (OpusDecoder *) globals.free_dec[idx];
+		globals.free_dec[idx] = globals.free_dec[idx]->next;
+		globals.free_dec_count[idx]--;
+		globals.dec_reused++;
+	} else {
+		globals.dec_created++;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	if (!dec && !(dec = malloc(opus_decoder_get_size(channels)))) {
+		*err = OPUS_ALLOC_FAIL;
+		return NULL;
+	}
+
+	if ((*err = opus_decoder_init(dec, samplerate, channels)) != OPUS_OK) {
+		free(dec);
+		return NULL;
+	}
+
+	return dec;
+}
+
+static void opus_state_decoder_put(OpusDecoder *dec, int channels)
+{
+	opus_state_node_t *node = (opus_state_node_t *) dec;
+	int idx = channels - 1;
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.free_dec_count[idx] < opus_prefs.state_pool_size) {
+		node->next = globals.free_dec[idx];
+		globals.free_dec[idx] = node;
+		globals.free_dec_count[idx]++;
+		node = NULL;
+	}
+	switch_mutex_unlock(globals.mutex);
+
+	free(node);
+}
+
+static void opus_state_pool_flush(void)
+{
+	opus_state_node_t *node;
+	int i;
+
+	switch_mutex_lock(globals.mutex);
+	for (i = 0; i < 2; i++) {
+		while ((node = globals.free_enc[i])) {
+			globals.free_enc[i] = node->next;
+			free(node);
+		}
+		while ((node = globals.free_dec[i])) {
+			globals.free_dec[i] = node->next;
+			free(node);
+		}
+		globals.free_enc_count[i] = globals.free_dec_count[i] = 0;
+	}
+	switch_mutex_unlock(globals.mutex);
+}
+
+static int opus_base_complexity(void)
+{
+	return opus_prefs.complexity ? opus_prefs.complexity : SWITCH_OPUS_DEFAULT_COMPLEXITY;
+}
+
+/* Walk the encoder complexity down while the box is short on idle cpu and back up once it recovers */
+SWITCH_STANDARD_SCHED_FUNC(opus_complexity_callback)
+{
+	double idle = switch_core_idle_cpu();
+	int base = opus_base_complexity();
+	int cur = globals.complexity;
+
+	if (idle < opus_prefs.auto_complexity_idle_low && cur > opus_prefs.auto_complexity_min) {
+		cur -= 2;
+		if (cur < opus_prefs.auto_complexity_min) {
+			cur = opus_prefs.auto_complexity_min;
+		}
+	} else if (idle > opus_prefs.auto_complexity_idle_high && cur < base) {
+		cur++;
+	}
+
+	if (cur != globals.complexity) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Opus encoder complexity %d -> %d (idle cpu %.1f%%)\n", globals.complexity, cur, idle);
+		globals.complexity = cur;
+		globals.complexity_gen++;
+	}
+
+	task->runtime = switch_epoch_time_now(NULL) + SWITCH_OPUS_AUTO_COMPLEXITY_INTERVAL;
+}
+
+/* Start or stop the load controller to match the current config, called with globals.mutex held */
+static void opus_complexity_task_sync(void)
+{
+	if (opus_prefs.auto_complexity && !globals.complexity_task_id) {
+		globals.complexity_task_id = switch_scheduler_add_task(switch_epoch_time_now(NULL) + SWITCH_OPUS_AUTO_COMPLEXITY_INTERVAL,
+															   opus_complexity_callback, "opus_complexity", "mod_opus", 0, NULL, SSHF_NONE);
+	} else if (!opus_prefs.auto_complexity && globals.complexity_task_id) {
+		switch_scheduler_del_task_id(globals.complexity_task_id);
+		globals.complexity_task_id = 0;
+	}
+}
+
 static switch_bool_t switch_opus_acceptable_rate(int rate)
 {
 	if (rate != 8000 && rate != 12000 && rate != 16000 && rate != 24000 && rate != 48000) {
@@ -569,7 +773,7 @@ static switch_status_t switch_opus_init(switch_codec_t *codec, switch_codec_flag
 		/* come up with a way to specify these */
 		int bitrate_bps = OPUS_AUTO;
 		int use_vbr = opus_codec_settings.cbr ? 0 : opus_prefs.use_vbr  ;
-		int complexity = opus_prefs.complexity;
+		int complexity = opus_prefs.auto_complexity ? globals.complexity : opus_prefs.complexity;
 		int plpct = opus_prefs.plpct;
 		int err;
 		int enc_samplerate = opus_codec_settings.samplerate ? opus_codec_settings.samplerate : codec->implementation->actual_samples_per_second;
@@ -593,9 +797,10 @@ static switch_status_t switch_opus_init(switch_codec_t *codec, switch_codec_flag
 			}
 		}
 
-		context->encoder_object = opus_encoder_create(enc_samplerate,
-													  codec->implementation->number_of_channels,
-													  codec->implementation->number_of_channels == 1 ? OPUS_APPLICATION_VOIP : OPUS_APPLICATION_AUDIO, &err);
+		context->enc_channels = codec->implementation->number_of_channels;
+		context->encoder_object = opus_state_encoder_get(enc_samplerate, context->enc_channels,
+														 context->enc_channels == 1 ? OPUS_APPLICATION_VOIP : OPUS_APPLICATION_AUDIO, &err);
+		context->complexity_gen = globals.complexity_gen;
 
 		if (err != OPUS_OK) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Cannot create encoder: %s\n", opus_strerror(err));
@@ -686,7 +891,8 @@ static switch_status_t switch_opus_init(switch_codec_t *codec, switch_codec_flag
 			}
 		}
 
-		context->decoder_object = opus_decoder_create(dec_samplerate, (!context->codec_settings.sprop_stereo ? codec->implementation->number_of_channels : 2), &err);
+		context->dec_channels = !context->codec_settings.sprop_stereo ? codec->implementation->number_of_channels : 2;
+		context->decoder_object = opus_state_decoder_get(dec_samplerate, context->dec_channels, &err);
 
 		switch_set_flag(codec, SWITCH_CODEC_FLAG_HAS_PLC);
 
@@ -694,7 +900,7 @@ static switch_status_t switch_opus_init(switch_codec_t *codec, switch_codec_flag
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Cannot create decoder: %s\n", opus_strerror(err));
 
 			if (context->encoder_object) {
-				opus_encoder_destroy(context->encoder_object);
+				opus_state_encoder_put(context->encoder_object, context->enc_channels);
 				context->encoder_object = NULL;
 			}
 
@@ -716,10 +922,15 @@ static switch_status_t switch_opus_destroy(switch_codec_t *codec)
 		if (context->decoder_object) {
 			switch_core_session_t *session = codec->session;
 			if (session) {
-				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,"Opus decoder stats: Frames[%d] PLC[%d] FEC[%d]\n",
-										context->decoder_stats.frame_counter, context->decoder_stats.plc_counter-context->decoder_stats.fec_counter, context->decoder_stats.fec_counter);
+				switch_channel_t *channel = switch_core_session_get_channel(session);
+
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,"Opus decoder stats: Frames[%d] PLC[%d] FEC[%d] Decode usec[%" SWITCH_TIME_T_FMT "] Max[%" SWITCH_TIME_T_FMT "]\n",
+										context->decoder_stats.frame_counter, context->decoder_stats.plc_counter-context->decoder_stats.fec_counter, context->decoder_stats.fec_counter,
+										context->decoder_stats.decode_usec, context->decoder_stats.max_decode_usec);
+				switch_channel_set_variable_printf(channel, "opus_decode_frames", "%u", context->decoder_stats.frame_counter);
+				switch_channel_set_variable_printf(channel, "opus_decode_usec", "%" SWITCH_TIME_T_FMT, context->decoder_stats.decode_usec);
 			}
-			opus_decoder_destroy(context->decoder_object);
+			opus_state_decoder_put(context->decoder_object, context->dec_channels);
 			context->decoder_object = NULL;
 		}
 		if (context->encoder_object) {
@@ -732,15 +943,18 @@ static switch_status_t switch_opus_destroy(switch_codec_t *codec)
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
-						"Opus encoder stats: Frames[%d] Bytes encoded[%d] Encoded length ms[%d] Average encoded bitrate bps[%d]\n",
-						context->encoder_stats.frame_counter, context->encoder_stats.encoded_bytes, context->encoder_stats.encoded_msec, avg_encoded_bitrate);
+						"Opus encoder stats: Frames[%d] Bytes encoded[%d] Encoded length ms[%d] Average encoded bitrate bps[%d] Encode usec[%" SWITCH_TIME_T_FMT "] Max[%" SWITCH_TIME_T_FMT "]\n",
+						context->encoder_stats.frame_counter, context->encoder_stats.encoded_bytes, context->encoder_stats.encoded_msec, avg_encoded_bitrate,
+						context->encoder_stats.encode_usec, context->encoder_stats.max_encode_usec);
+				switch_channel_set_variable_printf(switch_core_session_get_channel(session), "opus_encode_frames", "%u", context->encoder_stats.frame_counter);
+				switch_channel_set_variable_printf(switch_core_session_get_channel(session), "opus_encode_usec", "%" SWITCH_TIME_T_FMT, context->encoder_stats.encode_usec);
 
 				if (globals.debug || context->debug > 1) {
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
 							"Opus encoder stats: FEC frames (only for debug mode) [%d]\n", context->encoder_stats.fec_counter);
 				}
 			}
-			opus_encoder_destroy(context->encoder_object);
+			opus_state_encoder_put(context->encoder_object, context->enc_channels);
 			context->encoder_object = NULL;
 		}
 	}
@@ -749,6 +963,25 @@ static switch_status_t switch_opus_destroy(switch_codec_t *codec)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* Pick up a complexity change from the load controller on the encoding thread, where the encoder isn't contended */
+static inline void switch_opus_sync_complexity(struct opus_context *context)
+{
+	if (context->complexity_gen != globals.complexity_gen) {
+		context->complexity_gen = globals.complexity_gen;
+		opus_encoder_ctl(context->encoder_object, OPUS_SET_COMPLEXITY(globals.complexity));
+	}
+}
+
+static inline void switch_opus_account(switch_time_t *total, switch_time_t *max, switch_time_t start)
+{
+	switch_time_t spent = switch_time_ref() - start;
+
+	*total += spent;
+	if (spent > *max) {
+		*max = spent;
+	}
+}
+
 static switch_status_t switch_opus_encode(switch_codec_t *codec,
 										  switch_codec_t *other_codec,
 										  void *decoded_data,
@@ -759,12 +992,17 @@ static switch_status_t switch_opus_encode(switch_codec_t *codec,
 	struct opus_context *context = codec->private_info;
 	int bytes = 0;
 	int len = (int) *encoded_data_len;
+	switch_time_t start;
 
 	if (!context) {
 		return SWITCH_STATUS_FALSE;
 	}
 
+	switch_opus_sync_complexity(context);
+
+	start = switch_time_ref();
 	bytes = opus_encode(context->encoder_object, (void *) decoded_data, context->enc_frame_size, (unsigned char *) encoded_data, len);
+	switch_opus_account(&context->encoder_stats.encode_usec, &context->encoder_stats.max_encode_usec, start);
 
 	if (globals.debug || context->debug > 1) {
 		int samplerate = context->enc_frame_size * 1000 / (codec->implementation->microseconds_per_packet / 1000);
@@ -811,6 +1049,7 @@ static switch_status_t switch_opus_decode(switch_codec_t *codec,
 	int fec = 0, plc = 0;
 	int32_t frame_size = 0, last_frame_size = 0;
 	uint32_t frame_samples;
+	switch_time_t start;
 
 	if (!context) {
 		return SWITCH_STATUS_FALSE;
@@ -909,7 +1148,9 @@ static switch_status_t switch_opus_decode(switch_codec_t *codec,
 	/* a frame for which we decode FEC will be counted twice */
 	context->decoder_stats.frame_counter++;
 
+	start = switch_time_ref();
 	samples = opus_decode(context->decoder_object, encoded_data, encoded_data_len, decoded_data, frame_size, fec);
+	switch_opus_account(&context->decoder_stats.decode_usec, &context->decoder_stats.max_decode_usec, start);
 
 	if (samples < 0) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Decoder Error: %s fs:%u plc:%s!\n",
@@ -941,10 +1182,15 @@ static switch_status_t switch_opus_encode_repacketize(switch_codec_t *codec,
 	opus_int32 ret = 0;
 	opus_int32 total_len = 0;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_time_t start = 0;
 
 	if (!context) {
 		switch_goto_status(SWITCH_STATUS_FALSE, end);
 	}
+
+	switch_opus_sync_complexity(context);
+	start = switch_time_ref();
+
 	opus_encoder_ctl(context->encoder_object, OPUS_GET_INBAND_FEC(&want_fec));
 	if (want_fec && context->codec_settings.useinbandfec) {
 		/* if FEC might be used , pack only 2 frames like: 80 ms = 2 x 40 ms , 120 ms = 2 x 60 ms  */
@@ -1014,6 +1260,10 @@ static switch_status_t switch_opus_encode_repacketize(switch_codec_t *codec,
 	*encoded_data_len = (uint32_t) ret;
 
 end:
+	if (start) {
+		switch_opus_account(&context->encoder_stats.encode_usec, &context->encoder_stats.max_encode_usec, start);
+	}
+
 	if (rp) {
 		opus_repacketizer_destroy(rp);
 	}
@@ -1026,19 +1276,25 @@ static switch_status_t opus_load_config(switch_bool_t reload)
 	char *cf = "opus.conf";
 	switch_xml_t cfg, xml = NULL, param, settings;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	opus_prefs_t prefs;
+	int was_auto;
 
 	if (!(xml = switch_xml_open_cfg(cf, &cfg, NULL))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Opening of %s failed\n", cf);
 		return status;
 	}
 
-	memset(&opus_prefs, 0, sizeof(opus_prefs));
-	opus_prefs.use_jb_lookahead = 1;
-	opus_prefs.keep_fec = 1;
-	opus_prefs.use_dtx = 0;
-	opus_prefs.plpct = 20;
-	opus_prefs.use_vbr = 0;
-	opus_prefs.fec_decode = 1;
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.use_jb_lookahead = 1;
+	prefs.keep_fec = 1;
+	prefs.use_dtx = 0;
+	prefs.plpct = 20;
+	prefs.use_vbr = 0;
+	prefs.fec_decode = 1;
+	prefs.state_pool_size = SWITCH_OPUS_STATE_POOL_SIZE;
+	prefs.auto_complexity_min = 3;
+	prefs.auto_complexity_idle_low = 20;
+	prefs.auto_complexity_idle_high = 40;
 
 	if ((settings = switch_xml_child(cfg, "settings"))) {
 		for (param = switch_xml_child(settings, "param"); param; param = param->next) {
@@ -1046,44 +1302,75 @@ static switch_status_t opus_load_config(switch_bool_t reload)
 			char *val = (char *) switch_xml_attr_soft(param, "value");
 
 			if (!strcasecmp(key, "use-vbr") && !zstr(val)) {
-				opus_prefs.use_vbr = atoi(val);
+				prefs.use_vbr = atoi(val);
 			} else if (!strcasecmp(key, "use-dtx")) {
-				opus_prefs.use_dtx = atoi(val);
+				prefs.use_dtx = atoi(val);
 			} else if (!strcasecmp(key, "complexity")) {
-				opus_prefs.complexity = atoi(val);
+				prefs.complexity = atoi(val);
+			} else if (!strcasecmp(key, "auto-complexity")) {
+				prefs.auto_complexity = switch_true(val);
+			} else if (!strcasecmp(key, "auto-complexity-min") && !zstr(val)) {
+				prefs.auto_complexity_min = atoi(val);
+			} else if (!strcasecmp(key, "auto-complexity-idle-low") && !zstr(val)) {
+				prefs.auto_complexity_idle_low = atof(val);
+			} else if (!strcasecmp(key, "auto-complexity-idle-high") && !zstr(val)) {
+				prefs.auto_complexity_idle_high = atof(val);
+			} else if (!strcasecmp(key, "state-pool-size") && !zstr(val)) {
+				prefs.state_pool_size = atoi(val);
 			} else if (!strcasecmp(key, "packet-loss-percent")) {
-				opus_prefs.plpct = atoi(val);
+				prefs.plpct = atoi(val);
 			} else if (!strcasecmp(key, "asymmetric-sample-rates")) {
-				opus_prefs.asymmetric_samplerates = atoi(val);
+				prefs.asymmetric_samplerates = atoi(val);
 			} else if (!strcasecmp(key, "bitrate-negotiation")) {
-				opus_prefs.bitrate_negotiation = atoi(val);
+				prefs.bitrate_negotiation = atoi(val);
 			} else if (!strcasecmp(key, "use-jb-lookahead")) {
-				opus_prefs.use_jb_lookahead = switch_true(val);
+				prefs.use_jb_lookahead = switch_true(val);
 			} else if (!strcasecmp(key, "keep-fec-enabled")) { /* encoder */
-				opus_prefs.keep_fec = atoi(val);
+				prefs.keep_fec = atoi(val);
 			} else if (!strcasecmp(key, "advertise-useinbandfec")) { /*decoder, has meaning only for FMTP: useinbandfec=1 by default */
-				opus_prefs.fec_decode = atoi(val);
+				prefs.fec_decode = atoi(val);
 			} else if (!strcasecmp(key, "adjust-bitrate")) { /* encoder, this setting will make the encoder adjust its bitrate based on a feedback loop (RTCP). This is not "VBR".*/
-				opus_prefs.adjust_bitrate = atoi(val);
+				prefs.adjust_bitrate = atoi(val);
 			} else if (!strcasecmp(key, "maxaveragebitrate")) {
-				opus_prefs.maxaveragebitrate = atoi(val);
-				if (opus_prefs.maxaveragebitrate < SWITCH_OPUS_MIN_BITRATE || opus_prefs.maxaveragebitrate > SWITCH_OPUS_MAX_BITRATE) {
-					opus_prefs.maxaveragebitrate = 0; /* values outside the range between 6000 and 510000 SHOULD be ignored */
+				prefs.maxaveragebitrate = atoi(val);
+				if (prefs.maxaveragebitrate < SWITCH_OPUS_MIN_BITRATE || prefs.maxaveragebitrate > SWITCH_OPUS_MAX_BITRATE) {
+					prefs.maxaveragebitrate = 0; /* values outside the range between 6000 and 510000 SHOULD be ignored */
 				}
 			} else if (!strcasecmp(key, "maxplaybackrate")) {
-				opus_prefs.maxplaybackrate = atoi(val);
-				if (!switch_opus_acceptable_rate(opus_prefs.maxplaybackrate)) {
-					opus_prefs.maxplaybackrate = 0; /* value not supported */
+				prefs.maxplaybackrate = atoi(val);
+				if (!switch_opus_acceptable_rate(prefs.maxplaybackrate)) {
+					prefs.maxplaybackrate = 0; /* value not supported */
 				}
 			} else if (!strcasecmp(key, "sprop-maxcapturerate")) {
-				opus_prefs.sprop_maxcapturerate = atoi(val);
-				if (!switch_opus_acceptable_rate(opus_prefs.sprop_maxcapturerate)) {
-					opus_prefs.sprop_maxcapturerate = 0; /* value not supported */
+				prefs.sprop_maxcapturerate = atoi(val);
+				if (!switch_opus_acceptable_rate(prefs.sprop_maxcapturerate)) {
+					prefs.sprop_maxcapturerate = 0; /* value not supported */
 				}
 			}
 		}
 	}
 
+	if (prefs.auto_complexity_min < 0 || prefs.auto_complexity_min > 10) {
+		prefs.auto_complexity_min = 3;
+	}
+
+	if (prefs.auto_complexity_idle_high < prefs.auto_complexity_idle_low) {
+		prefs.auto_complexity_idle_high = prefs.auto_complexity_idle_low;
+	}
+
+	switch_mutex_lock(globals.mutex);
+	was_auto = opus_prefs.auto_complexity;
+	opus_prefs = prefs;
+	globals.complexity = opus_base_complexity();
+
+	/* running encoders only follow the shared complexity while the load controller owns it, and fall back to the base when it lets go */
+	if (opus_prefs.auto_complexity || was_auto) {
+		globals.complexity_gen++;
+	}
+
+	opus_complexity_task_sync();
+	switch_mutex_unlock(globals.mutex);
+
 	switch_xml_free(xml);
 
 	return status;
@@ -1177,6 +1464,13 @@ static switch_status_t switch_opus_control(switch_codec_t *codec,
 						context->use_jb_lookahead = switch_true(arg);
 					}
 					reply = context->use_jb_lookahead ? "LOOKAHEAD ON" : "LOOKAHEAD OFF";
+				} else if (!strcasecmp(command, "stats")) {
+					switch_snprintf(context->stats_str, sizeof(context->stats_str),
+									"encode_frames=%u encode_usec=%" SWITCH_TIME_T_FMT " max_encode_usec=%" SWITCH_TIME_T_FMT
+									" decode_frames=%u decode_usec=%" SWITCH_TIME_T_FMT " max_decode_usec=%" SWITCH_TIME_T_FMT,
+									context->encoder_stats.frame_counter, context->encoder_stats.encode_usec, context->encoder_stats.max_encode_usec,
+									context->decoder_stats.frame_counter, context->decoder_stats.decode_usec, context->decoder_stats.max_decode_usec);
+					reply = context->stats_str;
 				}
 			}
 
@@ -1327,6 +1621,24 @@ SWITCH_STANDARD_API(mod_opus_debug)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(mod_opus_stats)
+{
+	switch_mutex_lock(globals.mutex);
+	stream->write_function(stream, "complexity: %d%s\n", globals.complexity, opus_prefs.auto_complexity ? " (auto)" : "");
+	stream->write_function(stream, "idle-cpu: %.1f\n", switch_core_idle_cpu());
+	stream->write_function(stream, "encoders created: %" SWITCH_UINT64_T_FMT " reused: %" SWITCH_UINT64_T_FMT " pooled: %u\n",
+						   globals.enc_created, globals.enc_reused, globals.free_enc_count[0] + globals.free_enc_count[1]);
+	stream->write_function(stream, "decoders created: %" SWITCH_UINT64_T_FMT " reused: %" SWITCH_UINT64_T_FMT " pooled: %u\n",
+						   globals.dec_created, globals.dec_reused, globals.free_dec_count[0] + globals.free_dec_count[1]);
+	switch_mutex_unlock(globals.mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void opus_reload_event_handler(switch_event_t *event)
+{
+	opus_load_config(SWITCH_TRUE);
+}
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_opus_load)
 {
@@ -1342,15 +1654,22 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_opus_load)
 	opus_codec_settings_t settings = { 0 };
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
 
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+
 	if ((status = opus_load_config(SWITCH_FALSE)) != SWITCH_STATUS_SUCCESS) {
 		return status;
 	}
 
+	if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, opus_reload_event_handler, NULL, &globals.reload_node) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind to reloadxml, opus.conf changes need a module reload\n");
+	}
+
 	/* connect my internal structure to the blank pointer passed to me */
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
 	SWITCH_ADD_CODEC(codec_interface, "OPUS (STANDARD)");
 	SWITCH_ADD_API(commands_api_interface, "opus_debug", "Set OPUS Debug", mod_opus_debug, OPUS_DEBUG_SYNTAX);
+	SWITCH_ADD_API(commands_api_interface, "opus_stats", "Show OPUS encoder/decoder pool and complexity", mod_opus_stats, "");
 
 	switch_console_set_complete("add opus_debug on");
 	switch_console_set_complete("add opus_debug off");
@@ -1660,6 +1979,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_opus_load)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_opus_shutdown)
+{
+	switch_event_unbind(&globals.reload_node);
+	switch_scheduler_del_task_group("mod_opus");
+	opus_state_pool_flush();
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 
 /* For Emacs:
  * Local Variables:
@@ -51,6 +51,8 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_pgsql_shutdown);
 SWITCH_MODULE_DEFINITION(mod_pgsql, mod_pgsql_load, mod_pgsql_shutdown, NULL);
 
 #define DEFAULT_PGSQL_RETRIES 120
+/* named statements kept prepared per connection, further sql is sent unnamed */
+#define PGSQL_PREPARED_MAX 128
 
 typedef enum {
 	SWITCH_PGSQL_STATE_INIT,
@@ -69,6 +71,10 @@ struct switch_pgsql_handle {
 	int num_retries;
 	switch_bool_t auto_commit;
 	switch_bool_t in_txn;
+	/* sql -> name of the statement prepared on this connection */
+	switch_hash_t *prepared;
+	uint32_t prepared_count;
+	uint32_t prepared_seq;
 };
 
 struct switch_pgsql_result {
@@ -105,6 +111,16 @@ char * pgsql_handle_get_error(switch_pgsql_handle_t *handle)
 	return err_str;
 }
 
+/* the server drops prepared statements with the connection */
+static void pgsql_prepared_reset(switch_pgsql_handle_t *handle)
+{
+	if (handle->prepared) {
+		switch_core_hash_destroy(&handle->prepared);
+	}
+
+	handle->prepared_count = 0;
+}
+
 static int db_is_up(switch_pgsql_handle_t *handle)
 {
 	int ret = 0;
@@ -137,6 +153,7 @@ top:
 	if (PQstatus(handle->con) == CONNECTION_BAD) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "PQstatus returned bad connection; reconnecting...\n");
 		handle->state = SWITCH_PGSQL_STATE_ERROR;
+		pgsql_prepared_reset(handle);
 		PQreset(handle->con);
 		if (PQstatus(handle->con) == CONNECTION_BAD) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "PQstatus returned bad connection -- reconnection failed!\n");
@@ -154,6 +171,7 @@ error:
 
 	if (PQstatus(handle->con) == CONNECTION_BAD) {
 		handle->state = SWITCH_PGSQL_STATE_ERROR;
+		pgsql_prepared_reset(handle);
 		PQreset(handle->con);
 		if (PQstatus(handle->con) == CONNECTION_OK) {
 			handle->state = SWITCH_PGSQL_STATE_CONNECTED;
@@ -324,6 +342,7 @@ switch_status_t pgsql_handle_disconnect(switch_pgsql_handle_t *handle)
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "Disconnected from [%s]\n", handle->dsn);
 	}
 	switch_safe_free(handle->sql);
+	pgsql_prepared_reset(handle);
 	handle->state = SWITCH_PGSQL_STATE_DOWN;
 
 	return SWITCH_STATUS_SUCCESS;
@@ -422,13 +441,59 @@ switch_status_t database_flush(switch_database_interface_handle_t *dih)
 	return pgsql_flush(handle);
 }
 
-switch_status_t pgsql_send_query(switch_pgsql_handle_t *handle, const char* sql)
+/* name of the server side statement for sql, prepared on first use, NULL to send it unnamed */
+static const char *pgsql_prepared_name(switch_pgsql_handle_t *handle, const char *sql, int nparams)
+{
+	PGresult *res;
+	char *name;
+
+	if (!handle->prepared) {
+		switch_core_hash_init(&handle->prepared);
+	}
+
+	if ((name = switch_core_hash_find(handle->prepared, sql))) {
+		return name;
+	}
+
+	if (handle->prepared_count >= PGSQL_PREPARED_MAX) {
+		return NULL;
+	}
+
+	name = switch_mprintf("fs_stmt_%u", ++handle->prepared_seq);
+	res = PQprepare(handle->con, name, sql, nparams, NULL);
+
+	if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Failed to prepare (%s): %s", sql, PQresultErrorMessage(res));
+		PQclear(res);
+		switch_safe_free(name);
+		return NULL;
+	}
+
+	PQclear(res);
+	switch_core_hash_insert_auto_free(handle->prepared, sql, name);
+	handle->prepared_count++;
+
+	return name;
+}
+
+switch_status_t pgsql_send_query_params(switch_pgsql_handle_t *handle, const char* sql, int nparams, char **params)
 {
+	const char *name;
 	char *err_str;
+	int sent;
 
 	switch_safe_free(handle->sql);
 	handle->sql = strdup(sql);
-	if (!PQsendQuery(handle->con, sql)) {
+
+	if (nparams > 0 && (name = pgsql_prepared_name(handle, sql, nparams))) {
+		sent = PQsendQueryPrepared(handle->con, name, nparams, (const char * const *) params, NULL, NULL, 0);
+	} else if (nparams > 0) {
+		sent = PQsendQueryParams(handle->con, sql, nparams, NULL, (const char * const *) params, NULL, NULL, 0);
+	} else {
+		sent = PQsendQuery(handle->con, sql);
+	}
+
+	if (!sent) {
 		err_str = pgsql_handle_get_error(handle);
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Failed to send query (%s) to database: %s\n", sql, err_str);
 		switch_safe_free(err_str);
@@ -441,8 +506,13 @@ error:
 	return SWITCH_STATUS_FALSE;
 }
 
-switch_status_t pgsql_handle_exec_base_detailed(const char *file, const char *func, int line,
-	switch_pgsql_handle_t *handle, const char *sql, char **err)
+switch_status_t pgsql_send_query(switch_pgsql_handle_t *handle, const char* sql)
+{
+	return pgsql_send_query_params(handle, sql, 0, NULL);
+}
+
+switch_status_t pgsql_handle_exec_base_params_detailed(const char *file, const char *func, int line,
+	switch_pgsql_handle_t *handle, const char *sql, int nparams, char **params, char **err)
 {
 	char *err_str = NULL;
 	char *er = NULL;
@@ -472,7 +542,7 @@ switch_status_t pgsql_handle_exec_base_detailed(const char *file, const char *fu
 		handle->in_txn = SWITCH_TRUE;
 	}
 
-	if (pgsql_send_query(handle, sql) != SWITCH_STATUS_SUCCESS) {
+	if (pgsql_send_query_params(handle, sql, nparams, params) != SWITCH_STATUS_SUCCESS) {
 		er = strdup("Error sending query!");
 		if (pgsql_finish_results(handle) != SWITCH_STATUS_SUCCESS) {
 			db_is_up(handle);
@@ -512,6 +582,11 @@ error:
 	return SWITCH_STATUS_FALSE;
 }
 
+switch_status_t pgsql_handle_exec_base_detailed(const char *file, const char *func, int line,
+	switch_pgsql_handle_t *handle, const char *sql, char **err)
+{
+	return pgsql_handle_exec_base_params_detailed(file, func, line, handle, sql, 0, NULL, err);
+}
 
 switch_status_t pgsql_handle_exec_detailed(const char *file, const char *func, int line,
 	switch_pgsql_handle_t *handle, const char *sql, char **err)
@@ -878,8 +953,9 @@ switch_status_t database_rollback(switch_database_interface_handle_t *dih)
 	return SWITCH_STATUS_SUCCESS;
 }
 
-switch_status_t pgsql_handle_callback_exec_detailed(const char *file, const char *func, int line,
-	switch_database_interface_handle_t *dih, const char *sql, switch_core_db_callback_func_t callback, void *pdata, char **err)
+static switch_status_t pgsql_handle_callback_exec_params(const char *file, const char *func, int line,
+	switch_database_interface_handle_t *dih, const char *sql, int nparams, char **params,
+	switch_core_db_callback_func_t callback, void *pdata, char **err)
 {
 	char *err_str = NULL;
 	int row = 0, col = 0, err_cnt = 0;
@@ -901,7 +977,7 @@ switch_status_t pgsql_handle_callback_exec_detailed(const char *file, const char
 
 	switch_assert(callback != NULL);
 
-	if (pgsql_handle_exec_base(handle, sql, err) == SWITCH_STATUS_FALSE) {
+	if (pgsql_handle_exec_base_params_detailed(file, func, line, handle, sql, nparams, params, err) == SWITCH_STATUS_FALSE) {
 		goto error;
 	}
 
@@ -994,6 +1070,63 @@ error:
 	return SWITCH_STATUS_FALSE;
 }
 
+switch_status_t pgsql_handle_callback_exec_detailed(const char *file, const char *func, int line,
+	switch_database_interface_handle_t *dih, const char *sql, switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	return pgsql_handle_callback_exec_params(file, func, line, dih, sql, 0, NULL, callback, pdata, err);
+}
+
+/* the core binds ? placeholders, libpq numbers them $1..$n */
+static char *pgsql_number_params(const char *sql)
+{
+	switch_stream_handle_t stream = { 0 };
+	const char *p, *s;
+	char quote = 0;
+	int idx = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = s = sql; *p; p++) {
+		if (quote) {
+			if (*p == quote) quote = 0;
+		} else if (*p == '\'' || *p == '"') {
+			quote = *p;
+		} else if (*p == '?') {
+			stream.write_function(&stream, "%.*s$%d", (int)(p - s), s, ++idx);
+			s = p + 1;
+		}
+	}
+
+	stream.write_function(&stream, "%s", s);
+
+	return (char *) stream.data;
+}
+
+switch_status_t database_handle_exec_params_detailed(const char *file, const char *func, int line,
+	switch_database_interface_handle_t *dih, const char *sql, int argc, char **argv,
+	switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	switch_pgsql_handle_t *handle;
+	switch_status_t status;
+	char *psql;
+
+	if (!dih || !(handle = dih->handle)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	psql = pgsql_number_params(sql);
+
+	if (callback) {
+		status = pgsql_handle_callback_exec_params(file, func, line, dih, psql, argc, argv, callback, pdata, err);
+	} else if ((status = pgsql_handle_exec_base_params_detailed(file, func, line, handle, psql, argc, argv, err)) == SWITCH_STATUS_SUCCESS) {
+		status = pgsql_finish_results(handle);
+	}
+
+	switch_safe_free(psql);
+
+	return status;
+}
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_pgsql_load)
 {
 	switch_database_interface_t *database_interface;
@@ -1020,6 +1153,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_pgsql_load)
 	database_interface->commit = database_commit;
 	database_interface->rollback = database_rollback;
 	database_interface->callback_exec_detailed = pgsql_handle_callback_exec_detailed;
+	database_interface->exec_params_detailed = database_handle_exec_params_detailed;
 	
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -2992,6 +2992,8 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 					}
 					stream->write_function(stream, "Auto-NAT         \t%s\n", sofia_test_pflag(profile, PFLAG_AUTO_NAT) ? "true" : "false");
 					stream->write_function(stream, "DBName           \t%s\n", profile->dbname ? profile->dbname : switch_str_nil(profile->odbc_dsn));
+					sofia_reg_cache_status(profile, stream);
+					sofia_presence_index_status(profile, stream);
 					stream->write_function(stream, "Pres Hosts       \t%s\n", switch_str_nil(profile->presence_hosts));
 					stream->write_function(stream, "Dialplan         \t%s\n", switch_str_nil(profile->dialplan));
 					stream->write_function(stream, "Context          \t%s\n", switch_str_nil(profile->context));
@@ -4416,7 +4418,9 @@ SWITCH_STANDARD_API(sofia_function)
 		"--------------------------------------------------------------------------------\n"
 		"sofia global siptrace <on|off>\n"
 		"sofia        capture  <on|off>\n"
-		"             watchdog <on|off>\n\n"
+		"             watchdog <on|off>\n"
+		"             presence_stats\n"
+		"             presence_load <count> <user@host>\n\n"
 		"sofia profile <name> [start | stop | restart | rescan] [wait]\n"
 		"                     flush_inbound_reg [<call_id> | <[user]@domain>] [reboot]\n"
 		"                     check_sync [<call_id> | <[user]@domain>]\n"
@@ -4518,6 +4522,40 @@ SWITCH_STANDARD_API(sofia_function)
 				goto done;
 			}
 
+			if (!strcasecmp(argv[1], "presence_stats")) {
+				sofia_presence_stats(stream);
+				goto done;
+			}
+
+			if (!strcasecmp(argv[1], "presence_load")) {
+				int count = argc > 2 ? atoi(argv[2]) : 0, i;
+
+				if (count <= 0 || argc < 4 || !strchr(argv[3], '@')) {
+					stream->write_function(stream, "-ERR Usage: presence_load <count> <user@host>\n");
+					goto done;
+				}
+
+				/* alternate between ringing and answered so every event is a real state change */
+				for (i = 0; i < count; i++) {
+					switch_event_t *event;
+
+					if (switch_event_create(&event, SWITCH_EVENT_PRESENCE_IN) == SWITCH_STATUS_SUCCESS) {
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "proto", SOFIA_CHAT_PROTO);
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "login", argv[3]);
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "from", argv[3]);
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "status", (i % 2) ? "Talk" : "Ringing");
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "rpid", "unknown");
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "event_type", "presence");
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "alt_event_type", "dialog");
+						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "answer-state", (i % 2) ? "confirmed" : "early");
+						switch_event_fire(&event);
+					}
+				}
+
+				stream->write_function(stream, "+OK fired %d presence events for %s\n", count, argv[3]);
+				goto done;
+			}
+
 			if (!strcasecmp(argv[1], "siptrace")) {
 				if (argc > 2) {
 					ston = switch_true(argv[2]);
@@ -4556,7 +4594,7 @@ SWITCH_STANDARD_API(sofia_function)
 			sofia_glue_global_standby(stbyon);
 			stream->write_function(stream, "+OK Global standby %s", stbyon ? "on" : "off");
 		} else {
-			stream->write_function(stream, "-ERR Usage: siptrace <on|off>|capture <on|off>|watchdog <on|off>|debug <sla|presence|none");
+			stream->write_function(stream, "-ERR Usage: siptrace <on|off>|capture <on|off>|watchdog <on|off>|debug <sla|presence|none>|presence_stats|presence_load <count> <user@host>");
 		}
 
 		goto done;
@@ -6366,6 +6404,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_sofia_load)
 
 	switch_console_set_complete("add sofia global ::[siptrace::standby::capture::watchdog ::[on:off");
 	switch_console_set_complete("add sofia global debug ::[presence:sla:none");
+	switch_console_set_complete("add sofia global presence_stats");
+	switch_console_set_complete("add sofia global presence_load");
 
 	switch_console_set_complete("add sofia profile restart all");
 	switch_console_set_complete("add sofia profile ::sofia::list_profiles ::[start:rescan:restart:check_sync");
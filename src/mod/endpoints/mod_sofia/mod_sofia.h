@@ -70,6 +70,8 @@ typedef struct sofia_gateway_subscription sofia_gateway_subscription_t;
 
 struct sofia_profile;
 typedef struct sofia_profile sofia_profile_t;
+typedef struct sofia_reg_cache_s sofia_reg_cache_t;
+typedef struct sofia_pres_index_s sofia_pres_index_t;
 #define NUA_MAGIC_T sofia_profile_t
 
 typedef struct sofia_private sofia_private_t;
@@ -310,6 +312,8 @@ typedef enum {
 	PFLAG_AUTH_REQUIRE_USER,
 	PFLAG_AUTH_CALLS_ACL_ONLY,
 	PFLAG_USE_PORT_FOR_ACL_CHECK,
+	PFLAG_REG_CACHE,
+	PFLAG_PRESENCE_INDEX,
 
 	/* No new flags below this line */
 	PFLAG_MAX
@@ -405,6 +409,11 @@ struct mod_sofia_globals {
 	uint32_t max_reg_threads;
 	time_t presence_epoch;
 	int presence_year;
+	uint32_t presence_notify_interval;
+	uint32_t presence_events;
+	uint32_t presence_coalesced;
+	uint32_t presence_skipped;
+	switch_atomic_t presence_notifies;
 };
 extern struct mod_sofia_globals mod_sofia_globals;
 
@@ -691,6 +700,8 @@ struct sofia_profile {
 	switch_hash_t *chat_hash;
 	switch_hash_t *reg_nh_hash;
 	switch_hash_t *mwi_debounce_hash;
+	sofia_reg_cache_t *reg_cache;
+	sofia_pres_index_t *pres_index;
 	//switch_core_db_t *master_db;
 	switch_thread_rwlock_t *rwlock;
 	switch_mutex_t *flag_mutex;
@@ -706,6 +717,7 @@ struct sofia_profile {
 	char *post_trans_execute;
 	char *inner_pre_trans_execute;
 	char *inner_post_trans_execute;
+	uint32_t db_writers;
 	switch_sql_queue_manager_t *qm;
 	char *acl[SOFIA_MAX_ACL];
 	char *acl_pass_context[SOFIA_MAX_ACL];
@@ -1043,6 +1055,7 @@ void sofia_presence_handle_sip_i_subscribe(int status, char const *phrase, nua_t
 								sofia_dispatch_event_t *de, tagi_t tags[]);
 
 void sofia_glue_execute_sql(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic);
+void sofia_glue_execute_sql_key(sofia_profile_t *profile, const char *key, char **sqlp, switch_bool_t sql_already_dynamic);
 void sofia_glue_actually_execute_sql(sofia_profile_t *profile, char *sql, switch_mutex_t *mutex);
 void sofia_glue_actually_execute_sql_trans(sofia_profile_t *profile, char *sql, switch_mutex_t *mutex);
 void sofia_glue_execute_sql_now(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic);
@@ -1075,6 +1088,8 @@ char *sofia_overcome_sip_uri_weakness(switch_core_session_t *session, const char
 									  const char *params, const char *invite_tel_params);
 switch_bool_t sofia_glue_execute_sql_callback(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, switch_core_db_callback_func_t callback,
 											  void *pdata);
+switch_bool_t sofia_glue_execute_prepared_callback(sofia_profile_t *profile, switch_mutex_t *mutex, const char *sql, int argc, const char **argv,
+												   switch_core_db_callback_func_t callback, void *pdata);
 char *sofia_glue_execute_sql2str(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, char *resbuf, size_t len);
 void sofia_glue_del_profile(sofia_profile_t *profile);
 
@@ -1222,6 +1237,23 @@ const char *sofia_sip_user_status_name(sofia_sip_user_status_t status);
 void sofia_reg_fire_custom_sip_user_state_event(sofia_profile_t *profile, const char *sip_user, const char *contact,
 							const char* from_user, const char* from_host, const char *call_id, sofia_sip_user_status_t status, int options_res, const char *phrase);
 uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const char *host);
+void sofia_reg_cache_create(sofia_profile_t *profile);
+void sofia_reg_cache_destroy(sofia_profile_t *profile);
+void sofia_reg_cache_add(sofia_profile_t *profile, const char *call_id, const char *user, const char *host, const char *username,
+						 const char *contact, const char *presence_hosts, const char *network_ip, const char *network_port,
+						 long expires, switch_bool_t update);
+void sofia_reg_cache_del_user(sofia_profile_t *profile, const char *user, const char *host, const char *contact, long keep_expires);
+void sofia_reg_cache_del_contact(sofia_profile_t *profile, const char *contact, long keep_expires);
+void sofia_reg_cache_del_call_id(sofia_profile_t *profile, const char *call_id, const char *network_ip, const char *network_port, long keep_expires);
+void sofia_reg_cache_del_host(sofia_profile_t *profile, const char *host);
+void sofia_reg_cache_set_expires(sofia_profile_t *profile, const char *user, const char *host, const char *call_id, long expires);
+void sofia_reg_cache_expire(sofia_profile_t *profile, time_t now);
+uint32_t sofia_reg_cache_count(sofia_profile_t *profile, const char *user, const char *host, const char *username, const char *contact,
+							   const char *not_call_id, switch_bool_t exact_host);
+void sofia_reg_cache_nonce_add(sofia_profile_t *profile, const char *nonce, long expires, unsigned long last_nc);
+switch_bool_t sofia_reg_cache_nonce_find(sofia_profile_t *profile, const char *nonce, unsigned long *last_nc);
+void sofia_reg_cache_nonce_del(sofia_profile_t *profile, const char *nonce);
+void sofia_reg_cache_status(sofia_profile_t *profile, switch_stream_handle_t *stream);
 char *sofia_media_get_multipart(switch_core_session_t *session, const char *prefix, const char *sdp, char **mp_type);
 int sofia_glue_tech_simplify(private_object_t *tech_pvt);
 switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *profile, const char *user, const char *host);
@@ -1239,6 +1271,16 @@ void sofia_process_dispatch_event(sofia_dispatch_event_t **dep);
 void sofia_process_dispatch_event_in_thread(sofia_dispatch_event_t **dep);
 char *sofia_glue_get_host(const char *str, switch_memory_pool_t *pool);
 void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now);
+void sofia_presence_index_create(sofia_profile_t *profile);
+void sofia_presence_index_load(sofia_profile_t *profile);
+void sofia_presence_index_destroy(sofia_profile_t *profile);
+void sofia_presence_index_add(sofia_profile_t *profile, const char *call_id, const char *sub_to_user);
+void sofia_presence_index_del(sofia_profile_t *profile, const char *call_id);
+void sofia_presence_index_clear(sofia_profile_t *profile);
+switch_bool_t sofia_presence_index_watched(sofia_profile_t *profile, const char *sub_to_user);
+switch_bool_t sofia_presence_index_subscribed(sofia_profile_t *profile, const char *call_id);
+void sofia_presence_index_status(sofia_profile_t *profile, switch_stream_handle_t *stream);
+void sofia_presence_stats(switch_stream_handle_t *stream);
 void sofia_msg_thread_start(int idx);
 void crtp_init(switch_loadable_module_interface_t *module_interface);
 int sofia_recover_callback(switch_core_session_t *session);
@@ -144,6 +144,7 @@ void sofia_handle_sip_r_notify(switch_core_session_t *session, int status,
 		sql = switch_mprintf("delete from sip_subscriptions where call_id='%q'", sip->sip_call_id->i_id);
 		switch_assert(sql != NULL);
 		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		sofia_presence_index_del(profile, sip->sip_call_id->i_id);
 		nua_handle_destroy(nh);
 	}
 
@@ -2045,7 +2046,7 @@ static void our_sofia_event_callback(nua_event_t event,
 									  profile->name, from_user, from_host, to_user, to_host, sql);
 				}
 
-
+				sofia_presence_index_add(profile, call_id, to_user);
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
 				sip_to_tag(nh->nh_home, sip->sip_to, to_tag);
@@ -2072,6 +2073,7 @@ static void our_sofia_event_callback(nua_event_t event,
 
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q' and network_ip='%q' and network_port='%q'",
 										   sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port);
+				sofia_reg_cache_del_call_id(profile, sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port, 0);
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "SOCKET DISCONNECT: %s %s:%s\n",
 								  sofia_private->call_id, sofia_private->network_ip, sofia_private->network_port);
 				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
@@ -2664,6 +2666,7 @@ void sofia_event_callback(nua_event_t event,
 void event_handler(switch_event_t *event)
 {
 	char *subclass, *sql;
+	char reg_key[512];
 	char *class;
 	switch_event_t *pevent;
 
@@ -2736,8 +2739,10 @@ void event_handler(switch_event_t *event)
 
 		if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
 			sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+			sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, 0);
 		} else {
 			sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", from_user, from_host);
+			sofia_reg_cache_del_user(profile, from_user, from_host, NULL, 0);
 		}
 
 		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
@@ -2800,8 +2805,10 @@ void event_handler(switch_event_t *event)
 		}
 		if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
 			sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+			sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, 0);
 		} else {
 			sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", from_user, from_host);
+			sofia_reg_cache_del_user(profile, from_user, from_host, NULL, 0);
 		}
 
 		if (mod_sofia_globals.rewrite_multicasted_fs_path && contact_str) {
@@ -2840,7 +2847,8 @@ void event_handler(switch_event_t *event)
 		}
 
 
-		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		switch_snprintf(reg_key, sizeof(reg_key), "%s@%s", from_user, from_host);
+		sofia_glue_execute_sql_key(profile, reg_key, &sql, SWITCH_TRUE);
 
 		switch_find_local_ip(guess_ip4, sizeof(guess_ip4), NULL, AF_INET);
 		sql = switch_mprintf("insert into sip_registrations "
@@ -2853,10 +2861,12 @@ void event_handler(switch_event_t *event)
 							 orig_server_host, orig_hostname, "Reachable", 0);
 
 		if (sql) {
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			sofia_glue_execute_sql_key(profile, reg_key, &sql, SWITCH_TRUE);
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Propagating registration for %s@%s->%s\n", from_user, from_host, contact_str);
 		}
 
+		sofia_reg_cache_add(profile, call_id, from_user, from_host, username, contact_str, presence_hosts, network_ip, network_port, expires, SWITCH_FALSE);
+
 
 		sofia_glue_release_profile(profile);
 	  end:
@@ -2881,7 +2891,8 @@ void event_handler(switch_event_t *event)
 								 	"Unreachable", from_user, from_host, call_id);
 			}
 			if (sql) {
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				switch_snprintf(reg_key, sizeof(reg_key), "%s@%s", from_user, from_host);
+				sofia_glue_execute_sql_key(profile, reg_key, &sql, SWITCH_TRUE);
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Propagating sip_user_state for %s@%s. Ping-Status: %s\n", from_user, from_host, ping_status);
 			}
 
@@ -3149,6 +3160,15 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		goto end;
 	}
 
+	if (sofia_test_pflag(profile, PFLAG_REG_CACHE)) {
+		sofia_reg_cache_create(profile);
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_PRESENCE_INDEX)) {
+		sofia_presence_index_create(profile);
+		sofia_presence_index_load(profile);
+	}
+
 	supported = switch_core_sprintf(profile->pool, "%s%s%spath, replaces", use_100rel ? "precondition, 100rel, " : "", use_timer ? "timer, " : "", use_rfc_5626 ? "outbound, " : "");
 
 	if (sofia_test_pflag(profile, PFLAG_AUTO_NAT) && switch_nat_get_type()) {
@@ -3373,6 +3393,9 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 									   profile->post_trans_execute,
 									   profile->inner_pre_trans_execute,
 									   profile->inner_post_trans_execute);
+	if (profile->db_writers > 1) {
+		switch_sql_queue_manager_set_writers(profile->qm, profile->db_writers, 0, SWITCH_SQL_QUEUE_POLICY_BLOCK);
+	}
 	switch_sql_queue_manager_start(profile->qm);
 
 	if (switch_event_create(&s_event, SWITCH_EVENT_PUBLISH) == SWITCH_STATUS_SUCCESS) {
@@ -3503,6 +3526,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 	switch_core_hash_destroy(&profile->chat_hash);
 	switch_core_hash_destroy(&profile->reg_nh_hash);
 	switch_core_hash_destroy(&profile->mwi_debounce_hash);
+	sofia_reg_cache_destroy(profile);
+	sofia_presence_index_destroy(profile);
 
 	switch_thread_rwlock_unlock(profile->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write unlock %s\n", profile->name);
@@ -4422,6 +4447,10 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 				mod_sofia_globals.debug_presence = atoi(val);
 			} else if (!strcasecmp(var, "debug-sla")) {
 				mod_sofia_globals.debug_sla = atoi(val);
+			} else if (!strcasecmp(var, "presence-notify-min-interval")) {
+				int x = atoi(val);
+
+				mod_sofia_globals.presence_notify_interval = x > 0 ? x : 0;
 			} else if (!strcasecmp(var, "max-reg-threads") && val) {
 				int x = atoi(val);
 
@@ -4682,6 +4711,12 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						profile->inner_pre_trans_execute = switch_core_strdup(profile->pool, val);
 					} else if (!strcasecmp(var, "db-inner-post-trans-execute") && !zstr(val)) {
 						profile->inner_post_trans_execute = switch_core_strdup(profile->pool, val);
+					} else if (!strcasecmp(var, "db-writers") && !zstr(val)) {
+						int tmp = atoi(val);
+
+						if (tmp > 0) {
+							profile->db_writers = (uint32_t) tmp;
+						}
 					} else if (!strcasecmp(var, "forward-unsolicited-mwi-notify")) {
 						if (switch_true(val)) {
 							sofia_set_pflag(profile, PFLAG_FORWARD_MWI_NOTIFY);
@@ -4749,6 +4784,18 @@ switch_status_t config_sofia(sofia_config_t reload, char *profile_name)
 						} else {
 							sofia_clear_pflag(profile, PFLAG_TCP_UNREG_ON_SOCKET_CLOSE);
 						}
+					} else if (!strcasecmp(var, "registration-cache")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_REG_CACHE);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_REG_CACHE);
+						}
+					} else if (!strcasecmp(var, "presence-index")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_PRESENCE_INDEX);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_PRESENCE_INDEX);
+						}
 					} else if (!strcasecmp(var, "tcp-always-nat")) {
 						if (switch_true(val)) {
 							sofia_set_pflag(profile, PFLAG_TCP_ALWAYS_NAT);
@@ -6358,7 +6405,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 						  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, status, sip_user_status.count, sip_user_status.status);
 				sql = switch_mprintf("update sip_registrations set ping_count=%d, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 									 sip_user_status.count, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				sofia_glue_execute_sql_key(profile, sip_user, &sql, SWITCH_TRUE);
 				switch_safe_free(sql);
 			}
 			if (sip_user_status.count < sip_user_ping_min) {
@@ -6367,7 +6414,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 							  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 					sql = switch_mprintf("update sip_registrations set ping_status='Unreachable', ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 										 ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-					sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					sofia_glue_execute_sql_key(profile, sip_user, &sql, SWITCH_TRUE);
 					switch_safe_free(sql);
 					sofia_reg_fire_custom_sip_user_state_event(profile, sip_user, sip_user_status.contact, sip->sip_to->a_url->url_user,
 															   sip->sip_to->a_url->url_host, call_id, SOFIA_REG_REACHABLE, status, phrase);
@@ -6379,7 +6426,8 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 
 						sql = switch_mprintf("update sip_registrations set expires=%ld, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 											 (long) now, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-						sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+						sofia_glue_execute_sql_key(profile, sip_user, &sql, SWITCH_TRUE);
+						sofia_reg_cache_set_expires(profile, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id, (long) now);
 						switch_safe_free(sql);
 					}
 				}
@@ -6391,7 +6439,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 						  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, status, sip_user_status.count, sip_user_status.status);
 				sql = switch_mprintf("update sip_registrations set ping_count=%d, ping_time=%d where sip_user='%q' and sip_host='%q' and call_id='%q'",
 									 sip_user_status.count, ping_time, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				sofia_glue_execute_sql_key(profile, sip_user, &sql, SWITCH_TRUE);
 				switch_safe_free(sql);
 			}
 			if (sip_user_status.count >= sip_user_ping_min) {
@@ -6400,7 +6448,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 							  sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 					sql = switch_mprintf("update sip_registrations set ping_status='Reachable' where sip_user='%q' and sip_host='%q' and call_id='%q'",
 							     sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, call_id);
-					sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+					sofia_glue_execute_sql_key(profile, sip_user, &sql, SWITCH_TRUE);
 					switch_safe_free(sql);
 					sofia_reg_fire_custom_sip_user_state_event(profile, sip_user, sip_user_status.contact, sip->sip_to->a_url->url_user,
 															   sip->sip_to->a_url->url_host, call_id, SOFIA_REG_UNREACHABLE, status, phrase);
@@ -2697,6 +2697,21 @@ void sofia_glue_execute_sql(sofia_profile_t *profile, char **sqlp, switch_bool_t
 	}
 }
 
+/* statements with the same key (user@host, nonce ...) stay in order, different keys may go to different db-writers */
+void sofia_glue_execute_sql_key(sofia_profile_t *profile, const char *key, char **sqlp, switch_bool_t sql_already_dynamic)
+{
+	char *sql;
+
+	switch_assert(sqlp && *sqlp);
+	sql = *sqlp;
+
+	switch_sql_queue_manager_push_key(profile->qm, key, sql, 1, !sql_already_dynamic);
+
+	if (sql_already_dynamic) {
+		*sqlp = NULL;
+	}
+}
+
 
 void sofia_glue_execute_sql_now(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic)
 {
@@ -2848,6 +2863,53 @@ switch_bool_t sofia_glue_execute_sql_callback(sofia_profile_t *profile,
 	return ret;
 }
 
+switch_bool_t sofia_glue_execute_prepared_callback(sofia_profile_t *profile, switch_mutex_t *mutex, const char *sql, int argc, const char **argv,
+												   switch_core_db_callback_func_t callback, void *pdata)
+{
+	switch_bool_t ret = SWITCH_FALSE;
+	char *errmsg = NULL;
+	switch_cache_db_handle_t *dbh = NULL;
+	switch_cache_db_stmt_t *stmt = NULL;
+	int i;
+
+	if (mutex) {
+		switch_mutex_lock(mutex);
+	}
+
+	if (!(dbh = sofia_glue_get_db_handle(profile))) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening DB\n");
+
+		if (mutex) {
+			switch_mutex_unlock(mutex);
+		}
+
+		return ret;
+	}
+
+	if (switch_cache_db_prepare(dbh, sql, &stmt) == SWITCH_STATUS_SUCCESS) {
+		for (i = 0; i < argc; i++) {
+			switch_cache_db_stmt_bind_text(stmt, i + 1, argv[i]);
+		}
+
+		if (switch_cache_db_stmt_execute(stmt, callback, pdata, &errmsg) == SWITCH_STATUS_SUCCESS) {
+			ret = SWITCH_TRUE;
+		}
+	}
+
+	if (mutex) {
+		switch_mutex_unlock(mutex);
+	}
+
+	if (errmsg) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR: [%s] %s\n", sql, errmsg);
+		free(errmsg);
+	}
+
+	switch_cache_db_release_db_handle(&dbh);
+
+	return ret;
+}
+
 char *sofia_glue_execute_sql2str(sofia_profile_t *profile, switch_mutex_t *mutex, char *sql, char *resbuf, size_t len)
 {
 	char *ret = NULL;
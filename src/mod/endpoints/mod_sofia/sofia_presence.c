@@ -61,6 +61,7 @@ static int sofia_dialog_probe_notify_callback(void *pArg, int argc, char **argv,
 struct pres_sql_cb {
 	sofia_profile_t *profile;
 	int ttl;
+	switch_bool_t unindex;
 };
 
 static int sofia_presence_send_sql(void *pArg, int argc, char **argv, char **columnNames);
@@ -1036,6 +1037,7 @@ static void send_conference_data(sofia_profile_t *profile, switch_event_t *event
 								 "and call_id = '%q' ",
 								 mod_sofia_globals.hostname, profile->name,
 								 from_user, from_host, event_str, call_id);
+			sofia_presence_index_del(profile, call_id);
 
 		} else {
 			sql = switch_mprintf("delete from sip_subscriptions where "
@@ -1358,6 +1360,13 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 					proto = SOFIA_CHAT_PROTO;
 				}
 
+				if (zstr(call_id) ? !sofia_presence_index_watched(profile, euser) : !sofia_presence_index_subscribed(profile, call_id)) {
+					/* nobody subscribed to this user, or the subscription this event targets is gone, there is nobody to notify */
+					mod_sofia_globals.presence_skipped++;
+					sofia_glue_release_profile(profile);
+					continue;
+				}
+
 				if (zstr(uuid)) {
 
 					sql = switch_mprintf("select state,status,rpid,presence_id,uuid from sip_dialogs "
@@ -1587,6 +1596,196 @@ static switch_event_t *actual_sofia_presence_event_handler(switch_event_t *event
 static int EVENT_THREAD_RUNNING = 0;
 static int EVENT_THREAD_STARTED = 0;
 
+/* A presence event held back because its presence id notified less than presence-notify-min-interval ago.
+   A newer event for the same channel and presence id replaces it, so only the latest state goes out.
+   The limit is kept per presence id rather than per subscriber: one event is fanned out to every
+   subscriber of the id in a single pass, so holding the event bounds the NOTIFY rate each of them
+   sees for that id, and a subscriber watching many ids still gets every id's latest state. */
+typedef struct pres_held_s {
+	char *key;
+	char *from;
+	switch_event_t *event;
+	switch_time_t due;
+	struct pres_held_s *next;
+} pres_held_t;
+
+/* only touched by the presence event thread */
+static struct {
+	switch_hash_t *last;
+	switch_hash_t *held;
+	pres_held_t *list;
+	pres_held_t *tail;
+	uint32_t count;
+	switch_time_t pruned;
+	uint32_t stats_notifies;
+	switch_time_t stats_time;
+} pres_rate;
+
+static void process_presence_event(switch_event_t *event)
+{
+	switch (event->event_id) {
+	case SWITCH_EVENT_MESSAGE_WAITING:
+		actual_sofia_presence_mwi_event_handler(event);
+		break;
+	case SWITCH_EVENT_CONFERENCE_DATA:
+		conference_data_event_handler(event);
+		break;
+	default:
+		do {
+			switch_event_t *ievent = event;
+			event = actual_sofia_presence_event_handler(ievent);
+			switch_event_destroy(&ievent);
+		} while (event);
+		break;
+	}
+
+	switch_event_destroy(&event);
+	mod_sofia_globals.presence_events++;
+}
+
+static void pres_rate_touch(const char *from, switch_time_t now)
+{
+	switch_time_t *last;
+
+	if (!(last = (switch_time_t *) switch_core_hash_find(pres_rate.last, from))) {
+		switch_zmalloc(last, sizeof(*last));
+		switch_core_hash_insert(pres_rate.last, from, last);
+	}
+
+	*last = now;
+}
+
+/* Take ownership of the event when it has to wait for its presence id's interval to pass */
+static switch_bool_t pres_rate_hold(switch_event_t **eventp)
+{
+	switch_event_t *event = *eventp;
+	const char *from = switch_event_get_header(event, "from");
+	switch_time_t now = switch_micro_time_now(), interval = (switch_time_t) mod_sofia_globals.presence_notify_interval * 1000, *last;
+	pres_held_t *held;
+	char *key;
+
+	if (!interval || zstr(from) || (event->event_id != SWITCH_EVENT_PRESENCE_IN && event->event_id != SWITCH_EVENT_PRESENCE_OUT) ||
+		switch_event_get_header(event, "presence-call-info")) {
+		return SWITCH_FALSE;
+	}
+
+	key = switch_mprintf("%s|%s|%s|%s", from, switch_str_nil(switch_event_get_header(event, "unique-id")),
+						 switch_str_nil(switch_event_get_header(event, "call-id")), switch_str_nil(switch_event_get_header(event, "event_type")));
+	switch_assert(key);
+
+	if ((held = (pres_held_t *) switch_core_hash_find(pres_rate.held, key))) {
+		switch_event_destroy(&held->event);
+		held->event = event;
+		*eventp = NULL;
+		mod_sofia_globals.presence_coalesced++;
+		free(key);
+		return SWITCH_TRUE;
+	}
+
+	if ((last = (switch_time_t *) switch_core_hash_find(pres_rate.last, from)) && now - *last < interval) {
+		switch_zmalloc(held, sizeof(*held));
+		held->key = key;
+		held->from = strdup(from);
+		held->event = event;
+		held->due = *last + interval;
+
+		/* append so events held for the same presence id go out in the order they happened */
+		if (pres_rate.tail) {
+			pres_rate.tail->next = held;
+		} else {
+			pres_rate.list = held;
+		}
+		pres_rate.tail = held;
+		pres_rate.count++;
+		switch_core_hash_insert(pres_rate.held, key, held);
+		*eventp = NULL;
+		return SWITCH_TRUE;
+	}
+
+	pres_rate_touch(from, now);
+	free(key);
+
+	return SWITCH_FALSE;
+}
+
+/* Send held events whose interval has passed, or drop them all when shutting down */
+static void pres_rate_release(switch_bool_t drop)
+{
+	switch_time_t now = switch_micro_time_now();
+	pres_held_t *held, *prev = NULL, **pp = &pres_rate.list;
+
+	while ((held = *pp)) {
+		if (drop || held->due <= now) {
+			*pp = held->next;
+			if (pres_rate.tail == held) {
+				pres_rate.tail = prev;
+			}
+			pres_rate.count--;
+			switch_core_hash_delete(pres_rate.held, held->key);
+
+			if (drop) {
+				switch_event_destroy(&held->event);
+			} else {
+				pres_rate_touch(held->from, now);
+				process_presence_event(held->event);
+			}
+
+			free(held->key);
+			free(held->from);
+			free(held);
+		} else {
+			prev = held;
+			pp = &held->next;
+		}
+	}
+
+	if (drop || now - pres_rate.pruned > 10000000) {
+		switch_hash_index_t *hi;
+		const void *var;
+		void *val;
+		char *stale[64];
+		int i, n;
+
+		/* forget presence ids that have been quiet for longer than the interval */
+		do {
+			n = 0;
+			for (hi = switch_core_hash_first(pres_rate.last); hi && n < 64; hi = switch_core_hash_next(&hi)) {
+				switch_core_hash_this(hi, &var, NULL, &val);
+				if (drop || now - *(switch_time_t *) val > (switch_time_t) mod_sofia_globals.presence_notify_interval * 1000) {
+					stale[n++] = strdup((const char *) var);
+				}
+			}
+			switch_safe_free(hi);
+
+			for (i = 0; i < n; i++) {
+				free(switch_core_hash_delete(pres_rate.last, stale[i]));
+				free(stale[i]);
+			}
+		} while (n == 64);
+
+		pres_rate.pruned = now;
+	}
+}
+
+void sofia_presence_stats(switch_stream_handle_t *stream)
+{
+	uint32_t notifies = switch_atomic_read(&mod_sofia_globals.presence_notifies);
+	switch_time_t now = switch_micro_time_now();
+	double rate = 0;
+
+	switch_mutex_lock(mod_sofia_globals.mutex);
+	if (pres_rate.stats_time && now > pres_rate.stats_time) {
+		rate = (double) (notifies - pres_rate.stats_notifies) * 1000000 / (now - pres_rate.stats_time);
+	}
+	pres_rate.stats_notifies = notifies;
+	pres_rate.stats_time = now;
+	switch_mutex_unlock(mod_sofia_globals.mutex);
+
+	stream->write_function(stream, "events: %u\ncoalesced: %u\nheld: %u\nskipped-unwatched: %u\nnotifies: %u\nnotifies-per-sec: %.1f\nmin-interval-ms: %u\n",
+						   mod_sofia_globals.presence_events, mod_sofia_globals.presence_coalesced, pres_rate.count,
+						   mod_sofia_globals.presence_skipped, notifies, rate, mod_sofia_globals.presence_notify_interval);
+}
+
 static void do_flush(void)
 {
 	void *pop = NULL;
@@ -1618,10 +1817,19 @@ void *SWITCH_THREAD_FUNC sofia_presence_event_thread_run(switch_thread_t *thread
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Event Thread Started\n");
 
+	switch_core_hash_init(&pres_rate.last);
+	switch_core_hash_init(&pres_rate.held);
+
 	while (mod_sofia_globals.running == 1) {
-		int count = 0;
+		switch_status_t status;
 
-		if (switch_queue_pop(mod_sofia_globals.presence_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		if (pres_rate.list) {
+			status = switch_queue_pop_timeout(mod_sofia_globals.presence_queue, &pop, 20000);
+		} else {
+			status = switch_queue_pop(mod_sofia_globals.presence_queue, &pop);
+		}
+
+		if (status == SWITCH_STATUS_SUCCESS) {
 			switch_event_t *event = (switch_event_t *) pop;
 
 			if (!pop) {
@@ -1637,28 +1845,20 @@ void *SWITCH_THREAD_FUNC sofia_presence_event_thread_run(switch_thread_t *thread
 				switch_mutex_unlock(mod_sofia_globals.mutex);
 			}
 
-			switch(event->event_id) {
-			case SWITCH_EVENT_MESSAGE_WAITING:
-				actual_sofia_presence_mwi_event_handler(event);
-				break;
-			case SWITCH_EVENT_CONFERENCE_DATA:
-				conference_data_event_handler(event);
-				break;
-			default:
-				do {
-					switch_event_t *ievent = event;
-					event = actual_sofia_presence_event_handler(ievent);
-					switch_event_destroy(&ievent);
-				} while (event);
-				break;
+			if (!pres_rate_hold(&event)) {
+				process_presence_event(event);
 			}
+		}
 
-			switch_event_destroy(&event);
-			count++;
+		if (pres_rate.list) {
+			pres_rate_release(SWITCH_FALSE);
 		}
 	}
 
 	do_flush();
+	pres_rate_release(SWITCH_TRUE);
+	switch_core_hash_destroy(&pres_rate.held);
+	switch_core_hash_destroy(&pres_rate.last);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Event Thread Ended\n");
 
@@ -2337,6 +2537,7 @@ static void _send_presence_notify(sofia_profile_t *profile,
 	cseq = sip_cseq_create(nh->nh_home, callsequence, SIP_METHOD_NOTIFY);
 	nua_handle_bind(nh, &mod_sofia_globals.destroy_private);
 
+	switch_atomic_inc(&mod_sofia_globals.presence_notifies);
 
 	nua_notify(nh,
 			   NUTAG_NEWSUB(1),
@@ -3924,6 +4125,8 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 		}
 
 		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		/* a refresh racing the expiry sweep keeps its row, so keep it indexed too */
+		sofia_presence_index_add(profile, call_id, to_user);
 	} else {
 
 		if (sub_state == nua_substate_terminated) {
@@ -3937,6 +4140,7 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 
 			switch_assert(sql != NULL);
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_presence_index_del(profile, call_id);
 			sstr = switch_mprintf("terminated;reason=noresource");
 
 		} else {
@@ -3969,7 +4173,8 @@ void sofia_presence_handle_sip_i_subscribe(int status,
 								  profile->name, from_user, from_host, to_user, to_host, sql);
 			}
 
-
+			/* index before the row exists, a presence event in between then just costs a query */
+			sofia_presence_index_add(profile, call_id, to_user);
 			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 			sstr = switch_mprintf("active;expires=%ld", exp_delta);
 		}
@@ -4528,6 +4733,10 @@ static int sofia_presence_send_sql(void *pArg, int argc, char **argv, char **col
 	send_presence_notify(cb->profile, argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6], argv[7], argv[8], argv[9], NULL);
 	cb->ttl++;
 
+	if (cb->unindex) {
+		sofia_presence_index_del(cb->profile, argv[4]);
+	}
+
 	return 0;
 }
 
@@ -5057,12 +5266,203 @@ void sofia_presence_set_chat_hash(private_object_t *tech_pvt, sip_t const *sip)
 }
 
 
+/* Which users somebody is subscribed to, and by which subscriptions. A user or call id missing
+   from the index has no rows in sip_subscriptions, so presence events for that user, or aimed
+   at that subscription, can skip the database entirely.
+   Entries are only dropped on known deletes; a stale entry just costs a query. */
+struct sofia_pres_index_s {
+	switch_mutex_t *mutex;
+	switch_hash_t *users;
+	switch_hash_t *call_ids;
+	uint32_t count;
+};
+
+static int pres_index_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) pArg;
+
+	if (argc > 1) {
+		sofia_presence_index_add(profile, argv[0], argv[1]);
+	}
+
+	return 0;
+}
+
+void sofia_presence_index_create(sofia_profile_t *profile)
+{
+	sofia_pres_index_t *index;
+
+	index = switch_core_alloc(profile->pool, sizeof(*index));
+	switch_mutex_init(&index->mutex, SWITCH_MUTEX_NESTED, profile->pool);
+	/* the subscription queries compare users the way the database does, which may ignore case */
+	switch_core_hash_init_case(&index->users, SWITCH_FALSE);
+	switch_core_hash_init(&index->call_ids);
+
+	profile->pres_index = index;
+}
+
+void sofia_presence_index_load(sofia_profile_t *profile)
+{
+	char *sql;
+
+	if (!profile->pres_index) {
+		return;
+	}
+
+	sql = switch_mprintf("select call_id,sub_to_user from sip_subscriptions where profile_name='%q' and hostname='%q'",
+						 profile->name, mod_sofia_globals.hostname);
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, pres_index_load_callback, profile);
+	switch_safe_free(sql);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Loaded %u subscriptions into the presence index for %s\n",
+					  profile->pres_index->count, profile->name);
+}
+
+static void pres_index_unlink(sofia_pres_index_t *index, const char *call_id)
+{
+	char *user;
+	uint32_t *watchers;
+
+	if (!(user = (char *) switch_core_hash_delete(index->call_ids, call_id))) {
+		return;
+	}
+
+	if ((watchers = (uint32_t *) switch_core_hash_find(index->users, user)) && !--*watchers) {
+		free(switch_core_hash_delete(index->users, user));
+	}
+
+	index->count--;
+	free(user);
+}
+
+void sofia_presence_index_add(sofia_profile_t *profile, const char *call_id, const char *sub_to_user)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+	uint32_t *watchers;
+	char *user;
+
+	if (!index || zstr(call_id) || zstr(sub_to_user)) {
+		return;
+	}
+
+	switch_mutex_lock(index->mutex);
+	pres_index_unlink(index, call_id);
+
+	if (!(watchers = (uint32_t *) switch_core_hash_find(index->users, sub_to_user))) {
+		switch_zmalloc(watchers, sizeof(*watchers));
+		switch_core_hash_insert(index->users, sub_to_user, watchers);
+	}
+	(*watchers)++;
+
+	user = strdup(sub_to_user);
+	switch_assert(user);
+	switch_core_hash_insert(index->call_ids, call_id, user);
+	index->count++;
+	switch_mutex_unlock(index->mutex);
+}
+
+void sofia_presence_index_del(sofia_profile_t *profile, const char *call_id)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+
+	if (!index || zstr(call_id)) {
+		return;
+	}
+
+	switch_mutex_lock(index->mutex);
+	pres_index_unlink(index, call_id);
+	switch_mutex_unlock(index->mutex);
+}
+
+void sofia_presence_index_clear(sofia_profile_t *profile)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+
+	if (!index) {
+		return;
+	}
+
+	switch_mutex_lock(index->mutex);
+	while (index->count) {
+		switch_hash_index_t *hi = switch_core_hash_first(index->call_ids);
+		const void *var;
+		char *call_id;
+
+		switch_core_hash_this(hi, &var, NULL, NULL);
+		call_id = strdup((const char *) var);
+		switch_safe_free(hi);
+		pres_index_unlink(index, call_id);
+		free(call_id);
+	}
+	switch_mutex_unlock(index->mutex);
+}
+
+void sofia_presence_index_destroy(sofia_profile_t *profile)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+
+	if (!index) {
+		return;
+	}
+
+	sofia_presence_index_clear(profile);
+	profile->pres_index = NULL;
+
+	switch_core_hash_destroy(&index->users);
+	switch_core_hash_destroy(&index->call_ids);
+}
+
+switch_bool_t sofia_presence_index_watched(sofia_profile_t *profile, const char *sub_to_user)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+	switch_bool_t r;
+
+	if (!index || zstr(sub_to_user)) {
+		return SWITCH_TRUE;
+	}
+
+	switch_mutex_lock(index->mutex);
+	r = switch_core_hash_find(index->users, sub_to_user) ? SWITCH_TRUE : SWITCH_FALSE;
+	switch_mutex_unlock(index->mutex);
+
+	return r;
+}
+
+switch_bool_t sofia_presence_index_subscribed(sofia_profile_t *profile, const char *call_id)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+	switch_bool_t r;
+
+	if (!index || zstr(call_id)) {
+		return SWITCH_TRUE;
+	}
+
+	switch_mutex_lock(index->mutex);
+	r = switch_core_hash_find(index->call_ids, call_id) ? SWITCH_TRUE : SWITCH_FALSE;
+	switch_mutex_unlock(index->mutex);
+
+	return r;
+}
+
+void sofia_presence_index_status(sofia_profile_t *profile, switch_stream_handle_t *stream)
+{
+	sofia_pres_index_t *index = profile->pres_index;
+
+	if (!index) {
+		return;
+	}
+
+	switch_mutex_lock(index->mutex);
+	stream->write_function(stream, "Pres Index       \t%u subscriptions\n", index->count);
+	switch_mutex_unlock(index->mutex);
+}
+
 void sofia_presence_check_subscriptions(sofia_profile_t *profile, time_t now)
 {
 	char *sql;
 
 	if (now) {
-		struct pres_sql_cb cb = {profile, 0};
+		struct pres_sql_cb cb = {profile, 0, SWITCH_TRUE};
 
 		if (profile->pres_type != PRES_TYPE_FULL) {
 			if (mod_sofia_globals.debug_presence > 0) {
@@ -541,6 +541,645 @@ void sofia_reg_check_gateway(sofia_profile_t *profile, time_t now)
 }
 
 
+/* In-memory registration and nonce store.
+ *
+ * Mirrors the rows this node writes to sip_registrations and sip_authentication so the
+ * REGISTER and INVITE hot paths can answer from memory and push their writes to the
+ * profile's sql queue instead of waiting on the database.  Entries are indexed by
+ * sip_user (chained across hosts so the presence_hosts match stays cheap), by call_id and
+ * by contact (multiple-registrations=contact deletes a contact across users), and expire on a one second timer wheel driven by sofia_reg_check_expire.
+ */
+
+#define REG_CACHE_WHEEL_SLOTS 4096
+
+typedef enum {
+	REG_CACHE_NODE_REG,
+	REG_CACHE_NODE_NONCE
+} reg_cache_node_type_t;
+
+typedef struct reg_cache_node_s {
+	reg_cache_node_type_t type;
+	long expires;
+	int slot;
+	struct reg_cache_node_s *wheel_prev;
+	struct reg_cache_node_s *wheel_next;
+} reg_cache_node_t;
+
+typedef struct reg_cache_entry_s {
+	reg_cache_node_t node;
+	char *call_id;
+	char *sip_user;
+	char *sip_host;
+	char *sip_username;
+	char *contact;
+	char *presence_hosts;
+	char *network_ip;
+	char *network_port;
+	struct reg_cache_entry_s *next;
+	struct reg_cache_entry_s *next_call;
+	struct reg_cache_entry_s *next_contact;
+} reg_cache_entry_t;
+
+typedef struct reg_cache_nonce_s {
+	reg_cache_node_t node;
+	unsigned long last_nc;
+	char *nonce;
+} reg_cache_nonce_t;
+
+struct sofia_reg_cache_s {
+	switch_mutex_t *mutex;
+	switch_hash_t *users;
+	switch_hash_t *call_ids;
+	switch_hash_t *contacts;
+	switch_hash_t *nonces;
+	reg_cache_node_t *wheel[REG_CACHE_WHEEL_SLOTS];
+	time_t wheel_time;
+	uint32_t reg_count;
+	uint32_t nonce_count;
+};
+
+static void reg_cache_wheel_add(sofia_reg_cache_t *cache, reg_cache_node_t *node)
+{
+	long when = node->expires;
+
+	if (when <= 0) {
+		node->slot = -1;
+		return;
+	}
+
+	/* anything already due goes in the next slot the wheel will visit */
+	if (when <= (long) cache->wheel_time) {
+		when = (long) cache->wheel_time + 1;
+	}
+
+	node->slot = (int) (when % REG_CACHE_WHEEL_SLOTS);
+	node->wheel_prev = NULL;
+	node->wheel_next = cache->wheel[node->slot];
+
+	if (node->wheel_next) {
+		node->wheel_next->wheel_prev = node;
+	}
+
+	cache->wheel[node->slot] = node;
+}
+
+static void reg_cache_wheel_del(sofia_reg_cache_t *cache, reg_cache_node_t *node)
+{
+	if (node->slot < 0) {
+		return;
+	}
+
+	if (node->wheel_prev) {
+		node->wheel_prev->wheel_next = node->wheel_next;
+	} else {
+		cache->wheel[node->slot] = node->wheel_next;
+	}
+
+	if (node->wheel_next) {
+		node->wheel_next->wheel_prev = node->wheel_prev;
+	}
+
+	node->slot = -1;
+	node->wheel_prev = node->wheel_next = NULL;
+}
+
+static char *reg_cache_copy(char **buf, const char *str)
+{
+	char *r = *buf;
+	size_t len = strlen(switch_str_nil(str)) + 1;
+
+	memcpy(r, switch_str_nil(str), len);
+	*buf += len;
+
+	return r;
+}
+
+static void reg_cache_entry_del(sofia_reg_cache_t *cache, reg_cache_entry_t *entry)
+{
+	reg_cache_entry_t *head, *ep, *last = NULL;
+
+	if ((head = switch_core_hash_find(cache->users, entry->sip_user))) {
+		for (ep = head; ep && ep != entry; ep = ep->next) {
+			last = ep;
+		}
+
+		if (ep) {
+			if (last) {
+				last->next = entry->next;
+			} else if (entry->next) {
+				switch_core_hash_insert(cache->users, entry->sip_user, entry->next);
+			} else {
+				switch_core_hash_delete(cache->users, entry->sip_user);
+			}
+		}
+	}
+
+	last = NULL;
+
+	if ((head = switch_core_hash_find(cache->call_ids, entry->call_id))) {
+		for (ep = head; ep && ep != entry; ep = ep->next_call) {
+			last = ep;
+		}
+
+		if (ep) {
+			if (last) {
+				last->next_call = entry->next_call;
+			} else if (entry->next_call) {
+				switch_core_hash_insert(cache->call_ids, entry->call_id, entry->next_call);
+			} else {
+				switch_core_hash_delete(cache->call_ids, entry->call_id);
+			}
+		}
+	}
+
+	last = NULL;
+
+	if ((head = switch_core_hash_find(cache->contacts, entry->contact))) {
+		for (ep = head; ep && ep != entry; ep = ep->next_contact) {
+			last = ep;
+		}
+
+		if (ep) {
+			if (last) {
+				last->next_contact = entry->next_contact;
+			} else if (entry->next_contact) {
+				switch_core_hash_insert(cache->contacts, entry->contact, entry->next_contact);
+			} else {
+				switch_core_hash_delete(cache->contacts, entry->contact);
+			}
+		}
+	}
+
+	reg_cache_wheel_del(cache, &entry->node);
+	cache->reg_count--;
+	free(entry);
+}
+
+static void reg_cache_nonce_del(sofia_reg_cache_t *cache, reg_cache_nonce_t *np)
+{
+	switch_core_hash_delete(cache->nonces, np->nonce);
+	reg_cache_wheel_del(cache, &np->node);
+	cache->nonce_count--;
+	free(np);
+}
+
+static void reg_cache_node_del(sofia_reg_cache_t *cache, reg_cache_node_t *node)
+{
+	if (node->type == REG_CACHE_NODE_NONCE) {
+		reg_cache_nonce_del(cache, (reg_cache_nonce_t *) node);
+	} else {
+		reg_cache_entry_del(cache, (reg_cache_entry_t *) node);
+	}
+}
+
+static int reg_cache_host_match(reg_cache_entry_t *entry, const char *host)
+{
+	return !host || !strcmp(entry->sip_host, host) || (*entry->presence_hosts && switch_stristr(host, entry->presence_hosts));
+}
+
+static int reg_cache_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) pArg;
+
+	if (argc > 8) {
+		sofia_reg_cache_add(profile, argv[0], argv[1], argv[2], argv[3], argv[4], argv[5], argv[6], argv[7], argv[8] ? atol(argv[8]) : 0, SWITCH_FALSE);
+	}
+
+	return 0;
+}
+
+void sofia_reg_cache_create(sofia_profile_t *profile)
+{
+	sofia_reg_cache_t *cache;
+	char *sql;
+
+	cache = switch_core_alloc(profile->pool, sizeof(*cache));
+	switch_mutex_init(&cache->mutex, SWITCH_MUTEX_NESTED, profile->pool);
+	switch_core_hash_init(&cache->users);
+	switch_core_hash_init(&cache->call_ids);
+	switch_core_hash_init(&cache->contacts);
+	switch_core_hash_init(&cache->nonces);
+	cache->wheel_time = switch_epoch_time_now(NULL);
+
+	profile->reg_cache = cache;
+
+	sql = switch_mprintf("select call_id,sip_user,sip_host,sip_username,contact,presence_hosts,network_ip,network_port,expires "
+						 "from sip_registrations where profile_name='%q' and hostname='%q'", profile->name, mod_sofia_globals.hostname);
+	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, reg_cache_load_callback, profile);
+	switch_safe_free(sql);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Loaded %u registrations into the registration cache for %s\n", cache->reg_count, profile->name);
+}
+
+void sofia_reg_cache_destroy(sofia_profile_t *profile)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	int i;
+
+	if (!cache) {
+		return;
+	}
+
+	profile->reg_cache = NULL;
+
+	switch_mutex_lock(cache->mutex);
+	for (i = 0; i < REG_CACHE_WHEEL_SLOTS; i++) {
+		while (cache->wheel[i]) {
+			reg_cache_node_del(cache, cache->wheel[i]);
+		}
+	}
+
+	/* whatever is left never expires and is not on the wheel */
+	while (cache->reg_count) {
+		switch_hash_index_t *hi = switch_core_hash_first(cache->users);
+		void *val;
+
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		switch_safe_free(hi);
+		reg_cache_entry_del(cache, (reg_cache_entry_t *) val);
+	}
+
+	while (cache->nonce_count) {
+		switch_hash_index_t *hi = switch_core_hash_first(cache->nonces);
+		void *val;
+
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		switch_safe_free(hi);
+		reg_cache_nonce_del(cache, (reg_cache_nonce_t *) val);
+	}
+	switch_mutex_unlock(cache->mutex);
+
+	switch_core_hash_destroy(&cache->users);
+	switch_core_hash_destroy(&cache->call_ids);
+	switch_core_hash_destroy(&cache->contacts);
+	switch_core_hash_destroy(&cache->nonces);
+}
+
+void sofia_reg_cache_add(sofia_profile_t *profile, const char *call_id, const char *user, const char *host, const char *username,
+						 const char *contact, const char *presence_hosts, const char *network_ip, const char *network_port,
+						 long expires, switch_bool_t update)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *entry, *head;
+	size_t len;
+	char *p;
+
+	if (!cache || zstr(user)) {
+		return;
+	}
+
+	len = sizeof(*entry) + strlen(switch_str_nil(call_id)) + strlen(user) + strlen(switch_str_nil(host)) + strlen(switch_str_nil(username)) +
+		strlen(switch_str_nil(contact)) + strlen(switch_str_nil(presence_hosts)) + strlen(switch_str_nil(network_ip)) +
+		strlen(switch_str_nil(network_port)) + 8;
+
+	switch_zmalloc(entry, len);
+	p = (char *) (entry + 1);
+
+	entry->node.type = REG_CACHE_NODE_REG;
+	entry->node.expires = expires;
+	entry->call_id = reg_cache_copy(&p, call_id);
+	entry->sip_user = reg_cache_copy(&p, user);
+	entry->sip_host = reg_cache_copy(&p, host);
+	entry->sip_username = reg_cache_copy(&p, username);
+	entry->contact = reg_cache_copy(&p, contact);
+	entry->presence_hosts = reg_cache_copy(&p, presence_hosts);
+	entry->network_ip = reg_cache_copy(&p, network_ip);
+	entry->network_port = reg_cache_copy(&p, network_port);
+
+	switch_mutex_lock(cache->mutex);
+
+	if (update && (head = switch_core_hash_find(cache->users, user))) {
+		reg_cache_entry_t *ep, *np;
+
+		for (ep = head; ep; ep = np) {
+			np = ep->next;
+			if (!strcmp(ep->sip_host, entry->sip_host) && !strcmp(ep->sip_username, entry->sip_username) && !strcmp(ep->contact, entry->contact)) {
+				reg_cache_entry_del(cache, ep);
+			}
+		}
+	}
+
+	entry->next = switch_core_hash_find(cache->users, user);
+	switch_core_hash_insert(cache->users, user, entry);
+	entry->next_call = switch_core_hash_find(cache->call_ids, entry->call_id);
+	switch_core_hash_insert(cache->call_ids, entry->call_id, entry);
+	entry->next_contact = switch_core_hash_find(cache->contacts, entry->contact);
+	switch_core_hash_insert(cache->contacts, entry->contact, entry);
+	reg_cache_wheel_add(cache, &entry->node);
+	cache->reg_count++;
+
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_del_user(sofia_profile_t *profile, const char *user, const char *host, const char *contact, long keep_expires)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep, *np;
+
+	if (!cache || zstr(user)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->users, user); ep; ep = np) {
+		np = ep->next;
+
+		if ((!host || !strcmp(ep->sip_host, host)) && (!contact || !strcmp(ep->contact, contact)) &&
+			(!keep_expires || ep->node.expires != keep_expires)) {
+			reg_cache_entry_del(cache, ep);
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_del_contact(sofia_profile_t *profile, const char *contact, long keep_expires)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep, *np;
+
+	if (!cache || zstr(contact)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->contacts, contact); ep; ep = np) {
+		np = ep->next_contact;
+
+		if (!keep_expires || ep->node.expires != keep_expires) {
+			reg_cache_entry_del(cache, ep);
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_del_call_id(sofia_profile_t *profile, const char *call_id, const char *network_ip, const char *network_port, long keep_expires)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep, *np;
+
+	if (!cache || zstr(call_id)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->call_ids, call_id); ep; ep = np) {
+		np = ep->next_call;
+
+		if ((!network_ip || !strcmp(ep->network_ip, network_ip)) && (!network_port || !strcmp(ep->network_port, network_port)) &&
+			(!keep_expires || ep->node.expires != keep_expires)) {
+			reg_cache_entry_del(cache, ep);
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_del_host(sofia_profile_t *profile, const char *host)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	int i;
+
+	if (!cache || zstr(host)) {
+		return;
+	}
+
+	/* admin path only, walk everything */
+	switch_mutex_lock(cache->mutex);
+	for (i = 0; i < REG_CACHE_WHEEL_SLOTS; i++) {
+		reg_cache_node_t *node, *next;
+
+		for (node = cache->wheel[i]; node; node = next) {
+			next = node->wheel_next;
+			if (node->type == REG_CACHE_NODE_REG && !strcmp(((reg_cache_entry_t *) node)->sip_host, host)) {
+				reg_cache_entry_del(cache, (reg_cache_entry_t *) node);
+			}
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_set_expires(sofia_profile_t *profile, const char *user, const char *host, const char *call_id, long expires)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep;
+
+	if (!cache || zstr(call_id)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->call_ids, call_id); ep; ep = ep->next_call) {
+		if (!strcmp(ep->sip_user, switch_str_nil(user)) && !strcmp(ep->sip_host, switch_str_nil(host))) {
+			reg_cache_wheel_del(cache, &ep->node);
+			ep->node.expires = expires;
+			reg_cache_wheel_add(cache, &ep->node);
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_expire(sofia_profile_t *profile, time_t now)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_node_t *node, *next;
+	time_t t, from, to;
+
+	if (!cache) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+
+	if (!now || now - cache->wheel_time >= REG_CACHE_WHEEL_SLOTS) {
+		from = 0;
+		to = REG_CACHE_WHEEL_SLOTS - 1;
+	} else {
+		from = cache->wheel_time + 1;
+		to = now;
+	}
+
+	for (t = from; t <= to; t++) {
+		for (node = cache->wheel[t % REG_CACHE_WHEEL_SLOTS]; node; node = next) {
+			next = node->wheel_next;
+			if (!now || node->expires <= (long) now) {
+				reg_cache_node_del(cache, node);
+			}
+		}
+	}
+
+	if (now > cache->wheel_time) {
+		cache->wheel_time = now;
+	}
+
+	switch_mutex_unlock(cache->mutex);
+}
+
+/* feeds (contact, expires) rows to a sip_registrations style callback, returns the number of rows */
+static int reg_cache_select(sofia_profile_t *profile, const char *user, const char *host, switch_core_db_callback_func_t callback, void *pdata)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep;
+	int rows = 0;
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->users, user); ep; ep = ep->next) {
+		char expires[32];
+		char *argv[2];
+
+		if (!reg_cache_host_match(ep, host)) {
+			continue;
+		}
+
+		switch_snprintf(expires, sizeof(expires), "%ld", ep->node.expires);
+		argv[0] = ep->contact;
+		argv[1] = expires;
+		rows++;
+
+		if (callback(pdata, 2, argv, NULL)) {
+			break;
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+
+	return rows;
+}
+
+uint32_t sofia_reg_cache_count(sofia_profile_t *profile, const char *user, const char *host, const char *username, const char *contact,
+							   const char *not_call_id, switch_bool_t exact_host)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_entry_t *ep;
+	uint32_t count = 0;
+
+	if (!cache || zstr(user)) {
+		return 0;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	for (ep = switch_core_hash_find(cache->users, user); ep; ep = ep->next) {
+		if ((exact_host ? !strcmp(ep->sip_host, switch_str_nil(host)) : reg_cache_host_match(ep, host)) &&
+			(!username || !strcmp(ep->sip_username, username)) && (!contact || !strcmp(ep->contact, contact)) &&
+			(!not_call_id || strcmp(ep->call_id, not_call_id))) {
+			count++;
+		}
+	}
+	switch_mutex_unlock(cache->mutex);
+
+	return count;
+}
+
+void sofia_reg_cache_nonce_add(sofia_profile_t *profile, const char *nonce, long expires, unsigned long last_nc)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_nonce_t *np;
+
+	if (!cache || zstr(nonce)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	if ((np = switch_core_hash_find(cache->nonces, nonce))) {
+		reg_cache_wheel_del(cache, &np->node);
+	} else {
+		size_t len = strlen(nonce) + 1;
+
+		switch_zmalloc(np, sizeof(*np) + len);
+		np->node.type = REG_CACHE_NODE_NONCE;
+		np->nonce = (char *) (np + 1);
+		memcpy(np->nonce, nonce, len);
+		switch_core_hash_insert(cache->nonces, np->nonce, np);
+		cache->nonce_count++;
+	}
+
+	np->node.expires = expires;
+	np->last_nc = last_nc;
+	reg_cache_wheel_add(cache, &np->node);
+	switch_mutex_unlock(cache->mutex);
+}
+
+switch_bool_t sofia_reg_cache_nonce_find(sofia_profile_t *profile, const char *nonce, unsigned long *last_nc)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_nonce_t *np;
+	switch_bool_t r = SWITCH_FALSE;
+
+	if (!cache || zstr(nonce)) {
+		return SWITCH_FALSE;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	if ((np = switch_core_hash_find(cache->nonces, nonce))) {
+		if (last_nc) {
+			*last_nc = np->last_nc;
+		}
+		r = SWITCH_TRUE;
+	}
+	switch_mutex_unlock(cache->mutex);
+
+	return r;
+}
+
+void sofia_reg_cache_nonce_del(sofia_profile_t *profile, const char *nonce)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+	reg_cache_nonce_t *np;
+
+	if (!cache || zstr(nonce)) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	if ((np = switch_core_hash_find(cache->nonces, nonce))) {
+		reg_cache_nonce_del(cache, np);
+	}
+	switch_mutex_unlock(cache->mutex);
+}
+
+void sofia_reg_cache_status(sofia_profile_t *profile, switch_stream_handle_t *stream)
+{
+	sofia_reg_cache_t *cache = profile->reg_cache;
+
+	if (!cache) {
+		return;
+	}
+
+	switch_mutex_lock(cache->mutex);
+	stream->write_function(stream, "Reg Cache        \t%u registrations, %u nonces\n", cache->reg_count, cache->nonce_count);
+	switch_mutex_unlock(cache->mutex);
+}
+
+/* the cache only holds the registrations this node wrote, it can answer the reads on its own
+   unless the database (odbc-dsn) is shared with other nodes */
+#define reg_cache_authoritative(_profile) ((_profile)->reg_cache && !(_profile)->odbc_dsn)
+
+/* registration writes skip the synchronous round trip once the cache answers the reads,
+   on a shared database the other nodes read them straight away so they stay synchronous.
+   Queued writes are keyed by user@host (or the nonce) so each user's rows stay in order across db-writers. */
+static const char *reg_sql_key(char *buf, switch_size_t len, const char *user, const char *host)
+{
+	if (host) {
+		switch_snprintf(buf, len, "%s@%s", switch_str_nil(user), host);
+	} else {
+		switch_copy_string(buf, switch_str_nil(user), len);
+	}
+
+	return buf;
+}
+
+static void reg_execute_sql(sofia_profile_t *profile, const char *user, const char *host, char **sqlp)
+{
+	if (reg_cache_authoritative(profile)) {
+		char key[512];
+
+		sofia_glue_execute_sql_key(profile, reg_sql_key(key, sizeof(key), user, host), sqlp, SWITCH_TRUE);
+	} else {
+		sofia_glue_execute_sql_now(profile, sqlp, SWITCH_TRUE);
+	}
+}
+
+/* nonces only need to reach the database when other nodes may see the response */
+#define reg_cache_persist_auth(_profile) (!reg_cache_authoritative(_profile))
+
+
 int sofia_reg_find_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	struct callback_t *cbt = (struct callback_t *) pArg;
@@ -787,6 +1426,13 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 	sql = switch_mprintf("delete from sip_registrations where call_id='%q' %s", call_id, sqlextra);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+	sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, 0);
+	if (zstr(user)) {
+		sofia_reg_cache_del_host(profile, host);
+	} else {
+		sofia_reg_cache_del_user(profile, user, host, NULL, 0);
+	}
+
 	switch_safe_free(sqlextra);
 	switch_safe_free(sql);
 	switch_safe_free(dup);
@@ -817,6 +1463,8 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 	}
 	sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 
+	sofia_reg_cache_expire(profile, now);
+
 
 
 
@@ -1017,6 +1665,8 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 	sql = switch_mprintf("delete from sip_registrations where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
+	sofia_reg_cache_expire(profile, 0);
+
 	sql = switch_mprintf("delete from sip_presence where expires > 0 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
@@ -1025,16 +1675,37 @@ void sofia_reg_check_sync(sofia_profile_t *profile)
 
 	sql = switch_mprintf("delete from sip_subscriptions where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	sofia_presence_index_clear(profile);
 
 	sql = switch_mprintf("delete from sip_dialogs where expires >= -1 and hostname='%q'", mod_sofia_globals.hostname);
 	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 
 }
 
+/* the registration lookups run on every INVITE and REGISTER, they go through cached prepared statements */
+static void reg_execute_find(sofia_profile_t *profile, const char *cols, const char *user, const char *host,
+							 switch_core_db_callback_func_t callback, void *pdata)
+{
+	char sql[256];
+
+	if (host) {
+		char *like = switch_mprintf("%%%s%%", host);
+		const char *argv[] = { user, host, like };
+
+		switch_snprintf(sql, sizeof(sql), "select %s from sip_registrations where sip_user=? and (sip_host=? or presence_hosts like ?)", cols);
+		sofia_glue_execute_prepared_callback(profile, profile->dbh_mutex, sql, 3, argv, callback, pdata);
+		switch_safe_free(like);
+	} else {
+		const char *argv[] = { user };
+
+		switch_snprintf(sql, sizeof(sql), "select %s from sip_registrations where sip_user=?", cols);
+		sofia_glue_execute_prepared_callback(profile, profile->dbh_mutex, sql, 1, argv, callback, pdata);
+	}
+}
+
 char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const char *host, char *val, switch_size_t len)
 {
 	struct callback_t cbt = { 0 };
-	char *sql;
 
 	if (!user) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Called with null user!\n");
@@ -1044,17 +1715,14 @@ char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const c
 	cbt.val = val;
 	cbt.len = len;
 
-	if (host) {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
+	if (reg_cache_authoritative(profile)) {
+		reg_cache_select(profile, user, host, sofia_reg_find_callback, &cbt);
+		goto found;
 	}
 
+	reg_execute_find(profile, "contact", user, host, sofia_reg_find_callback, &cbt);
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
-
-	switch_safe_free(sql);
+ found:
 
 	if (cbt.list) {
 		switch_console_free_matches(&cbt.list);
@@ -1071,24 +1739,18 @@ char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const c
 switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *profile, const char *user, const char *host)
 {
 	struct callback_t cbt = { 0 };
-	char *sql;
 
 	if (!user) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Called with null user!\n");
 		return NULL;
 	}
 
-	if (host) {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact from sip_registrations where sip_user='%q'", user);
+	if (reg_cache_authoritative(profile)) {
+		reg_cache_select(profile, user, host, sofia_reg_find_callback, &cbt);
+		return cbt.list;
 	}
 
-
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_callback, &cbt);
-
-	switch_safe_free(sql);
+	reg_execute_find(profile, "contact", user, host, sofia_reg_find_callback, &cbt);
 
 	return cbt.list;
 }
@@ -1097,26 +1759,22 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *p
 switch_console_callback_match_t *sofia_reg_find_reg_url_with_positive_expires_multi(sofia_profile_t *profile, const char *user, const char *host, time_t reg_time, const char *contact_str, long exptime)
 {
 	struct callback_t cbt = { 0 };
-	char *sql;
 
 	if (!user) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Called with null user!\n");
 		return NULL;
 	}
 
-	if (host) {
-		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-						user, host, host);
-	} else {
-		sql = switch_mprintf("select contact,expires from sip_registrations where sip_user='%q'", user);
-	}
-
 	cbt.time = reg_time;
 	cbt.contact_str = contact_str;
 	cbt.exptime = exptime;
 
-	sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
-	free(sql);
+	if (reg_cache_authoritative(profile)) {
+		reg_cache_select(profile, user, host, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
+		return cbt.list;
+	}
+
+	reg_execute_find(profile, "contact,expires", user, host, sofia_reg_find_reg_with_positive_expires_callback, &cbt);
 
 	return cbt.list;
 }
@@ -1129,6 +1787,7 @@ void sofia_reg_auth_challenge(sofia_profile_t *profile, nua_handle_t *nh, sofia_
 	char uuid_str[SWITCH_UUID_FORMATTED_LENGTH + 1];
 	char *sql, *auth_str;
 	msg_t *msg = NULL;
+	long expires;
 
 
 	if (de && de->data) {
@@ -1138,12 +1797,16 @@ void sofia_reg_auth_challenge(sofia_profile_t *profile, nua_handle_t *nh, sofia_
 	switch_uuid_get(&uuid);
 	switch_uuid_format(uuid_str, &uuid);
 
-	sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
-						 "values('%q', %ld, '%q', '%q', 0)", uuid_str,
-						 (long) switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime,
-						 profile->name, mod_sofia_globals.hostname);
-	switch_assert(sql != NULL);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+	expires = (long) switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime;
+
+	sofia_reg_cache_nonce_add(profile, uuid_str, expires, 0);
+
+	if (reg_cache_persist_auth(profile)) {
+		sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
+							 "values('%q', %ld, '%q', '%q', 0)", uuid_str, expires, profile->name, mod_sofia_globals.hostname);
+		switch_assert(sql != NULL);
+		reg_execute_sql(profile, uuid_str, NULL, &sql);
+	}
 
 	auth_str = switch_mprintf("Digest realm=\"%q\", nonce=\"%q\",%s algorithm=MD5, qop=\"auth\"", realm, uuid_str, stale ? " stale=true," : "");
 
@@ -1158,17 +1821,29 @@ void sofia_reg_auth_challenge(sofia_profile_t *profile, nua_handle_t *nh, sofia_
 	switch_safe_free(auth_str);
 }
 
+static int sofia_reg_regcount_callback(void *pArg, int argc, char **argv, char **columnNames);
+
 uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const char *host)
 {
-	char buf[32] = "";
-	char *sql;
+	char *like;
+	const char *argv[4];
+	int total = 0;
 
-	sql = switch_mprintf("select count(*) from sip_registrations where profile_name='%q' and "
-						 "sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')", profile->name, user, host, host);
+	if (reg_cache_authoritative(profile)) {
+		return sofia_reg_cache_count(profile, user, host, NULL, NULL, NULL, SWITCH_FALSE);
+	}
 
-	sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, buf, sizeof(buf));
-	switch_safe_free(sql);
-	return atoi(buf);
+	like = switch_mprintf("%%%s%%", switch_str_nil(host));
+	argv[0] = profile->name;
+	argv[1] = user;
+	argv[2] = host;
+	argv[3] = like;
+
+	sofia_glue_execute_prepared_callback(profile, profile->dbh_mutex, "select count(*) from sip_registrations where profile_name=? and "
+										 "sip_user=? and (sip_host=? or presence_hosts like ?)", 4, argv, sofia_reg_regcount_callback, &total);
+	switch_safe_free(like);
+
+	return (uint32_t) total;
 }
 
 static int debounce_check(sofia_profile_t *profile, const char *user, const char *host)
@@ -1889,14 +2564,21 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 				if (multi_reg_contact) {
 					sql =
 						switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+					sofia_reg_cache_del_user(profile, to_user, reg_host, contact_str, 0);
 				} else {
 					sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+					sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, 0);
 				}
 			} else {
 				sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host);
+				sofia_reg_cache_del_user(profile, to_user, reg_host, NULL, 0);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			reg_execute_sql(profile, to_user, reg_host, &sql);
+		} else if (reg_cache_authoritative(profile)) {
+			if (sofia_reg_cache_count(profile, to_user, reg_host, username, contact_str, NULL, SWITCH_TRUE)) {
+				update_registration = SWITCH_TRUE;
+			}
 		} else {
 			char buf[32] = "";
 
@@ -1979,9 +2661,12 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		}
 
 		if (sql) {
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			reg_execute_sql(profile, to_user, reg_host, &sql);
 		}
 
+		sofia_reg_cache_add(profile, call_id, to_user, reg_host, username, contact_str, profile->presence_hosts, network_ip, network_port_c,
+							(long) reg_time + (long) exptime + profile->sip_expires_late_margin, update_registration);
+
 		if (!update_registration && sofia_reg_reg_count(profile, to_user, reg_host) == 1) {
 			sql = switch_mprintf("delete from sip_presence where sip_user='%q' and sip_host='%q' and profile_name='%q' and open_closed='closed'",
 								 to_user, reg_host, profile->name);
@@ -1992,13 +2677,19 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 		}
 
 		if (multi_reg) {
+			long keep_expires = (long) reg_time + (long) exptime + profile->sip_expires_late_margin;
+			char reg_key[512];
+
 			if (multi_reg_contact) {
-				sql = switch_mprintf("delete from sip_registrations where contact='%q' and expires!=%ld", contact_str, (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
+				sql = switch_mprintf("delete from sip_registrations where contact='%q' and expires!=%ld", contact_str, keep_expires);
+				sofia_reg_cache_del_contact(profile, contact_str, keep_expires);
 			} else {
-				sql = switch_mprintf("delete from sip_registrations where call_id='%q' and expires!=%ld", call_id, (long) reg_time + (long) exptime + profile->sip_expires_late_margin);
+				sql = switch_mprintf("delete from sip_registrations where call_id='%q' and expires!=%ld", call_id, keep_expires);
+				sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, keep_expires);
 			}
 
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			/* same key as the insert above so it cannot overtake it */
+			sofia_glue_execute_sql_key(profile, reg_sql_key(reg_key, sizeof(reg_key), to_user, reg_host), &sql, SWITCH_TRUE);
 		}
 
 
@@ -2074,18 +2765,21 @@ uint8_t sofia_reg_handle_register_token(nua_t *nua, sofia_profile_t *profile, nu
 			if (multi_reg_contact) {
 				sql =
 					switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+				sofia_reg_cache_del_user(profile, to_user, reg_host, contact_str, 0);
 			} else {
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+				sofia_reg_cache_del_call_id(profile, call_id, NULL, NULL, 0);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			reg_execute_sql(profile, to_user, reg_host, &sql);
 
 			switch_safe_free(icontact);
 		} else {
 
 			if ((sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host))) {
-				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+				reg_execute_sql(profile, to_user, reg_host, &sql);
 			}
+			sofia_reg_cache_del_user(profile, to_user, reg_host, NULL, 0);
 		}
 	}
 
@@ -2809,28 +3503,44 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 	if (zstr(np)) {
 		nonce_cb_t cb = { 0 };
 		long nc_long = 0;
+		unsigned long last_nc = 0;
 
 		first = 1;
 
 		if (nc) {
 			nc_long = strtoul(nc, 0, 16);
-			sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, nc_long);
-		} else {
-			sql = switch_mprintf("select nonce from sip_authentication where nonce='%q'", nonce);
 		}
 
 		cb.nonce = np;
 		cb.nplen = nplen;
 
-		switch_assert(sql != NULL);
-
-		sofia_glue_execute_sql_callback(profile, profile->dbh_mutex, sql, sofia_reg_nonce_callback, &cb);
-		free(sql);
+		if (reg_cache_authoritative(profile) && sofia_reg_cache_nonce_find(profile, nonce, &last_nc)) {
+			if (!nc || last_nc < (unsigned long) nc_long) {
+				switch_copy_string(np, nonce, nplen);
+				cb.last_nc = (int) last_nc;
+			}
+		} else if (reg_cache_persist_auth(profile)) {
+			const char *argv[] = { nonce };
+
+			/* one statement for both cases, the nonce count is checked here instead of in the sql */
+			sofia_glue_execute_prepared_callback(profile, profile->dbh_mutex, "select nonce,last_nc from sip_authentication where nonce=?",
+												 1, argv, sofia_reg_nonce_callback, &cb);
+
+			if (!nc) {
+				cb.last_nc = 0;
+			} else if (cb.last_nc >= nc_long) {
+				*np = '\0';
+				cb.last_nc = 0;
+			}
+		}
 
 		//if (!sofia_glue_execute_sql2str(profile, profile->dbh_mutex, sql, np, nplen)) {
 		if (zstr(np) || (profile->max_auth_validity != 0 && (uint32_t)cb.last_nc >= profile->max_auth_validity )) {
-			sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+			sofia_reg_cache_nonce_del(profile, nonce);
+			if (reg_cache_persist_auth(profile)) {
+				sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
+				sofia_glue_execute_sql_key(profile, nonce, &sql, SWITCH_TRUE);
+			}
 			ret = AUTH_STALE;
 			goto end;
 		}
@@ -3088,11 +3798,15 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 		call_id = sip->sip_call_id->i_id;
 		switch_assert(call_id);
 
-		sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
-							 sip->sip_to->a_url->url_user, call_id, domain_name);
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
-		free(sql);
+		if (reg_cache_authoritative(profile)) {
+			count = sofia_reg_cache_count(profile, sip->sip_to->a_url->url_user, domain_name, NULL, NULL, call_id, SWITCH_TRUE);
+		} else {
+			sql = switch_mprintf("select count(sip_user) from sip_registrations where sip_user='%q' AND call_id <> '%q' AND sip_host='%q'",
+								 sip->sip_to->a_url->url_user, call_id, domain_name);
+			switch_assert(sql != NULL);
+			sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_regcount_callback, &count);
+			free(sql);
+		}
 
 		if (count + 1 > max_registrations_perext) {
 			ret = AUTH_FORBIDDEN;
@@ -3252,13 +3966,20 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 
 
 	if (nc && cnonce && qop) {
+		long nonce_expires = (long)switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime;
+
 		ncl = strtoul(nc, 0, 16);
 
-		sql = switch_mprintf("update sip_authentication set expires='%ld',last_nc=%lu where nonce='%q'",
-							 (long)switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL) + exptime, ncl, nonce);
+		if (sofia_reg_cache_nonce_find(profile, nonce, NULL)) {
+			sofia_reg_cache_nonce_add(profile, nonce, nonce_expires, ncl);
+		}
 
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		if (reg_cache_persist_auth(profile)) {
+			sql = switch_mprintf("update sip_authentication set expires='%ld',last_nc=%lu where nonce='%q'", nonce_expires, ncl, nonce);
+
+			switch_assert(sql != NULL);
+			reg_execute_sql(profile, nonce, NULL, &sql);
+		}
 
 		if (ret == AUTH_OK)
 			ret = AUTH_RENEWED;
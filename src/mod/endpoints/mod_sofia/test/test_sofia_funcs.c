@@ -94,6 +94,115 @@ FST_TEST_BEGIN(test_protect_url)
 }
 FST_TEST_END()
 
+FST_TEST_BEGIN(test_reg_cache_shared_contact)
+{
+	sofia_profile_t profile = { 0 };
+	const char *contact = "sip:shared@192.168.0.10:5060";
+	long now = (long) switch_epoch_time_now(NULL);
+
+	switch_core_new_memory_pool(&profile.pool);
+	profile.name = "test";
+	profile.dbname = "test_sofia_reg_cache";
+
+	sofia_reg_cache_create(&profile);
+	fst_requires(profile.reg_cache);
+
+	sofia_reg_cache_add(&profile, "call-a", "1000", "example.com", "1000", contact, "", "192.168.0.10", "5060", now + 3600, SWITCH_FALSE);
+	sofia_reg_cache_add(&profile, "call-b", "1001", "example.com", "1001", contact, "", "192.168.0.10", "5060", now + 3600, SWITCH_FALSE);
+	sofia_reg_cache_add(&profile, "call-c", "1002", "example.com", "1002", "sip:other@192.168.0.11", "", "192.168.0.11", "5060", now + 3600, SWITCH_FALSE);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1000", "example.com", NULL, contact, NULL, SWITCH_TRUE), 1);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1001", "example.com", NULL, contact, NULL, SWITCH_TRUE), 1);
+
+	/* 1001 registers the contact again, the contact is dropped from every other user and from its own older entry */
+	sofia_reg_cache_add(&profile, "call-d", "1001", "example.com", "1001", contact, "", "192.168.0.10", "5060", now + 7200, SWITCH_FALSE);
+	sofia_reg_cache_del_contact(&profile, contact, now + 7200);
+
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1000", "example.com", NULL, NULL, NULL, SWITCH_TRUE), 0);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1001", "example.com", NULL, NULL, NULL, SWITCH_TRUE), 1);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1001", "example.com", NULL, NULL, "call-d", SWITCH_TRUE), 0);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1002", "example.com", NULL, NULL, NULL, SWITCH_TRUE), 1);
+
+	/* the contact index follows the other deletes too */
+	sofia_reg_cache_del_call_id(&profile, "call-d", NULL, NULL, 0);
+	sofia_reg_cache_del_contact(&profile, contact, 0);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1001", "example.com", NULL, NULL, NULL, SWITCH_TRUE), 0);
+	fst_check_int_equals(sofia_reg_cache_count(&profile, "1002", "example.com", NULL, NULL, NULL, SWITCH_TRUE), 1);
+
+	sofia_reg_cache_destroy(&profile);
+	fst_check(profile.reg_cache == NULL);
+
+	switch_core_destroy_memory_pool(&profile.pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_presence_index)
+{
+	sofia_profile_t profile = { 0 };
+	switch_time_t start_ts, end_ts;
+	char call_id[64], user[64];
+	int i, hits = 0;
+
+	switch_core_new_memory_pool(&profile.pool);
+
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_TRUE);
+
+	sofia_presence_index_create(&profile);
+	fst_requires(profile.pres_index);
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_FALSE);
+
+	sofia_presence_index_add(&profile, "call-a", "1000");
+	sofia_presence_index_add(&profile, "call-b", "1000");
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_TRUE);
+	fst_check(sofia_presence_index_watched(&profile, "1001") == SWITCH_FALSE);
+
+	fst_check(sofia_presence_index_subscribed(&profile, "call-a") == SWITCH_TRUE);
+	fst_check(sofia_presence_index_subscribed(&profile, "call-x") == SWITCH_FALSE);
+
+	sofia_presence_index_del(&profile, "call-a");
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_TRUE);
+	fst_check(sofia_presence_index_subscribed(&profile, "call-a") == SWITCH_FALSE);
+	sofia_presence_index_del(&profile, "call-b");
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_FALSE);
+
+	/* re-adding a call id moves the subscription to the new user */
+	sofia_presence_index_add(&profile, "call-c", "1000");
+	sofia_presence_index_add(&profile, "call-c", "1001");
+	fst_check(sofia_presence_index_watched(&profile, "1000") == SWITCH_FALSE);
+	fst_check(sofia_presence_index_watched(&profile, "1001") == SWITCH_TRUE);
+
+	for (i = 0; i < 10000; i++) {
+		switch_snprintf(call_id, sizeof(call_id), "call-%d", i);
+		switch_snprintf(user, sizeof(user), "%d", 20000 + (i % 1000));
+		sofia_presence_index_add(&profile, call_id, user);
+	}
+
+	start_ts = switch_time_now();
+	for (i = 0; i < 100000; i++) {
+		switch_snprintf(user, sizeof(user), "%d", 20000 + (i % 2000));
+		if (sofia_presence_index_watched(&profile, user)) {
+			hits++;
+		}
+	}
+	end_ts = switch_time_now();
+
+	fst_check_int_equals(hits, 50000);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "100000 presence index lookups over 10000 subscriptions in %" SWITCH_TIME_T_FMT "us\n",
+					  end_ts - start_ts);
+
+	fst_check(sofia_presence_index_subscribed(&profile, "call-9999") == SWITCH_TRUE);
+
+	sofia_presence_index_clear(&profile);
+	fst_check(sofia_presence_index_watched(&profile, "1001") == SWITCH_FALSE);
+	fst_check(sofia_presence_index_subscribed(&profile, "call-9999") == SWITCH_FALSE);
+	fst_check(sofia_presence_index_watched(&profile, "20000") == SWITCH_FALSE);
+
+	sofia_presence_index_destroy(&profile);
+	fst_check(profile.pres_index == NULL);
+
+	switch_core_destroy_memory_pool(&profile.pool);
+}
+FST_TEST_END()
+
 FST_SUITE_END()
 
 FST_MINCORE_END()
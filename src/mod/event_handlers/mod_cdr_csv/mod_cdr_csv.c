@@ -39,6 +39,9 @@ struct cdr_fd {
 	char *path;
 	int64_t bytes;
 	switch_mutex_t *mutex;
+	char *buf;
+	switch_size_t buf_len;
+	switch_size_t buf_size;
 };
 typedef struct cdr_fd cdr_fd_t;
 
@@ -58,6 +61,13 @@ static struct {
 	int rotate;
 	int debug;
 	cdr_leg_t legs;
+	uint32_t commit_interval;
+	switch_size_t buffer_size;
+	int fsync_commit;
+	char *compress_cmd;
+	int rotate_pending;
+	int running;
+	switch_thread_t *writer_thread;
 } globals;
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load);
@@ -110,7 +120,18 @@ static void do_rotate(cdr_fd_t *fd)
 
 		p = switch_mprintf("%s.%s", fd->path, date);
 		assert(p);
-		switch_file_rename(fd->path, p, globals.pool);
+		if (switch_file_rename(fd->path, p, globals.pool) == SWITCH_STATUS_SUCCESS && !zstr(globals.compress_cmd)) {
+			/* the path comes from the config and the channel, never hand it to the shell unquoted */
+			char *arg = switch_util_quote_shell_arg(p);
+			char *cmd;
+
+			switch_assert(arg);
+			cmd = switch_mprintf("%s %s", globals.compress_cmd, arg);
+			switch_assert(cmd);
+			switch_system(cmd, SWITCH_FALSE);
+			free(cmd);
+			free(arg);
+		}
 		free(p);
 	}
 
@@ -129,6 +150,85 @@ static void do_rotate(cdr_fd_t *fd)
 
 }
 
+/* write out everything buffered on this file, must be called with fd->mutex locked */
+static void flush_cdr_fd(cdr_fd_t *fd)
+{
+	switch_size_t off = 0;
+	int loops = 0;
+
+	if (!fd->buf_len) {
+		return;
+	}
+
+	if (fd->fd < 0) {
+		do_reopen(fd);
+		if (fd->fd < 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", fd->path);
+			if (fd->buf_len < globals.buffer_size * 16) {
+				/* keep it for the next commit */
+				return;
+			}
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Dropping %ld bytes of CDRs for %s\n", (long) fd->buf_len, fd->path);
+			fd->buf_len = 0;
+			return;
+		}
+	}
+
+	if (fd->bytes + fd->buf_len > UINT_MAX) {
+		do_rotate(fd);
+	}
+
+	while (off < fd->buf_len && fd->fd > -1) {
+		switch_ssize_t x = write(fd->fd, fd->buf + off, fd->buf_len - off);
+
+		if (x <= 0) {
+			if (++loops >= 10) {
+				break;
+			}
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", fd->path, (int) x, (int) (fd->buf_len - off));
+			do_rotate(fd);
+			switch_yield(250000);
+			continue;
+		}
+
+		off += x;
+		fd->bytes += x;
+	}
+
+#ifndef _MSC_VER
+	if (globals.fsync_commit && off && fd->fd > -1) {
+		fsync(fd->fd);
+	}
+#endif
+
+	if (off < fd->buf_len) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Dropping %ld bytes of CDRs for %s\n", (long) (fd->buf_len - off), fd->path);
+	}
+
+	fd->buf_len = 0;
+}
+
+static void buffer_cdr(cdr_fd_t *fd, const char *log_line, switch_size_t len)
+{
+	if (fd->buf_len + len > fd->buf_size) {
+		/* full, write it out from here rather than wait for the next commit */
+		flush_cdr_fd(fd);
+
+		if (fd->buf_len + len > fd->buf_size) {
+			void *mem;
+
+			/* grows past buffer-size only for huge lines or while the file can't be opened */
+			fd->buf_size = fd->buf_len + len > globals.buffer_size ? fd->buf_len + len : globals.buffer_size;
+			mem = realloc(fd->buf, fd->buf_size);
+			switch_assert(mem);
+			fd->buf = mem;
+		}
+	}
+
+	memcpy(fd->buf + fd->buf_len, log_line, len);
+	fd->buf_len += len;
+}
+
 static void write_cdr(const char *path, const char *log_line)
 {
 	cdr_fd_t *fd = NULL;
@@ -150,6 +250,11 @@ static void write_cdr(const char *path, const char *log_line)
 	switch_mutex_lock(fd->mutex);
 	bytes_out = (unsigned) strlen(log_line);
 
+	if (globals.writer_thread) {
+		buffer_cdr(fd, log_line, bytes_out);
+		goto end;
+	}
+
 	if (fd->fd < 0) {
 		do_reopen(fd);
 		if (fd->fd < 0) {
@@ -272,27 +377,74 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 }
 
 
-static void do_rotate_all()
+static void do_rotate_all_now()
 {
 	switch_hash_index_t *hi;
 	void *val;
 	cdr_fd_t *fd;
 
+	switch_mutex_lock(globals.mutex);
+	for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		fd = (cdr_fd_t *) val;
+		switch_mutex_lock(fd->mutex);
+		flush_cdr_fd(fd);
+		do_rotate(fd);
+		switch_mutex_unlock(fd->mutex);
+	}
+	switch_mutex_unlock(globals.mutex);
+}
+
+static void do_rotate_all()
+{
 	if (globals.shutdown) {
 		return;
 	}
 
+	/* the writer thread picks it up on its next commit */
+	if (globals.writer_thread) {
+		globals.rotate_pending = 1;
+		return;
+	}
+
+	do_rotate_all_now();
+}
+
+static void do_flush_all()
+{
+	switch_hash_index_t *hi;
+	void *val;
+	cdr_fd_t *fd;
+
 	switch_mutex_lock(globals.mutex);
 	for (hi = switch_core_hash_first(globals.fd_hash); hi; hi = switch_core_hash_next(&hi)) {
 		switch_core_hash_this(hi, NULL, NULL, &val);
 		fd = (cdr_fd_t *) val;
 		switch_mutex_lock(fd->mutex);
-		do_rotate(fd);
+		flush_cdr_fd(fd);
 		switch_mutex_unlock(fd->mutex);
 	}
 	switch_mutex_unlock(globals.mutex);
 }
 
+static void *SWITCH_THREAD_FUNC writer_thread_run(switch_thread_t *thread, void *obj)
+{
+	while (globals.running) {
+		switch_yield(globals.commit_interval * 1000);
+
+		if (globals.rotate_pending) {
+			globals.rotate_pending = 0;
+			do_rotate_all_now();
+		} else {
+			do_flush_all();
+		}
+	}
+
+	do_flush_all();
+
+	return NULL;
+}
+
 
 static void do_teardown()
 {
@@ -308,6 +460,8 @@ static void do_teardown()
 			close(fd->fd);
 			fd->fd = -1;
 		}
+		switch_safe_free(fd->buf);
+		fd->buf_len = fd->buf_size = 0;
 		switch_mutex_unlock(fd->mutex);
 	}
 	switch_mutex_unlock(globals.mutex);
@@ -367,6 +521,7 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 	switch_core_hash_insert(globals.template_hash, "default", default_template);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding default template.\n");
 	globals.legs = CDR_LEG_A;
+	globals.buffer_size = 65536;
 
 	if ((xml = switch_xml_open_cfg(cf, &cfg, NULL))) {
 
@@ -394,6 +549,22 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 					globals.default_template = switch_core_strdup(pool, val);
 				} else if (!strcasecmp(var, "master-file-only")) {
 					globals.masterfileonly = switch_true(val);
+				} else if (!strcasecmp(var, "group-commit-interval")) {
+					int tmp = atoi(val);
+					if (tmp >= 0) {
+						globals.commit_interval = (uint32_t) tmp;
+					}
+				} else if (!strcasecmp(var, "buffer-size")) {
+					int tmp = atoi(val);
+					if (tmp >= 1024) {
+						globals.buffer_size = (switch_size_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "buffer-size must be at least 1024\n");
+					}
+				} else if (!strcasecmp(var, "fsync")) {
+					globals.fsync_commit = !strcasecmp(val, "commit");
+				} else if (!strcasecmp(var, "rotate-compress-command") && !zstr(val)) {
+					globals.compress_cmd = switch_core_strdup(pool, val);
 				}
 			}
 		}
@@ -451,6 +622,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 		return status;
 	}
 
+	if (globals.commit_interval) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		globals.running = 1;
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&globals.writer_thread, thd_attr, writer_thread_run, NULL, pool);
+	}
+
 	switch_core_add_state_handler(&state_handlers);
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
@@ -469,6 +649,13 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_cdr_csv_shutdown)
 	switch_event_unbind_callback(event_handler);
 	switch_core_remove_state_handler(&state_handlers);
 
+	if (globals.writer_thread) {
+		switch_status_t st;
+
+		globals.running = 0;
+		switch_thread_join(&st, globals.writer_thread);
+	}
+
 	do_teardown();
 	switch_core_hash_destroy(&globals.fd_hash);
 	switch_core_hash_destroy(&globals.template_hash);
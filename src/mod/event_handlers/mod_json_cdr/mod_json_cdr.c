@@ -36,6 +36,8 @@
 
 #define MAX_URLS 20
 #define MAX_ERR_DIRS 20
+#define MAX_BATCH_SIZE 1000
+#define REPLAY_BATCH 100
 
 #define ENCODING_NONE 0
 #define ENCODING_DEFAULT 1
@@ -75,6 +77,13 @@ static struct {
 	int encode_values;
 	switch_queue_t *queue;
 	switch_thread_t *thread;
+	int queue_capacity;
+	uint32_t batch_size;
+	uint32_t max_delay;
+	uint32_t replay_interval;
+	char *spool_dir;
+	uint32_t down_delay;
+	switch_time_t down_until;
 } globals;
 
 typedef struct {
@@ -193,47 +202,71 @@ static switch_status_t set_json_cdr_log_dirs()
 	return status;
 }
 
+static switch_bool_t write_backup(const char *dir, cdr_data_t *data)
+{
+	int fd = -1;
+	char *path = NULL;
+	const char *json_text = data->json_text_escaped ? data->json_text_escaped : data->json_text;
+	switch_bool_t ok = SWITCH_FALSE;
+#ifdef _MSC_VER
+	mode_t mode = S_IRUSR | S_IWUSR;
+#else
+	mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
+#endif
+
+	if (!(path = switch_mprintf("%s%s%s", dir, SWITCH_PATH_SEPARATOR, data->filename))) {
+		return SWITCH_FALSE;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Backup file %s\n", path);
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode)) > -1) {
+		switch_size_t json_len = strlen(json_text);
+		switch_ssize_t wrote = 0, x;
+		do { x = write(fd, json_text, json_len);
+		} while (!(x<0) && json_len > (wrote += x));
+		if (!(x<0)) do { x = write(fd, "\n", 1);
+			} while (!(x<0) && x<1);
+		close(fd); fd = -1;
+		if (x < 0) {
+			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
+			if (0 > unlink(path))
+				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
+		}
+		ok = SWITCH_TRUE;
+	} else {
+		char ebuf[512] = { 0 };
+		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Can't open %s! [%s]\n",
+						  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+	}
+
+	switch_safe_free(path);
+
+	return ok;
+}
+
 static void backup_cdr(cdr_data_t *data)
 {
 	if (globals.log_errors_to_disk) {
-		int fd = -1, err_dir_index;
-		char *path = NULL;
-		const char *json_text = data->json_text_escaped ? data->json_text_escaped : data->json_text;
+		int err_dir_index;
+		char *dir;
+		switch_bool_t ok;
+
+		/* with replay on, failed posts go to their own spool so archived cdrs in the log dir are never re-posted */
+		if (globals.spool_dir && write_backup(globals.spool_dir, data)) {
+			return;
+		}
 
 		for (err_dir_index = 0; err_dir_index < globals.err_dir_count; err_dir_index++) {
 			switch_thread_rwlock_rdlock(globals.log_path_lock);
-			path = switch_mprintf("%s%s%s", globals.err_log_dir[err_dir_index], SWITCH_PATH_SEPARATOR, data->filename);
+			dir = switch_safe_strdup(globals.err_log_dir[err_dir_index]);
 			switch_thread_rwlock_unlock(globals.log_path_lock);
 
-			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Backup file %s\n", path);
-			if (path) {
-#ifdef _MSC_VER
-				mode_t mode = S_IRUSR | S_IWUSR;
-#else
-				mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
-#endif
-				if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, mode)) > -1) {
-					switch_size_t json_len = strlen(json_text);
-					switch_ssize_t wrote = 0, x;
-					do { x = write(fd, json_text, json_len);
-					} while (!(x<0) && json_len > (wrote += x));
-					if (!(x<0)) do { x = write(fd, "\n", 1);
-						} while (!(x<0) && x<1);
-					close(fd); fd = -1;
-					if (x < 0) {
-						switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
-						if (0 > unlink(path))
-							switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
-					}
-					switch_safe_free(path);
-					break;
-				} else {
-					char ebuf[512] = { 0 };
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Can't open %s! [%s]\n",
-									  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+			ok = dir && write_backup(dir, data);
+			switch_safe_free(dir);
 
-				}
-				switch_safe_free(path);
+			if (ok) {
+				break;
 			}
 		}
 	} else {
@@ -241,7 +274,6 @@ static void backup_cdr(cdr_data_t *data)
 	}
 }
 
-
 void destroy_cdr_data(cdr_data_t *data)
 {
 	switch_safe_free(data->json_text);
@@ -252,185 +284,340 @@ void destroy_cdr_data(cdr_data_t *data)
 	switch_safe_free(data);
 }
 
-static void process_cdr(cdr_data_t *data)
+static void log_cdr_to_disk(cdr_data_t *data)
 {
-	char *curl_json_text = NULL;
-	long httpRes;
-	CURL *curl_handle = NULL;
-	switch_curl_slist_t *headers = NULL;
-	switch_curl_slist_t *slist = NULL;
 	int fd = -1;
-	uint32_t cur_try;
+	char *path;
 
-	switch_assert(data != NULL);
-
-	if (globals.shutdown) {
-		goto end;
+	if (zstr(data->logdir) || !(globals.log_http_and_disk || !globals.url_count)) {
+		return;
 	}
 
-	switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Process [%s]\n", data->filename);
-
-	if (!zstr(data->logdir) && (globals.log_http_and_disk || !globals.url_count)) {
-		char *path = switch_mprintf("%s%s%s", data->logdir, SWITCH_PATH_SEPARATOR, data->filename);
-		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Log to disk [%s]\n", path);
-		if (path) {
+	path = switch_mprintf("%s%s%s", data->logdir, SWITCH_PATH_SEPARATOR, data->filename);
+	switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_INFO, "Log to disk [%s]\n", path);
+	if (path) {
 #ifdef _MSC_VER
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
 #else
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
 #endif
-				switch_size_t json_len = strlen(data->json_text);
-				switch_ssize_t wrote = 0, x;
-				do { x = write(fd, data->json_text, json_len);
-				} while (!(x<0) && json_len > (wrote += x));
-				if (!(x<0)) do { x = write(fd, "\n", 1);
-					} while (!(x<0) && x<1);
-				close(fd); fd = -1;
-				if (x < 0) {
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
-					if (0 > unlink(path))
-						switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
-				}
-			} else {
-				char ebuf[512] = { 0 };
-				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s][%s]\n",
-								  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+			switch_size_t json_len = strlen(data->json_text);
+			switch_ssize_t wrote = 0, x;
+			do { x = write(fd, data->json_text, json_len);
+			} while (!(x<0) && json_len > (wrote += x));
+			if (!(x<0)) do { x = write(fd, "\n", 1);
+				} while (!(x<0) && x<1);
+			close(fd); fd = -1;
+			if (x < 0) {
+				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s]\n",path);
+				if (0 > unlink(path))
+					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error unlinking [%s]\n",path);
 			}
-			switch_safe_free(path);
+		} else {
+			char ebuf[512] = { 0 };
+			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Error writing [%s][%s]\n",
+							  path, switch_strerror_r(errno, ebuf, sizeof(ebuf)));
 		}
+		switch_safe_free(path);
 	}
+}
 
-	/* try to post it to the web server */
-	if (globals.url_count) {
-		char *destUrl = NULL;
-		curl_handle = switch_curl_easy_init();
+static switch_curl_slist_t *cdr_curl_headers(void)
+{
+	switch_curl_slist_t *headers = NULL;
 
-		if (globals.encode) {
-			if (globals.encode == ENCODING_DEFAULT) {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
-			} else {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
-			}
+	if (globals.encode == ENCODING_DEFAULT) {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
+	} else if (globals.encode) {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
+	} else {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/json");
+	}
 
-			curl_json_text = switch_mprintf("cdr=%s", data->json_text_escaped);
-			switch_assert(curl_json_text != NULL);
+	if (globals.disable100continue) {
+		headers = switch_curl_slist_append(headers, "Expect:");
+	}
 
-		} else {
-			headers = switch_curl_slist_append(headers, "Content-Type: application/json");
-			curl_json_text = (char *)data->json_text;
-		}
+	return headers;
+}
+
+/* everything but the url and the body, so the delivery thread can keep one handle (and its connections) alive */
+static switch_CURL *cdr_curl_init(switch_curl_slist_t *headers)
+{
+	switch_CURL *curl_handle = switch_curl_easy_init();
+
+	if (!zstr(globals.cred)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
+	}
+
+	switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-json/1.0");
+	switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
+
+	if (!zstr(globals.ssl_cert_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
+	}
 
-		if (!zstr(globals.cred)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
+	if (!zstr(globals.ssl_key_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
+	}
+
+	if (!zstr(globals.ssl_key_password)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
+	}
+
+	if (!zstr(globals.ssl_version)) {
+		if (!strcasecmp(globals.ssl_version, "SSLv3")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
+		} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
 		}
+	}
 
-		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, curl_json_text);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-json/1.0");
-		switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
+	if (!zstr(globals.ssl_cacert_file)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
+	}
+
+	/* these were used for testing, optionally they may be enabled if someone desires
+	   switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 120); // tcp timeout
+	   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
+	 */
 
-		if (globals.disable100continue) {
-			slist = switch_curl_slist_append(slist, "Expect:");
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
+	return curl_handle;
+}
+
+/* sleep in small steps so a long backoff does not hold up the module shutdown */
+static void cdr_sleep(uint32_t seconds)
+{
+	switch_time_t until = switch_micro_time_now() + (switch_time_t) seconds * 1000000;
+
+	while (!globals.shutdown && switch_micro_time_now() < until) {
+		switch_yield(100000);
+	}
+}
+
+static uint32_t cdr_backoff(uint32_t delay)
+{
+	delay = delay ? delay * 2 : globals.delay;
+
+	return delay > globals.max_delay ? globals.max_delay : delay;
+}
+
+static switch_bool_t post_cdr(switch_CURL *curl_handle, const char *uuid, const char *body, uint32_t tries)
+{
+	char *destUrl = NULL;
+	long httpRes = 0;
+	uint32_t cur_try, delay = 0;
+
+	switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, body);
+
+	for (cur_try = 0; cur_try < tries && !globals.shutdown; cur_try++) {
+		if (cur_try > 0) {
+			delay = cdr_backoff(delay);
+			cdr_sleep(delay);
 		}
 
-		if (!zstr(globals.ssl_cert_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
+		if (uuid) {
+			destUrl = switch_mprintf("%s?uuid=%s", globals.urls[globals.url_index], uuid);
+		} else {
+			destUrl = strdup(globals.urls[globals.url_index]);
 		}
+		switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
 
-		if (!zstr(globals.ssl_key_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
+		if (!strncasecmp(destUrl, "https", 5)) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
 		}
 
-		if (!zstr(globals.ssl_key_password)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
+		if (globals.enable_cacert_check) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
 		}
 
-		if (!zstr(globals.ssl_version)) {
-			if (!strcasecmp(globals.ssl_version, "SSLv3")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
-			} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
+		if (globals.enable_ssl_verifyhost) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+		}
+
+		httpRes = 0;
+		switch_curl_easy_perform(curl_handle);
+		switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
+		switch_safe_free(destUrl);
+		if (httpRes >= 200 && httpRes < 300) {
+			return SWITCH_TRUE;
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_UUID_LOG(uuid), SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
+							  httpRes, globals.urls[globals.url_index]);
+			globals.url_index++;
+			switch_assert(globals.url_count <= MAX_URLS);
+			if (globals.url_index >= globals.url_count) {
+				globals.url_index = 0;
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(uuid), SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[globals.url_index]);
 			}
 		}
+	}
+
+	return SWITCH_FALSE;
+}
+
+static char *cdr_post_body(cdr_data_t *data)
+{
+	if (globals.encode) {
+		char *body = switch_mprintf("cdr=%s", data->json_text_escaped);
+		switch_assert(body != NULL);
+		return body;
+	}
+
+	return data->json_text;
+}
+
+/* a failed post from the delivery thread puts the collector in backoff, cdrs are spooled to disk until it is retried */
+static switch_bool_t cdr_collector_down(void)
+{
+	return globals.replay_interval && globals.down_until > switch_micro_time_now() ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+static void cdr_collector_result(switch_bool_t ok)
+{
+	if (ok) {
+		if (globals.down_delay) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Web server is accepting CDRs again\n");
+		}
+		globals.down_delay = 0;
+		globals.down_until = 0;
+	} else if (globals.replay_interval) {
+		globals.down_delay = cdr_backoff(globals.down_delay);
+		globals.down_until = switch_micro_time_now() + (switch_time_t) globals.down_delay * 1000000;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Spooling CDRs to disk for %u seconds\n", globals.down_delay);
+	}
+}
+
+static void deliver_cdrs(cdr_data_t **batch, uint32_t count, switch_CURL *curl_handle)
+{
+	switch_curl_slist_t *headers = NULL;
+	switch_CURL *tmp_handle = NULL;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(batch[i]->uuid), SWITCH_LOG_INFO, "Process [%s]\n", batch[i]->filename);
+		log_cdr_to_disk(batch[i]);
+	}
 
-		if (!zstr(globals.ssl_cacert_file)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
+	/* try to post it to the web server */
+	if (globals.url_count && !globals.shutdown) {
+		if (!curl_handle) {
+			headers = cdr_curl_headers();
+			curl_handle = tmp_handle = cdr_curl_init(headers);
 		}
 
-		/* these were used for testing, optionally they may be enabled if someone desires
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 120); // tcp timeout
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
-		 */
+		if (cdr_collector_down()) {
+			for (i = 0; i < count; i++) {
+				backup_cdr(batch[i]);
+			}
+		} else if (count > 1) {
+			switch_stream_handle_t stream = { 0 };
+			switch_bool_t ok;
 
-		for (cur_try = 0; cur_try < globals.retries; cur_try++) {
-			if (cur_try > 0) {
-				switch_yield(globals.delay * 1000000);
+			SWITCH_STANDARD_STREAM(stream);
+			for (i = 0; i < count; i++) {
+				stream.write_function(&stream, "%c%s", i ? ',' : '[', batch[i]->json_text);
 			}
+			stream.write_function(&stream, "]");
 
-			destUrl = switch_mprintf("%s?uuid=%s", globals.urls[globals.url_index], data->uuid);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
+			ok = post_cdr(curl_handle, NULL, (char *) stream.data, globals.retries);
+			switch_safe_free(stream.data);
+
+			if (!ok) {
+				/* if we are here the web post failed for some reason */
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post batch of %u CDRs to web server\n", count);
+				for (i = 0; i < count; i++) {
+					backup_cdr(batch[i]);
+				}
+			}
 
-			if (!strncasecmp(destUrl, "https", 5)) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
+			if (!tmp_handle) {
+				cdr_collector_result(ok);
 			}
+		} else {
+			char *body = cdr_post_body(batch[0]);
+			switch_bool_t ok = post_cdr(curl_handle, batch[0]->uuid, body, globals.retries);
 
-			if (globals.enable_cacert_check) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
+			if (body != batch[0]->json_text) {
+				switch_safe_free(body);
 			}
 
-			if (globals.enable_ssl_verifyhost) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+			if (!ok) {
+				/* if we are here the web post failed for some reason */
+				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(batch[0]->uuid), SWITCH_LOG_ERROR, "Unable to post to web server\n");
+				backup_cdr(batch[0]);
 			}
 
-			switch_curl_easy_perform(curl_handle);
-			switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-			switch_safe_free(destUrl);
-			if (httpRes >= 200 && httpRes < 300) {
-				goto end;
-			} else {
-				switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
-								  httpRes, globals.urls[globals.url_index]);
-				globals.url_index++;
-				switch_assert(globals.url_count <= MAX_URLS);
-				if (globals.url_index >= globals.url_count) {
-					globals.url_index = 0;
-				} else {
-					switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[globals.url_index]);
-					}
+			if (!tmp_handle) {
+				cdr_collector_result(ok);
 			}
 		}
-		switch_curl_easy_cleanup(curl_handle);
-		switch_curl_slist_free_all(headers);
-		switch_curl_slist_free_all(slist);
-		slist = NULL;
-		headers = NULL;
-		curl_handle = NULL;
 
-		/* if we are here the web post failed for some reason */
-		switch_log_printf(SWITCH_CHANNEL_UUID_LOG(data->uuid), SWITCH_LOG_ERROR, "Unable to post to web server\n");
-		backup_cdr(data);
+		if (tmp_handle) {
+			switch_curl_easy_cleanup(tmp_handle);
+			switch_curl_slist_free_all(headers);
+		}
 	}
 
-	end:
-	if (curl_handle) {
-		switch_curl_easy_cleanup(curl_handle);
+	for (i = 0; i < count; i++) {
+		destroy_cdr_data(batch[i]);
 	}
-	if (headers) {
-		switch_curl_slist_free_all(headers);
+}
+
+static switch_bool_t replay_cdr(const char *name, char *text, switch_size_t len, void *pdata)
+{
+	switch_CURL *curl_handle = (switch_CURL *) pdata;
+	const char *uuid = name;
+	char *body = text;
+	switch_bool_t ok;
+
+	if (globals.shutdown) {
+		return SWITCH_FALSE;
+	}
+
+	if (!strncmp(uuid, "a_", 2)) {
+		uuid += 2;
 	}
-	if (slist) {
-		switch_curl_slist_free_all(slist);
+
+	if (globals.encode) {
+		body = switch_mprintf("cdr=%s", text);
+		switch_assert(body);
 	}
-	if (curl_json_text != data->json_text) {
-		switch_safe_free(curl_json_text);
+
+	ok = post_cdr(curl_handle, uuid, body, 1);
+
+	if (body != text) {
+		switch_safe_free(body);
 	}
 
-	destroy_cdr_data(data);
+	return ok;
+}
+
+/* send the CDRs left behind by failed posts in the spool dir, a few at a time, and stop at the first failure */
+static void replay_backups(switch_CURL *curl_handle)
+{
+	switch_bool_t failed = SWITCH_FALSE;
+	uint32_t sent;
+
+	if (!globals.url_count || !globals.spool_dir) {
+		return;
+	}
+
+	sent = switch_spool_replay(globals.spool_dir, ".cdr.json", REPLAY_BATCH, 5, replay_cdr, curl_handle, &failed);
+
+	if (sent) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Replayed %u backed up CDRs\n", sent);
+	}
+
+	if ((sent || failed) && !globals.shutdown) {
+		cdr_collector_result(!failed);
+	}
 }
 
 static switch_status_t my_on_reporting(switch_core_session_t *session)
@@ -503,7 +690,7 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 			destroy_cdr_data(cdr_data);
 		}
 	} else {
-		process_cdr(cdr_data);
+		deliver_cdrs(&cdr_data, 1, NULL);
 	}
 
 	cJSON_Delete(json_cdr);
@@ -513,28 +700,64 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 
 static void *SWITCH_THREAD_FUNC cdr_thread(switch_thread_t *t, void *obj)
 {
+	cdr_data_t **batch = NULL;
+	switch_curl_slist_t *headers = NULL;
+	switch_CURL *curl_handle = NULL;
+	switch_time_t next_replay = 0;
 	void *pop = NULL;
+	int running = 1;
+
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread started.\n");
 
-	while (!globals.shutdown) {
-		cdr_data_t *data = NULL;
+	switch_zmalloc(batch, sizeof(*batch) * globals.batch_size);
 
-		if (switch_queue_pop(globals.queue, &pop) != SWITCH_STATUS_SUCCESS) {
-			break;
+	if (globals.url_count) {
+		headers = cdr_curl_headers();
+		curl_handle = cdr_curl_init(headers);
+	}
+
+	while (running && !globals.shutdown) {
+		uint32_t count = 0;
+
+		if (switch_queue_pop_timeout(globals.queue, &pop, 1000000) != SWITCH_STATUS_SUCCESS) {
+			if (curl_handle && globals.replay_interval && !cdr_collector_down() && switch_micro_time_now() >= next_replay) {
+				replay_backups(curl_handle);
+				next_replay = switch_micro_time_now() + (switch_time_t) globals.replay_interval * 1000000;
+			}
+			continue;
 		}
 
 		if (!pop) {
 			break;
 		}
 
-		data = (cdr_data_t *) pop;
-		process_cdr(data);
+		batch[count++] = (cdr_data_t *) pop;
+
+		/* only plain JSON can be posted as an array */
+		while (count < globals.batch_size && !globals.encode && switch_queue_trypop(globals.queue, &pop) == SWITCH_STATUS_SUCCESS) {
+			if (!pop) {
+				running = 0;
+				break;
+			}
+			batch[count++] = (cdr_data_t *) pop;
+		}
+
+		deliver_cdrs(batch, count, curl_handle);
 	}
 
 	while (switch_queue_trypop(globals.queue, &pop) == SWITCH_STATUS_SUCCESS) {
-		destroy_cdr_data((cdr_data_t *) pop);
+		if (pop) {
+			backup_cdr((cdr_data_t *) pop);
+			destroy_cdr_data((cdr_data_t *) pop);
+		}
 	}
 
+	if (curl_handle) {
+		switch_curl_easy_cleanup(curl_handle);
+	}
+	switch_curl_slist_free_all(headers);
+	switch_safe_free(batch);
+
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread ended.\n");
 	switch_thread_exit(t, SWITCH_STATUS_SUCCESS);
 
@@ -581,6 +804,9 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 	globals.pool = pool;
 	globals.auth_scheme = CURLAUTH_BASIC;
 	globals.encode_values = ENCODING_DEFAULT;
+	globals.queue_capacity = -1;
+	globals.batch_size = 1;
+	globals.max_delay = 60;
 
 	switch_thread_rwlock_create(&globals.log_path_lock, pool);
 
@@ -686,15 +912,20 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 				globals.encode_values = switch_true(val) ? ENCODING_DEFAULT : ENCODING_NONE;
 			} else if (!strcasecmp(var, "queue-capacity") && !zstr(val)) {
 				int capacity = atoi(val);
-				if (capacity > 0) {
-					switch_threadattr_t *thd_attr;
-
-					switch_queue_create(&globals.queue, capacity, globals.pool);
-
-					switch_threadattr_create(&thd_attr, globals.pool);
-					switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-					switch_thread_create(&globals.thread, thd_attr, cdr_thread, NULL, globals.pool);
+				if (capacity >= 0) {
+					globals.queue_capacity = capacity;
+				}
+			} else if (!strcasecmp(var, "batch-size") && !zstr(val)) {
+				int tmp = atoi(val);
+				if (tmp > 0 && tmp <= MAX_BATCH_SIZE) {
+					globals.batch_size = (uint32_t) tmp;
+				} else {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "batch-size must be between 1 and %d\n", MAX_BATCH_SIZE);
 				}
+			} else if (!strcasecmp(var, "max-delay") && !zstr(val)) {
+				globals.max_delay = (uint32_t) atoi(val);
+			} else if (!strcasecmp(var, "retry-backup-interval") && !zstr(val)) {
+				globals.replay_interval = (uint32_t) atoi(val);
 			}
 		}
 
@@ -714,8 +945,36 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_json_cdr_load)
 
 	globals.retries++;
 
+	if (globals.max_delay < globals.delay) {
+		globals.max_delay = globals.delay;
+	}
+
+	if (globals.batch_size > 1 && globals.encode) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "batch-size requires encode to be off, posting one CDR at a time\n");
+	}
+
 	set_json_cdr_log_dirs();
 
+	if (globals.replay_interval && globals.url_count) {
+		globals.spool_dir = switch_core_sprintf(globals.pool, "%s%sspool", globals.base_err_log_dir[0], SWITCH_PATH_SEPARATOR);
+		switch_dir_make_recursive(globals.spool_dir, SWITCH_DEFAULT_DIR_PERMS, globals.pool);
+	}
+
+	/* unless told otherwise, post from a delivery thread so hung up sessions never wait on the web server */
+	if (globals.queue_capacity < 0) {
+		globals.queue_capacity = globals.url_count ? 1000 : 0;
+	}
+
+	if (globals.queue_capacity > 0) {
+		switch_threadattr_t *thd_attr;
+
+		switch_queue_create(&globals.queue, globals.queue_capacity, globals.pool);
+
+		switch_threadattr_create(&thd_attr, globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&globals.thread, thd_attr, cdr_thread, NULL, globals.pool);
+	}
+
 	if (switch_event_bind_removable(modname, SWITCH_EVENT_TRAP, SWITCH_EVENT_SUBCLASS_ANY, event_handler, NULL, &globals.node) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind!\n");
 		return SWITCH_STATUS_GENERR;
@@ -42,9 +42,44 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_lua_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_lua_shutdown);
 
 SWITCH_MODULE_DEFINITION_EX(mod_lua, mod_lua_load, mod_lua_shutdown, NULL, SMODF_GLOBAL_SYMBOLS);
+#if LUA_VERSION_NUM < 502
+#define lua_pushglobaltable(L) lua_pushvalue(L, LUA_GLOBALSINDEX)
+#endif
+
+#define LUA_BASELINE_KEY "mod_lua_baseline"
+#define LUA_BASELINE_LIBS_KEY "mod_lua_baseline_libs"
+
+/* one compiled script, keyed by its full path */
+typedef struct lua_chunk_s {
+	char *path;
+	char *name;
+	time_t mtime;
+	switch_size_t size;
+	char *code;
+	switch_size_t len;
+	uint32_t hits;
+} lua_chunk_t;
+
+typedef struct lua_pooled_state_s {
+	lua_State *L;
+	struct lua_pooled_state_s *next;
+} lua_pooled_state_t;
+
 static struct {
 	switch_memory_pool_t *pool;
 	char *xml_handler;
+	switch_mutex_t *cache_mutex;
+	switch_hash_t *chunk_hash;
+	switch_bool_t bytecode_cache;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+	switch_mutex_t *state_mutex;
+	lua_pooled_state_t *free_states;
+	lua_pooled_state_t *free_nodes;
+	uint32_t state_pool_size;
+	uint32_t idle_states;
+	uint64_t states_reused;
+	uint64_t states_created;
 } globals;
 
 int luaopen_freeswitch(lua_State * L);
@@ -131,6 +166,307 @@ static lua_State *lua_init(void)
 	return L;
 }
 
+/* Push a shallow copy of the table at idx */
+static void lua_table_copy(lua_State *L, int idx)
+{
+	idx = lua_absindex(L, idx);
+	lua_newtable(L);
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, -4);
+	}
+}
+
+/* Make the table at idx hold exactly the keys and values of the copy at copy_idx again */
+static void lua_table_restore(lua_State *L, int idx, int copy_idx)
+{
+	idx = lua_absindex(L, idx);
+	copy_idx = lua_absindex(L, copy_idx);
+
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		lua_pop(L, 1);
+		lua_pushvalue(L, -1);
+		lua_rawget(L, copy_idx);
+		if (lua_isnil(L, -1)) {
+			lua_pushvalue(L, -2);
+			lua_pushnil(L);
+			lua_rawset(L, idx);
+		}
+		lua_pop(L, 1);
+	}
+
+	lua_pushnil(L);
+	while (lua_next(L, copy_idx)) {
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, idx);
+	}
+}
+
+/* Remember the globals of a freshly initialized state so lua_state_reset() can bring it back.
+   The library tables (string, table, math, the freeswitch module...) are copied too, one level deep. */
+static void lua_state_baseline(lua_State *L)
+{
+	lua_pushglobaltable(L);
+	lua_table_copy(L, -1);
+	lua_setfield(L, LUA_REGISTRYINDEX, LUA_BASELINE_KEY);
+
+	lua_newtable(L);
+	lua_pushnil(L);
+	while (lua_next(L, -3)) {
+		if (lua_istable(L, -1) && !lua_rawequal(L, -1, -4)) {
+			lua_table_copy(L, -1);
+			lua_rawset(L, -4);
+		} else {
+			lua_pop(L, 1);
+		}
+	}
+	lua_setfield(L, LUA_REGISTRYINDEX, LUA_BASELINE_LIBS_KEY);
+	lua_pop(L, 1);
+}
+
+/* Drop the globals a script created and restore the ones it replaced, then do the same
+   for the fields of each library table. Modules pulled in with require() stay loaded,
+   and tables nested inside a library table are not restored. */
+static void lua_state_reset(lua_State *L)
+{
+	lua_settop(L, 0);
+	lua_pushglobaltable(L);
+	lua_getfield(L, LUA_REGISTRYINDEX, LUA_BASELINE_KEY);
+	lua_table_restore(L, 1, 2);
+	lua_settop(L, 0);
+
+	lua_getfield(L, LUA_REGISTRYINDEX, LUA_BASELINE_LIBS_KEY);
+	if (lua_istable(L, 1)) {
+		lua_pushnil(L);
+		while (lua_next(L, 1)) {
+			lua_table_restore(L, -2, -1);
+			lua_pop(L, 1);
+		}
+	}
+
+	lua_settop(L, 0);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+}
+
+/* Take a state from the idle pool, or build a new one */
+static lua_State *lua_state_get(void)
+{
+	lua_State *L = NULL;
+
+	if (globals.state_pool_size) {
+		lua_pooled_state_t *ps;
+
+		switch_mutex_lock(globals.state_mutex);
+		if ((ps = globals.free_states)) {
+			globals.free_states = ps->next;
+			L = ps->L;
+			ps->L = NULL;
+			ps->next = globals.free_nodes;
+			globals.free_nodes = ps;
+			globals.idle_states--;
+			globals.states_reused++;
+		}
+		switch_mutex_unlock(globals.state_mutex);
+
+		if (L) {
+			return L;
+		}
+	}
+
+	if ((L = lua_init())) {
+		if (globals.state_pool_size) {
+			lua_state_baseline(L);
+		}
+		globals.states_created++;
+	}
+
+	return L;
+}
+
+/* Hand a state back; it is reset and kept while the pool has room, closed otherwise */
+static void lua_state_put(lua_State *L)
+{
+	lua_pooled_state_t *ps = NULL;
+
+	if (!L) {
+		return;
+	}
+
+	if (globals.state_pool_size && globals.idle_states < globals.state_pool_size) {
+		lua_getfield(L, LUA_REGISTRYINDEX, LUA_BASELINE_KEY);
+		if (lua_istable(L, -1)) {
+			lua_state_reset(L);
+
+			switch_mutex_lock(globals.state_mutex);
+			if (globals.idle_states < globals.state_pool_size) {
+				if ((ps = globals.free_nodes)) {
+					globals.free_nodes = ps->next;
+				} else {
+					ps = (lua_pooled_state_t *) switch_core_alloc(globals.pool, sizeof(*ps));
+				}
+				ps->L = L;
+				ps->next = globals.free_states;
+				globals.free_states = ps;
+				globals.idle_states++;
+			}
+			switch_mutex_unlock(globals.state_mutex);
+		}
+	}
+
+	if (!ps) {
+		lua_uninit(L);
+	}
+}
+
+static void lua_state_pool_flush(void)
+{
+	lua_pooled_state_t *ps, *list;
+
+	if (!globals.state_mutex) {
+		return;
+	}
+
+	switch_mutex_lock(globals.state_mutex);
+	list = globals.free_states;
+	globals.free_states = NULL;
+	globals.idle_states = 0;
+	switch_mutex_unlock(globals.state_mutex);
+
+	while ((ps = list)) {
+		list = ps->next;
+		lua_uninit(ps->L);
+		switch_mutex_lock(globals.state_mutex);
+		ps->L = NULL;
+		ps->next = globals.free_nodes;
+		globals.free_nodes = ps;
+		switch_mutex_unlock(globals.state_mutex);
+	}
+}
+
+static int lua_chunk_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+	switch_buffer_t *buffer = (switch_buffer_t *) ud;
+
+	return switch_buffer_write(buffer, p, sz) == sz ? 0 : 1;
+}
+
+static void lua_chunk_free(lua_chunk_t *chunk)
+{
+	if (chunk) {
+		switch_safe_free(chunk->code);
+		switch_safe_free(chunk->path);
+		switch_safe_free(chunk->name);
+		free(chunk);
+	}
+}
+
+/* Dump the function on top of the stack into the cache */
+static void lua_chunk_store(lua_State *L, const char *file, struct stat *st)
+{
+	switch_buffer_t *buffer = NULL;
+	lua_chunk_t *chunk, *old;
+	int r;
+
+	if (switch_buffer_create_dynamic(&buffer, 4096, 4096, 0) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+#if LUA_VERSION_NUM >= 503
+	r = lua_dump(L, lua_chunk_writer, buffer, 0);
+#else
+	r = lua_dump(L, lua_chunk_writer, buffer);
+#endif
+
+	if (!r && switch_buffer_inuse(buffer)) {
+		chunk = (lua_chunk_t *) calloc(1, sizeof(*chunk));
+		switch_assert(chunk);
+		chunk->path = strdup(file);
+		/* "@" marks the chunk name as a file name, the same as luaL_loadfile() uses */
+		chunk->name = switch_mprintf("@%s", file);
+		chunk->mtime = st->st_mtime;
+		chunk->size = (switch_size_t) st->st_size;
+		chunk->len = switch_buffer_inuse(buffer);
+		chunk->code = (char *) malloc(chunk->len);
+		switch_assert(chunk->path && chunk->name && chunk->code);
+		switch_buffer_read(buffer, chunk->code, chunk->len);
+
+		switch_mutex_lock(globals.cache_mutex);
+		if ((old = (lua_chunk_t *) switch_core_hash_find(globals.chunk_hash, file))) {
+			switch_core_hash_delete(globals.chunk_hash, file);
+			lua_chunk_free(old);
+		}
+		switch_core_hash_insert(globals.chunk_hash, chunk->path, chunk);
+		switch_mutex_unlock(globals.cache_mutex);
+	}
+
+	switch_buffer_destroy(&buffer);
+}
+
+/* luaL_loadfile() backed by the bytecode cache; a changed mtime or size recompiles the script */
+static int lua_load_script(lua_State *L, const char *file)
+{
+	struct stat st;
+	lua_chunk_t *chunk;
+	int status;
+
+	if (!globals.bytecode_cache || stat(file, &st)) {
+		return luaL_loadfile(L, file);
+	}
+
+	switch_mutex_lock(globals.cache_mutex);
+	if ((chunk = (lua_chunk_t *) switch_core_hash_find(globals.chunk_hash, file)) &&
+		chunk->mtime == st.st_mtime && chunk->size == (switch_size_t) st.st_size) {
+		chunk->hits++;
+		globals.cache_hits++;
+		/* loading bytecode is cheap, doing it under the lock keeps the chunk alive without refcounts */
+		status = luaL_loadbuffer(L, chunk->code, chunk->len, chunk->name);
+		switch_mutex_unlock(globals.cache_mutex);
+		return status;
+	}
+	globals.cache_misses++;
+	switch_mutex_unlock(globals.cache_mutex);
+
+	if ((status = luaL_loadfile(L, file))) {
+		return status;
+	}
+
+	lua_chunk_store(L, file, &st);
+
+	return 0;
+}
+
+static void lua_chunk_cache_flush(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!globals.cache_mutex) {
+		return;
+	}
+
+	switch_mutex_lock(globals.cache_mutex);
+	while ((hi = switch_core_hash_first(globals.chunk_hash))) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		switch_safe_free(hi);
+		switch_core_hash_delete(globals.chunk_hash, ((lua_chunk_t *) val)->path);
+		lua_chunk_free((lua_chunk_t *) val);
+	}
+	switch_mutex_unlock(globals.cache_mutex);
+}
+
+static char *lua_script_path(const char *file)
+{
+	if (switch_is_file_path(file)) {
+		return strdup(file);
+	}
+
+	return switch_mprintf("%s/%s", SWITCH_GLOBAL_dirs.script_dir, file);
+}
+
 
 static int lua_parse_and_execute(lua_State * L, char *input_code, switch_core_session_t *session)
 {
@@ -184,15 +520,11 @@ static int lua_parse_and_execute(lua_State * L, char *input_code, switch_core_se
 		}
 
 		if (!error) {
-			char *file = input_code, *fdup = NULL;
+			char *file = lua_script_path(input_code);
 
-			if (!switch_is_file_path(file)) {
-				fdup = switch_mprintf("%s/%s", SWITCH_GLOBAL_dirs.script_dir, file);
-				switch_assert(fdup);
-				file = fdup;
-			}
-			error = luaL_loadfile(L, file) || docall(L, 0, 0, 0, 1);
-			switch_safe_free(fdup);
+			switch_assert(file);
+			error = lua_load_script(L, file) || docall(L, 0, 0, 0, 1);
+			switch_safe_free(file);
 		}
 	}
 
@@ -239,7 +571,7 @@ static switch_xml_t lua_fetch(const char *section,
 	lua_State *L = NULL;
 
 	if (!zstr(globals.xml_handler)) {
-		L = lua_init();
+		L = lua_state_get();
 		const char *str;
 		int error;
 
@@ -291,9 +623,7 @@ static switch_xml_t lua_fetch(const char *section,
 
 	switch_safe_free(mycmd);
 
-	if (L) {
-		lua_uninit(L);
-	}
+	lua_state_put(L);
 
 	return xml;
 }
@@ -327,6 +657,11 @@ static switch_status_t do_config(void)
 					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "binding '%s' to '%s'\n", globals.xml_handler, val);
 					switch_xml_bind_search_function(lua_fetch, switch_xml_parse_section_string(val), NULL);
 				}
+			} else if (!strcmp(var, "bytecode-cache")) {
+				globals.bytecode_cache = switch_true(val) ? SWITCH_TRUE : SWITCH_FALSE;
+			} else if (!strcmp(var, "state-pool-size")) {
+				int n = atoi(val);
+				globals.state_pool_size = n > 0 ? n : 0;
 			} else if (!strcmp(var, "module-directory") && !zstr(val)) {
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "lua: appending module directory: '%s'\n", val);
 				if (cpath_stream.data_len) {
@@ -450,7 +785,7 @@ int lua_thread(const char *text)
 
 static void lua_event_handler(switch_event_t *event)
 {
-	lua_State *L = lua_init();
+	lua_State *L = lua_state_get();
 	char *script = NULL;
 
 	if (event->bind_user_data) {
@@ -460,14 +795,14 @@ static void lua_event_handler(switch_event_t *event)
 	mod_lua_conjure_event(L, event, "event", 1);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "lua event hook: execute '%s'\n", (char *)script);
 	lua_parse_and_execute(L, (char *)script, NULL);
-	lua_uninit(L);
+	lua_state_put(L);
 
 	switch_safe_free(script);
 }
 
 SWITCH_STANDARD_APP(lua_function)
 {
-	lua_State *L = lua_init();
+	lua_State *L;
 	char *mycmd;
 
 	if (zstr(data)) {
@@ -475,13 +810,15 @@ SWITCH_STANDARD_APP(lua_function)
 		return;
 	}
 
+	L = lua_state_get();
+
 	mod_lua_conjure_session(L, session, "session", 1);
 
 	mycmd = strdup((char *) data);
 	switch_assert(mycmd);
 
 	lua_parse_and_execute(L, mycmd, session);
-	lua_uninit(L);
+	lua_state_put(L);
 	free(mycmd);
 
 }
@@ -499,9 +836,71 @@ SWITCH_STANDARD_API(luarun_api_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define LUACACHE_SYNTAX "list|flush|warm <script>"
+SWITCH_STANDARD_API(luacache_api_function)
+{
+	char *mycmd = NULL, *argv[2] = { 0 };
+	int argc = 0;
+
+	if (!zstr(cmd) && (mycmd = strdup(cmd))) {
+		argc = switch_separate_string(mycmd, ' ', argv, (sizeof(argv) / sizeof(argv[0])));
+	}
+
+	if (!argc) {
+		stream->write_function(stream, "-USAGE: %s\n", LUACACHE_SYNTAX);
+	} else if (!strcasecmp(argv[0], "list")) {
+		switch_hash_index_t *hi;
+		const void *var;
+		void *val;
+
+		switch_mutex_lock(globals.cache_mutex);
+		stream->write_function(stream, "bytecode cache %s hits=%" SWITCH_UINT64_T_FMT " misses=%" SWITCH_UINT64_T_FMT "\n",
+							   globals.bytecode_cache ? "on" : "off", globals.cache_hits, globals.cache_misses);
+		for (hi = switch_core_hash_first(globals.chunk_hash); hi; hi = switch_core_hash_next(&hi)) {
+			lua_chunk_t *chunk;
+
+			switch_core_hash_this(hi, &var, NULL, &val);
+			chunk = (lua_chunk_t *) val;
+			stream->write_function(stream, "%s bytes=%" SWITCH_SIZE_T_FMT " hits=%u\n", chunk->path, chunk->len, chunk->hits);
+		}
+		switch_mutex_unlock(globals.cache_mutex);
+
+		switch_mutex_lock(globals.state_mutex);
+		stream->write_function(stream, "state pool size=%u idle=%u reused=%" SWITCH_UINT64_T_FMT " created=%" SWITCH_UINT64_T_FMT "\n",
+							   globals.state_pool_size, globals.idle_states, globals.states_reused, globals.states_created);
+		switch_mutex_unlock(globals.state_mutex);
+	} else if (!strcasecmp(argv[0], "flush")) {
+		lua_chunk_cache_flush();
+		lua_state_pool_flush();
+		stream->write_function(stream, "+OK\n");
+	} else if (!strcasecmp(argv[0], "warm") && argc > 1) {
+		char *file = lua_script_path(argv[1]);
+		lua_State *L = luaL_newstate();
+
+		if (!globals.bytecode_cache) {
+			stream->write_function(stream, "-ERR bytecode cache is disabled\n");
+		} else if (!L || !file || lua_load_script(L, file)) {
+			stream->write_function(stream, "-ERR %s\n", L ? switch_str_nil(lua_tostring(L, -1)) : "cannot create state");
+		} else {
+			stream->write_function(stream, "+OK\n");
+		}
+
+		if (L) {
+			lua_close(L);
+		}
+		switch_safe_free(file);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", LUACACHE_SYNTAX);
+	}
+
+	switch_safe_free(mycmd);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_CHAT_APP(lua_chat_function)
 {
-	lua_State *L = lua_init();
+	lua_State *L = lua_state_get();
 	char *dup = NULL;
 
 	if (data) {
@@ -510,7 +909,7 @@ SWITCH_STANDARD_CHAT_APP(lua_chat_function)
 
 	mod_lua_conjure_event(L, message, "message", 1);
 	lua_parse_and_execute(L, (char *)dup, NULL);
-	lua_uninit(L);
+	lua_state_put(L);
 
 	switch_safe_free(dup);
 
@@ -527,7 +926,7 @@ SWITCH_STANDARD_API(lua_api_function)
 	if (zstr(cmd)) {
 		stream->write_function(stream, "");
 	} else {
-		lua_State *L = lua_init();
+		lua_State *L = lua_state_get();
 		mycmd = strdup(cmd);
 		switch_assert(mycmd);
 
@@ -552,7 +951,7 @@ SWITCH_STANDARD_API(lua_api_function)
 				stream->write_function(stream, "-ERR Cannot execute script\n");
 			}
 		}
-		lua_uninit(L);
+		lua_state_put(L);
 		free(mycmd);
 	}
 	return SWITCH_STATUS_SUCCESS;
@@ -560,7 +959,7 @@ SWITCH_STANDARD_API(lua_api_function)
 
 SWITCH_STANDARD_DIALPLAN(lua_dialplan_hunt)
 {
-	lua_State *L = lua_init();
+	lua_State *L = lua_state_get();
 	switch_caller_extension_t *extension = NULL;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 	char *cmd = NULL;
@@ -672,7 +1071,7 @@ SWITCH_STANDARD_DIALPLAN(lua_dialplan_hunt)
 
  done:
 	switch_safe_free(cmd);
-	lua_uninit(L);
+	lua_state_put(L);
 	return extension;
 }
 
@@ -688,6 +1087,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_lua_load)
 
 	SWITCH_ADD_API(api_interface, "luarun", "run a script", luarun_api_function, "<script>");
 	SWITCH_ADD_API(api_interface, "lua", "run a script as an api function", lua_api_function, "<script>");
+	SWITCH_ADD_API(api_interface, "luacache", "manage the lua bytecode cache and state pool", luacache_api_function, LUACACHE_SYNTAX);
 	SWITCH_ADD_APP(app_interface, "lua", "Launch LUA ivr", "Run a lua ivr on a channel", lua_function, "<script>",
 				   SAF_SUPPORT_NOMEDIA | SAF_ROUTING_EXEC | SAF_ZOMBIE_EXEC | SAF_SUPPORT_TEXT_ONLY);
 	SWITCH_ADD_DIALPLAN(dp_interface, "LUA", lua_dialplan_hunt);
@@ -696,6 +1096,10 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_lua_load)
 
 
 	globals.pool = pool;
+	globals.bytecode_cache = SWITCH_TRUE;
+	switch_mutex_init(&globals.cache_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_mutex_init(&globals.state_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_core_hash_init(&globals.chunk_hash);
 	do_config();
 
 	/* indicate that the module should continue to be loaded */
@@ -706,6 +1110,10 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_lua_shutdown)
 {
 	switch_event_unbind_callback(lua_event_handler);
 
+	lua_state_pool_flush();
+	lua_chunk_cache_flush();
+	switch_core_hash_destroy(&globals.chunk_hash);
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
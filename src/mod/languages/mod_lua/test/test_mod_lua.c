@@ -56,6 +56,50 @@ FST_CORE_BEGIN("conf")
 		}
 		FST_TEST_END()
 
+		FST_TEST_BEGIN(state_pool_test)
+		{
+			int i;
+
+			for (i = 0; i < 3; i++) {
+				switch_stream_handle_t stream = { 0 };
+
+				SWITCH_STANDARD_STREAM(stream);
+				switch_api_execute("lua", "test_pool.lua", NULL, &stream);
+				fst_requires(stream.data);
+				fst_check_string_equals((char *)stream.data, "+OK");
+				free(stream.data);
+			}
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(bytecode_cache_test)
+		{
+			switch_stream_handle_t stream = { 0 };
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_api_execute("luacache", "warm test_pool.lua", NULL, &stream);
+			fst_requires(stream.data);
+			fst_check_string_equals((char *)stream.data, "+OK\n");
+			free(stream.data);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_api_execute("luacache", "list", NULL, &stream);
+			fst_requires(stream.data);
+			fst_check(strstr((char *)stream.data, "test_pool.lua bytes=") != NULL);
+			free(stream.data);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_api_execute("luacache", "flush", NULL, &stream);
+			free(stream.data);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_api_execute("luacache", "list", NULL, &stream);
+			fst_requires(stream.data);
+			fst_check(strstr((char *)stream.data, "test_pool.lua") == NULL);
+			free(stream.data);
+		}
+		FST_TEST_END()
+
 		FST_TEARDOWN_BEGIN()
 		{
 		}
@@ -0,0 +1,9 @@
+-- a pooled state must not carry globals over from the previous run
+assert(pool_marker == nil)
+pool_marker = true
+
+-- replaced builtins come back as well
+assert(type(print) == "function")
+print = nil
+
+stream:write("+OK")
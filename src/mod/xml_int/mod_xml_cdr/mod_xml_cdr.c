@@ -35,6 +35,7 @@
 #include <sys/stat.h>
 #include <switch_curl.h>
 #define MAX_URLS 20
+#define REPLAY_BATCH 100
 
 #define ENCODING_NONE 0
 #define ENCODING_DEFAULT 1
@@ -73,8 +74,21 @@ static struct {
 	switch_memory_pool_t *pool;
 	switch_event_node_t *node;
 	char *cookie_file;
+	switch_queue_t *queue;
+	switch_thread_t *thread;
+	int queue_capacity;
+	uint32_t max_delay;
+	uint32_t replay_interval;
+	char *spool_dir;
+	uint32_t down_delay;
+	switch_time_t down_until;
 } globals;
 
+typedef struct {
+	char *xml_text;
+	char *name;
+} cdr_data_t;
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_cdr_shutdown);
 SWITCH_MODULE_DEFINITION(mod_xml_cdr, mod_xml_cdr_load, mod_xml_cdr_shutdown, NULL);
@@ -182,25 +196,352 @@ static switch_status_t set_xml_cdr_log_dirs()
 	return status;
 }
 
+static void destroy_cdr_data(cdr_data_t *data)
+{
+	switch_safe_free(data->xml_text);
+	switch_safe_free(data->name);
+	switch_safe_free(data);
+}
+
+static void backup_cdr(cdr_data_t *data)
+{
+	char *path;
+	int fd = -1;
+
+	switch_thread_rwlock_rdlock(globals.log_path_lock);
+	/* with replay on, failed posts go to their own spool so archived cdrs in the log dir are never re-posted */
+	path = switch_mprintf("%s%s%s.cdr.xml", globals.spool_dir ? globals.spool_dir : globals.err_log_dir, SWITCH_PATH_SEPARATOR, data->name);
+	switch_thread_rwlock_unlock(globals.log_path_lock);
+	if (path) {
+#ifdef _MSC_VER
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
+#else
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
+#endif
+			int wrote;
+			wrote = write(fd, data->xml_text, (unsigned) strlen(data->xml_text));
+			wrote++;
+			close(fd);
+			fd = -1;
+		} else {
+			char ebuf[512] = { 0 };
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error![%s]\n",
+					switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+		}
+		switch_safe_free(path);
+	}
+}
+
+static switch_curl_slist_t *cdr_curl_headers(void)
+{
+	switch_curl_slist_t *headers = NULL;
+
+	if (globals.encode == ENCODING_TEXTXML) {
+		headers = switch_curl_slist_append(headers, "Content-Type: text/xml");
+	} else if (globals.encode == ENCODING_DEFAULT) {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
+	} else if (globals.encode) {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
+	} else {
+		headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-plaintext");
+	}
+
+	if (globals.disable100continue) {
+		headers = switch_curl_slist_append(headers, "Expect:");
+	}
+
+	return headers;
+}
+
+/* everything but the url and the body, so the delivery thread can keep one handle (and its connections) alive */
+static switch_CURL *cdr_curl_init(switch_curl_slist_t *headers)
+{
+	switch_CURL *curl_handle = switch_curl_easy_init();
+
+	if (!zstr(globals.cred)) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
+	}
+
+	switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
+	switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-xml/1.0");
+	switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
+
+	if (globals.ssl_cert_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
+	}
+
+	if (globals.ssl_key_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
+	}
+
+	if (globals.ssl_key_password) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
+	}
+
+	if (globals.ssl_version) {
+		if (!strcasecmp(globals.ssl_version, "SSLv3")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
+		} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
+		}
+	}
+
+	if (globals.ssl_cacert_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
+	}
+
+	if (globals.cookie_file) {
+		switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, globals.cookie_file);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, globals.cookie_file);
+	}
+
+	switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, globals.timeout);
+
+	/* these were used for testing, optionally they may be enabled if someone desires
+	   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
+	 */
+
+	return curl_handle;
+}
+
+/* sleep in small steps so a long backoff does not hold up the module shutdown */
+static void cdr_sleep(uint32_t seconds)
+{
+	switch_time_t until = switch_micro_time_now() + (switch_time_t) seconds * 1000000;
+
+	while (!globals.shutdown && switch_micro_time_now() < until) {
+		switch_yield(100000);
+	}
+}
+
+static uint32_t cdr_backoff(uint32_t delay)
+{
+	delay = delay ? delay * 2 : globals.delay;
+
+	return delay > globals.max_delay ? globals.max_delay : delay;
+}
+
+static switch_bool_t post_cdr(switch_CURL *curl_handle, const char *name, const char *xml_text, uint32_t tries)
+{
+	char *destUrl = NULL;
+	char *curl_xml_text = NULL;
+	char url_joiner = '?';
+	long httpRes = 0;
+	uint32_t cur_try, delay = 0;
+	int g_url_index = -1;
+	switch_bool_t ok = SWITCH_FALSE;
+
+	if (globals.encode == ENCODING_TEXTXML) {
+		curl_xml_text = (char *) xml_text;
+	} else if (!(curl_xml_text = switch_mprintf("cdr=%s", xml_text))) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Memory Error!\n");
+		return SWITCH_FALSE;
+	}
+
+	switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, curl_xml_text);
+
+	switch_mutex_lock(globals.url_index_mutex);
+	g_url_index = globals.url_index;
+	switch_mutex_unlock(globals.url_index_mutex);
+
+	for (cur_try = 0; cur_try < tries && !globals.shutdown; cur_try++) {
+		if (cur_try > 0) {
+			delay = cdr_backoff(delay);
+			cdr_sleep(delay);
+		}
+
+		url_joiner = strchr(globals.urls[g_url_index], '?') ? '&' : '?';
+		destUrl = switch_mprintf("%s%cuuid=%s", globals.urls[g_url_index], url_joiner, name);
+		switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
+
+		if (!strncasecmp(destUrl, "https", 5)) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
+		}
+
+		if (globals.enable_cacert_check) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
+		}
+
+		if (globals.enable_ssl_verifyhost) {
+			switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+		}
+
+		/* overrides default 300s timeout, could be usefull if the current web server is down to prevent long time waiting for nothing */
+		/* connection_timeout = retry_timeout  */
+		switch_curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, !globals.delay ? 5 : (long)globals.delay);
+		httpRes = 0;
+		switch_curl_easy_perform(curl_handle);
+		switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
+		switch_safe_free(destUrl);
+		if (httpRes >= 200 && httpRes <= 299) {
+			ok = SWITCH_TRUE;
+			break;
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
+							  httpRes, globals.urls[g_url_index]);
+			g_url_index++;
+			switch_assert(globals.url_count <= MAX_URLS);
+			if (g_url_index >= globals.url_count) {
+				g_url_index = 0;
+			}
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[g_url_index]);
+			switch_mutex_lock(globals.url_index_mutex);
+			if (globals.url_index != g_url_index) {
+				globals.url_index = g_url_index;
+			}
+			switch_mutex_unlock(globals.url_index_mutex);
+		}
+	}
+
+	if (curl_xml_text != xml_text) {
+		switch_safe_free(curl_xml_text);
+	}
+
+	return ok;
+}
+
+/* a failed post from the delivery thread puts the web server in backoff, cdrs are spooled to disk until it is retried */
+static switch_bool_t cdr_collector_down(void)
+{
+	return globals.replay_interval && globals.down_until > switch_micro_time_now() ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+static void cdr_collector_result(switch_bool_t ok)
+{
+	if (ok) {
+		if (globals.down_delay) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Web server is accepting CDRs again\n");
+		}
+		globals.down_delay = 0;
+		globals.down_until = 0;
+	} else if (globals.replay_interval) {
+		globals.down_delay = cdr_backoff(globals.down_delay);
+		globals.down_until = switch_micro_time_now() + (switch_time_t) globals.down_delay * 1000000;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Spooling CDRs to disk for %u seconds\n", globals.down_delay);
+	}
+}
+
+static void deliver_cdr(cdr_data_t *data, switch_CURL *curl_handle)
+{
+	switch_curl_slist_t *headers = NULL;
+	switch_CURL *tmp_handle = NULL;
+	switch_bool_t ok;
+
+	if (!curl_handle) {
+		headers = cdr_curl_headers();
+		curl_handle = tmp_handle = cdr_curl_init(headers);
+	}
+
+	if (!tmp_handle && cdr_collector_down()) {
+		backup_cdr(data);
+	} else {
+		if (!(ok = post_cdr(curl_handle, data->name, data->xml_text, globals.retries))) {
+			/* if we are here the web post failed for some reason */
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post to web server, writing to file\n");
+			backup_cdr(data);
+		}
+
+		if (!tmp_handle) {
+			cdr_collector_result(ok);
+		}
+	}
+
+	if (tmp_handle) {
+		switch_curl_easy_cleanup(tmp_handle);
+		switch_curl_slist_free_all(headers);
+	}
+}
+
+static switch_bool_t replay_cdr(const char *name, char *text, switch_size_t len, void *pdata)
+{
+	if (globals.shutdown) {
+		return SWITCH_FALSE;
+	}
+
+	return post_cdr((switch_CURL *) pdata, name, text, 1);
+}
+
+/* send the CDRs left behind by failed posts in the spool dir, a few at a time, and stop at the first failure */
+static void replay_backups(switch_CURL *curl_handle)
+{
+	switch_bool_t failed = SWITCH_FALSE;
+	uint32_t sent;
+
+	if (!globals.spool_dir) {
+		return;
+	}
+
+	sent = switch_spool_replay(globals.spool_dir, ".cdr.xml", REPLAY_BATCH, 5, replay_cdr, curl_handle, &failed);
+
+	if (sent) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Replayed %u backed up CDRs\n", sent);
+	}
+
+	if ((sent || failed) && !globals.shutdown) {
+		cdr_collector_result(!failed);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC cdr_thread(switch_thread_t *t, void *obj)
+{
+	switch_curl_slist_t *headers = cdr_curl_headers();
+	switch_CURL *curl_handle = cdr_curl_init(headers);
+	switch_time_t next_replay = 0;
+	void *pop = NULL;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread started.\n");
+
+	while (!globals.shutdown) {
+		cdr_data_t *data;
+
+		if (switch_queue_pop_timeout(globals.queue, &pop, 1000000) != SWITCH_STATUS_SUCCESS) {
+			if (globals.replay_interval && !cdr_collector_down() && switch_micro_time_now() >= next_replay) {
+				replay_backups(curl_handle);
+				next_replay = switch_micro_time_now() + (switch_time_t) globals.replay_interval * 1000000;
+			}
+			continue;
+		}
+
+		if (!(data = (cdr_data_t *) pop)) {
+			break;
+		}
+
+		deliver_cdr(data, curl_handle);
+		destroy_cdr_data(data);
+	}
+
+	while (switch_queue_trypop(globals.queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		if (pop) {
+			backup_cdr((cdr_data_t *) pop);
+			destroy_cdr_data((cdr_data_t *) pop);
+		}
+	}
+
+	switch_curl_easy_cleanup(curl_handle);
+	switch_curl_slist_free_all(headers);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Cdr thread ended.\n");
+	switch_thread_exit(t, SWITCH_STATUS_SUCCESS);
+
+	return NULL;
+}
+
 static switch_status_t my_on_reporting(switch_core_session_t *session)
 {
 	switch_xml_t cdr = NULL;
 	char *xml_text = NULL;
 	char *path = NULL;
-	char *curl_xml_text = NULL;
 	const char *logdir = NULL;
 	char *xml_text_escaped = NULL;
 	int fd = -1;
-	uint32_t cur_try;
-	long httpRes;
-	switch_CURL *curl_handle = NULL;
-	switch_curl_slist_t *headers = NULL;
-	switch_curl_slist_t *slist = NULL;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int is_b;
 	const char *a_prefix = "";
-	char url_joiner = '?';
 	int prefix_a;
 	const char *prefix_a_var = NULL;
 
@@ -270,191 +611,43 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 
 	/* try to post it to the web server */
 	if (globals.url_count) {
-		char *destUrl = NULL;
-		int g_url_index = -1;
-
-		switch_mutex_lock(globals.url_index_mutex);
-		g_url_index = globals.url_index;
-		switch_mutex_unlock(globals.url_index_mutex);
+		cdr_data_t *data;
 
-		curl_handle = switch_curl_easy_init();
-
-		if (globals.encode == ENCODING_TEXTXML) {
-			headers = switch_curl_slist_append(headers, "Content-Type: text/xml");
-		} else if (globals.encode) {
+		if (globals.encode && globals.encode != ENCODING_TEXTXML) {
 			switch_size_t need_bytes = strlen(xml_text) * 3 + 1;
 
 			xml_text_escaped = malloc(need_bytes);
 			switch_assert(xml_text_escaped);
 			memset(xml_text_escaped, 0, need_bytes);
 			if (globals.encode == ENCODING_DEFAULT) {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
 				switch_url_encode_opt(xml_text, xml_text_escaped, need_bytes, SWITCH_TRUE);
 			} else {
-				headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-base64-encoded");
 				switch_b64_encode((unsigned char *) xml_text, need_bytes / 3, (unsigned char *) xml_text_escaped, need_bytes);
 			}
 			switch_safe_free(xml_text);
 			xml_text = xml_text_escaped;
-		} else {
-			headers = switch_curl_slist_append(headers, "Content-Type: application/x-www-form-plaintext");
-		}
-
-		if (globals.encode == ENCODING_TEXTXML) {
-			curl_xml_text = xml_text;
-		} else if (!(curl_xml_text = switch_mprintf("cdr=%s", xml_text))) {
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Memory Error!\n");
-			goto error;
-		}
-
-		if (!zstr(globals.cred)) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, globals.auth_scheme);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_USERPWD, globals.cred);
-		}
-
-		switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, curl_xml_text);
-		switch_curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-xml/1.0");
-		switch_curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, httpCallBack);
-
-		if (globals.disable100continue) {
-			slist = switch_curl_slist_append(slist, "Expect:");
-			switch_curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
-		}
-
-		if (globals.ssl_cert_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, globals.ssl_cert_file);
 		}
 
-		if (globals.ssl_key_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, globals.ssl_key_file);
-		}
-
-		if (globals.ssl_key_password) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, globals.ssl_key_password);
-		}
+		switch_zmalloc(data, sizeof(*data));
+		data->xml_text = xml_text;
+		data->name = switch_mprintf("%s%s", a_prefix, switch_core_session_get_uuid(session));
+		xml_text = NULL;
 
-		if (globals.ssl_version) {
-			if (!strcasecmp(globals.ssl_version, "SSLv3")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
-			} else if (!strcasecmp(globals.ssl_version, "TLSv1")) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
-			}
-		}
-
-		if (globals.ssl_cacert_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CAINFO, globals.ssl_cacert_file);
-		}
-
-		if (globals.cookie_file) {
-			switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, globals.cookie_file);
-			switch_curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, globals.cookie_file);
-		}
-
-		switch_curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, globals.timeout);
-
-		/* these were used for testing, optionally they may be enabled if someone desires
-		   switch_curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1); // 302 recursion level
-		 */
-
-		for (cur_try = 0; cur_try < globals.retries; cur_try++) {
-			if (cur_try > 0) {
-				switch_yield(globals.delay * 1000000);
-			}
-
-			if( strchr(globals.urls[g_url_index], '?') != NULL ) {
-				url_joiner = '&';
-			}
-			destUrl = switch_mprintf("%s%cuuid=%s%s", globals.urls[g_url_index], url_joiner, a_prefix, switch_core_session_get_uuid(session));
-			switch_curl_easy_setopt(curl_handle, CURLOPT_URL, destUrl);
-
-			if (!strncasecmp(destUrl, "https", 5)) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0);
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0);
-			}
-
-			if (globals.enable_cacert_check) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
-			}
-
-			if (globals.enable_ssl_verifyhost) {
-				switch_curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
-			}
-
-			/* overrides default 300s timeout, could be usefull if the current web server is down to prevent long time waiting for nothing */
-			/* connection_timeout = retry_timeout  */
-			switch_curl_easy_setopt(curl_handle, CURLOPT_CONNECTTIMEOUT, !globals.delay ? 5 : (long)globals.delay);
-			switch_curl_easy_perform(curl_handle);
-			switch_curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-			switch_safe_free(destUrl);
-			if (httpRes >= 200 && httpRes <= 299) {
-				goto success;
-			} else {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Got error [%ld] posting to web server [%s]\n",
-								  httpRes, globals.urls[g_url_index]);
-				g_url_index++;
-				switch_assert(globals.url_count <= MAX_URLS);
-				if (g_url_index >= globals.url_count) {
-					g_url_index = 0;
-				}
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Retry will be with url [%s]\n", globals.urls[g_url_index]);
-				switch_mutex_lock(globals.url_index_mutex);
-				if (globals.url_index != g_url_index) {
-					globals.url_index = g_url_index;
-				}
-				switch_mutex_unlock(globals.url_index_mutex);
-			}
-		}
-		switch_curl_easy_cleanup(curl_handle);
-		switch_curl_slist_free_all(headers);
-		switch_curl_slist_free_all(slist);
-		slist = NULL;
-		headers = NULL;
-		curl_handle = NULL;
-
-		/* if we are here the web post failed for some reason */
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to post to web server, writing to file\n");
-
-		switch_thread_rwlock_rdlock(globals.log_path_lock);
-		path = switch_mprintf("%s%s%s%s.cdr.xml", globals.err_log_dir, SWITCH_PATH_SEPARATOR, a_prefix, switch_core_session_get_uuid(session));
-		switch_thread_rwlock_unlock(globals.log_path_lock);
-		if (path) {
-#ifdef _MSC_VER
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
-#else
-			if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) > -1) {
-#endif
-				int wrote;
-				wrote = write(fd, xml_text, (unsigned) strlen(xml_text));
-				wrote++;
-				close(fd);
-				fd = -1;
-			} else {
-				char ebuf[512] = { 0 };
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error![%s]\n",
-						switch_strerror_r(errno, ebuf, sizeof(ebuf)));
+		if (globals.queue) {
+			if (switch_queue_trypush(globals.queue, data) != SWITCH_STATUS_SUCCESS) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Unable to push cdr to queue\n");
+				backup_cdr(data);
+				destroy_cdr_data(data);
 			}
+		} else {
+			deliver_cdr(data, NULL);
+			destroy_cdr_data(data);
 		}
 	}
 
-  success:
 	status = SWITCH_STATUS_SUCCESS;
 
   error:
-	if (curl_handle) {
-		switch_curl_easy_cleanup(curl_handle);
-	}
-	if (headers) {
-		switch_curl_slist_free_all(headers);
-	}
-	if (slist) {
-		switch_curl_slist_free_all(slist);
-	}
-	if (curl_xml_text != xml_text) {
-		switch_safe_free(curl_xml_text);
-	}
 	switch_safe_free(xml_text);
 	switch_safe_free(path);
 	switch_xml_free(cdr);
@@ -511,6 +704,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 	globals.disable100continue = 0;
 	globals.pool = pool;
 	globals.auth_scheme = CURLAUTH_BASIC;
+	globals.queue_capacity = -1;
+	globals.max_delay = 60;
 
 	switch_thread_rwlock_create(&globals.log_path_lock, pool);
 	switch_mutex_init(&globals.url_index_mutex, SWITCH_MUTEX_NESTED, globals.pool);
@@ -620,6 +815,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 				}
 			} else if (!strcasecmp(var, "cookie-file")) {
 				globals.cookie_file = switch_core_strdup(globals.pool, val);
+			} else if (!strcasecmp(var, "queue-capacity") && !zstr(val)) {
+				int capacity = atoi(val);
+				if (capacity >= 0) {
+					globals.queue_capacity = capacity;
+				}
+			} else if (!strcasecmp(var, "max-delay") && !zstr(val)) {
+				globals.max_delay = switch_atoui(val);
+			} else if (!strcasecmp(var, "retry-backup-interval") && !zstr(val)) {
+				globals.replay_interval = switch_atoui(val);
 			}
 		}
 
@@ -640,8 +844,32 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 
 	globals.retries++;
 
+	if (globals.max_delay < globals.delay) {
+		globals.max_delay = globals.delay;
+	}
+
 	set_xml_cdr_log_dirs();
 
+	if (globals.replay_interval && globals.url_count) {
+		globals.spool_dir = switch_core_sprintf(globals.pool, "%s%sspool", globals.base_err_log_dir, SWITCH_PATH_SEPARATOR);
+		switch_dir_make_recursive(globals.spool_dir, SWITCH_DEFAULT_DIR_PERMS, globals.pool);
+	}
+
+	/* unless told otherwise, post from a delivery thread so hung up sessions never wait on the web server */
+	if (globals.queue_capacity < 0) {
+		globals.queue_capacity = 1000;
+	}
+
+	if (globals.url_count && globals.queue_capacity > 0) {
+		switch_threadattr_t *thd_attr;
+
+		switch_queue_create(&globals.queue, globals.queue_capacity, globals.pool);
+
+		switch_threadattr_create(&thd_attr, globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&globals.thread, thd_attr, cdr_thread, NULL, globals.pool);
+	}
+
 	switch_xml_free(xml);
 
 	return status;
@@ -649,9 +877,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_cdr_load)
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_cdr_shutdown)
 {
+	switch_status_t status;
 
 	globals.shutdown = 1;
 
+	if (globals.queue) {
+		switch_queue_push(globals.queue, NULL);
+		switch_thread_join(&status, globals.thread);
+	}
+
 	switch_safe_free(globals.log_dir);
 	switch_safe_free(globals.err_log_dir);
 
@@ -1351,6 +1351,11 @@ SWITCH_DECLARE(int) switch_atomic_dec(volatile switch_atomic_t *mem)
 #endif
 }
 
+SWITCH_DECLARE(void *) switch_atomic_casptr(volatile void **mem, void *with, const void *cmp)
+{
+	return apr_atomic_casptr(mem, with, cmp);
+}
+
 SWITCH_DECLARE(char *) switch_strerror(switch_status_t statcode, char *buf, switch_size_t bufsize)
 {
 	return apr_strerror(statcode, buf, bufsize);
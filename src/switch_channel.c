@@ -181,6 +181,7 @@ struct switch_channel {
 	switch_event_t *var_list;
 	switch_hold_record_t *hold_record;
 	switch_device_node_t *device_node;
+	switch_state_notify_t *state_notify;
 	char *device_id;
 	switch_event_t *log_tags;
 };
@@ -274,6 +275,27 @@ static struct switch_device_state_table DEVICE_STATE_CHART[] = {
 };
 
 
+static void channel_state_notify(switch_channel_t *channel)
+{
+	switch_state_notify_t *notify;
+
+	switch_mutex_lock(channel->state_mutex);
+	if ((notify = channel->state_notify)) {
+		switch_mutex_lock(notify->mutex);
+		notify->seq++;
+		switch_thread_cond_broadcast(notify->cond);
+		switch_mutex_unlock(notify->mutex);
+	}
+	switch_mutex_unlock(channel->state_mutex);
+}
+
+SWITCH_DECLARE(void) switch_channel_set_state_notify(switch_channel_t *channel, switch_state_notify_t *notify)
+{
+	switch_mutex_lock(channel->state_mutex);
+	channel->state_notify = notify;
+	switch_mutex_unlock(channel->state_mutex);
+}
+
 SWITCH_DECLARE(void) switch_channel_perform_set_callstate(switch_channel_t *channel, switch_channel_callstate_t callstate,
 														  const char *file, const char *func, int line)
 {
@@ -291,6 +313,7 @@ SWITCH_DECLARE(void) switch_channel_perform_set_callstate(switch_channel_t *chan
 					  switch_channel_callstate2str(o_callstate), switch_channel_callstate2str(callstate));
 
 	switch_channel_check_device_state(channel, channel->callstate);
+	channel_state_notify(channel);
 
 	if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_CALLSTATE) == SWITCH_STATUS_SUCCESS) {
 		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Original-Channel-Call-State", switch_channel_callstate2str(o_callstate));
@@ -2322,6 +2345,7 @@ SWITCH_DECLARE(switch_channel_state_t) switch_channel_perform_set_running_state(
 	switch_mutex_lock(channel->state_mutex);
 
 	careful_set(channel, &channel->running_state, state);
+	channel_state_notify(channel);
 
 	if (state <= CS_DESTROY) {
 		switch_event_t *event;
@@ -3283,11 +3307,26 @@ SWITCH_DECLARE(switch_caller_extension_t *) switch_channel_get_caller_extension(
 
 SWITCH_DECLARE(void) switch_channel_set_bridge_time(switch_channel_t *channel)
 {
+	switch_time_t latency = 0;
+
 	switch_mutex_lock(channel->profile_mutex);
 	if (channel->caller_profile && channel->caller_profile->times) {
-		channel->caller_profile->times->bridged = switch_micro_time_now();
+		switch_channel_timetable_t *times = channel->caller_profile->times;
+
+		times->bridged = switch_micro_time_now();
+
+		/* on an outbound leg answered is the far end's answer, so this is the time from its answer to the bridge */
+		if (channel->direction == SWITCH_CALL_DIRECTION_OUTBOUND && times->answered && times->bridged >= times->answered) {
+			latency = times->bridged - times->answered;
+		}
 	}
 	switch_mutex_unlock(channel->profile_mutex);
+
+	if (latency && !switch_channel_get_variable(channel, "originate_answer_latency_usec")) {
+		switch_channel_set_variable_printf(channel, "originate_answer_latency_usec", "%" SWITCH_TIME_T_FMT, latency);
+		switch_log_printf(SWITCH_CHANNEL_CHANNEL_LOG(channel), SWITCH_LOG_DEBUG, "%s bridged %" SWITCH_TIME_T_FMT "us after answer\n",
+						  switch_channel_get_name(channel), latency);
+	}
 }
 
 
@@ -3348,6 +3387,8 @@ SWITCH_DECLARE(switch_channel_state_t) switch_channel_perform_hangup(switch_chan
 		switch_log_printf(SWITCH_CHANNEL_ID_LOG, file, func, line, switch_channel_get_uuid(channel), SWITCH_LOG_NOTICE, "Hangup %s [%s] [%s]\n",
 						  channel->name, state_names[last_state], switch_channel_cause2str(channel->hangup_cause));
 
+		channel_state_notify(channel);
+
 
 		switch_channel_set_variable_partner(channel, "last_bridge_hangup_cause", switch_channel_cause2str(hangup_cause));
 
@@ -1353,7 +1353,60 @@ typedef struct {
 	switch_hash_t *hash;
 } switch_ip_list_t;
 
-static switch_ip_list_t IP_LIST = { 0 };
+/*
+ * Lookups never lock: a reload publishes the rebuilt lists with a pointer swap and
+ * frees the old ones once every reader that could have seen them is gone.
+ * Readers count themselves in the slot of the current epoch; a reload swaps the
+ * pointer, flips the epoch and drains the previous slot before freeing.
+ */
+static switch_ip_list_t *volatile IP_LIST = NULL;
+static volatile switch_atomic_t IP_LIST_EPOCH = 0;
+static volatile switch_atomic_t IP_LIST_READERS[2] = { 0 };
+
+static uint32_t ip_list_enter(switch_ip_list_t **lists)
+{
+	uint32_t epoch;
+
+	for (;;) {
+		epoch = switch_atomic_read(&IP_LIST_EPOCH) & 1;
+		switch_atomic_inc(&IP_LIST_READERS[epoch]);
+
+		/* a reload flipped the epoch before we were counted, it may not wait for this slot */
+		if ((switch_atomic_read(&IP_LIST_EPOCH) & 1) == epoch) {
+			break;
+		}
+
+		switch_atomic_dec(&IP_LIST_READERS[epoch]);
+	}
+
+	*lists = IP_LIST;
+	return epoch;
+}
+
+static void ip_list_leave(uint32_t epoch)
+{
+	switch_atomic_dec(&IP_LIST_READERS[epoch]);
+}
+
+static void ip_list_free(switch_ip_list_t **lists)
+{
+	switch_ip_list_t *old = *lists;
+	switch_memory_pool_t *pool;
+
+	if (!old) {
+		return;
+	}
+
+	*lists = NULL;
+
+	if (old->hash) {
+		switch_core_hash_destroy(&old->hash);
+	}
+
+	/* the list struct lives in its own pool */
+	pool = old->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
 
 SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_port_token(const char *ip_str, int port, const char *list_name, const char **token)
 {
@@ -1363,6 +1416,8 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_port_token(const char
 	char *ipv6 = strchr(ip_str,':');
 	switch_bool_t ok = SWITCH_FALSE;
 	char *ipv4 = NULL;
+	switch_ip_list_t *lists = NULL;
+	uint32_t epoch;
 
 	if (!list_name) {
 		return SWITCH_FALSE;
@@ -1373,7 +1428,7 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_port_token(const char
 		ipv6 = NULL;
 	}
 
-	switch_mutex_lock(runtime.global_mutex);
+	epoch = ip_list_enter(&lists);
 	if (ipv6) {
 		switch_inet_pton(AF_INET6, ip_str, &ip);
 	} else {
@@ -1381,7 +1436,7 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_port_token(const char
 		ip.v4 = htonl(ip.v4);
 	}
 
-	if ((list = switch_core_hash_find(IP_LIST.hash, list_name))) {
+	if (lists && (list = switch_core_hash_find(lists->hash, list_name))) {
 		if (ipv6) {
 			ok = switch_network_list_validate_ip6_port_token(list, ip, port, token);
 		} else {
@@ -1423,7 +1478,7 @@ SWITCH_DECLARE(switch_bool_t) switch_check_network_list_ip_port_token(const char
 	}
 
 	switch_safe_free(ipv4);
-	switch_mutex_unlock(runtime.global_mutex);
+	ip_list_leave(epoch);
 
 	return ok;
 }
@@ -1442,6 +1497,9 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 	char guess_mask[16] = "";
 	char *tmp_name;
 	struct in_addr in;
+	switch_ip_list_t *new_lists = NULL, *old_lists = NULL;
+	switch_memory_pool_t *new_pool = NULL;
+	uint32_t old_epoch;
 
 	switch_find_local_ip(guess_ip, sizeof(guess_ip), &mask, AF_INET);
 	in.s_addr = mask;
@@ -1449,36 +1507,30 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 
 	switch_mutex_lock(runtime.global_mutex);
 
-	if (IP_LIST.hash) {
-		switch_core_hash_destroy(&IP_LIST.hash);
-	}
-
-	if (IP_LIST.pool) {
-		switch_core_destroy_memory_pool(&IP_LIST.pool);
-	}
-
-	memset(&IP_LIST, 0, sizeof(IP_LIST));
-	switch_core_new_memory_pool(&IP_LIST.pool);
-	switch_core_hash_init(&IP_LIST.hash);
+	/* build the new lists on the side so lookups keep running against the old ones */
+	switch_core_new_memory_pool(&new_pool);
+	new_lists = switch_core_alloc(new_pool, sizeof(*new_lists));
+	new_lists->pool = new_pool;
+	switch_core_hash_init(&new_lists->hash);
 
 
 	tmp_name = "rfc6598.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (deny)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "100.64.0.0/10", SWITCH_TRUE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 	tmp_name = "rfc1918.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (deny)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "10.0.0.0/8", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "172.16.0.0/12", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "192.168.0.0/16", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "fe80::/10", SWITCH_TRUE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 	tmp_name = "wan.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (allow)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "0.0.0.0/8", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "10.0.0.0/8", SWITCH_FALSE);
@@ -1486,18 +1538,18 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 	switch_network_list_add_cidr(rfc_list, "192.168.0.0/16", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "169.254.0.0/16", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "fe80::/10", SWITCH_FALSE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 	tmp_name = "wan_v6.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (allow)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "0.0.0.0/0", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "fe80::/10", SWITCH_FALSE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 
 	tmp_name = "wan_v4.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (allow)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "0.0.0.0/8", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "10.0.0.0/8", SWITCH_FALSE);
@@ -1505,25 +1557,25 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 	switch_network_list_add_cidr(rfc_list, "192.168.0.0/16", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "169.254.0.0/16", SWITCH_FALSE);
 	switch_network_list_add_cidr(rfc_list, "::/0", SWITCH_FALSE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 
 	tmp_name = "any_v6.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (allow)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "0.0.0.0/0", SWITCH_FALSE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 
 	tmp_name = "any_v4.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_TRUE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (allow)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "::/0", SWITCH_FALSE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 
 	tmp_name = "nat.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (deny)\n", tmp_name);
 	if (switch_network_list_add_host_mask(rfc_list, guess_ip, guess_mask, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Adding %s/%s (deny) to list %s\n", guess_ip, guess_mask, tmp_name);
@@ -1532,23 +1584,23 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 	switch_network_list_add_cidr(rfc_list, "172.16.0.0/12", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "192.168.0.0/16", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "100.64.0.0/10", SWITCH_TRUE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 	tmp_name = "loopback.auto";
-	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, IP_LIST.pool);
+	switch_network_list_create(&rfc_list, tmp_name, SWITCH_FALSE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (deny)\n", tmp_name);
 	switch_network_list_add_cidr(rfc_list, "127.0.0.0/8", SWITCH_TRUE);
 	switch_network_list_add_cidr(rfc_list, "::1/128", SWITCH_TRUE);
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, rfc_list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, rfc_list);
 
 	tmp_name = "localnet.auto";
-	switch_network_list_create(&list, tmp_name, SWITCH_FALSE, IP_LIST.pool);
+	switch_network_list_create(&list, tmp_name, SWITCH_FALSE, new_lists->pool);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Created ip list %s default (deny)\n", tmp_name);
 
 	if (switch_network_list_add_host_mask(list, guess_ip, guess_mask, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Adding %s/%s (allow) to list %s\n", guess_ip, guess_mask, tmp_name);
 	}
-	switch_core_hash_insert(IP_LIST.hash, tmp_name, list);
+	switch_core_hash_insert(new_lists->hash, tmp_name, list);
 
 
 	if ((xml = switch_xml_open_cfg("acl.conf", &cfg, NULL))) {
@@ -1566,7 +1618,7 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 					default_type = switch_true(dft);
 				}
 
-				if (switch_network_list_create(&list, name, default_type, IP_LIST.pool) != SWITCH_STATUS_SUCCESS) {
+				if (switch_network_list_create(&list, name, default_type, new_lists->pool) != SWITCH_STATUS_SUCCESS) {
 					abort();
 				}
 
@@ -1673,13 +1725,26 @@ SWITCH_DECLARE(void) switch_load_network_lists(switch_bool_t reload)
 					}
 				}
 
-				switch_core_hash_insert(IP_LIST.hash, name, list);
+				switch_core_hash_insert(new_lists->hash, name, list);
 			}
 		}
 
 		switch_xml_free(xml);
 	}
 
+	/* reloads are serialized by the global mutex, only lookups run alongside */
+	old_epoch = switch_atomic_read(&IP_LIST_EPOCH) & 1;
+	old_lists = IP_LIST;
+	switch_atomic_casptr((volatile void **) &IP_LIST, new_lists, old_lists);
+	switch_atomic_inc(&IP_LIST_EPOCH);
+
+	/* readers still counted in the previous epoch may hold the old lists */
+	while (switch_atomic_read(&IP_LIST_READERS[old_epoch]) > 0) {
+		switch_cond_next();
+	}
+
+	ip_list_free(&old_lists);
+
 	switch_mutex_unlock(runtime.global_mutex);
 }
 
@@ -1922,6 +1987,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_thread_rwlock_create(&runtime.global_var_rwlock, runtime.memory_pool);
 	switch_core_set_globals();
 	switch_core_session_init(runtime.memory_pool);
+	switch_core_prompt_cache_init(runtime.memory_pool);
 	switch_event_create_plain(&runtime.global_vars, SWITCH_EVENT_CHANNEL_DATA);
 	switch_core_hash_init_case(&runtime.mime_types, SWITCH_FALSE);
 	switch_core_hash_init_case(&runtime.mime_type_exts, SWITCH_FALSE);
@@ -2204,6 +2270,42 @@ static void switch_load_core_config(const char *file)
 					runtime.core_db_inner_pre_trans_execute = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-inner-post-trans-execute") && !zstr(val)) {
 					runtime.core_db_inner_post_trans_execute = switch_core_strdup(runtime.memory_pool, val);
+				} else if (!strcasecmp(var, "core-db-writers")) {
+					long tmp = atol(val);
+
+					if (tmp > 0 && tmp < 33) {
+						runtime.core_db_writers = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "core-db-writers must be between 1 and 32\n");
+					}
+				} else if (!strcasecmp(var, "memory-accounting")) {
+					runtime.memory_accounting = switch_true(val);
+				} else if (!strcasecmp(var, "recovery-threads")) {
+					long tmp = atol(val);
+
+					if (tmp > 0 && tmp < 65) {
+						runtime.recovery_threads = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "recovery-threads must be between 1 and 64\n");
+					}
+				} else if (!strcasecmp(var, "core-db-queue-len")) {
+					long tmp = atol(val);
+
+					if (tmp > 999) {
+						runtime.core_db_queue_len = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "core-db-queue-len must be at least 1000\n");
+					}
+				} else if (!strcasecmp(var, "core-db-queue-policy") && !zstr(val)) {
+					runtime.core_db_queue_drop = !strcasecmp(val, "drop");
+				} else if (!strcasecmp(var, "prompt-cache-size") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						switch_core_prompt_cache_set_size((switch_size_t) tmp * 1024 * 1024);
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "prompt-cache-size must be a number of megabytes\n");
+					}
 				} else if (!strcasecmp(var, "dialplan-timestamps")) {
 					if (switch_true(val)) {
 						switch_set_flag((&runtime), SCF_DIALPLAN_TIMESTAMPS);
@@ -2321,6 +2423,9 @@ static void switch_load_core_config(const char *file)
 					switch_rtp_set_end_port((switch_port_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-port-usage-robustness") && switch_true(val)) {
 					runtime.port_alloc_flags |= SPF_ROBUST_UDP;
+				} else if (!strcasecmp(var, "rtp-dtls-workers") && !zstr(val)) {
+					int workers = atoi(val);
+					switch_rtp_set_dtls_workers(workers > 0 ? (uint32_t) workers : 0);
 				} else if (!strcasecmp(var, "core-db-name") && !zstr(val)) {
 					runtime.dbname = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-dsn") && !zstr(val)) {
@@ -2934,6 +3039,14 @@ SWITCH_DECLARE(int32_t) switch_core_session_ctl(switch_session_ctl_t cmd, void *
 	case SCSC_SESSIONS_PEAK_FIVEMIN:
 		newintval = runtime.sessions_peak_fivemin;
 		break;
+	case SCSC_MEMORY_ACCOUNTING:
+		if (intval) {
+			if (oldintval > -1) {
+				runtime.memory_accounting = oldintval ? 1 : 0;
+			}
+			newintval = runtime.memory_accounting;
+		}
+		break;
 	case SCSC_MAX_DTMF_DURATION:
 		newintval = switch_core_max_dtmf_duration(oldintval);
 		break;
@@ -3038,6 +3151,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Finalizing Shutdown.\n");
 	switch_log_shutdown();
 
+	switch_core_prompt_cache_uninit();
 	switch_core_session_uninit();
 	switch_core_unset_variables();
 	switch_core_memory_stop();
@@ -3075,13 +3189,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_core_hash_destroy(&runtime.mime_types);
 	switch_core_hash_destroy(&runtime.mime_type_exts);
 
-	if (IP_LIST.hash) {
-		switch_core_hash_destroy(&IP_LIST.hash);
-	}
-
-	if (IP_LIST.pool) {
-		switch_core_destroy_memory_pool(&IP_LIST.pool);
-	}
+	ip_list_free((switch_ip_list_t **) &IP_LIST);
 
 	switch_core_media_deinit();
 
@@ -36,6 +36,28 @@ static switch_mutex_t **ssl_mutexes;
 static switch_memory_pool_t *ssl_pool = NULL;
 static int ssl_count = 0;
 
+#define DTLS_CTX_SESSION_ID "FreeSWITCH-DTLS-SRTP"
+
+typedef struct dtls_fp_cache_s {
+	char *key;
+	time_t mtime;
+	uint32_t len;
+	uint8_t data[MAX_FPLEN+1];
+	char str[MAX_FPSTRLEN];
+	struct dtls_fp_cache_s *next;
+} dtls_fp_cache_t;
+
+/* certificate material shared by every DTLS session instead of being loaded per call */
+static struct {
+	switch_mutex_t *mutex;
+	dtls_fp_cache_t *fps;
+	char *prefix;
+	time_t mtime;
+	SSL_CTX *ctx[4];
+} dtls_cache;
+
+static void dtls_cache_clear(void);
+
 static inline void switch_ssl_ssl_lock_callback(int mode, int type, char *file, int line)
 {
 	if (mode & CRYPTO_LOCK) {
@@ -71,6 +93,8 @@ SWITCH_DECLARE(void) switch_ssl_init_ssl_locks(void)
 
 		CRYPTO_set_id_callback(switch_ssl_ssl_thread_id);
 		CRYPTO_set_locking_callback((void (*)(int, int, const char*, int))switch_ssl_ssl_lock_callback);
+
+		switch_mutex_init(&dtls_cache.mutex, SWITCH_MUTEX_NESTED, ssl_pool);
 	}
 
 	ssl_count++;
@@ -81,6 +105,9 @@ SWITCH_DECLARE(void) switch_ssl_destroy_ssl_locks(void)
 	int i;
 
 	if (ssl_count == 1) {
+		dtls_cache_clear();
+		dtls_cache.mutex = NULL;
+
 		CRYPTO_set_locking_callback(NULL);
 		for (i = 0; i < CRYPTO_num_locks(); i++) {
 			if (ssl_mutexes[i]) {
@@ -190,12 +217,41 @@ SWITCH_DECLARE(int) switch_core_cert_extract_fingerprint(X509* x509, dtls_finger
 
 }
 
+static switch_status_t cert_mtime(const char *path, time_t *mtime)
+{
+	struct stat st;
+
+	if (stat(path, &st)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*mtime = st.st_mtime;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* must be called with dtls_cache.mutex held */
+static dtls_fp_cache_t *dtls_fp_cache_find(const char *key)
+{
+	dtls_fp_cache_t *fpc;
+
+	for (fpc = dtls_cache.fps; fpc; fpc = fpc->next) {
+		if (!strcmp(fpc->key, key)) {
+			return fpc;
+		}
+	}
+
+	return NULL;
+}
+
 SWITCH_DECLARE(int) switch_core_cert_gen_fingerprint(const char *prefix, dtls_fingerprint_t *fp)
 {
 	X509* x509 = NULL;
 	BIO* bio = NULL;
 	int ret = 0;
-	char *rsa;
+	char *rsa, *key = NULL;
+	time_t mtime = 0;
+	dtls_fp_cache_t *fpc;
 
 	rsa = switch_mprintf("%s%s%s.pem", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
 
@@ -204,6 +260,24 @@ SWITCH_DECLARE(int) switch_core_cert_gen_fingerprint(const char *prefix, dtls_fi
 		rsa = switch_mprintf("%s%s%s.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
 	}
 
+	/* every call leg asks for the same fingerprint, only read the cert again when it changes */
+	if (dtls_cache.mutex && fp->type && cert_mtime(rsa, &mtime) == SWITCH_STATUS_SUCCESS) {
+		key = switch_mprintf("%s|%s", rsa, fp->type);
+
+		switch_mutex_lock(dtls_cache.mutex);
+		if ((fpc = dtls_fp_cache_find(key)) && fpc->mtime == mtime) {
+			fp->len = fpc->len;
+			memcpy(fp->data, fpc->data, sizeof(fp->data));
+			switch_copy_string(fp->str, fpc->str, sizeof(fp->str));
+			ret = 1;
+		}
+		switch_mutex_unlock(dtls_cache.mutex);
+
+		if (ret) {
+			goto end;
+		}
+	}
+
 	if (!(bio = BIO_new(BIO_s_file()))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "FP BIO ERR!\n");
 		goto end;
@@ -219,7 +293,20 @@ SWITCH_DECLARE(int) switch_core_cert_gen_fingerprint(const char *prefix, dtls_fi
 		goto end;
 	}
 
-	switch_core_cert_extract_fingerprint(x509, fp);
+	if (switch_core_cert_extract_fingerprint(x509, fp) == 0 && key) {
+		switch_mutex_lock(dtls_cache.mutex);
+		if (!(fpc = dtls_fp_cache_find(key))) {
+			switch_zmalloc(fpc, sizeof(*fpc));
+			fpc->key = strdup(key);
+			fpc->next = dtls_cache.fps;
+			dtls_cache.fps = fpc;
+		}
+		fpc->mtime = mtime;
+		fpc->len = fp->len;
+		memcpy(fpc->data, fp->data, sizeof(fpc->data));
+		switch_copy_string(fpc->str, fp->str, sizeof(fpc->str));
+		switch_mutex_unlock(dtls_cache.mutex);
+	}
 
 	ret = 1;
 
@@ -233,11 +320,189 @@ SWITCH_DECLARE(int) switch_core_cert_gen_fingerprint(const char *prefix, dtls_fi
 		X509_free(x509);
 	}
 
+	switch_safe_free(key);
 	free(rsa);
 
 	return ret;
 }
 
+/* must be called with dtls_cache.mutex held, or at shutdown */
+static void dtls_cache_clear_ctx(void)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		if (dtls_cache.ctx[i]) {
+			/* sessions still using a context hold their own reference */
+			SSL_CTX_free(dtls_cache.ctx[i]);
+			dtls_cache.ctx[i] = NULL;
+		}
+	}
+
+	switch_safe_free(dtls_cache.prefix);
+	dtls_cache.mtime = 0;
+}
+
+static void dtls_cache_clear(void)
+{
+	dtls_fp_cache_t *fpc;
+
+	dtls_cache_clear_ctx();
+
+	while ((fpc = dtls_cache.fps)) {
+		dtls_cache.fps = fpc->next;
+		free(fpc->key);
+		free(fpc);
+	}
+}
+
+static SSL_CTX *dtls_ctx_new(const char *prefix, int server, int want_DTLSv1_2)
+{
+	SSL_CTX *ctx;
+	char *pem, *rsa, *pvt, *ca;
+	BIO *bio;
+	DH *dh;
+	int ret;
+#ifndef OPENSSL_NO_EC
+	EC_KEY *ecdh;
+#endif
+
+	pem = switch_mprintf("%s%s%s.pem", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
+
+	if (switch_file_exists(pem, NULL) == SWITCH_STATUS_SUCCESS) {
+		pvt = strdup(pem);
+		rsa = strdup(pem);
+	} else {
+		pvt = switch_mprintf("%s%s%s.key", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
+		rsa = switch_mprintf("%s%s%s.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
+	}
+
+	ca = switch_mprintf("%s%sca-bundle.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000
+	ctx = SSL_CTX_new(server ? DTLS_server_method() : DTLS_client_method());
+#else
+    #ifdef HAVE_OPENSSL_DTLSv1_2_method
+	ctx = SSL_CTX_new(server ? (want_DTLSv1_2 ? DTLSv1_2_server_method() : DTLSv1_server_method()) : (want_DTLSv1_2 ? DTLSv1_2_client_method() : DTLSv1_client_method()));
+    #else
+	ctx = SSL_CTX_new(server ? DTLSv1_server_method() : DTLSv1_client_method());
+    #endif // HAVE_OPENSSL_DTLSv1_2_method
+#endif
+	switch_assert(ctx);
+
+	bio = BIO_new_file(pem, "r");
+	dh = PEM_read_bio_DHparams(bio, NULL, NULL, NULL);
+	BIO_free(bio);
+	if (dh) {
+		SSL_CTX_set_tmp_dh(ctx, dh);
+		DH_free(dh);
+	}
+
+	SSL_CTX_set_mode(ctx, SSL_MODE_AUTO_RETRY);
+	SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+	SSL_CTX_set_cipher_list(ctx, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
+	SSL_CTX_set_read_ahead(ctx, 1);
+#ifdef HAVE_OPENSSL_DTLS_SRTP
+	SSL_CTX_set_tlsext_use_srtp(ctx, "SRTP_AES128_CM_SHA1_80");
+#endif
+
+#ifndef OPENSSL_NO_EC
+	if ((ecdh = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1))) {
+		SSL_CTX_set_options(ctx, SSL_OP_SINGLE_ECDH_USE);
+		SSL_CTX_set_tmp_ecdh(ctx, ecdh);
+		EC_KEY_free(ecdh);
+	}
+#endif
+
+	if (server) {
+		/* returning peers can resume with a session ticket or id and skip the full key exchange */
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_set_session_id_context(ctx, (const unsigned char *) DTLS_CTX_SESSION_ID, (unsigned int) strlen(DTLS_CTX_SESSION_ID));
+	}
+
+	if ((ret = SSL_CTX_use_certificate_file(ctx, rsa, SSL_FILETYPE_PEM)) != 1) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DTLS cert err [%s]\n", rsa);
+		goto fail;
+	}
+
+	if ((ret = SSL_CTX_use_PrivateKey_file(ctx, pvt, SSL_FILETYPE_PEM)) != 1) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DTLS key err [%s]\n", pvt);
+		goto fail;
+	}
+
+	if (SSL_CTX_check_private_key(ctx) == 0) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DTLS check key failed\n");
+		goto fail;
+	}
+
+	if (switch_file_exists(ca, NULL) == SWITCH_STATUS_SUCCESS && (ret = SSL_CTX_load_verify_locations(ctx, ca, NULL)) != 1) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "DTLS check chain cert failed [%s]\n", ca);
+		goto fail;
+	}
+
+	goto end;
+
+ fail:
+
+	SSL_CTX_free(ctx);
+	ctx = NULL;
+
+ end:
+
+	free(pem);
+	free(rsa);
+	free(pvt);
+	free(ca);
+
+	return ctx;
+}
+
+SWITCH_DECLARE(SSL_CTX *) switch_core_cert_dtls_ctx(const char *prefix, int server, int want_DTLSv1_2)
+{
+	SSL_CTX *ctx = NULL;
+	char *rsa;
+	time_t mtime = 0;
+	int idx = (server ? 2 : 0) + (want_DTLSv1_2 ? 1 : 0);
+
+	if (!dtls_cache.mutex) {
+		return dtls_ctx_new(prefix, server, want_DTLSv1_2);
+	}
+
+	rsa = switch_mprintf("%s%s%s.pem", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
+
+	if (switch_file_exists(rsa, NULL) != SWITCH_STATUS_SUCCESS) {
+		free(rsa);
+		rsa = switch_mprintf("%s%s%s.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, prefix);
+	}
+
+	cert_mtime(rsa, &mtime);
+	free(rsa);
+
+	switch_mutex_lock(dtls_cache.mutex);
+
+	if (!dtls_cache.prefix || strcmp(dtls_cache.prefix, prefix) || dtls_cache.mtime != mtime) {
+		dtls_cache_clear_ctx();
+		dtls_cache.prefix = strdup(prefix);
+		dtls_cache.mtime = mtime;
+	}
+
+	if (!dtls_cache.ctx[idx]) {
+		dtls_cache.ctx[idx] = dtls_ctx_new(prefix, server, want_DTLSv1_2);
+	}
+
+	if ((ctx = dtls_cache.ctx[idx])) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000
+		SSL_CTX_up_ref(ctx);
+#else
+		CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+#endif
+	}
+
+	switch_mutex_unlock(dtls_cache.mutex);
+
+	return ctx;
+}
+
 
 static int mkcert(X509 **x509p, EVP_PKEY **pkeyp, int bits, int serial, int days);
 
@@ -62,6 +62,471 @@ static switch_status_t get_file_size(switch_file_handle_t *fh, const char **stri
 	return status;
 }
 
+struct switch_prompt_cache_entry {
+	char *key;
+	char *file_path;
+	time_t mtime;
+	uint32_t rate;
+	uint32_t channels;
+	int16_t *data;
+	switch_size_t samples;
+	switch_size_t bytes;
+	uint32_t refs;
+	uint32_t hits;
+	int stale;
+	struct switch_prompt_cache_entry *prev;
+	struct switch_prompt_cache_entry *next;
+};
+
+typedef struct switch_prompt_cache_entry switch_prompt_cache_entry_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *hash;
+	switch_prompt_cache_entry_t *head;
+	switch_prompt_cache_entry_t *tail;
+	switch_size_t max_bytes;
+	switch_size_t bytes;
+	uint32_t entries;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t loads;
+	uint64_t evictions;
+	uint64_t invalidations;
+	uint64_t skipped;
+} prompt_cache;
+
+static void prompt_cache_free(switch_prompt_cache_entry_t *entry)
+{
+	switch_safe_free(entry->data);
+	switch_safe_free(entry->key);
+	free(entry);
+}
+
+static void prompt_cache_unlink(switch_prompt_cache_entry_t *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		prompt_cache.head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		prompt_cache.tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+}
+
+static void prompt_cache_link(switch_prompt_cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = prompt_cache.head;
+
+	if (prompt_cache.head) {
+		prompt_cache.head->prev = entry;
+	} else {
+		prompt_cache.tail = entry;
+	}
+
+	prompt_cache.head = entry;
+}
+
+/* must be called with prompt_cache.mutex locked, entries still in use are freed on their last release */
+static void prompt_cache_remove(switch_prompt_cache_entry_t *entry)
+{
+	switch_core_hash_delete(prompt_cache.hash, entry->key);
+	prompt_cache_unlink(entry);
+	prompt_cache.bytes -= entry->bytes;
+	prompt_cache.entries--;
+
+	if (entry->refs) {
+		entry->stale = 1;
+	} else {
+		prompt_cache_free(entry);
+	}
+}
+
+static switch_bool_t prompt_cache_make_room(switch_size_t bytes)
+{
+	switch_prompt_cache_entry_t *entry, *prev;
+
+	for (entry = prompt_cache.tail; entry && prompt_cache.bytes + bytes > prompt_cache.max_bytes; entry = prev) {
+		prev = entry->prev;
+
+		if (!entry->refs) {
+			prompt_cache_remove(entry);
+			prompt_cache.evictions++;
+		}
+	}
+
+	return prompt_cache.bytes + bytes <= prompt_cache.max_bytes ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
+static void prompt_cache_release(switch_prompt_cache_entry_t *entry)
+{
+	switch_mutex_lock(prompt_cache.mutex);
+	if (!--entry->refs && entry->stale) {
+		prompt_cache_free(entry);
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+}
+
+static switch_status_t prompt_cache_mtime(const char *file_path, time_t *mtime)
+{
+	struct stat st;
+
+	if (stat(file_path, &st)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	*mtime = st.st_mtime;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* decode the whole file through the regular format module and resampler, outside of the cache lock */
+static switch_prompt_cache_entry_t *prompt_cache_decode(const char *key, const char *file_path, uint32_t rate, uint32_t channels, time_t mtime)
+{
+	switch_file_handle_t fh = { 0 };
+	switch_prompt_cache_entry_t *entry;
+	switch_size_t max_bytes = prompt_cache.max_bytes / 4;
+	switch_size_t alloced = 0, len;
+	int16_t buf[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	int16_t *data = NULL;
+	int too_big = 0;
+
+	if (switch_core_file_open(&fh, file_path, channels, rate, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT | SWITCH_FILE_NOCACHE, NULL) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->key = strdup(key);
+	entry->file_path = entry->key + strlen(key) - strlen(file_path);
+	entry->mtime = mtime;
+	entry->rate = rate;
+	entry->channels = channels;
+
+	if (switch_test_flag(&fh, SWITCH_FILE_NATIVE)) {
+		too_big = 1;
+	}
+
+	if (!too_big && fh.samples > 0 && fh.native_rate) {
+		alloced = ((switch_size_t) fh.samples * rate / fh.native_rate + SWITCH_RECOMMENDED_BUFFER_SIZE) * 2 * channels;
+
+		if (alloced > max_bytes) {
+			too_big = 1;
+		} else {
+			switch_malloc(data, alloced);
+		}
+	}
+
+	while (!too_big) {
+		/* the format module may hand us more channels than we asked for before they are muxed down */
+		len = SWITCH_RECOMMENDED_BUFFER_SIZE / 16;
+
+		if (switch_core_file_read(&fh, buf, &len) != SWITCH_STATUS_SUCCESS || !len) {
+			break;
+		}
+
+		if (alloced - entry->bytes < len * 2 * channels) {
+			void *mem;
+
+			while (alloced - entry->bytes < len * 2 * channels) {
+				alloced = alloced ? alloced * 2 : SWITCH_RECOMMENDED_BUFFER_SIZE * 16;
+			}
+
+			if (alloced > max_bytes) {
+				too_big = 1;
+				break;
+			}
+
+			mem = realloc(data, alloced);
+			switch_assert(mem);
+			data = mem;
+		}
+
+		memcpy((char *) data + entry->bytes, buf, len * 2 * channels);
+		entry->bytes += len * 2 * channels;
+	}
+
+	switch_core_file_close(&fh);
+
+	if (too_big) {
+		/* remembered as a negative entry so the next open goes straight to the format module */
+		switch_safe_free(data);
+		entry->bytes = 0;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Not caching [%s], too large or not decodable to L16\n", file_path);
+	} else {
+		entry->data = data;
+		entry->samples = entry->bytes / 2 / channels;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Cached [%s] at %uhz %uc, %" SWITCH_SIZE_T_FMT " bytes\n",
+						  file_path, rate, channels, entry->bytes);
+	}
+
+	return entry;
+}
+
+static switch_prompt_cache_entry_t *prompt_cache_get(const char *file_path, uint32_t rate, uint32_t channels)
+{
+	switch_prompt_cache_entry_t *entry, *found;
+	char *key;
+	time_t mtime;
+
+	if (!prompt_cache.max_bytes || prompt_cache_mtime(file_path, &mtime) != SWITCH_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	key = switch_mprintf("%u:%u:%s", rate, channels, file_path);
+
+	switch_mutex_lock(prompt_cache.mutex);
+	if ((entry = switch_core_hash_find(prompt_cache.hash, key)) && entry->mtime != mtime) {
+		prompt_cache_remove(entry);
+		prompt_cache.invalidations++;
+		entry = NULL;
+	}
+
+	if (entry) {
+		if (entry->data) {
+			prompt_cache_unlink(entry);
+			prompt_cache_link(entry);
+			entry->refs++;
+			entry->hits++;
+			prompt_cache.hits++;
+		} else {
+			prompt_cache.skipped++;
+			entry = NULL;
+		}
+
+		switch_mutex_unlock(prompt_cache.mutex);
+		free(key);
+		return entry;
+	}
+
+	prompt_cache.misses++;
+	switch_mutex_unlock(prompt_cache.mutex);
+
+	if (!(entry = prompt_cache_decode(key, file_path, rate, channels, mtime))) {
+		free(key);
+		return NULL;
+	}
+
+	free(key);
+
+	switch_mutex_lock(prompt_cache.mutex);
+	if ((found = switch_core_hash_find(prompt_cache.hash, entry->key))) {
+		/* somebody else decoded it while we were busy */
+		if (found->mtime == entry->mtime) {
+			prompt_cache_free(entry);
+			entry = NULL;
+
+			if (found->data) {
+				found->refs++;
+				found->hits++;
+				prompt_cache.hits++;
+				entry = found;
+			}
+
+			switch_mutex_unlock(prompt_cache.mutex);
+			return entry;
+		}
+
+		prompt_cache_remove(found);
+		prompt_cache.invalidations++;
+	}
+
+	prompt_cache.loads++;
+
+	if (prompt_cache_make_room(entry->bytes)) {
+		switch_core_hash_insert(prompt_cache.hash, entry->key, entry);
+		prompt_cache_link(entry);
+		prompt_cache.bytes += entry->bytes;
+		prompt_cache.entries++;
+	} else {
+		/* everything is in use, serve this caller from its own copy */
+		entry->stale = 1;
+	}
+
+	if (entry->data) {
+		entry->refs++;
+	} else {
+		if (entry->stale) {
+			prompt_cache_free(entry);
+		}
+		entry = NULL;
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+
+	return entry;
+}
+
+static switch_status_t prompt_cache_open(switch_file_handle_t *fh, uint32_t rate)
+{
+	switch_prompt_cache_entry_t *entry;
+
+	if (!(entry = prompt_cache_get(fh->file_path, rate, fh->channels))) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	fh->prompt_cache = entry;
+	fh->samplerate = fh->native_rate = rate;
+	fh->real_channels = fh->channels;
+	fh->seekable = 1;
+	fh->pos = 0;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t prompt_cache_read(switch_file_handle_t *fh, void *data, switch_size_t *len)
+{
+	switch_prompt_cache_entry_t *entry = fh->prompt_cache;
+	switch_size_t want = *len;
+
+	if (fh->max_samples > 0) {
+		if (fh->samples_in >= (switch_size_t) fh->max_samples) {
+			*len = 0;
+			return SWITCH_STATUS_FALSE;
+		}
+
+		if (want > (switch_size_t) fh->max_samples - fh->samples_in) {
+			want = (switch_size_t) fh->max_samples - fh->samples_in;
+		}
+	}
+
+	if (fh->pos < 0 || (switch_size_t) fh->pos >= entry->samples) {
+		*len = 0;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (want > entry->samples - (switch_size_t) fh->pos) {
+		want = entry->samples - (switch_size_t) fh->pos;
+	}
+
+	memcpy(data, entry->data + fh->pos * entry->channels, want * 2 * entry->channels);
+	fh->pos += want;
+	fh->samples_in += want;
+	*len = want;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t prompt_cache_seek(switch_file_handle_t *fh, unsigned int *cur_pos, int64_t samples, int whence)
+{
+	switch_prompt_cache_entry_t *entry = fh->prompt_cache;
+	int64_t pos;
+
+	switch (whence) {
+	case SEEK_CUR:
+		pos = fh->pos + samples;
+		break;
+	case SEEK_END:
+		pos = (int64_t) entry->samples + samples;
+		break;
+	default:
+		pos = samples;
+		break;
+	}
+
+	if (pos < 0) {
+		pos = 0;
+	} else if (pos > (int64_t) entry->samples) {
+		pos = (int64_t) entry->samples;
+	}
+
+	switch_set_flag_locked(fh, SWITCH_FILE_SEEK);
+	fh->pos = pos;
+	*cur_pos = (unsigned int) pos;
+	fh->offset_pos = *cur_pos;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+void switch_core_prompt_cache_init(switch_memory_pool_t *pool)
+{
+	memset(&prompt_cache, 0, sizeof(prompt_cache));
+	switch_mutex_init(&prompt_cache.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&prompt_cache.hash);
+}
+
+void switch_core_prompt_cache_uninit(void)
+{
+	if (!prompt_cache.hash) {
+		return;
+	}
+
+	switch_core_prompt_cache_flush(NULL);
+	switch_core_hash_destroy(&prompt_cache.hash);
+}
+
+SWITCH_DECLARE(void) switch_core_prompt_cache_set_size(switch_size_t bytes)
+{
+	switch_mutex_lock(prompt_cache.mutex);
+	prompt_cache.max_bytes = bytes;
+	prompt_cache_make_room(0);
+	switch_mutex_unlock(prompt_cache.mutex);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_prompt_cache_preload(const char *file_path, uint32_t rate, uint32_t channels)
+{
+	switch_prompt_cache_entry_t *entry;
+
+	if (zstr(file_path) || !rate || !channels) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!(entry = prompt_cache_get(file_path, rate, channels))) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	prompt_cache_release(entry);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(uint32_t) switch_core_prompt_cache_flush(const char *file_path)
+{
+	switch_prompt_cache_entry_t *entry, *next;
+	uint32_t count = 0;
+
+	switch_mutex_lock(prompt_cache.mutex);
+	for (entry = prompt_cache.head; entry; entry = next) {
+		next = entry->next;
+
+		if (!file_path || !strcmp(entry->file_path, file_path)) {
+			prompt_cache_remove(entry);
+			count++;
+		}
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+
+	return count;
+}
+
+SWITCH_DECLARE(void) switch_core_prompt_cache_stats(switch_stream_handle_t *stream)
+{
+	switch_prompt_cache_entry_t *entry;
+
+	switch_mutex_lock(prompt_cache.mutex);
+	stream->write_function(stream, "Size: %" SWITCH_SIZE_T_FMT "/%" SWITCH_SIZE_T_FMT " bytes, Entries: %u\n",
+						   prompt_cache.bytes, prompt_cache.max_bytes, prompt_cache.entries);
+	stream->write_function(stream, "Hits: %" SWITCH_UINT64_T_FMT ", Misses: %" SWITCH_UINT64_T_FMT ", Loads: %" SWITCH_UINT64_T_FMT
+						   ", Evictions: %" SWITCH_UINT64_T_FMT ", Invalidations: %" SWITCH_UINT64_T_FMT ", Skipped: %" SWITCH_UINT64_T_FMT "\n",
+						   prompt_cache.hits, prompt_cache.misses, prompt_cache.loads,
+						   prompt_cache.evictions, prompt_cache.invalidations, prompt_cache.skipped);
+
+	for (entry = prompt_cache.head; entry; entry = entry->next) {
+		if (entry->data) {
+			stream->write_function(stream, "%s %uhz %uc %" SWITCH_SIZE_T_FMT " bytes, %u refs, %u hits\n",
+								   entry->file_path, entry->rate, entry->channels, entry->bytes, entry->refs, entry->hits);
+		} else {
+			stream->write_function(stream, "%s %uhz %uc not cached\n", entry->file_path, entry->rate, entry->channels);
+		}
+	}
+	switch_mutex_unlock(prompt_cache.mutex);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file, const char *func, int line,
 															  switch_file_handle_t *fh,
 															  const char *file_path,
@@ -351,6 +816,15 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_file_open(const char *file,
 		fh->mm.channels = fh->channels;
 	}
 
+	fh->prompt_cache = NULL;
+
+	if (prompt_cache.max_bytes && !is_stream && !fh->params && channels && rate && !force_channels &&
+		(flags & SWITCH_FILE_FLAG_READ) && !(flags & (SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_NOCACHE)) &&
+		!switch_test_flag(fh, SWITCH_FILE_FLAG_VIDEO) && prompt_cache_open(fh, rate) == SWITCH_STATUS_SUCCESS) {
+		switch_set_flag_locked(fh, SWITCH_FILE_OPEN);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
 	file_path = fh->spool_path ? fh->spool_path : fh->file_path;
 
 	if ((status = fh->file_interface->file_open(fh, file_path)) != SWITCH_STATUS_SUCCESS) {
@@ -443,6 +917,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_read(switch_file_handle_t *fh,
 		return SWITCH_STATUS_FALSE;
 	}
 
+	if (fh->prompt_cache) {
+		return prompt_cache_read(fh, data, len);
+	}
+
   top:
 
 	if (fh->max_samples > 0 && fh->samples_in >= (switch_size_t)fh->max_samples) {
@@ -728,6 +1206,10 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_seek(switch_file_handle_t *fh,
 
 	switch_assert(fh != NULL);
 
+	if (fh->prompt_cache && switch_test_flag(fh, SWITCH_FILE_OPEN)) {
+		return prompt_cache_seek(fh, cur_pos, samples, whence);
+	}
+
 	if (!switch_test_flag(fh, SWITCH_FILE_OPEN) || !fh->file_interface->file_seek) {
 		ok = 0;
 	} else if (switch_test_flag(fh, SWITCH_FILE_FLAG_WRITE)) {
@@ -781,7 +1263,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_set_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_set_string) {
+	if (fh->prompt_cache || !fh->file_interface->file_set_string) {
 		return SWITCH_STATUS_FALSE;
 	}
 
@@ -799,7 +1281,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_get_string(switch_file_handle_t
 		return SWITCH_STATUS_FALSE;
 	}
 
-	if (!fh->file_interface->file_get_string) {
+	if (fh->prompt_cache || !fh->file_interface->file_get_string) {
 		if (col == SWITCH_AUDIO_COL_STR_FILE_SIZE) {
 			return get_file_size(fh, string);
 		}
@@ -869,7 +1351,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_command(switch_file_handle_t *f
 		break;
 	}
 
-	if (fh->file_interface->file_command) {
+	if (!fh->prompt_cache && fh->file_interface->file_command) {
 		switch_mutex_lock(fh->flag_mutex);
 		status = fh->file_interface->file_command(fh, command);
 		switch_mutex_unlock(fh->flag_mutex);
@@ -917,7 +1399,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_pre_close(switch_file_handle_t
 	switch_clear_flag_locked(fh, SWITCH_FILE_OPEN);
 	switch_set_flag_locked(fh, SWITCH_FILE_PRE_CLOSED);
 
-	if (fh->file_interface->file_pre_close) {
+	if (!fh->prompt_cache && fh->file_interface->file_pre_close) {
 		status = fh->file_interface->file_pre_close(fh);
 	}
 
@@ -936,7 +1418,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_file_close(switch_file_handle_t *fh)
 
 	switch_clear_flag_locked(fh, SWITCH_FILE_PRE_CLOSED);
 
-	fh->file_interface->file_close(fh);
+	if (fh->prompt_cache) {
+		prompt_cache_release(fh->prompt_cache);
+		fh->prompt_cache = NULL;
+	} else {
+		fh->file_interface->file_close(fh);
+	}
 
 	if (fh->params) {
 		switch_event_destroy(&fh->params);
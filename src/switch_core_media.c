@@ -220,10 +220,9 @@ struct switch_media_handle_s {
 	switch_msrp_session_t *msrp_session;
 	switch_mutex_t *read_mutex[SWITCH_MEDIA_TYPE_TOTAL];
 	switch_mutex_t *write_mutex[SWITCH_MEDIA_TYPE_TOTAL];
-	char *codec_order[SWITCH_MAX_CODECS];
-	int codec_order_last;
 	const switch_codec_implementation_t *codecs[SWITCH_MAX_CODECS];
 	char fmtp[SWITCH_MAX_CODECS][MAX_FMTP_LEN];
+	uint64_t codec_name_mask[SWITCH_MAX_CODECS];
 	int payload_space;
 	char *origin;
 
@@ -234,6 +233,11 @@ struct switch_media_handle_s {
 	switch_mutex_t *sdp_mutex;
 	switch_mutex_t *control_mutex;
 
+	switch_mutex_t *r_sdp_mutex;
+	char *r_sdp_parsed_str;
+	sdp_parser_t *r_sdp_parser;
+	int r_sdp_parser_refs;
+
 	const switch_codec_implementation_t *negotiated_codecs[SWITCH_MAX_CODECS];
 	int num_negotiated_codecs;
 	switch_payload_t ianacodes[SWITCH_MAX_CODECS];
@@ -650,19 +654,99 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_get_vid_params(switch_core_ses
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* The same remote SDP is usually looked at several times per offer/answer (t38 check, codec string, negotiation),
+   so keep the last parse around on the media handle and hand it out again while the text is unchanged.
+   A parse that is still in use is never replaced; a different SDP arriving meanwhile gets a private parse. */
+static sdp_parser_t *media_sdp_get(switch_media_handle_t *smh, const char *r_sdp, switch_bool_t *private_parse)
+{
+	sdp_parser_t *parser = NULL;
+
+	*private_parse = SWITCH_FALSE;
+
+	if (!smh || !smh->r_sdp_mutex) {
+		*private_parse = SWITCH_TRUE;
+		return sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0);
+	}
+
+	switch_mutex_lock(smh->r_sdp_mutex);
+
+	if (smh->r_sdp_parser && smh->r_sdp_parsed_str && !strcmp(smh->r_sdp_parsed_str, r_sdp)) {
+		parser = smh->r_sdp_parser;
+		smh->r_sdp_parser_refs++;
+	} else if (!smh->r_sdp_parser_refs) {
+		if (smh->r_sdp_parser) {
+			sdp_parser_free(smh->r_sdp_parser);
+			smh->r_sdp_parser = NULL;
+		}
+		switch_safe_free(smh->r_sdp_parsed_str);
+
+		if ((parser = sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0))) {
+			if (sdp_session(parser)) {
+				smh->r_sdp_parser = parser;
+				smh->r_sdp_parsed_str = strdup(r_sdp);
+				smh->r_sdp_parser_refs = 1;
+			} else {
+				*private_parse = SWITCH_TRUE;
+			}
+		}
+	} else {
+		*private_parse = SWITCH_TRUE;
+		parser = sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0);
+	}
+
+	switch_mutex_unlock(smh->r_sdp_mutex);
+
+	return parser;
+}
+
+static void media_sdp_put(switch_media_handle_t *smh, sdp_parser_t *parser, switch_bool_t private_parse)
+{
+	if (!parser) {
+		return;
+	}
+
+	if (private_parse) {
+		sdp_parser_free(parser);
+		return;
+	}
+
+	switch_mutex_lock(smh->r_sdp_mutex);
+	if (smh->r_sdp_parser_refs > 0) {
+		smh->r_sdp_parser_refs--;
+	}
+	switch_mutex_unlock(smh->r_sdp_mutex);
+}
+
+static void media_sdp_flush(switch_media_handle_t *smh)
+{
+	if (!smh->r_sdp_mutex) {
+		return;
+	}
+
+	switch_mutex_lock(smh->r_sdp_mutex);
+	if (smh->r_sdp_parser) {
+		sdp_parser_free(smh->r_sdp_parser);
+		smh->r_sdp_parser = NULL;
+	}
+	switch_safe_free(smh->r_sdp_parsed_str);
+	smh->r_sdp_parser_refs = 0;
+	switch_mutex_unlock(smh->r_sdp_mutex);
+}
+
 SWITCH_DECLARE(switch_t38_options_t *) switch_core_media_extract_t38_options(switch_core_session_t *session, const char *r_sdp)
 {
 	sdp_media_t *m;
 	sdp_parser_t *parser = NULL;
 	sdp_session_t *sdp;
 	switch_t38_options_t *t38_options = NULL;
+	switch_bool_t private_parse = SWITCH_FALSE;
 
-	if (!(parser = sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0))) {
+	if (!(parser = media_sdp_get(session->media_handle, r_sdp, &private_parse))) {
 		return NULL;
 	}
 
 	if (!(sdp = sdp_session(parser))) {
-		sdp_parser_free(parser);
+		media_sdp_put(session->media_handle, parser, private_parse);
 		return NULL;
 	}
 
@@ -673,7 +757,7 @@ SWITCH_DECLARE(switch_t38_options_t *) switch_core_media_extract_t38_options(swi
 		}
 	}
 
-	sdp_parser_free(parser);
+	media_sdp_put(session->media_handle, parser, private_parse);
 
 	return t38_options;
 
@@ -2097,6 +2181,8 @@ SWITCH_DECLARE(void) switch_media_handle_destroy(switch_core_session_t *session)
 	if (a_engine->write_fb) switch_frame_buffer_destroy(&a_engine->write_fb);
 
 	if (smh->msrp_session) switch_msrp_session_destroy(&smh->msrp_session);
+
+	media_sdp_flush(smh);
 }
 
 
@@ -2176,6 +2262,7 @@ SWITCH_DECLARE(switch_status_t) switch_media_handle_create(switch_media_handle_t
 		switch_mutex_init(&session->media_handle->mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
 		switch_mutex_init(&session->media_handle->sdp_mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
 		switch_mutex_init(&session->media_handle->control_mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
+		switch_mutex_init(&session->media_handle->r_sdp_mutex, SWITCH_MUTEX_NESTED, switch_core_session_get_pool(session));
 
 		session->media_handle->engines[SWITCH_MEDIA_TYPE_AUDIO].ssrc =
 			(uint32_t) ((intptr_t) &session->media_handle->engines[SWITCH_MEDIA_TYPE_AUDIO] + (uint32_t) time(NULL));
@@ -2334,7 +2421,6 @@ SWITCH_DECLARE(void) switch_core_media_prepare_codecs(switch_core_session_t *ses
 	const char *abs, *codec_string = NULL;
 	const char *ocodec = NULL, *val;
 	switch_media_handle_t *smh;
-	char *tmp_codec_string;
 
 	switch_assert(session);
 
@@ -2391,10 +2477,8 @@ SWITCH_DECLARE(void) switch_core_media_prepare_codecs(switch_core_session_t *ses
 		codec_string = "PCMU@20i,PCMA@20i,speex@20i";
 	}
 
-	tmp_codec_string = switch_core_session_strdup(smh->session, codec_string);
 	switch_channel_set_variable(session->channel, "rtp_use_codec_string", codec_string);
-	smh->codec_order_last = switch_separate_string(tmp_codec_string, ',', smh->codec_order, SWITCH_MAX_CODECS);
-	smh->mparams->num_codecs = switch_loadable_module_get_codecs_sorted(smh->codecs, smh->fmtp, SWITCH_MAX_CODECS, smh->codec_order, smh->codec_order_last);
+	smh->mparams->num_codecs = switch_loadable_module_get_codecs_cached(codec_string, smh->codecs, smh->fmtp, smh->codec_name_mask, SWITCH_MAX_CODECS);
 }
 
 static void check_jb(switch_core_session_t *session, const char *input, int32_t jb_msec, int32_t maxlen, switch_bool_t silent)
@@ -4572,6 +4656,28 @@ struct matches {
 	int codec_idx;
 };
 
+/* Which of the local codecs can match an offered encoding by name, found by comparing
+   one codec per distinct iana name against the name masks built with the codec list */
+static uint64_t codec_name_candidates(switch_media_handle_t *smh, const char *encoding, int total_codecs)
+{
+	uint64_t seen = 0;
+	int i;
+
+	for (i = 0; i < total_codecs; i++) {
+		if (seen & ((uint64_t) 1 << i)) {
+			continue;
+		}
+
+		if (!strcasecmp(encoding, smh->codecs[i]->iananame)) {
+			return smh->codec_name_mask[i];
+		}
+
+		seen |= smh->codec_name_mask[i];
+	}
+
+	return 0;
+}
+
 static void greedy_sort(switch_media_handle_t *smh, struct matches *matches, int m_idx, const switch_codec_implementation_t **codec_array, int total_codecs)
 {
 	int j = 0, f = 0, g;
@@ -4837,6 +4943,7 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
 	int sendonly = 0, recvonly = 0, inactive = 0;
 	int greedy = 0, x = 0, skip = 0;
 	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_bool_t private_parse = SWITCH_FALSE;
 	const char *val;
 	const char *crypto = NULL;
 	int got_crypto = 0, got_video_crypto = 0, got_audio = 0, saw_audio = 0, saw_video = 0, got_avp = 0, got_video_avp = 0, got_video_savp = 0, got_savp = 0, got_udptl = 0, got_webrtc = 0, got_text = 0, got_text_crypto = 0, got_msrp = 0;
@@ -4883,12 +4990,12 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
 	codec_array = smh->codecs;
 	total_codecs = smh->mparams->num_codecs;
 
-	if (!(parser = sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0))) {
+	if (!(parser = media_sdp_get(smh, r_sdp, &private_parse))) {
 		return 0;
 	}
 
 	if (!(sdp = sdp_session(parser))) {
-		sdp_parser_free(parser);
+		media_sdp_put(smh, parser, private_parse);
 		return 0;
 	}
 
@@ -5495,6 +5602,8 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
 				uint32_t map_bit_rate = 0;
 				switch_codec_fmtp_t codec_fmtp = { 0 };
 				int map_channels = map->rm_params ? atoi(map->rm_params) : 1;
+				uint64_t candidates;
+				int by_name;
 
 				if (!(rm_encoding = map->rm_encoding)) {
 					rm_encoding = "";
@@ -5580,6 +5689,9 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
 					}
 				}
 
+				by_name = !((zstr(map->rm_encoding) || (smh->mparams->ndlb & SM_NDLB_ALLOW_BAD_IANANAME)) && map->rm_pt < 96);
+				candidates = by_name ? codec_name_candidates(smh, rm_encoding, total_codecs) : ~(uint64_t) 0;
+
 				for (i = 0; i < smh->mparams->num_codecs && i < total_codecs; i++) {
 					const switch_codec_implementation_t *imp = codec_array[i];
 					uint32_t bit_rate = imp->bits_per_second;
@@ -5589,6 +5701,14 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
 						continue;
 					}
 
+					if (!(candidates & ((uint64_t) 1 << i))) {
+						/* different name, can not match; keep the rate the full compare would have left behind */
+						if (fmtp_remote_codec_rate) {
+							remote_codec_rate = fmtp_remote_codec_rate;
+						}
+						continue;
+					}
+
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Audio Codec Compare [%s:%d:%u:%d:%u:%d]/[%s:%d:%u:%d:%u:%d]\n",
 									  rm_encoding, map->rm_pt, (int) remote_codec_rate, codec_ms, map_bit_rate, map_channels,
 									  imp->iananame, imp->ianacode, codec_rate, imp->microseconds_per_packet / 1000, bit_rate, imp->number_of_channels);
@@ -6443,7 +6563,7 @@ SWITCH_DECLARE(uint8_t) switch_core_media_negotiate_sdp(switch_core_session_t *s
  t38_done:
 
 	if (parser) {
-		sdp_parser_free(parser);
+		media_sdp_put(smh, parser, private_parse);
 	}
 
 	smh->mparams->cng_pt = cng_pt;
@@ -10301,7 +10421,9 @@ SWITCH_DECLARE(void) switch_core_media_gen_local_sdp(switch_core_session_t *sess
 	username = smh->mparams->sdp_username;
 
 
-	switch_zmalloc(buf, SDPBUFLEN);
+	/* everything below appends at strlen(buf); only the terminator needs clearing, not all 64k */
+	switch_malloc(buf, SDPBUFLEN);
+	*buf = '\0';
 
 	switch_core_media_check_dtmf_type(session);
 
@@ -13313,6 +13435,7 @@ SWITCH_DECLARE(void) switch_core_media_merge_sdp_codec_string(switch_core_sessio
 	sdp_parser_t *parser;
 	sdp_session_t *sdp;
 	switch_media_handle_t *smh;
+	switch_bool_t private_parse = SWITCH_FALSE;
 
 	switch_assert(session);
 
@@ -13329,13 +13452,13 @@ SWITCH_DECLARE(void) switch_core_media_merge_sdp_codec_string(switch_core_sessio
 		codec_string = switch_core_media_get_codec_string(session);
 	}
 	
-	if ((parser = sdp_parse(NULL, r_sdp, (int) strlen(r_sdp), 0))) {
+	if ((parser = media_sdp_get(smh, r_sdp, &private_parse))) {
 
 		if ((sdp = sdp_session(parser))) {
 			switch_core_media_set_r_sdp_codec_string(session, codec_string, sdp, sdp_type);
 		}
 
-		sdp_parser_free(parser);
+		media_sdp_put(smh, parser, private_parse);
 	}
 
 }
@@ -13413,7 +13536,6 @@ static void switch_core_media_set_r_sdp_codec_string(switch_core_session_t *sess
 	int i;
 	int already_did[128] = { 0 };
 	int num_codecs = 0;
-	char *codec_order[SWITCH_MAX_CODECS];
 	const switch_codec_implementation_t *codecs[SWITCH_MAX_CODECS] = { 0 };
 	char fmtp[SWITCH_MAX_CODECS][MAX_FMTP_LEN];
 
@@ -13435,15 +13557,9 @@ static void switch_core_media_set_r_sdp_codec_string(switch_core_session_t *sess
 
 
 	if (!zstr(codec_string)) {
-		char *tmp_codec_string;
-
 		if (*codec_string == '=') codec_string++;
 
-		if ((tmp_codec_string = strdup(codec_string))) {
-			num_codecs = switch_separate_string(tmp_codec_string, ',', codec_order, SWITCH_MAX_CODECS);
-			num_codecs = switch_loadable_module_get_codecs_sorted(codecs, fmtp, SWITCH_MAX_CODECS, codec_order, num_codecs);
-			switch_safe_free(tmp_codec_string);
-		}
+		num_codecs = switch_loadable_module_get_codecs_cached(codec_string, codecs, fmtp, NULL, SWITCH_MAX_CODECS);
 	} else {
 		num_codecs = switch_loadable_module_get_codecs(codecs, SWITCH_MAX_CODECS);
 	}
@@ -13926,9 +14042,7 @@ SWITCH_DECLARE (void) switch_core_media_recover_session(switch_core_session_t *s
 	}
 
 	if ((tmp = switch_channel_get_variable(session->channel, "rtp_use_codec_string"))) {
-		char *tmp_codec_string = switch_core_session_strdup(smh->session, tmp);
-		smh->codec_order_last = switch_separate_string(tmp_codec_string, ',', smh->codec_order, SWITCH_MAX_CODECS);
-		smh->mparams->num_codecs = switch_loadable_module_get_codecs_sorted(smh->codecs, smh->fmtp, SWITCH_MAX_CODECS, smh->codec_order, smh->codec_order_last);
+		smh->mparams->num_codecs = switch_loadable_module_get_codecs_cached(tmp, smh->codecs, smh->fmtp, smh->codec_name_mask, SWITCH_MAX_CODECS);
 	}
 
 	if ((tmp = switch_channel_get_variable(session->channel, "rtp_2833_send_payload"))) {
@@ -14130,44 +14244,51 @@ static int find_pt(const char *sdp, const char *name)
 }
 
 
-SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const char *cmd, const char *arg)
+/* payload types to strip from an SDP; numbers outside 0-127 follow drop_other */
+typedef struct {
+	uint8_t drop[128];
+	switch_bool_t drop_other;
+} sdp_pt_filter_t;
+
+#define SDP_PT_DROPPED(_n) ((_n) >= 0 && (_n) < 128 ? filter->drop[(_n)] : filter->drop_other)
+
+/* Add one remove(pt) or only(pt) command to the filter; te is the telephone-event pt "only" keeps as well */
+static void sdp_pt_filter_add(sdp_pt_filter_t *filter, switch_bool_t only, int pt, int te)
+{
+	int x;
+
+	if (only) {
+		for (x = 0; x < 128; x++) {
+			if (x != pt && x != te) {
+				filter->drop[x] = 1;
+			}
+		}
+		filter->drop_other = SWITCH_TRUE;
+	} else if (pt >= 0 && pt < 128) {
+		filter->drop[pt] = 1;
+	}
+}
+
+/* Copy sdp_str leaving out the dropped payload types from the m= lines and their rtpmap/fmtp attributes */
+static char *sdp_pt_filter_apply(const char *sdp_str, sdp_pt_filter_t *filter)
 {
 	char *new_sdp = NULL;
-	int pt = -1, te = -1;
 	switch_size_t len;
 	const char *i;
 	char *o;
 	int in_m = 0, m_tally = 0, slash = 0;
 	int number = 0, skip = 0;
-	int remove = !strcasecmp(cmd, "remove");
-	int only = !strcasecmp(cmd, "only");
 	char *end = end_of_p((char *)sdp_str);
 	int tst;
 	end++;
 
-
-	if (remove || only) {
-		pt = payload_number(arg);
-
-		if (pt < 0) {
-			pt = find_pt(sdp_str, arg);
-		}
-	} else {
-		return NULL;
-	}
-
-	if (only) {
-		te = find_pt(sdp_str, "telephone-event");
-	}
-
-
 	len = strlen(sdp_str) + 2;
 	new_sdp = malloc(len);
 	o = new_sdp;
 	i = sdp_str;
 
 
-	while(i && *i && i < end) {
+	while(i && i < end && *i) {
 
 		if (*i == 'm' && *(i+1) == '=') {
 			in_m = 1;
@@ -14195,13 +14316,7 @@ SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const c
 
 					while(i < end && ((*i > 47 && *i < 58) || *i == ' ')) {
 
-						if (remove)  {
-							tst = (number != pt);
-						} else {
-							tst = (number == pt || number == te);
-						}
-
-						if (tst) {
+						if (!SDP_PT_DROPPED(number)) {
 							*o++ = *i;
 						}
 						i++;
@@ -14212,29 +14327,21 @@ SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const c
 
 					}
 
-					if (remove)  {
-						tst = (number == pt);
-					} else {
-						tst = (number != pt && number != te);
-					}
-
-					if (tst) {
+					if (SDP_PT_DROPPED(number)) {
 						skip++;
 					}
 				}
 			}
 		}
 
-		while (i < end && !strncasecmp(i, "a=rtpmap:", 9)) {
-			const char *t = i + 9;
+		/* take a whole rtpmap or fmtp line, then look at the next line from the top so an m= line
+		   or another attribute right after it is not copied blindly */
+		if (i < end && (!strncasecmp(i, "a=rtpmap:", 9) || !strncasecmp(i, "a=fmtp:", 7))) {
+			const char *t = i + (i[2] == 'r' || i[2] == 'R' ? 9 : 7);
 
 			number = atoi(t);
 
-			if (remove)  {
-				tst = (number == pt);
-			} else {
-				tst = (number != pt && number != te);
-			}
+			tst = SDP_PT_DROPPED(number);
 
 			while(i < end && (*i != '\r' && *i != '\n')) {
 				if (!tst) *o++ = *i;
@@ -14245,28 +14352,9 @@ SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const c
 				if (!tst) *o++ = *i;
 				i++;
 			}
-		}
-
-		while (i < end && !strncasecmp(i, "a=fmtp:", 7)) {
-			const char *t = i + 7;
-
-			number = atoi(t);
 
-			if (remove)  {
-				tst = (number == pt);
-			} else {
-				tst = (number != pt && number != te);
-			}
-
-			while(i < end && (*i != '\r' && *i != '\n')) {
-				if (!tst) *o++ = *i;
-				i++;
-			}
-
-			while(i < end && (*i == '\r' || *i == '\n')) {
-				if (!tst) *o++ = *i;
-				i++;
-			}
+			skip = 0;
+			continue;
 		}
 
 		if (!skip) {
@@ -14283,6 +14371,49 @@ SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const c
 	return new_sdp;
 }
 
+SWITCH_DECLARE(char *) switch_core_media_filter_sdp(const char *sdp_str, const char *cmd, const char *arg)
+{
+	sdp_pt_filter_t filter = { { 0 } };
+	int pt = -1, te = -1;
+	int remove = !strcasecmp(cmd, "remove");
+	int only = !strcasecmp(cmd, "only");
+
+	if (remove || only) {
+		pt = payload_number(arg);
+
+		if (pt < 0) {
+			pt = find_pt(sdp_str, arg);
+		}
+	} else {
+		return NULL;
+	}
+
+	if (only) {
+		te = find_pt(sdp_str, "telephone-event");
+	}
+
+	sdp_pt_filter_add(&filter, only, pt, te);
+
+	return sdp_pt_filter_apply(sdp_str, &filter);
+}
+
+/* find_pt() against a parsed SDP: the first rtpmap with this encoding name */
+static int sdp_session_find_pt(sdp_session_t *sdp, const char *name)
+{
+	sdp_media_t *m;
+	sdp_rtpmap_t *map;
+
+	for (m = sdp->sdp_media; m; m = m->m_next) {
+		for (map = m->m_rtpmaps; map; map = map->rm_next) {
+			if (map->rm_encoding && !strcasecmp(map->rm_encoding, name)) {
+				return map->rm_pt;
+			}
+		}
+	}
+
+	return -1;
+}
+
 SWITCH_DECLARE(char *) switch_core_media_process_sdp_filter(const char *sdp, const char *cmd_buf, switch_core_session_t *session)
 {
 	switch_channel_t *channel = switch_core_session_get_channel(session);
@@ -14291,12 +14422,24 @@ SWITCH_DECLARE(char *) switch_core_media_process_sdp_filter(const char *sdp, con
 	char *argv[50];
 	int x = 0;
 	char *patched_sdp = NULL;
+	sdp_parser_t *parser = NULL;
+	sdp_session_t *sdp_sess = NULL;
+	switch_bool_t private_parse = SWITCH_FALSE;
+	sdp_pt_filter_t filter = { { 0 } };
+	int te = -2, batched = 0;
 
 	argc = switch_split(cmd, '|', argv);
 
+	/* Every command only ever removes payload types, so the whole chain can be resolved against one
+	   parse of the input and applied in a single copy instead of rescanning and copying per command. */
+	if ((parser = media_sdp_get(session->media_handle, sdp, &private_parse))) {
+		sdp_sess = sdp_session(parser);
+	}
+
 	for (x = 0; x < argc; x++) {
 		char *command = argv[x];
 		char *arg = strchr(command, '(');
+		int only, pt;
 
 		if (arg) {
 			char *e = switch_find_end_paren(arg, '(', ')');
@@ -14306,27 +14449,56 @@ SWITCH_DECLARE(char *) switch_core_media_process_sdp_filter(const char *sdp, con
 
 		if (zstr(command) || zstr(arg)) {
 			switch_log_printf(SWITCH_CHANNEL_CHANNEL_LOG(channel), SWITCH_LOG_WARNING, "%s SDP FILTER PARSE ERROR\n", switch_channel_get_name(channel));
-		} else {
-			char *tmp_sdp = NULL;
-
-			if (patched_sdp) {
-				tmp_sdp = switch_core_media_filter_sdp(patched_sdp, command, arg);
-			} else {
-				tmp_sdp = switch_core_media_filter_sdp(sdp, command, arg);
-			}
+			continue;
+		}
 
+		if (!sdp_sess) {
+			/* not parsable, filter the text one command at a time */
+			char *tmp_sdp = switch_core_media_filter_sdp(patched_sdp ? patched_sdp : sdp, command, arg);
 
 			switch_log_printf(SWITCH_CHANNEL_CHANNEL_LOG(channel), SWITCH_LOG_DEBUG,
 							  "%s Filter command %s(%s)\nFROM:\n==========\n%s\nTO:\n==========\n%s\n\n",
 							  switch_channel_get_name(channel),
 							  command, arg, patched_sdp ? patched_sdp : sdp, tmp_sdp);
 
-
 			if (tmp_sdp) {
 				switch_safe_free(patched_sdp);
 				patched_sdp = tmp_sdp;
 			}
+			continue;
+		}
+
+		only = !strcasecmp(command, "only");
+
+		if (!only && strcasecmp(command, "remove")) {
+			continue;
+		}
+
+		if ((pt = payload_number(arg)) < 0) {
+			pt = sdp_session_find_pt(sdp_sess, arg);
 		}
+
+		if (only && te == -2) {
+			te = sdp_session_find_pt(sdp_sess, "telephone-event");
+		}
+
+		switch_log_printf(SWITCH_CHANNEL_CHANNEL_LOG(channel), SWITCH_LOG_DEBUG, "%s Filter command %s(%s) pt %d\n",
+						  switch_channel_get_name(channel), command, arg, pt);
+
+		sdp_pt_filter_add(&filter, only, pt, te);
+		batched++;
+	}
+
+	if (batched) {
+		patched_sdp = sdp_pt_filter_apply(sdp, &filter);
+
+		switch_log_printf(SWITCH_CHANNEL_CHANNEL_LOG(channel), SWITCH_LOG_DEBUG,
+						  "%s Filter %s\nFROM:\n==========\n%s\nTO:\n==========\n%s\n\n",
+						  switch_channel_get_name(channel), cmd_buf, sdp, patched_sdp);
+	}
+
+	if (parser) {
+		media_sdp_put(session->media_handle, parser, private_parse);
 	}
 
 	return patched_sdp;
@@ -14870,6 +15042,99 @@ SWITCH_DECLARE(void) switch_core_session_passthru(switch_core_session_t *session
 
 }
 
+static switch_rtp_t *relay_rtp(switch_core_session_t *session)
+{
+	if (!session->media_handle) {
+		return NULL;
+	}
+
+	return session->media_handle->engines[SWITCH_MEDIA_TYPE_AUDIO].rtp_session;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_media_relay_start(switch_core_session_t *session, switch_core_session_t *peer_session)
+{
+	switch_rtp_engine_t *a_engine;
+	switch_rtp_t *rtp_session, *peer_rtp_session;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (!session->media_handle || !peer_session->media_handle) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	a_engine = &session->media_handle->engines[SWITCH_MEDIA_TYPE_AUDIO];
+	rtp_session = a_engine->rtp_session;
+	peer_rtp_session = relay_rtp(peer_session);
+
+	if (!switch_rtp_ready(rtp_session) || !switch_rtp_ready(peer_rtp_session) || !a_engine->cur_payload_map) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (switch_core_session_transcoding(session, peer_session, SWITCH_MEDIA_TYPE_AUDIO)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* hold both bug lists until the relay is running so a bug added meanwhile always finds it and suspends it,
+	   a busy lock just means trying again on a later frame */
+	if (switch_thread_rwlock_tryrdlock(session->bug_rwlock) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (switch_thread_rwlock_tryrdlock(peer_session->bug_rwlock) != SWITCH_STATUS_SUCCESS) {
+		switch_thread_rwlock_unlock(session->bug_rwlock);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (session->bugs || peer_session->bugs ||
+		session->event_hooks.read_frame || peer_session->event_hooks.write_frame ||
+		switch_channel_test_flag(session->channel, CF_PROXY_MODE) || switch_channel_test_flag(peer_session->channel, CF_PROXY_MODE) ||
+		switch_channel_test_flag(session->channel, CF_PROXY_MEDIA) || switch_channel_test_flag(peer_session->channel, CF_PROXY_MEDIA) ||
+		switch_channel_test_flag(session->channel, CF_DTLS) || switch_channel_test_flag(peer_session->channel, CF_DTLS) ||
+		switch_channel_test_flag(session->channel, CF_ZRTP_PASSTHRU) ||
+		switch_channel_test_flag(session->channel, CF_AUDIO_PAUSE_READ) || switch_channel_test_flag(peer_session->channel, CF_AUDIO_PAUSE_WRITE)) {
+		goto end;
+	}
+
+	if ((status = switch_rtp_relay_start(rtp_session, peer_rtp_session, a_engine->cur_payload_map->recv_pt)) == SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Relaying audio RTP from %s to %s\n",
+						  switch_channel_get_name(session->channel), switch_channel_get_name(peer_session->channel));
+	}
+
+ end:
+
+	switch_thread_rwlock_unlock(peer_session->bug_rwlock);
+	switch_thread_rwlock_unlock(session->bug_rwlock);
+
+	return status;
+}
+
+SWITCH_DECLARE(void) switch_core_media_relay_stop(switch_core_session_t *session)
+{
+	switch_rtp_t *rtp_session;
+
+	if ((rtp_session = relay_rtp(session))) {
+		switch_rtp_relay_stop(rtp_session);
+	}
+}
+
+SWITCH_DECLARE(void) switch_core_media_relay_suspend(switch_core_session_t *session)
+{
+	switch_rtp_t *rtp_session;
+
+	if ((rtp_session = relay_rtp(session))) {
+		switch_rtp_relay_suspend(rtp_session);
+	}
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_core_media_relay_running(switch_core_session_t *session)
+{
+	return switch_rtp_relay_running(relay_rtp(session));
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_media_relay_wait(switch_core_session_t *session, uint32_t ms)
+{
+	return switch_rtp_relay_wait(relay_rtp(session), ms);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_session_read_video_frame(switch_core_session_t *session, switch_frame_t **frame, switch_io_flag_t flags,
 																	 int stream_id)
 {
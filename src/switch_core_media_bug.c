@@ -995,6 +995,9 @@ SWITCH_DECLARE(switch_status_t) switch_core_media_bug_add(switch_core_session_t
 	switch_thread_rwlock_unlock(session->bug_rwlock);
 	*new_bug = bug;
 
+	/* a relayed call never reaches the bug, put both directions back on the normal media path */
+	switch_core_media_relay_suspend(session);
+
 	if (tap_only) {
 		switch_set_flag(session, SSF_MEDIA_BUG_TAP_ONLY);
 	} else {
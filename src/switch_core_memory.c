@@ -58,8 +58,283 @@ static struct {
 	switch_queue_t *pool_recycle_queue;
 	switch_memory_pool_t *memory_pool;
 	int pool_thread_running;
+	switch_mutex_t *acct_mutex;
+	/* threads between reading acct_mutex and releasing it, shutdown waits for them */
+	switch_atomic_t acct_users;
+	switch_hash_t *acct_tags;
 } memory_manager;
 
+/* Pools are accounted to the source file that created them. Pool counts are always kept;
+   the bytes handed out from each pool are only counted with memory-accounting enabled
+   since that costs a userdata lookup on every allocation. */
+typedef struct pool_acct_s pool_acct_t;
+
+typedef struct {
+	const char *name;
+	uint32_t pools;
+	uint32_t pools_peak;
+	uint64_t pools_total;
+	uint64_t largest_pool;
+	volatile uint64_t bytes;
+	uint64_t bytes_peak;
+	pool_acct_t *live;
+} memory_tag_t;
+
+struct pool_acct_s {
+	memory_tag_t *tag;
+	volatile uint64_t bytes;
+	pool_acct_t *prev;
+	pool_acct_t *next;
+};
+
+#define POOL_ACCT_KEY "_switch_pool_acct_"
+
+/* Take the accounting mutex, or return NULL once accounting has been shut down.
+   The mutex is read under the user count so shutdown cannot free it underneath us. */
+static switch_mutex_t *pool_acct_lock(void)
+{
+	switch_mutex_t *mutex;
+
+	switch_atomic_inc(&memory_manager.acct_users);
+
+	if ((mutex = memory_manager.acct_mutex)) {
+		switch_mutex_lock(mutex);
+	} else {
+		switch_atomic_dec(&memory_manager.acct_users);
+	}
+
+	return mutex;
+}
+
+static void pool_acct_unlock(switch_mutex_t *mutex)
+{
+	switch_mutex_unlock(mutex);
+	switch_atomic_dec(&memory_manager.acct_users);
+}
+
+/* byte counters are 64 bit, a busy tag can hand out more than 4GiB over its pools' lifetime */
+static inline uint64_t pool_acct_bytes_add(volatile uint64_t *mem, uint64_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_add_fetch(mem, val, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+	return (uint64_t) InterlockedExchangeAdd64((volatile LONG64 *) mem, (LONG64) val) + val;
+#else
+	switch_mutex_t *mutex;
+	uint64_t r;
+
+	if (!(mutex = pool_acct_lock())) {
+		return *mem;
+	}
+	r = (*mem += val);
+	pool_acct_unlock(mutex);
+
+	return r;
+#endif
+}
+
+static inline uint64_t pool_acct_bytes_read(volatile uint64_t *mem)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(mem, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+	return (uint64_t) InterlockedCompareExchange64((volatile LONG64 *) mem, 0, 0);
+#else
+	return pool_acct_bytes_add(mem, 0);
+#endif
+}
+
+static apr_status_t pool_acct_cleanup(void *data)
+{
+	pool_acct_t *acct = (pool_acct_t *) data;
+	memory_tag_t *tag = acct->tag;
+	switch_mutex_t *mutex;
+	uint64_t bytes;
+
+	if (!(mutex = pool_acct_lock())) {
+		return APR_SUCCESS;
+	}
+
+	if (acct->prev) {
+		acct->prev->next = acct->next;
+	} else {
+		tag->live = acct->next;
+	}
+	if (acct->next) {
+		acct->next->prev = acct->prev;
+	}
+	bytes = pool_acct_bytes_read(&acct->bytes);
+	if (bytes > tag->largest_pool) {
+		tag->largest_pool = bytes;
+	}
+	pool_acct_bytes_add(&tag->bytes, 0 - bytes);
+	tag->pools--;
+	pool_acct_unlock(mutex);
+
+	return APR_SUCCESS;
+}
+
+/* Hook a pool into its tag's live list, created is false when a cleared pool is put back in use */
+static void pool_acct_attach(switch_memory_pool_t *pool, memory_tag_t *tag, switch_bool_t created)
+{
+	pool_acct_t *acct;
+	switch_mutex_t *mutex;
+
+	if (!(mutex = pool_acct_lock())) {
+		return;
+	}
+
+	acct = apr_pcalloc(pool, sizeof(*acct));
+	acct->tag = tag;
+	acct->next = tag->live;
+	if (tag->live) {
+		tag->live->prev = acct;
+	}
+	tag->live = acct;
+
+	if (created) {
+		tag->pools_total++;
+	}
+	if (++tag->pools > tag->pools_peak) {
+		tag->pools_peak = tag->pools;
+	}
+	pool_acct_unlock(mutex);
+
+	apr_pool_userdata_setn(acct, POOL_ACCT_KEY, NULL, pool);
+	apr_pool_cleanup_register(pool, acct, pool_acct_cleanup, apr_pool_cleanup_null);
+}
+
+static void pool_acct_track(switch_memory_pool_t *pool, const char *file)
+{
+	memory_tag_t *tag;
+	const char *name;
+	switch_mutex_t *mutex;
+
+	if (!file) {
+		return;
+	}
+
+	if ((name = strrchr(file, '/')) || (name = strrchr(file, '\\'))) {
+		name++;
+	} else {
+		name = file;
+	}
+
+	if (!(mutex = pool_acct_lock())) {
+		return;
+	}
+
+	if (!(tag = switch_core_hash_find(memory_manager.acct_tags, name))) {
+		tag = apr_pcalloc(memory_manager.memory_pool, sizeof(*tag));
+		tag->name = apr_pstrdup(memory_manager.memory_pool, name);
+		switch_core_hash_insert(memory_manager.acct_tags, tag->name, tag);
+	}
+	pool_acct_unlock(mutex);
+
+	pool_acct_attach(pool, tag, SWITCH_TRUE);
+}
+
+static memory_tag_t *pool_acct_tag(switch_memory_pool_t *pool)
+{
+	void *acct = NULL;
+
+	if (memory_manager.acct_mutex && apr_pool_userdata_get(&acct, POOL_ACCT_KEY, pool) == APR_SUCCESS && acct) {
+		return ((pool_acct_t *) acct)->tag;
+	}
+
+	return NULL;
+}
+
+static inline void pool_acct_add(switch_memory_pool_t *pool, switch_size_t bytes)
+{
+	void *data = NULL;
+
+	if (!runtime.memory_accounting) {
+		return;
+	}
+
+	if (apr_pool_userdata_get(&data, POOL_ACCT_KEY, pool) == APR_SUCCESS && data) {
+		pool_acct_t *acct = (pool_acct_t *) data;
+		memory_tag_t *tag = acct->tag;
+		uint64_t live;
+
+		/* pools such as a session's are allocated from by several threads */
+		pool_acct_bytes_add(&acct->bytes, bytes);
+		live = pool_acct_bytes_add(&tag->bytes, bytes);
+
+		/* only take the lock when this may be a new peak */
+		if (live > tag->bytes_peak) {
+			switch_mutex_t *mutex;
+
+			if ((mutex = pool_acct_lock())) {
+				if (live > tag->bytes_peak) {
+					tag->bytes_peak = live;
+				}
+				pool_acct_unlock(mutex);
+			}
+		}
+	}
+}
+
+static apr_status_t pool_acct_shutdown(void *data)
+{
+	switch_mutex_t *mutex = memory_manager.acct_mutex;
+
+	if (mutex) {
+		switch_atomic_casptr((volatile void **) &memory_manager.acct_mutex, NULL, mutex);
+
+		/* anyone who read the mutex before it was cleared still holds or waits for it */
+		while (switch_atomic_read(&memory_manager.acct_users)) {
+			switch_yield(1000);
+		}
+
+		switch_core_hash_destroy(&memory_manager.acct_tags);
+	}
+
+	return APR_SUCCESS;
+}
+
+static void pool_acct_report(switch_stream_handle_t *stream)
+{
+	switch_hash_index_t *hi;
+	const void *var;
+	void *val;
+	switch_mutex_t *mutex;
+
+	if (!(mutex = pool_acct_lock())) {
+		return;
+	}
+
+	stream->write_function(stream, "%-32s %8s %8s %12s %14s %14s %14s\n", "tag", "pools", "peak", "created", "live_bytes", "peak_bytes", "largest_pool");
+
+	for (hi = switch_core_hash_first(memory_manager.acct_tags); hi; hi = switch_core_hash_next(&hi)) {
+		memory_tag_t *tag;
+		pool_acct_t *acct;
+		uint64_t live = 0, largest;
+
+		switch_core_hash_this(hi, &var, NULL, &val);
+		tag = (memory_tag_t *) val;
+		largest = tag->largest_pool;
+
+		for (acct = tag->live; acct; acct = acct->next) {
+			uint64_t bytes = pool_acct_bytes_read(&acct->bytes);
+
+			live += bytes;
+			if (bytes > largest) {
+				largest = bytes;
+			}
+		}
+
+		stream->write_function(stream, "%-32s %8u %8u %12" SWITCH_UINT64_T_FMT " %14" SWITCH_UINT64_T_FMT " %14" SWITCH_UINT64_T_FMT " %14" SWITCH_UINT64_T_FMT "\n",
+							   tag->name, tag->pools, tag->pools_peak, tag->pools_total, live, tag->bytes_peak, largest);
+	}
+	pool_acct_unlock(mutex);
+
+	if (!runtime.memory_accounting) {
+		stream->write_function(stream, "byte counts need memory-accounting enabled in switch.conf\n");
+	}
+}
+
 SWITCH_DECLARE(switch_memory_pool_t *) switch_core_session_get_pool(switch_core_session_t *session)
 {
 	switch_assert(session != NULL);
@@ -96,6 +371,7 @@ SWITCH_DECLARE(void *) switch_core_perform_session_alloc(switch_core_session_t *
 	switch_assert(ptr != NULL);
 
 	memset(ptr, 0, memory);
+	pool_acct_add(session->pool, memory);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -207,6 +483,7 @@ SWITCH_DECLARE(char *) switch_core_vsprintf(switch_memory_pool_t *pool, const ch
 
 	result = apr_pvsprintf(pool, fmt, ap);
 	switch_assert(result != NULL);
+	pool_acct_add(pool, strlen(result) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -262,6 +539,7 @@ SWITCH_DECLARE(char *) switch_core_perform_session_strdup(switch_core_session_t
 
 	duped = apr_pstrdup(session->pool, todup);
 	switch_assert(duped != NULL);
+	pool_acct_add(session->pool, strlen(duped) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -303,6 +581,7 @@ SWITCH_DECLARE(char *) switch_core_perform_strndup(switch_memory_pool_t *pool, c
 
 	duped = apr_pstrmemdup(pool, todup, len);
 	switch_assert(duped != NULL);
+	pool_acct_add(pool, len);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -334,6 +613,8 @@ SWITCH_DECLARE(void) switch_core_memory_pool_tag(switch_memory_pool_t *pool, con
 
 SWITCH_DECLARE(void) switch_pool_clear(switch_memory_pool_t *p)
 {
+	/* clearing runs the accounting cleanup, the pool stays in use so count it again under the same tag */
+	memory_tag_t *tag = pool_acct_tag(p);
 #ifdef PER_POOL_LOCK
 	apr_thread_mutex_t *my_mutex;
 	apr_pool_mutex_set(p, NULL);
@@ -351,6 +632,9 @@ SWITCH_DECLARE(void) switch_pool_clear(switch_memory_pool_t *p)
 
 #endif
 
+	if (tag) {
+		pool_acct_attach(p, tag, SWITCH_FALSE);
+	}
 }
 
 #if APR_POOL_DEBUG
@@ -378,13 +662,19 @@ SWITCH_DECLARE(void) switch_core_pool_stats(switch_stream_handle_t *stream)
 	if (runtime.memory_pool) {
 		apr_pool_walk_tree_debug(runtime.memory_pool, switch_core_pool_stats_callback, (void *)stream);
 	}
-#else
+#endif
 	if (stream) {
-		stream->write_function(stream, "Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug");
+		pool_acct_report(stream);
+		switch_frame_buffer_stats(stream);
 	} else {
-		printf("Unable to get core pool statictics. Please rebuild FreeSWITCH with --enable-pool-debug");
+		switch_stream_handle_t mystream = { 0 };
+
+		SWITCH_STANDARD_STREAM(mystream);
+		pool_acct_report(&mystream);
+		switch_frame_buffer_stats(&mystream);
+		printf("%s", (char *) mystream.data);
+		switch_safe_free(mystream.data);
 	}
-#endif
 }
 
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memory_pool_t **pool, const char *file, const char *func, int line)
@@ -445,6 +735,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 	tmp = switch_core_sprintf(*pool, "%s:%d", file, line);
 	apr_pool_tag(*pool, tmp);
 
+	pool_acct_track(*pool, file);
+
 #if APR_POOL_DEBUG
 	apr_pool_userdata_set(tmp, "line", NULL, *pool);
 #endif
@@ -524,6 +816,7 @@ SWITCH_DECLARE(void *) switch_core_perform_alloc(switch_memory_pool_t *pool, swi
 #endif
 	switch_assert(ptr != NULL);
 	memset(ptr, 0, memory);
+	pool_acct_add(pool, memory);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -709,6 +1002,11 @@ switch_memory_pool_t *switch_core_memory_init(void)
 	switch_mutex_init(&memory_manager.mem_lock, SWITCH_MUTEX_NESTED, memory_manager.memory_pool);
 #endif
 
+	switch_mutex_init(&memory_manager.acct_mutex, SWITCH_MUTEX_NESTED, memory_manager.memory_pool);
+	switch_core_hash_init(&memory_manager.acct_tags);
+	/* registered after the mutex so it runs before the mutex goes away with the core pool */
+	apr_pool_cleanup_register(memory_manager.memory_pool, NULL, pool_acct_shutdown, apr_pool_cleanup_null);
+
 #ifdef INSTANTLY_DESTROY_POOLS
 	{
 		void *foo;
@@ -1017,6 +1017,18 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_pass_indication(switch_core_
 	return status;
 }
 
+/* The session loop polls every one of its queues on each pass and they are empty nearly all the time.
+   Looking at the element count first keeps those polls from taking the queue mutex; a push that races
+   with the unlocked read is always followed by a wakeup, so the item is picked up on the next pass. */
+static inline switch_status_t session_queue_trypop(switch_queue_t *queue, void **pop)
+{
+	if (!switch_queue_size(queue)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return switch_queue_trypop(queue, pop);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_session_queue_indication(switch_core_session_t *session, switch_core_session_message_types_t indication)
 {
 	switch_core_session_message_t *msg;
@@ -1083,7 +1095,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_message(switch_core_
 	switch_assert(session != NULL);
 
 	if (session->message_queue) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) session_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*message = (switch_core_session_message_t *) pop;
 			if ((*message)->delivery_time && (*message)->delivery_time > switch_epoch_time_now(NULL)) {
 				switch_core_session_queue_message(session, *message);
@@ -1106,7 +1118,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_flush_message(switch_core_se
 
 
 	if (session->message_queue) {
-		while ((status = (switch_status_t) switch_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) session_queue_trypop(session->message_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			message = (switch_core_session_message_t *) pop;
 			switch_ivr_process_indications(session, message);
 			switch_core_session_free_message(&message);
@@ -1144,7 +1156,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_signal_data(switch_c
 	switch_assert(session != NULL);
 
 	if (session->signal_data_queue) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->signal_data_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) session_queue_trypop(session->signal_data_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*signal_data = pop;
 		}
 	}
@@ -1223,6 +1235,36 @@ SWITCH_DECLARE(uint32_t) switch_core_session_messages_waiting(switch_core_sessio
 	return x;
 }
 
+/* called by the session thread with session->mutex held once it runs again after sleeping */
+void switch_core_session_account_wake(switch_core_session_t *session)
+{
+	switch_time_t latency;
+
+	if (!session->wake_time) {
+		return;
+	}
+
+	latency = switch_time_ref() - session->wake_time;
+	session->wake_time = 0;
+
+	switch_mutex_lock(session_manager.mutex);
+	session_manager.wakes++;
+	session_manager.wake_latency_total += latency;
+	if (latency > session_manager.wake_latency_max) {
+		session_manager.wake_latency_max = latency;
+	}
+	switch_mutex_unlock(session_manager.mutex);
+}
+
+SWITCH_DECLARE(void) switch_core_session_wake_stats(uint32_t *wakes, switch_time_t *avg, switch_time_t *max)
+{
+	switch_mutex_lock(session_manager.mutex);
+	*wakes = session_manager.wakes;
+	*avg = session_manager.wakes ? session_manager.wake_latency_total / session_manager.wakes : 0;
+	*max = session_manager.wake_latency_max;
+	switch_mutex_unlock(session_manager.mutex);
+}
+
 SWITCH_DECLARE(uint32_t) switch_core_session_event_count(switch_core_session_t *session)
 {
 	if (session->event_queue) {
@@ -1240,7 +1282,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_event(switch_core_se
 	switch_assert(session != NULL);
 
 	if (session->event_queue && (force || !switch_channel_test_flag(session->channel, CF_DIVERT_EVENTS))) {
-		if ((status = (switch_status_t) switch_queue_trypop(session->event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) session_queue_trypop(session->event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*event = (switch_event_t *) pop;
 		}
 	}
@@ -1323,7 +1365,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_dequeue_private_event(switch
 			}
 		}
 
-		if ((status = (switch_status_t) switch_queue_trypop(queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		if ((status = (switch_status_t) session_queue_trypop(queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			*event = (switch_event_t *) pop;
 		} else {
 			check_media(session);
@@ -1340,14 +1382,14 @@ SWITCH_DECLARE(uint32_t) switch_core_session_flush_private_events(switch_core_se
 	void *pop;
 
 	if (session->private_event_queue) {
-		while ((status = (switch_status_t) switch_queue_trypop(session->private_event_queue_pri, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) session_queue_trypop(session->private_event_queue_pri, &pop)) == SWITCH_STATUS_SUCCESS) {
 			if (pop) {
 				switch_event_t *event = (switch_event_t *) pop;
 				switch_event_destroy(&event);
 			}
 			x++;
 		}
-		while ((status = (switch_status_t) switch_queue_trypop(session->private_event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
+		while ((status = (switch_status_t) session_queue_trypop(session->private_event_queue, &pop)) == SWITCH_STATUS_SUCCESS) {
 			if (pop) {
 				switch_event_t *event = (switch_event_t *) pop;
 				switch_event_destroy(&event);
@@ -1435,6 +1477,9 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_wake_session_thread(switch_c
 	status = switch_mutex_trylock(session->mutex);
 
 	if (status == SWITCH_STATUS_SUCCESS) {
+		if (!session->wake_time && switch_channel_test_flag(session->channel, CF_THREAD_SLEEPING)) {
+			session->wake_time = switch_time_ref();
+		}
 		switch_thread_cond_signal(session->cond);
 		switch_mutex_unlock(session->mutex);
 	} else {
@@ -1562,6 +1607,8 @@ SWITCH_DECLARE(void) switch_core_session_perform_destroy(switch_core_session_t *
 		(*session)->plc = NULL;
 	}
 
+	switch_safe_free((*session)->recovery_metadata);
+
 	if (switch_event_create(&event, SWITCH_EVENT_CHANNEL_DESTROY) == SWITCH_STATUS_SUCCESS) {
 		switch_channel_event_set_data((*session)->channel, event);
 		switch_event_fire(&event);
@@ -2422,6 +2469,7 @@ SWITCH_DECLARE(switch_core_session_t *) switch_core_session_request_uuid(switch_
 	switch_mutex_init(&session->video_codec_read_mutex, SWITCH_MUTEX_NESTED, session->pool);
 	switch_mutex_init(&session->video_codec_write_mutex, SWITCH_MUTEX_NESTED, session->pool);
 	switch_mutex_init(&session->frame_read_mutex, SWITCH_MUTEX_NESTED, session->pool);
+	switch_mutex_init(&session->recovery_mutex, SWITCH_MUTEX_NESTED, session->pool);
 	switch_thread_rwlock_create(&session->bug_rwlock, session->pool);
 	switch_thread_cond_create(&session->cond, session->pool);
 	switch_thread_rwlock_create(&session->rwlock, session->pool);
@@ -39,6 +39,7 @@
 
 #define SWITCH_SQL_QUEUE_LEN 100000
 #define SWITCH_SQL_QUEUE_PAUSE_LEN 90000
+#define SWITCH_SQL_QUEUE_MAX_WRITERS 32
 
 struct switch_cache_db_handle {
 	char name[CACHE_DB_LEN];
@@ -55,9 +56,27 @@ struct switch_cache_db_handle {
 	char last_user[CACHE_DB_LEN];
 	uint32_t use_count;
 	uint64_t total_used_count;
+	switch_hash_t *stmt_hash;
+	uint32_t stmt_count;
+	uint64_t stmt_tick;
 	struct switch_cache_db_handle *next;
 };
 
+struct switch_cache_db_stmt {
+	switch_cache_db_handle_t *dbh;
+	char *sql;
+	int param_count;
+	/* native statement, core db only */
+	switch_core_db_stmt_t *core_stmt;
+	/* statement kept prepared on the server, ODBC only */
+	switch_odbc_prepared_t odbc_prepared;
+	/* bound value of each parameter for the other backends, NULL binds SQL NULL */
+	char **params;
+	switch_bool_t *param_is_int;
+	uint64_t exec_count;
+	uint64_t last_used;
+};
+
 static struct {
 	switch_memory_pool_t *memory_pool;
 	switch_thread_t *db_thread;
@@ -72,6 +91,8 @@ static struct {
 	switch_cache_db_handle_t *dbh;
 	switch_sql_queue_manager_t *qm;
 	int paused;
+	switch_mutex_t *key_mutex;
+	switch_hash_t *call_keys;
 } sql_manager;
 
 
@@ -260,6 +281,72 @@ SWITCH_DECLARE(switch_status_t) _switch_core_db_handle(switch_cache_db_handle_t
 #define SQL_REG_TIMEOUT 15
 
 
+/* statements kept per idle handle, the least recently used ones are finalized when the handle is released */
+#define SQL_STMT_CACHE_MAX 64
+
+static void stmt_free(switch_cache_db_stmt_t *stmt)
+{
+	int i;
+
+	if (stmt->core_stmt) {
+		switch_core_db_finalize(stmt->core_stmt);
+		stmt->core_stmt = NULL;
+	}
+
+	if (stmt->dbh->type == SCDB_TYPE_ODBC) {
+		switch_odbc_prepared_free(stmt->dbh->native_handle.odbc_dbh, &stmt->odbc_prepared);
+	}
+
+	for (i = 0; stmt->params && i < stmt->param_count; i++) {
+		switch_safe_free(stmt->params[i]);
+	}
+
+	switch_safe_free(stmt->params);
+	switch_safe_free(stmt->param_is_int);
+	switch_safe_free(stmt->sql);
+	free(stmt);
+}
+
+static void stmt_hash_evict(switch_cache_db_handle_t *dbh)
+{
+	switch_hash_index_t *hi;
+	switch_cache_db_stmt_t *stmt, *oldest = NULL;
+	void *val;
+
+	for (hi = switch_core_hash_first(dbh->stmt_hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		stmt = (switch_cache_db_stmt_t *) val;
+
+		if (!oldest || stmt->last_used < oldest->last_used) {
+			oldest = stmt;
+		}
+	}
+
+	if (oldest) {
+		switch_core_hash_delete(dbh->stmt_hash, oldest->sql);
+		dbh->stmt_count--;
+		stmt_free(oldest);
+	}
+}
+
+static void stmt_hash_destroy(switch_cache_db_handle_t *dbh)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!dbh->stmt_hash) {
+		return;
+	}
+
+	for (hi = switch_core_hash_first(dbh->stmt_hash); hi; hi = switch_core_hash_next(&hi)) {
+		switch_core_hash_this(hi, NULL, NULL, &val);
+		stmt_free((switch_cache_db_stmt_t *) val);
+	}
+
+	switch_core_hash_destroy(&dbh->stmt_hash);
+	dbh->stmt_count = 0;
+}
+
 static void sql_close(time_t prune)
 {
 	switch_cache_db_handle_t *dbh = NULL;
@@ -284,6 +371,8 @@ static void sql_close(time_t prune)
 		if (switch_mutex_trylock(dbh->mutex) == SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG10, "Dropping idle DB connection %s\n", dbh->name);
 
+			stmt_hash_destroy(dbh);
+
 			switch (dbh->type) {
 				case SCDB_TYPE_DATABASE_INTERFACE:
 				{
@@ -369,6 +458,12 @@ SWITCH_DECLARE(void) switch_cache_db_release_db_handle(switch_cache_db_handle_t
 		if ((*dbh)->use_count) {
 			--(*dbh)->use_count;
 		}
+
+		/* statements stay valid while the handle is held, trim the cache once nobody holds it */
+		while (!(*dbh)->use_count && (*dbh)->stmt_count > SQL_STMT_CACHE_MAX) {
+			stmt_hash_evict(*dbh);
+		}
+
 		switch_mutex_unlock((*dbh)->mutex);
 		sql_manager.total_used_handles--;
 		*dbh = NULL;
@@ -1446,6 +1541,370 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_sql_callback_err(switch_
 	return status;
 }
 
+static int count_sql_params(const char *sql)
+{
+	const char *p;
+	char quote = 0;
+	int count = 0;
+
+	for (p = sql; *p; p++) {
+		if (quote) {
+			if (*p == quote) quote = 0;
+		} else if (*p == '\'' || *p == '"') {
+			quote = *p;
+		} else if (*p == '?') {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static switch_status_t stmt_core_prepare(switch_cache_db_stmt_t *stmt)
+{
+	switch_cache_db_handle_t *dbh = stmt->dbh;
+
+	if (switch_core_db_prepare_v2(dbh->native_handle.core_db_dbh->handle, stmt->sql, -1, &stmt->core_stmt, NULL) != SWITCH_CORE_DB_OK) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] NATIVE SQL PREPARE ERR [%s]\n%s\n", dbh->name,
+						  switch_core_db_errmsg(dbh->native_handle.core_db_dbh->handle), stmt->sql);
+		stmt->core_stmt = NULL;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_prepare(switch_cache_db_handle_t *dbh, const char *sql, switch_cache_db_stmt_t **stmtP)
+{
+	switch_cache_db_stmt_t *stmt;
+
+	switch_assert(stmtP);
+	*stmtP = NULL;
+
+	if (zstr(sql)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!dbh->stmt_hash) {
+		switch_core_hash_init(&dbh->stmt_hash);
+	}
+
+	if ((stmt = switch_core_hash_find(dbh->stmt_hash, sql))) {
+		stmt->last_used = ++dbh->stmt_tick;
+		*stmtP = stmt;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	switch_zmalloc(stmt, sizeof(*stmt));
+	stmt->dbh = dbh;
+	stmt->sql = strdup(sql);
+	stmt->param_count = count_sql_params(sql);
+
+	if (dbh->type == SCDB_TYPE_CORE_DB) {
+		if (stmt_core_prepare(stmt) != SWITCH_STATUS_SUCCESS) {
+			stmt_free(stmt);
+			return SWITCH_STATUS_FALSE;
+		}
+	} else if (stmt->param_count) {
+		stmt->params = calloc(stmt->param_count, sizeof(char *));
+		stmt->param_is_int = calloc(stmt->param_count, sizeof(switch_bool_t));
+		switch_assert(stmt->params && stmt->param_is_int);
+	}
+
+	stmt->last_used = ++dbh->stmt_tick;
+	switch_core_hash_insert(dbh->stmt_hash, stmt->sql, stmt);
+	dbh->stmt_count++;
+	*stmtP = stmt;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t stmt_set_param(switch_cache_db_stmt_t *stmt, int idx, char *value, switch_bool_t is_int)
+{
+	if (idx < 1 || idx > stmt->param_count) {
+		switch_safe_free(value);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_safe_free(stmt->params[idx - 1]);
+	stmt->params[idx - 1] = value;
+	stmt->param_is_int[idx - 1] = is_int;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_text(switch_cache_db_stmt_t *stmt, int idx, const char *value)
+{
+	if (!value) {
+		return switch_cache_db_stmt_bind_null(stmt, idx);
+	}
+
+	if (stmt->core_stmt) {
+		return switch_core_db_bind_text(stmt->core_stmt, idx, value, -1, SWITCH_CORE_DB_TRANSIENT) == SWITCH_CORE_DB_OK ?
+			SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	}
+
+	return stmt_set_param(stmt, idx, strdup(value), SWITCH_FALSE);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_int(switch_cache_db_stmt_t *stmt, int idx, int64_t value)
+{
+	if (stmt->core_stmt) {
+		return switch_core_db_bind_int64(stmt->core_stmt, idx, value) == SWITCH_CORE_DB_OK ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	}
+
+	return stmt_set_param(stmt, idx, switch_mprintf("%" SWITCH_INT64_T_FMT, value), SWITCH_TRUE);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_bind_null(switch_cache_db_stmt_t *stmt, int idx)
+{
+	if (stmt->core_stmt) {
+		return switch_core_db_bind_null(stmt->core_stmt, idx) == SWITCH_CORE_DB_OK ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	}
+
+	return stmt_set_param(stmt, idx, NULL, SWITCH_FALSE);
+}
+
+/* substitute quoted literals for the placeholders, for the database interfaces without parameter binding */
+static char *stmt_render(switch_cache_db_stmt_t *stmt)
+{
+	switch_stream_handle_t stream = { 0 };
+	const char *p, *s;
+	char quote = 0;
+	int idx = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+
+	for (p = s = stmt->sql; *p; p++) {
+		if (quote) {
+			if (*p == quote) quote = 0;
+		} else if (*p == '\'' || *p == '"') {
+			quote = *p;
+		} else if (*p == '?') {
+			stream.write_function(&stream, "%.*s", (int)(p - s), s);
+
+			if (!stmt->params[idx]) {
+				stream.write_function(&stream, "NULL");
+			} else if (stmt->param_is_int[idx]) {
+				stream.write_function(&stream, "%s", stmt->params[idx]);
+			} else {
+				char *lit = switch_mprintf("'%q'", stmt->params[idx]);
+				stream.write_function(&stream, "%s", lit);
+				switch_safe_free(lit);
+			}
+
+			s = p + 1;
+			idx++;
+		}
+	}
+
+	stream.write_function(&stream, "%s", s);
+
+	return (char *) stream.data;
+}
+
+static switch_status_t stmt_core_execute(switch_cache_db_stmt_t *stmt, switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	switch_cache_db_handle_t *dbh = stmt->dbh;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	int running = 1;
+	int sane = 300;
+	int ret;
+
+	while (running) {
+		ret = switch_core_db_step(stmt->core_stmt);
+
+		if (ret == SWITCH_CORE_DB_ROW) {
+			int i, argc;
+			char **argv, **names;
+
+			if (!callback) {
+				continue;
+			}
+
+			argc = switch_core_db_column_count(stmt->core_stmt);
+			argv = malloc(sizeof(char *) * argc * 2);
+			switch_assert(argv);
+			names = argv + argc;
+
+			for (i = 0; i < argc; i++) {
+				argv[i] = (char *) switch_core_db_column_text(stmt->core_stmt, i);
+				names[i] = (char *) switch_core_db_column_name(stmt->core_stmt, i);
+			}
+
+			if (callback(pdata, argc, argv, names)) {
+				running = 0;
+			}
+
+			free(argv);
+		} else if ((ret == SWITCH_CORE_DB_BUSY || ret == SWITCH_CORE_DB_LOCKED) && --sane > 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "SQLite is %s, sane=%d [%s]\n",
+							  (ret == SWITCH_CORE_DB_BUSY ? "BUSY" : "LOCKED"), sane, stmt->sql);
+			switch_yield(100000);
+		} else if (ret == SWITCH_CORE_DB_DONE) {
+			running = 0;
+		} else {
+			if (err) {
+				*err = strdup(switch_str_nil(switch_core_db_errmsg(dbh->native_handle.core_db_dbh->handle)));
+			}
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "[%s] NATIVE SQL ERR [%s]\n%s\n", dbh->name,
+							  switch_core_db_errmsg(dbh->native_handle.core_db_dbh->handle), stmt->sql);
+			status = SWITCH_STATUS_FALSE;
+			running = 0;
+		}
+	}
+
+	switch_core_db_reset(stmt->core_stmt);
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_stmt_execute(switch_cache_db_stmt_t *stmt, switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	switch_cache_db_handle_t *dbh = stmt->dbh;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	switch (dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		if (stmt->core_stmt) {
+			status = stmt_core_execute(stmt, callback, pdata, err);
+		}
+		break;
+	case SCDB_TYPE_ODBC:
+		if (switch_odbc_handle_exec_params(dbh->native_handle.odbc_dbh, &stmt->odbc_prepared, stmt->sql, stmt->param_count, stmt->params, stmt->param_is_int,
+										   callback, pdata, err) == SWITCH_ODBC_SUCCESS) {
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		break;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		{
+			switch_database_interface_t *database_interface = dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+			char *sql;
+
+			if (database_interface->exec_params_detailed) {
+				status = database_interface->exec_params_detailed(__FILE__, (char *)__SWITCH_FUNC__, __LINE__, dbh->native_handle.database_interface_dbh,
+																  stmt->sql, stmt->param_count, stmt->params, callback, pdata, err);
+				break;
+			}
+
+			sql = stmt_render(stmt);
+
+			if (callback) {
+				status = switch_cache_db_execute_sql_callback(dbh, sql, callback, pdata, err);
+			} else {
+				status = switch_cache_db_execute_sql_real(dbh, sql, err);
+			}
+
+			switch_safe_free(sql);
+		}
+		break;
+	}
+
+	stmt->exec_count++;
+
+	if (io_mutex) switch_mutex_unlock(io_mutex);
+
+	return status;
+}
+
+static switch_status_t batch_begin(switch_cache_db_handle_t *dbh, char **err)
+{
+	switch (dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		return switch_cache_db_execute_sql_real(dbh, "BEGIN", err);
+	case SCDB_TYPE_ODBC:
+		return switch_odbc_SQLSetAutoCommitAttr(dbh->native_handle.odbc_dbh, 0) == SWITCH_ODBC_SUCCESS ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		{
+			switch_database_interface_t *database_interface = dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+			return database_interface->sql_set_auto_commit_attr(dbh->native_handle.database_interface_dbh, 0);
+		}
+	}
+
+	return SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t batch_end(switch_cache_db_handle_t *dbh, switch_bool_t commit)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch (dbh->type) {
+	case SCDB_TYPE_CORE_DB:
+		status = switch_cache_db_execute_sql_real(dbh, commit ? "COMMIT" : "ROLLBACK", NULL);
+		break;
+	case SCDB_TYPE_ODBC:
+		if (switch_odbc_SQLEndTran(dbh->native_handle.odbc_dbh, commit) == SWITCH_ODBC_SUCCESS) {
+			status = SWITCH_STATUS_SUCCESS;
+		}
+		switch_odbc_SQLSetAutoCommitAttr(dbh->native_handle.odbc_dbh, 1);
+		break;
+	case SCDB_TYPE_DATABASE_INTERFACE:
+		{
+			switch_database_interface_t *database_interface = dbh->native_handle.database_interface_dbh->connection_options.database_interface;
+
+			if (commit) {
+				status = database_interface->commit(dbh->native_handle.database_interface_dbh);
+			} else {
+				status = database_interface->rollback(dbh->native_handle.database_interface_dbh);
+			}
+		}
+		break;
+	}
+
+	return status;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_execute_batch(switch_cache_db_handle_t *dbh, const char *sql,
+															  const char **values, uint32_t rows, char **err)
+{
+	switch_cache_db_stmt_t *stmt = NULL;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+	uint32_t row;
+	int i;
+
+	if (err) {
+		*err = NULL;
+	}
+
+	if (switch_cache_db_prepare(dbh, sql, &stmt) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	if (batch_begin(dbh, err) != SWITCH_STATUS_SUCCESS) {
+		if (io_mutex) switch_mutex_unlock(io_mutex);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	for (row = 0; row < rows && status == SWITCH_STATUS_SUCCESS; row++) {
+		const char **row_values = values + (row * stmt->param_count);
+
+		for (i = 0; i < stmt->param_count; i++) {
+			switch_cache_db_stmt_bind_text(stmt, i + 1, row_values[i]);
+		}
+
+		status = switch_cache_db_stmt_execute(stmt, NULL, NULL, err);
+	}
+
+	if (batch_end(dbh, status == SWITCH_STATUS_SUCCESS) != SWITCH_STATUS_SUCCESS) {
+		status = SWITCH_STATUS_FALSE;
+	}
+
+	if (io_mutex) switch_mutex_unlock(io_mutex);
+
+	return status;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_cache_db_create_schema(switch_cache_db_handle_t *dbh, char *sql, char **err)
 {
 	switch_status_t r = SWITCH_STATUS_SUCCESS;
@@ -1607,20 +2066,42 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_db_thread(switch_thread_t *threa
 
 static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread, void *obj);
 
-struct switch_sql_queue_manager {
-	const char *name;
+/* one writer thread with its own db handle and its own set of priority queues */
+typedef struct sql_qm_shard_s {
+	switch_sql_queue_manager_t *qm;
+	uint32_t id;
 	switch_cache_db_handle_t *event_db;
 	switch_queue_t **sql_queue;
 	uint32_t *pre_written;
 	uint32_t *written;
-	uint32_t numq;
-	char *dsn;
 	switch_thread_t *thread;
 	int thread_running;
 	switch_thread_cond_t *cond;
 	switch_mutex_t *cond_mutex;
 	switch_mutex_t *cond2_mutex;
 	switch_mutex_t *mutex;
+	uint64_t total_written;
+	uint64_t dropped;
+	uint64_t pushed;
+	uint64_t popped;
+	int flush_wanted;
+	uint64_t trans_count;
+	switch_time_t trans_last;
+	switch_time_t trans_max;
+	switch_time_t trans_total;
+} sql_qm_shard_t;
+
+struct switch_sql_queue_manager {
+	const char *name;
+	sql_qm_shard_t *shards;
+	uint32_t writers;
+	uint32_t numq;
+	uint32_t queue_len;
+	switch_sql_queue_policy_t policy;
+	char *dsn;
+	int started;
+	switch_mutex_t *mutex;
+	switch_mutex_t *trans_mutex;
 	char *pre_trans_execute;
 	char *post_trans_execute;
 	char *inner_pre_trans_execute;
@@ -1631,22 +2112,22 @@ struct switch_sql_queue_manager {
 	uint8_t paused;
 };
 
-static int qm_wake(switch_sql_queue_manager_t *qm)
+static int qm_wake(sql_qm_shard_t *shard)
 {
 	switch_status_t status;
 	int tries = 0;
 
  top:
 
-	status = switch_mutex_trylock(qm->cond_mutex);
+	status = switch_mutex_trylock(shard->cond_mutex);
 
 	if (status == SWITCH_STATUS_SUCCESS) {
-		switch_thread_cond_signal(qm->cond);
-		switch_mutex_unlock(qm->cond_mutex);
+		switch_thread_cond_signal(shard->cond);
+		switch_mutex_unlock(shard->cond_mutex);
 		return 1;
 	} else {
-		if (switch_mutex_trylock(qm->cond2_mutex) == SWITCH_STATUS_SUCCESS) {
-			switch_mutex_unlock(qm->cond2_mutex);
+		if (switch_mutex_trylock(shard->cond2_mutex) == SWITCH_STATUS_SUCCESS) {
+			switch_mutex_unlock(shard->cond2_mutex);
 		} else {
 			if (++tries < 10) {
 				switch_cond_next();
@@ -1658,18 +2139,66 @@ static int qm_wake(switch_sql_queue_manager_t *qm)
 	return 0;
 }
 
-static uint32_t qm_ttl(switch_sql_queue_manager_t *qm)
+static void qm_wake_all(switch_sql_queue_manager_t *qm)
+{
+	uint32_t i;
+
+	for (i = 0; i < qm->writers; i++) {
+		qm_wake(&qm->shards[i]);
+	}
+}
+
+static uint32_t qm_ttl(sql_qm_shard_t *shard)
 {
 	uint32_t ttl = 0;
 	uint32_t i;
 
-	for (i = 0; i < qm->numq; i++) {
-		ttl += switch_queue_size(qm->sql_queue[i]);
+	for (i = 0; i < shard->qm->numq; i++) {
+		ttl += switch_queue_size(shard->sql_queue[i]);
 	}
 
 	return ttl;
 }
 
+static sql_qm_shard_t *qm_shard_by_key(switch_sql_queue_manager_t *qm, const char *key)
+{
+	switch_ssize_t klen = -1;
+
+	if (qm->writers < 2 || zstr(key)) {
+		return &qm->shards[0];
+	}
+
+	return &qm->shards[switch_ci_hashfunc_default(key, &klen) % qm->writers];
+}
+
+static void qm_create_shards(switch_sql_queue_manager_t *qm, uint32_t writers)
+{
+	uint32_t i, j;
+
+	qm->shards = switch_core_alloc(qm->pool, sizeof(sql_qm_shard_t) * writers);
+	qm->writers = writers;
+
+	for (i = 0; i < writers; i++) {
+		sql_qm_shard_t *shard = &qm->shards[i];
+
+		shard->qm = qm;
+		shard->id = i;
+
+		switch_mutex_init(&shard->cond_mutex, SWITCH_MUTEX_NESTED, qm->pool);
+		switch_mutex_init(&shard->cond2_mutex, SWITCH_MUTEX_NESTED, qm->pool);
+		switch_mutex_init(&shard->mutex, SWITCH_MUTEX_NESTED, qm->pool);
+		switch_thread_cond_create(&shard->cond, qm->pool);
+
+		shard->sql_queue = switch_core_alloc(qm->pool, sizeof(switch_queue_t *) * qm->numq);
+		shard->written = switch_core_alloc(qm->pool, sizeof(uint32_t) * qm->numq);
+		shard->pre_written = switch_core_alloc(qm->pool, sizeof(uint32_t) * qm->numq);
+
+		for (j = 0; j < qm->numq; j++) {
+			switch_queue_create(&shard->sql_queue[j], qm->queue_len, qm->pool);
+		}
+	}
+}
+
 struct db_job {
 	switch_sql_queue_manager_t *qm;
 	char *sql;
@@ -1799,24 +2328,34 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_execute_sql_event_callback_err(swi
 }
 
 
-static void do_flush(switch_sql_queue_manager_t *qm, int i, switch_cache_db_handle_t *dbh)
+static void do_flush(sql_qm_shard_t *shard, int i, switch_cache_db_handle_t *dbh)
 {
 	void *pop = NULL;
-	switch_queue_t *q = qm->sql_queue[i];
+	switch_queue_t *q = shard->sql_queue[i];
 
-	switch_mutex_lock(qm->mutex);
+	switch_mutex_lock(shard->mutex);
 	while (switch_queue_trypop(q, &pop) == SWITCH_STATUS_SUCCESS) {
 		if (pop) {
 			if (dbh) {
 				switch_cache_db_execute_sql(dbh, (char *) pop, NULL);
 			}
 			switch_safe_free(pop);
+			shard->popped++;
 		}
 	}
-	switch_mutex_unlock(qm->mutex);
+	switch_mutex_unlock(shard->mutex);
 
 }
 
+static void do_flush_shard(sql_qm_shard_t *shard, switch_cache_db_handle_t *dbh)
+{
+	uint32_t i;
+
+	for (i = 0; i < shard->qm->numq; i++) {
+		do_flush(shard, i, dbh);
+	}
+}
+
 
 SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t *qm)
 {
@@ -1824,7 +2363,7 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_resume(switch_sql_queue_manager_t
 	qm->paused = 0;
 	switch_mutex_unlock(qm->mutex);
 
-	qm_wake(qm);
+	qm_wake_all(qm);
 
 }
 
@@ -1837,8 +2376,8 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_pause(switch_sql_queue_manager_t *
 	switch_mutex_unlock(qm->mutex);
 
 	if (flush) {
-		for(i = 0; i < qm->numq; i++) {
-			do_flush(qm, i, NULL);
+		for (i = 0; i < qm->writers; i++) {
+			do_flush_shard(&qm->shards[i], NULL);
 		}
 	}
 
@@ -1847,12 +2386,15 @@ SWITCH_DECLARE(void) switch_sql_queue_manager_pause(switch_sql_queue_manager_t *
 SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm, uint32_t index)
 {
 	int size = 0;
+	uint32_t i;
 
-	switch_mutex_lock(qm->mutex);
 	if (index < qm->numq) {
-		size = switch_queue_size(qm->sql_queue[index]);
+		for (i = 0; i < qm->writers; i++) {
+			switch_mutex_lock(qm->shards[i].mutex);
+			size += switch_queue_size(qm->shards[i].sql_queue[index]);
+			switch_mutex_unlock(qm->shards[i].mutex);
+		}
 	}
-	switch_mutex_unlock(qm->mutex);
 
 	return size;
 }
@@ -1860,31 +2402,56 @@ SWITCH_DECLARE(int) switch_sql_queue_manager_size(switch_sql_queue_manager_t *qm
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_stop(switch_sql_queue_manager_t *qm)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
-	uint32_t i, sanity = 100;
+	uint32_t i, j, sanity = 100;
+	int stopping;
 
-	if (qm->thread_running == 1) {
-		qm->thread_running = -1;
+	if (qm->started) {
+		qm->started = 0;
 
-		while(--sanity && qm->thread_running == -1) {
-			for(i = 0; i < qm->numq; i++) {
-				switch_queue_push(qm->sql_queue[i], NULL);
-				switch_queue_interrupt_all(qm->sql_queue[i]);
+		for (i = 0; i < qm->writers; i++) {
+			if (qm->shards[i].thread_running == 1) {
+				qm->shards[i].thread_running = -1;
 			}
-			qm_wake(qm);
+		}
+
+		do {
+			stopping = 0;
+
+			for (i = 0; i < qm->writers; i++) {
+				sql_qm_shard_t *shard = &qm->shards[i];
 
-			if (qm->thread_running == -1) {
+				if (shard->thread_running != -1) {
+					continue;
+				}
+
+				stopping++;
+
+				for (j = 0; j < qm->numq; j++) {
+					switch_queue_push(shard->sql_queue[j], NULL);
+					switch_queue_interrupt_all(shard->sql_queue[j]);
+				}
+				qm_wake(shard);
+			}
+
+			if (stopping) {
 				switch_yield(100000);
 			}
-		}
+		} while (stopping && --sanity);
+
 		status = SWITCH_STATUS_SUCCESS;
 	}
 
-	if (qm->thread) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s Stopping SQL thread.\n", qm->name);
-		qm_wake(qm);
-		switch_thread_join(&status, qm->thread);
-		qm->thread = NULL;
-		status = SWITCH_STATUS_SUCCESS;
+	for (i = 0; i < qm->writers; i++) {
+		sql_qm_shard_t *shard = &qm->shards[i];
+		switch_status_t st;
+
+		if (shard->thread) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s Stopping SQL thread %u.\n", qm->name, shard->id);
+			qm_wake(shard);
+			switch_thread_join(&st, shard->thread);
+			shard->thread = NULL;
+			status = SWITCH_STATUS_SUCCESS;
+		}
 	}
 
 	return status;
@@ -1893,13 +2460,19 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_stop(switch_sql_queue_m
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_start(switch_sql_queue_manager_t *qm)
 {
 	switch_threadattr_t *thd_attr;
+	uint32_t i;
 
-	if (!qm->thread_running) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s Starting SQL thread.\n", qm->name);
+	if (!qm->started) {
+		qm->started = 1;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s Starting %u SQL thread%s.\n", qm->name, qm->writers, qm->writers == 1 ? "" : "s");
 		switch_threadattr_create(&thd_attr, qm->pool);
 		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
 		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_NORMAL);
-		switch_thread_create(&qm->thread, thd_attr, switch_user_sql_thread, qm, qm->pool);
+
+		for (i = 0; i < qm->writers; i++) {
+			switch_thread_create(&qm->shards[i].thread, thd_attr, switch_user_sql_thread, &qm->shards[i], qm->pool);
+		}
+
 		return SWITCH_STATUS_SUCCESS;
 	}
 
@@ -1928,8 +2501,8 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 
 
 
-	for(i = 0; i < qm->numq; i++) {
-		do_flush(qm, i, NULL);
+	for (i = 0; i < qm->writers; i++) {
+		do_flush_shard(&qm->shards[i], NULL);
 	}
 
 	pool = qm->pool;
@@ -1938,24 +2511,19 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_destroy(switch_sql_queu
 	return status;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+static switch_status_t qm_push(switch_sql_queue_manager_t *qm, sql_qm_shard_t *shard, const char *sql, uint32_t pos, switch_bool_t dup)
 {
 	char *sqlptr = NULL;
 	switch_status_t status;
 	int x = 0;
 
-	if (sql_manager.paused || qm->thread_running != 1) {
+	if (sql_manager.paused || shard->thread_running != 1) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", sql);
 		if (!dup) free((char *)sql);
-		qm_wake(qm);
+		qm_wake(shard);
 		return SWITCH_STATUS_SUCCESS;
 	}
 
-	if (qm->thread_running != 1) {
-		if (!dup) free((char *)sql);
-		return SWITCH_STATUS_FALSE;
-	}
-
 	if (pos > qm->numq - 1) {
 		pos = 0;
 	}
@@ -1963,22 +2531,93 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_m
 	sqlptr = dup ? strdup(sql) : (char *)sql;
 
 	do {
-		switch_mutex_lock(qm->mutex);
-		status = switch_queue_trypush(qm->sql_queue[pos], sqlptr);
-		switch_mutex_unlock(qm->mutex);
+		switch_mutex_lock(shard->mutex);
+		if ((status = switch_queue_trypush(shard->sql_queue[pos], sqlptr)) == SWITCH_STATUS_SUCCESS) {
+			shard->pushed++;
+		}
+		switch_mutex_unlock(shard->mutex);
+
 		if (status != SWITCH_STATUS_SUCCESS) {
+			if (qm->policy == SWITCH_SQL_QUEUE_POLICY_DROP || shard->thread_running != 1) {
+				uint64_t dropped;
+
+				switch_mutex_lock(shard->mutex);
+				dropped = ++shard->dropped;
+				switch_mutex_unlock(shard->mutex);
+
+				/* don't flood the log while the database is behind, one line per 1000 drops is plenty */
+				if (dropped % 1000 == 1) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "%s SQL thread %u queue %u full, %" SWITCH_UINT64_T_FMT " statements dropped\n",
+									  qm->name, shard->id, pos, dropped);
+				}
+
+				free(sqlptr);
+				qm_wake(shard);
+				return SWITCH_STATUS_FALSE;
+			}
+
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Delay %d sending sql\n", x);
+			qm_wake(shard);
 			if (x++) {
 				switch_yield(1000000 * x);
 			}
 		}
 	} while(status != SWITCH_STATUS_SUCCESS);
 
-	qm_wake(qm);
+	qm_wake(shard);
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
+{
+	return qm_push(qm, &qm->shards[0], sql, pos, dup);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_key(switch_sql_queue_manager_t *qm, const char *key, const char *sql, uint32_t pos, switch_bool_t dup)
+{
+	return qm_push(qm, qm_shard_by_key(qm, key), sql, pos, dup);
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_sql_queue_manager_move_key(switch_sql_queue_manager_t *qm, const char *from_key, const char *to_key)
+{
+	sql_qm_shard_t *from = qm_shard_by_key(qm, from_key), *to = qm_shard_by_key(qm, to_key);
+	uint64_t want;
+	int sanity = 5000;
+
+	if (from == to) {
+		return SWITCH_TRUE;
+	}
+
+	switch_mutex_lock(from->mutex);
+	want = from->pushed;
+	switch_mutex_unlock(from->mutex);
+
+	/* whatever from_key already queued has to be written before to_key's writer can see the next statement */
+	while (from->thread_running == 1 && !sql_manager.paused && --sanity) {
+		uint64_t popped;
+
+		switch_mutex_lock(from->mutex);
+		popped = from->popped;
+		switch_mutex_unlock(from->mutex);
+
+		if (popped >= want) {
+			return SWITCH_TRUE;
+		}
+
+		from->flush_wanted = 1;
+		qm_wake(from);
+		switch_yield(1000);
+	}
+
+	if (!sanity) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "%s SQL thread %u did not catch up, moving key %s to thread %u anyway\n",
+						  qm->name, from->id, switch_str_nil(from_key), to->id);
+	}
+
+	return sanity ? SWITCH_TRUE : SWITCH_FALSE;
+}
+
 
 SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql_queue_manager_t *qm, const char *sql, uint32_t pos, switch_bool_t dup)
 {
@@ -1986,10 +2625,10 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 #ifdef EXEC_NOW
 	switch_cache_db_handle_t *dbh;
 
-	if (sql_manager.paused || qm->thread_running != 1) {
+	if (sql_manager.paused || qm->shards[0].thread_running != 1) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "DROP [%s]\n", sql);
 		if (!dup) free((char *)sql);
-		qm_wake(qm);
+		qm_wake(&qm->shards[0]);
 		return SWITCH_STATUS_SUCCESS;
 	}
 
@@ -2004,14 +2643,15 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 
 	int size, x = 0, sanity = 0;
 	uint32_t written, want;
+	sql_qm_shard_t *shard = &qm->shards[0];
 
 	if (sql_manager.paused) {
 		if (!dup) free((char *)sql);
-		qm_wake(qm);
+		qm_wake(shard);
 		return SWITCH_STATUS_SUCCESS;
 	}
 
-	if (qm->thread_running != 1) {
+	if (shard->thread_running != 1) {
 		if (!dup) free((char *)sql);
 		return SWITCH_STATUS_FALSE;
 	}
@@ -2020,21 +2660,21 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 		pos = 0;
 	}
 
-	switch_mutex_lock(qm->mutex);
+	switch_mutex_lock(shard->mutex);
 	qm->confirm++;
-	switch_queue_push(qm->sql_queue[pos], dup ? strdup(sql) : (char *)sql);
-	written = qm->pre_written[pos];
-	size = switch_sql_queue_manager_size(qm, pos);
+	switch_queue_push(shard->sql_queue[pos], dup ? strdup(sql) : (char *)sql);
+	written = shard->pre_written[pos];
+	size = switch_queue_size(shard->sql_queue[pos]);
 	want = written + size;
-	switch_mutex_unlock(qm->mutex);
+	switch_mutex_unlock(shard->mutex);
 
-	qm_wake(qm);
+	qm_wake(shard);
 
-	while((qm->written[pos] < want) || (qm->written[pos] >= written && want < written && qm->written[pos] > want)) {
+	while((shard->written[pos] < want) || (shard->written[pos] >= written && want < written && shard->written[pos] > want)) {
 		switch_yield(5000);
 
 		if (++x == 200) {
-			qm_wake(qm);
+			qm_wake(shard);
 			x = 0;
 			if (++sanity == 20) {
 				break;
@@ -2042,9 +2682,9 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_push_confirm(switch_sql
 		}
 	}
 
-	switch_mutex_lock(qm->mutex);
+	switch_mutex_lock(shard->mutex);
 	qm->confirm--;
-	switch_mutex_unlock(qm->mutex);
+	switch_mutex_unlock(shard->mutex);
 #endif
 
 	return SWITCH_STATUS_SUCCESS;
@@ -2064,7 +2704,6 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 {
 	switch_memory_pool_t *pool;
 	switch_sql_queue_manager_t *qm;
-	uint32_t i;
 
 	if (!numq) numq = 1;
 
@@ -2076,19 +2715,13 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 	qm->dsn = switch_core_strdup(qm->pool, dsn);
 	qm->name = switch_core_strdup(qm->pool, name);
 	qm->max_trans = max_trans;
+	qm->queue_len = SWITCH_SQL_QUEUE_LEN;
+	qm->policy = SWITCH_SQL_QUEUE_POLICY_BLOCK;
 
-	switch_mutex_init(&qm->cond_mutex, SWITCH_MUTEX_NESTED, qm->pool);
-	switch_mutex_init(&qm->cond2_mutex, SWITCH_MUTEX_NESTED, qm->pool);
 	switch_mutex_init(&qm->mutex, SWITCH_MUTEX_NESTED, qm->pool);
-	switch_thread_cond_create(&qm->cond, qm->pool);
-
-	qm->sql_queue = switch_core_alloc(qm->pool, sizeof(switch_queue_t *) * numq);
-	qm->written = switch_core_alloc(qm->pool, sizeof(uint32_t) * numq);
-	qm->pre_written = switch_core_alloc(qm->pool, sizeof(uint32_t) * numq);
+	switch_mutex_init(&qm->trans_mutex, SWITCH_MUTEX_NESTED, qm->pool);
 
-	for (i = 0; i < qm->numq; i++) {
-		switch_queue_create(&qm->sql_queue[i], SWITCH_SQL_QUEUE_LEN, qm->pool);
-	}
+	qm_create_shards(qm, 1);
 
 	if (pre_trans_execute) {
 		qm->pre_trans_execute = switch_core_strdup(qm->pool, pre_trans_execute);
@@ -2109,36 +2742,106 @@ SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_init_name(const char *n
 
 }
 
-static uint32_t do_trans(switch_sql_queue_manager_t *qm)
+SWITCH_DECLARE(switch_status_t) switch_sql_queue_manager_set_writers(switch_sql_queue_manager_t *qm, uint32_t writers,
+																	 uint32_t queue_len, switch_sql_queue_policy_t policy)
+{
+	uint32_t i;
+
+	if (qm->started) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "%s Cannot change SQL writers while running.\n", qm->name);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!writers) {
+		writers = 1;
+	} else if (writers > SWITCH_SQL_QUEUE_MAX_WRITERS) {
+		writers = SWITCH_SQL_QUEUE_MAX_WRITERS;
+	}
+
+	if (!queue_len) {
+		queue_len = SWITCH_SQL_QUEUE_LEN;
+	}
+
+	for (i = 0; i < qm->writers; i++) {
+		do_flush_shard(&qm->shards[i], NULL);
+	}
+
+	qm->queue_len = queue_len;
+	qm->policy = policy;
+	qm_create_shards(qm, writers);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_sql_queue_manager_stats(switch_sql_queue_manager_t *qm, switch_stream_handle_t *stream)
+{
+	uint32_t i;
+
+	stream->write_function(stream, "%s\n\tWriters: %u\n\tQueue Length: %u\n\tPolicy: %s\n",
+						   qm->name, qm->writers, qm->queue_len, qm->policy == SWITCH_SQL_QUEUE_POLICY_DROP ? "drop" : "block");
+
+	for (i = 0; i < qm->writers; i++) {
+		sql_qm_shard_t *shard = &qm->shards[i];
+		uint64_t written, dropped, trans_count;
+		switch_time_t last, max, total;
+		uint32_t queued = qm_ttl(shard);
+
+		switch_mutex_lock(shard->mutex);
+		written = shard->total_written;
+		dropped = shard->dropped;
+		trans_count = shard->trans_count;
+		last = shard->trans_last;
+		max = shard->trans_max;
+		total = shard->trans_total;
+		switch_mutex_unlock(shard->mutex);
+
+		stream->write_function(stream, "\tWriter %u: %s, Queued: %u, Written: %" SWITCH_UINT64_T_FMT ", Dropped: %" SWITCH_UINT64_T_FMT
+							   ", Trans: %" SWITCH_UINT64_T_FMT ", Trans ms last/avg/max: %.3f/%.3f/%.3f\n",
+							   shard->id, shard->thread_running == 1 ? "Running" : "Stopped", queued, written, dropped, trans_count,
+							   (double) last / 1000, trans_count ? (double) total / trans_count / 1000 : 0.0, (double) max / 1000);
+	}
+}
+
+static uint32_t do_trans(sql_qm_shard_t *shard)
 {
+	switch_sql_queue_manager_t *qm = shard->qm;
+	switch_cache_db_handle_t *event_db = shard->event_db;
 	char *errmsg = NULL;
 	void *pop;
 	switch_status_t status;
 	uint32_t ttl = 0;
-	switch_mutex_t *io_mutex = qm->event_db->io_mutex;
+	switch_mutex_t *io_mutex = event_db->io_mutex;
+	switch_mutex_t *trans_mutex = NULL;
+	switch_time_t start = switch_micro_time_now(), elapsed;
 	uint32_t i;
 
+	/* sqlite only has one writer lock per file so writers sharing a core db take turns */
+	if (qm->writers > 1 && event_db->type == SCDB_TYPE_CORE_DB) {
+		trans_mutex = qm->trans_mutex;
+		switch_mutex_lock(trans_mutex);
+	}
+
 	if (io_mutex) switch_mutex_lock(io_mutex);
 
 	if (!zstr(qm->pre_trans_execute)) {
-		switch_cache_db_execute_sql_real(qm->event_db, qm->pre_trans_execute, &errmsg);
+		switch_cache_db_execute_sql_real(event_db, qm->pre_trans_execute, &errmsg);
 		if (errmsg) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL PRE TRANS EXEC %s [%s]\n", qm->pre_trans_execute, errmsg);
 			switch_safe_free(errmsg);
 		}
 	}
 
-	switch(qm->event_db->type) {
+	switch(event_db->type) {
 	case SCDB_TYPE_CORE_DB:
 		{
-			switch_cache_db_execute_sql_real(qm->event_db, "BEGIN EXCLUSIVE", &errmsg);
+			switch_cache_db_execute_sql_real(event_db, "BEGIN EXCLUSIVE", &errmsg);
 		}
 		break;
 	case SCDB_TYPE_ODBC:
 		{
 			switch_odbc_status_t result;
 
-			if ((result = switch_odbc_SQLSetAutoCommitAttr(qm->event_db->native_handle.odbc_dbh, 0)) != SWITCH_ODBC_SUCCESS) {
+			if ((result = switch_odbc_SQLSetAutoCommitAttr(event_db->native_handle.odbc_dbh, 0)) != SWITCH_ODBC_SUCCESS) {
 				char tmp[100];
 				switch_snprintfv(tmp, sizeof(tmp), "%q-%i", "Unable to Set AutoCommit Off", result);
 				errmsg = strdup(tmp);
@@ -2147,10 +2850,10 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 		break;
 	case SCDB_TYPE_DATABASE_INTERFACE:
 		{
-			switch_database_interface_t *database_interface = qm->event_db->native_handle.database_interface_dbh->connection_options.database_interface;
+			switch_database_interface_t *database_interface = event_db->native_handle.database_interface_dbh->connection_options.database_interface;
 			switch_status_t result;
 
-			if ((result = database_interface->sql_set_auto_commit_attr(qm->event_db->native_handle.database_interface_dbh, 0)) != SWITCH_STATUS_SUCCESS) {
+			if ((result = database_interface->sql_set_auto_commit_attr(event_db->native_handle.database_interface_dbh, 0)) != SWITCH_STATUS_SUCCESS) {
 				char tmp[100];
 				switch_snprintfv(tmp, sizeof(tmp), "%q-%i", "Unable to Set AutoCommit Off", result);
 				errmsg = strdup(tmp);
@@ -2160,14 +2863,14 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	}
 
 	if (errmsg) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "ERROR [%s], [%s]\n", errmsg, qm->event_db->name);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "ERROR [%s], [%s]\n", errmsg, event_db->name);
 		switch_safe_free(errmsg);
 		goto end;
 	}
 
 
 	if (!zstr(qm->inner_pre_trans_execute)) {
-		switch_cache_db_execute_sql_real(qm->event_db, qm->inner_pre_trans_execute, &errmsg);
+		switch_cache_db_execute_sql_real(event_db, qm->inner_pre_trans_execute, &errmsg);
 		if (errmsg) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL PRE TRANS EXEC %s [%s]\n", qm->inner_pre_trans_execute, errmsg);
 			switch_safe_free(errmsg);
@@ -2179,20 +2882,23 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 		pop = NULL;
 
 		for (i = 0; (qm->max_trans == 0 || ttl <= qm->max_trans) && (i < qm->numq); i++) {
-			switch_mutex_lock(qm->mutex);
-			switch_queue_trypop(qm->sql_queue[i], &pop);
-			switch_mutex_unlock(qm->mutex);
+			switch_mutex_lock(shard->mutex);
+			switch_queue_trypop(shard->sql_queue[i], &pop);
+			switch_mutex_unlock(shard->mutex);
 			if (pop) break;
 		}
 
 		if (pop) {
-			if ((status = switch_cache_db_execute_sql(qm->event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
-				switch_mutex_lock(qm->mutex);
-				qm->pre_written[i]++;
-				switch_mutex_unlock(qm->mutex);
+			if ((status = switch_cache_db_execute_sql(event_db, (char *) pop, NULL)) == SWITCH_STATUS_SUCCESS) {
+				switch_mutex_lock(shard->mutex);
+				shard->pre_written[i]++;
+				switch_mutex_unlock(shard->mutex);
 				ttl++;
 			}
 			switch_safe_free(pop);
+			switch_mutex_lock(shard->mutex);
+			shard->popped++;
+			switch_mutex_unlock(shard->mutex);
 			if (status != SWITCH_STATUS_SUCCESS) break;
 		} else {
 			break;
@@ -2200,7 +2906,7 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	}
 
 	if (!zstr(qm->inner_post_trans_execute)) {
-		switch_cache_db_execute_sql_real(qm->event_db, qm->inner_post_trans_execute, &errmsg);
+		switch_cache_db_execute_sql_real(event_db, qm->inner_post_trans_execute, &errmsg);
 		if (errmsg) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL POST TRANS EXEC %s [%s]\n", qm->inner_post_trans_execute, errmsg);
 			switch_safe_free(errmsg);
@@ -2210,24 +2916,24 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 
  end:
 
-	switch(qm->event_db->type) {
+	switch(event_db->type) {
 	case SCDB_TYPE_CORE_DB:
 		{
-			switch_cache_db_execute_sql_real(qm->event_db, "COMMIT", NULL);
+			switch_cache_db_execute_sql_real(event_db, "COMMIT", NULL);
 		}
 		break;
 	case SCDB_TYPE_ODBC:
 		{
-			switch_odbc_SQLEndTran(qm->event_db->native_handle.odbc_dbh, 1);
-			switch_odbc_SQLSetAutoCommitAttr(qm->event_db->native_handle.odbc_dbh, 1);
+			switch_odbc_SQLEndTran(event_db->native_handle.odbc_dbh, 1);
+			switch_odbc_SQLSetAutoCommitAttr(event_db->native_handle.odbc_dbh, 1);
 		}
 		break;
 	case SCDB_TYPE_DATABASE_INTERFACE:
 		{
-			switch_database_interface_t *database_interface = qm->event_db->native_handle.database_interface_dbh->connection_options.database_interface;
+			switch_database_interface_t *database_interface = event_db->native_handle.database_interface_dbh->connection_options.database_interface;
 			switch_status_t result;
 
-			if ((result = database_interface->commit(qm->event_db->native_handle.database_interface_dbh)) != SWITCH_STATUS_SUCCESS) {
+			if ((result = database_interface->commit(event_db->native_handle.database_interface_dbh)) != SWITCH_STATUS_SUCCESS) {
 				char tmp[100];
 				switch_snprintfv(tmp, sizeof(tmp), "%q-%i", "Unable to commit transaction", result);
 			}
@@ -2237,7 +2943,7 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 
 
 	if (!zstr(qm->post_trans_execute)) {
-		switch_cache_db_execute_sql_real(qm->event_db, qm->post_trans_execute, &errmsg);
+		switch_cache_db_execute_sql_real(event_db, qm->post_trans_execute, &errmsg);
 		if (errmsg) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL POST TRANS EXEC %s [%s]\n", qm->post_trans_execute, errmsg);
 			switch_safe_free(errmsg);
@@ -2245,14 +2951,27 @@ static uint32_t do_trans(switch_sql_queue_manager_t *qm)
 	}
 
 
-	switch_mutex_lock(qm->mutex);
+	elapsed = switch_micro_time_now() - start;
+
+	switch_mutex_lock(shard->mutex);
 	for (i = 0; i < qm->numq; i++) {
-		qm->written[i] = qm->pre_written[i];
+		shard->written[i] = shard->pre_written[i];
 	}
-	switch_mutex_unlock(qm->mutex);
+
+	if (ttl) {
+		shard->total_written += ttl;
+		shard->trans_count++;
+		shard->trans_last = elapsed;
+		shard->trans_total += elapsed;
+		if (elapsed > shard->trans_max) {
+			shard->trans_max = elapsed;
+		}
+	}
+	switch_mutex_unlock(shard->mutex);
 
 
 	if (io_mutex) switch_mutex_unlock(io_mutex);
+	if (trans_mutex) switch_mutex_unlock(trans_mutex);
 
 	return ttl;
 }
@@ -2261,43 +2980,43 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 {
 
 	uint32_t sanity = 120;
-	switch_sql_queue_manager_t *qm = (switch_sql_queue_manager_t *) obj;
-	uint32_t i;
+	sql_qm_shard_t *shard = (sql_qm_shard_t *) obj;
+	switch_sql_queue_manager_t *qm = shard->qm;
 
-	while (sanity && !qm->event_db) {
-		if (switch_cache_db_get_db_handle_dsn(&qm->event_db, qm->dsn) == SWITCH_STATUS_SUCCESS && qm->event_db)
+	while (sanity && !shard->event_db && qm->started) {
+		if (switch_cache_db_get_db_handle_dsn(&shard->event_db, qm->dsn) == SWITCH_STATUS_SUCCESS && shard->event_db)
 			break;
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "%s Error getting db handle, Retrying\n", qm->name);
 		switch_yield(500000);
 		sanity--;
 	}
 
-	if (!qm->event_db) {
+	if (!shard->event_db) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "%s Error getting db handle\n", qm->name);
 		return NULL;
 	}
 
-	qm->thread_running = 1;
+	shard->thread_running = 1;
 
-	switch_mutex_lock(qm->cond_mutex);
+	switch_mutex_lock(shard->cond_mutex);
 
-	switch (qm->event_db->type) {
+	switch (shard->event_db->type) {
 	case SCDB_TYPE_DATABASE_INTERFACE:
 		break;
 	case SCDB_TYPE_ODBC:
 		break;
 	case SCDB_TYPE_CORE_DB:
 		{
-			switch_cache_db_execute_sql(qm->event_db, "PRAGMA synchronous=OFF;", NULL);
-			switch_cache_db_execute_sql(qm->event_db, "PRAGMA count_changes=OFF;", NULL);
-			switch_cache_db_execute_sql(qm->event_db, "PRAGMA temp_store=MEMORY;", NULL);
-			switch_cache_db_execute_sql(qm->event_db, "PRAGMA journal_mode=OFF;", NULL);
+			switch_cache_db_execute_sql(shard->event_db, "PRAGMA synchronous=OFF;", NULL);
+			switch_cache_db_execute_sql(shard->event_db, "PRAGMA count_changes=OFF;", NULL);
+			switch_cache_db_execute_sql(shard->event_db, "PRAGMA temp_store=MEMORY;", NULL);
+			switch_cache_db_execute_sql(shard->event_db, "PRAGMA journal_mode=OFF;", NULL);
 		}
 		break;
 	}
 
 
-	while (qm->thread_running == 1) {
+	while (shard->thread_running == 1 && qm->started) {
 		uint32_t i, lc;
 		uint32_t written = 0, iterations = 0;
 
@@ -2306,17 +3025,15 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 		}
 
 		if (sql_manager.paused) {
-			for (i = 0; i < qm->numq; i++) {
-				do_flush(qm, i, NULL);
-			}
+			do_flush_shard(shard, NULL);
 			goto check;
 		}
 
 		do {
-			if (!qm_ttl(qm)) {
+			if (!qm_ttl(shard)) {
 				goto check;
 			}
-			written = do_trans(qm);
+			written = do_trans(shard);
 			iterations += written;
 		} while(written == qm->max_trans);
 
@@ -2324,11 +3041,11 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 			char line[128] = "";
 			switch_size_t l;
 
-			switch_snprintf(line, sizeof(line), "%s RUN QUEUE [", qm->name);
+			switch_snprintf(line, sizeof(line), "%s[%u] RUN QUEUE [", qm->name, shard->id);
 
 			for (i = 0; i < qm->numq; i++) {
 				l = strlen(line);
-				switch_snprintf(line + l, sizeof(line) - l, "%d%s", switch_queue_size(qm->sql_queue[i]), i == qm->numq - 1 ? "" : "|");
+				switch_snprintf(line + l, sizeof(line) - l, "%d%s", switch_queue_size(shard->sql_queue[i]), i == qm->numq - 1 ? "" : "|");
 			}
 
 			l = strlen(line);
@@ -2340,35 +3057,33 @@ static void *SWITCH_THREAD_FUNC switch_user_sql_thread(switch_thread_t *thread,
 
 	check:
 
-		if ((lc = qm_ttl(qm)) == 0) {
-			switch_mutex_lock(qm->cond2_mutex);
-			switch_thread_cond_wait(qm->cond, qm->cond_mutex);
-			switch_mutex_unlock(qm->cond2_mutex);
+		if ((lc = qm_ttl(shard)) == 0) {
+			switch_mutex_lock(shard->cond2_mutex);
+			switch_thread_cond_wait(shard->cond, shard->cond_mutex);
+			switch_mutex_unlock(shard->cond2_mutex);
 		}
 
 		i = 40;
 
-		while (--i > 0 && (lc = qm_ttl(qm)) < 500) {
+		while (--i > 0 && !shard->flush_wanted && (lc = qm_ttl(shard)) < 500) {
 			switch_yield(5000);
 		}
 
+		shard->flush_wanted = 0;
+
 
 	}
 
-	switch_mutex_unlock(qm->cond_mutex);
+	switch_mutex_unlock(shard->cond_mutex);
 
-	for(i = 0; i < qm->numq; i++) {
-		do_flush(qm, i, qm->event_db);
-	}
+	do_flush_shard(shard, shard->event_db);
 
-	switch_cache_db_release_db_handle(&qm->event_db);
+	switch_cache_db_release_db_handle(&shard->event_db);
 
-	qm->thread_running = 0;
+	shard->thread_running = 0;
 
 	return NULL;
 }
-
-
 static char *parse_presence_data_cols(switch_event_t *event)
 {
 	char *cols[128] = { 0 };
@@ -2419,6 +3134,120 @@ static char *parse_presence_data_cols(switch_event_t *event)
 #define new_sql()   switch_assert(sql_idx+1 < MAX_SQL); if (exists) sql[sql_idx++]
 #define new_sql_a() switch_assert(sql_idx+1 < MAX_SQL); sql[sql_idx++]
 
+/* every leg of a call shares one writer key so its channels and calls rows are written in order.
+   A channel starts out on its originator's key (or its own uuid) and takes the other leg's key when bridged. */
+static void call_key_get(const char *uuid, char *buf, switch_size_t len)
+{
+	const char *key;
+
+	switch_mutex_lock(sql_manager.key_mutex);
+	if (!(key = switch_core_hash_find(sql_manager.call_keys, uuid))) {
+		key = uuid;
+	}
+	switch_copy_string(buf, key, len);
+	switch_mutex_unlock(sql_manager.key_mutex);
+}
+
+static void call_key_set(const char *uuid, const char *key)
+{
+	char *old;
+
+	switch_mutex_lock(sql_manager.key_mutex);
+	if ((old = switch_core_hash_delete(sql_manager.call_keys, uuid))) {
+		free(old);
+	}
+	if (key && strcmp(uuid, key)) {
+		switch_core_hash_insert(sql_manager.call_keys, uuid, strdup(key));
+	}
+	switch_mutex_unlock(sql_manager.key_mutex);
+}
+
+static const char *core_event_key(switch_event_t *event, char *buf, switch_size_t len)
+{
+	const char *uuid = switch_event_get_header(event, "unique-id");
+	const char *other;
+
+	switch (event->event_id) {
+	case SWITCH_EVENT_ADD_SCHEDULE:
+	case SWITCH_EVENT_DEL_SCHEDULE:
+	case SWITCH_EVENT_EXE_SCHEDULE:
+	case SWITCH_EVENT_RE_SCHEDULE:
+		return "tasks";
+	case SWITCH_EVENT_MODULE_LOAD:
+	case SWITCH_EVENT_MODULE_UNLOAD:
+		return "interfaces";
+	case SWITCH_EVENT_NAT:
+		return "nat";
+	case SWITCH_EVENT_SHUTDOWN:
+		return NULL;
+	case SWITCH_EVENT_CHANNEL_CREATE:
+		if (zstr(uuid)) {
+			return NULL;
+		}
+		if (!zstr((other = switch_event_get_header(event, "variable_" SWITCH_ORIGINATOR_VARIABLE)))) {
+			call_key_get(other, buf, len);
+			call_key_set(uuid, buf);
+		} else {
+			switch_copy_string(buf, uuid, len);
+		}
+		return buf;
+	case SWITCH_EVENT_CHANNEL_UUID:
+		if (zstr(uuid) || zstr((other = switch_event_get_header(event, "old-unique-id")))) {
+			return NULL;
+		}
+		call_key_get(other, buf, len);
+		call_key_set(other, NULL);
+		call_key_set(uuid, buf);
+		return buf;
+	case SWITCH_EVENT_CHANNEL_BRIDGE:
+		{
+			const char *a_uuid = switch_event_get_header(event, "Bridge-A-Unique-ID");
+			const char *b_uuid = switch_event_get_header(event, "Bridge-B-Unique-ID");
+			char b_key[256];
+
+			if (zstr(a_uuid) || zstr(b_uuid)) {
+				a_uuid = switch_event_get_header(event, "caller-unique-id");
+				b_uuid = switch_event_get_header(event, "other-leg-unique-id");
+			}
+
+			if (zstr(a_uuid)) {
+				return NULL;
+			}
+
+			call_key_get(a_uuid, buf, len);
+
+			if (!zstr(b_uuid)) {
+				call_key_get(b_uuid, b_key, sizeof(b_key));
+
+				if (strcmp(b_key, buf)) {
+					if (sql_manager.qm) {
+						switch_sql_queue_manager_move_key(sql_manager.qm, b_key, buf);
+					}
+					call_key_set(b_uuid, buf);
+				}
+			}
+		}
+		return buf;
+	case SWITCH_EVENT_CALL_SECURE:
+		uuid = switch_event_get_header(event, "caller-unique-id");
+		break;
+	default:
+		break;
+	}
+
+	if (zstr(uuid)) {
+		return NULL;
+	}
+
+	call_key_get(uuid, buf, len);
+
+	if (event->event_id == SWITCH_EVENT_CHANNEL_DESTROY) {
+		call_key_set(uuid, NULL);
+	}
+
+	return buf;
+}
+
 static void core_event_handler(switch_event_t *event)
 {
 	char *sql[MAX_SQL] = { 0 };
@@ -2426,6 +3255,8 @@ static void core_event_handler(switch_event_t *event)
 	char *extra_cols;
 	int exists = 1;
 	char *uuid = NULL;
+	char key_buf[256] = "";
+	const char *key = NULL;
 
 	switch_assert(event);
 
@@ -2859,15 +3690,17 @@ static void core_event_handler(switch_event_t *event)
 		break;
 	}
 
+	key = core_event_key(event, key_buf, sizeof(key_buf));
+
 	if (sql_idx) {
 		int i = 0;
 
 
 		for (i = 0; i < sql_idx; i++) {
 			if (switch_stristr("update channels", sql[i]) || switch_stristr("delete from channels", sql[i])) {
-				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 1, SWITCH_FALSE);
+				switch_sql_queue_manager_push_key(sql_manager.qm, key, sql[i], 1, SWITCH_FALSE);
 			} else {
-				switch_sql_queue_manager_push(sql_manager.qm, sql[i], 0, SWITCH_FALSE);
+				switch_sql_queue_manager_push_key(sql_manager.qm, key, sql[i], 0, SWITCH_FALSE);
 			}
 			sql[i] = NULL;
 		}
@@ -3214,24 +4047,72 @@ SWITCH_DECLARE(void) switch_core_recovery_flush(const char *technology, const ch
 }
 
 
-static int recover_callback(void *pArg, int argc, char **argv, char **columnNames)
+typedef struct {
+	char *technology;
+	char *metadata;
+} recovery_row_t;
+
+typedef struct {
+	recovery_row_t *rows;
+	int count;
+	int size;
+	int next;
+	int recovered;
+	switch_mutex_t *mutex;
+} recovery_set_t;
+
+static int recover_collect_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	recovery_set_t *set = (recovery_set_t *) pArg;
+
+	if (argc < 5 || zstr(argv[0]) || zstr(argv[4])) {
+		return 0;
+	}
+
+	if (set->count == set->size) {
+		int size = set->size ? set->size * 2 : 64;
+		recovery_row_t *rows;
+
+		if (!(rows = realloc(set->rows, size * sizeof(*rows)))) {
+			return 1;
+		}
+
+		set->rows = rows;
+		set->size = size;
+	}
+
+	set->rows[set->count].technology = strdup(argv[0]);
+	set->rows[set->count].metadata = strdup(argv[4]);
+	set->count++;
+
+	return 0;
+}
+
+static int recover_row(recovery_row_t *row)
 {
-	int *rp = (int *) pArg;
+	int recovered = 0;
+	const char *technology = row->technology;
+	char *metadata = row->metadata;
 	switch_xml_t xml;
 	switch_endpoint_interface_t *ep;
 	switch_core_session_t *session;
 
-	if (argc < 4) {
+	if (!technology || !metadata) {
 		return 0;
 	}
 
-	if (!(xml = switch_xml_parse_str_dynamic(argv[4], SWITCH_TRUE))) {
+	/* the parsed tree takes ownership of the collected text */
+	row->metadata = NULL;
+
+	if (!(xml = switch_xml_parse_str_dynamic(metadata, SWITCH_FALSE))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "XML ERROR\n");
+		free(metadata);
 		return 0;
 	}
 
-	if (!(ep = switch_loadable_module_get_endpoint_interface(argv[0]))) {
+	if (!(ep = switch_loadable_module_get_endpoint_interface(technology))) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "EP ERROR\n");
+		switch_xml_free(xml);
 		return 0;
 	}
 
@@ -3295,12 +4176,12 @@ static int recover_callback(void *pArg, int argc, char **argv, char **columnName
 							  "Resurrecting fallen channel %s\n", switch_channel_get_name(channel));
 			switch_core_session_thread_launch(session);
 
-			*rp = (*rp) + 1;
+			recovered = 1;
 
 		}
 
 	} else {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Endpoint %s has no recovery function\n", argv[0]);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Endpoint %s has no recovery function\n", technology);
 	}
 
 
@@ -3310,15 +4191,128 @@ static int recover_callback(void *pArg, int argc, char **argv, char **columnName
 
 	switch_xml_free(xml);
 
-	return 0;
+	return recovered;
+}
+
+static void *SWITCH_THREAD_FUNC recover_thread(switch_thread_t *thread, void *obj)
+{
+	recovery_set_t *set = (recovery_set_t *) obj;
+
+	for (;;) {
+		int idx, r;
+
+		switch_mutex_lock(set->mutex);
+		idx = set->next++;
+		switch_mutex_unlock(set->mutex);
+
+		if (idx >= set->count) {
+			break;
+		}
+
+		r = recover_row(&set->rows[idx]);
+
+		switch_mutex_lock(set->mutex);
+		set->recovered += r;
+		switch_mutex_unlock(set->mutex);
+	}
+
+	return NULL;
+}
+
+/* Channels are independent of each other at this point, so replay them from several threads;
+   rebuilding media for each one is what makes a large recovery slow, not the select. */
+static int recover_rows(recovery_set_t *set)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_thread_t *threads[64] = { 0 };
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t nthreads = runtime.recovery_threads;
+	uint32_t i;
+
+	if (!nthreads) {
+		nthreads = runtime.cpu_count > 8 ? 8 : runtime.cpu_count;
+	}
+
+	if (nthreads > (uint32_t) set->count) {
+		nthreads = (uint32_t) set->count;
+	}
+
+	if (nthreads < 2 || switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+		int x;
+
+		for (x = 0; x < set->count; x++) {
+			set->recovered += recover_row(&set->rows[x]);
+		}
+
+		return set->recovered;
+	}
+
+	switch_mutex_init(&set->mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (i = 0; i < nthreads; i++) {
+		if (switch_thread_create(&threads[i], thd_attr, recover_thread, set, pool) != SWITCH_STATUS_SUCCESS) {
+			threads[i] = NULL;
+			break;
+		}
+	}
+
+	if (!i) {
+		/* could not start any helper, do the work here */
+		recover_thread(NULL, set);
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		switch_status_t st;
+
+		if (threads[i]) {
+			switch_thread_join(&st, threads[i]);
+		}
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Recovered %d of %d channel(s) using %u thread(s)\n",
+					  set->recovered, set->count, nthreads);
+
+	return set->recovered;
+}
+
+/* the recover select and delete filter the same way, the values are bound rather than quoted into the sql */
+static switch_status_t recovery_stmt_execute(switch_cache_db_handle_t *dbh, const char *head, const char *technology, const char *profile_name,
+											 switch_core_db_callback_func_t callback, void *pdata, char **err)
+{
+	switch_cache_db_stmt_t *stmt = NULL;
+	char sql[256];
+	int idx = 1;
+
+	switch_snprintf(sql, sizeof(sql), "%s where runtime_uuid!=?%s%s", head,
+					zstr(technology) ? "" : " and technology=?", zstr(profile_name) ? "" : " and profile_name=?");
+
+	if (switch_cache_db_prepare(dbh, sql, &stmt) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_cache_db_stmt_bind_text(stmt, idx++, switch_core_get_uuid());
+
+	if (!zstr(technology)) {
+		switch_cache_db_stmt_bind_text(stmt, idx++, technology);
+	}
+
+	if (!zstr(profile_name)) {
+		switch_cache_db_stmt_bind_text(stmt, idx++, profile_name);
+	}
+
+	return switch_cache_db_stmt_execute(stmt, callback, pdata, err);
 }
 
 SWITCH_DECLARE(int) switch_core_recovery_recover(const char *technology, const char *profile_name)
 
 {
-	char *sql = NULL;
 	char *errmsg = NULL;
 	switch_cache_db_handle_t *dbh;
+	recovery_set_t set = { 0 };
 	int r = 0;
 
 	if (!sql_manager.manage) {
@@ -3331,61 +4325,28 @@ SWITCH_DECLARE(int) switch_core_recovery_recover(const char *technology, const c
 		return 0;
 	}
 
-	if (zstr(technology)) {
-
-		if (zstr(profile_name)) {
-			sql = switch_mprintf("select technology, profile_name, hostname, uuid, metadata "
-								 "from recovery where runtime_uuid!='%q'",
-								 switch_core_get_uuid());
-		} else {
-			sql = switch_mprintf("select technology, profile_name, hostname, uuid, metadata "
-								 "from recovery where runtime_uuid!='%q' and profile_name='%q'",
-								 switch_core_get_uuid(), profile_name);
-		}
-
-	} else {
-
-		if (zstr(profile_name)) {
-			sql = switch_mprintf("select technology, profile_name, hostname, uuid, metadata "
-								 "from recovery where technology='%q' and runtime_uuid!='%q'",
-								 technology, switch_core_get_uuid());
-		} else {
-			sql = switch_mprintf("select technology, profile_name, hostname, uuid, metadata "
-								 "from recovery where technology='%q' and runtime_uuid!='%q' and profile_name='%q'",
-								 technology, switch_core_get_uuid(), profile_name);
-		}
-	}
-
-
-	switch_cache_db_execute_sql_callback(dbh, sql, recover_callback, &r, &errmsg);
+	recovery_stmt_execute(dbh, "select technology, profile_name, hostname, uuid, metadata from recovery",
+						  technology, profile_name, recover_collect_callback, &set, &errmsg);
 
 	if (errmsg) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR: [%s] %s\n", sql, errmsg);
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR: %s\n", errmsg);
 		switch_safe_free(errmsg);
 	}
 
-	switch_safe_free(sql);
+	if (set.count) {
+		int i;
 
-	if (zstr(technology)) {
-		if (zstr(profile_name)) {
-			sql = switch_mprintf("delete from recovery where runtime_uuid!='%q'",
-								 switch_core_get_uuid());
-		} else {
-			sql = switch_mprintf("delete from recovery where runtime_uuid!='%q' and profile_name='%q'",
-								 switch_core_get_uuid(), profile_name);
-		}
-	} else {
-		if (zstr(profile_name)) {
-			sql = switch_mprintf("delete from recovery where runtime_uuid!='%q' and technology='%q' ",
-								 switch_core_get_uuid(), technology);
-		} else {
-			sql = switch_mprintf("delete from recovery where runtime_uuid!='%q' and technology='%q' and profile_name='%q'",
-								 switch_core_get_uuid(), technology, profile_name);
+		r = recover_rows(&set);
+
+		for (i = 0; i < set.count; i++) {
+			switch_safe_free(set.rows[i].technology);
+			switch_safe_free(set.rows[i].metadata);
 		}
 	}
 
-	switch_cache_db_execute_sql(dbh, sql, NULL);
-	switch_safe_free(sql);
+	switch_safe_free(set.rows);
+
+	recovery_stmt_execute(dbh, "delete from recovery", technology, profile_name, NULL, NULL, NULL);
 
 	switch_cache_db_release_db_handle(&dbh);
 
@@ -3398,8 +4359,8 @@ SWITCH_DECLARE(switch_cache_db_handle_type_t) switch_core_dbtype(void)
 	switch_cache_db_handle_type_t type = SCDB_TYPE_CORE_DB;
 
 	switch_mutex_lock(sql_manager.ctl_mutex);
-	if (sql_manager.qm && sql_manager.qm->event_db) {
-		type = sql_manager.qm->event_db->type;
+	if (sql_manager.qm && sql_manager.qm->shards[0].event_db) {
+		type = sql_manager.qm->shards[0].event_db->type;
 	}
 	switch_mutex_unlock(sql_manager.ctl_mutex);
 
@@ -3488,6 +4449,15 @@ SWITCH_DECLARE(void) switch_core_recovery_track(switch_core_session_t *session)
 	}
 
 	if (xml_cdr_text) {
+		switch_mutex_lock(session->recovery_mutex);
+
+		/* tracking is triggered by many unrelated changes; don't rewrite a snapshot that is already stored as is */
+		if (switch_channel_test_flag(channel, CF_TRACKED) && session->recovery_metadata && !strcmp(session->recovery_metadata, xml_cdr_text)) {
+			switch_mutex_unlock(session->recovery_mutex);
+			switch_safe_free(xml_cdr_text);
+			return;
+		}
+
 		if (switch_channel_test_flag(channel, CF_TRACKED)) {
 			sql = switch_mprintf("update recovery set metadata='%q' where uuid='%q'",  xml_cdr_text, switch_core_session_get_uuid(session));
 		} else {
@@ -3499,9 +4469,13 @@ SWITCH_DECLARE(void) switch_core_recovery_track(switch_core_session_t *session)
 
 		switch_sql_queue_manager_push(sql_manager.qm, sql, 2, SWITCH_FALSE);
 
-		switch_safe_free(xml_cdr_text);
+		/* keep the text itself, a hash match alone could skip a real change */
+		switch_safe_free(session->recovery_metadata);
+		session->recovery_metadata = xml_cdr_text;
 		switch_channel_set_flag(channel, CF_TRACKED);
 
+		switch_mutex_unlock(session->recovery_mutex);
+
 	}
 
 }
@@ -3618,6 +4592,8 @@ switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_
 	switch_mutex_init(&sql_manager.dbh_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
 	switch_mutex_init(&sql_manager.io_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
 	switch_mutex_init(&sql_manager.ctl_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
+	switch_mutex_init(&sql_manager.key_mutex, SWITCH_MUTEX_NESTED, sql_manager.memory_pool);
+	switch_core_hash_init(&sql_manager.call_keys);
 
 	if (!sql_manager.manage) goto skip;
 
@@ -3898,6 +4874,11 @@ switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_sql_queue_manager_t *) switch_core_sqldb_queue_manager(void)
+{
+	return sql_manager.qm;
+}
+
 SWITCH_DECLARE(void) switch_core_sqldb_pause(void)
 {
 	if (sql_manager.paused) {
@@ -3954,6 +4935,10 @@ static void switch_core_sqldb_start_thread(void)
 											   runtime.core_db_inner_pre_trans_execute,
 											   runtime.core_db_inner_post_trans_execute);
 
+			if (runtime.core_db_writers > 1 || runtime.core_db_queue_len || runtime.core_db_queue_drop) {
+				switch_sql_queue_manager_set_writers(sql_manager.qm, runtime.core_db_writers, runtime.core_db_queue_len,
+													 runtime.core_db_queue_drop ? SWITCH_SQL_QUEUE_POLICY_DROP : SWITCH_SQL_QUEUE_POLICY_BLOCK);
+			}
 		}
 		switch_sql_queue_manager_start(sql_manager.qm);
 	} else {
@@ -3977,6 +4962,19 @@ void switch_core_sqldb_stop(void)
 
 	switch_cache_db_flush_handles();
 	sql_close(0);
+
+	if (sql_manager.call_keys) {
+		switch_hash_index_t *hi;
+		void *val;
+
+		switch_mutex_lock(sql_manager.key_mutex);
+		for (hi = switch_core_hash_first(sql_manager.call_keys); hi; hi = switch_core_hash_next(&hi)) {
+			switch_core_hash_this(hi, NULL, NULL, &val);
+			free(val);
+		}
+		switch_core_hash_destroy(&sql_manager.call_keys);
+		switch_mutex_unlock(sql_manager.key_mutex);
+	}
 }
 
 SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
@@ -4051,6 +5049,12 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 	stream->write_function(stream, "%d total. %d in use.\n", count, used);
 
 	switch_mutex_unlock(sql_manager.dbh_mutex);
+
+	switch_mutex_lock(sql_manager.ctl_mutex);
+	if (sql_manager.qm) {
+		switch_sql_queue_manager_stats(sql_manager.qm, stream);
+	}
+	switch_mutex_unlock(sql_manager.ctl_mutex);
 }
 
 SWITCH_DECLARE(char*)switch_sql_concat(void)
@@ -703,6 +703,7 @@ SWITCH_DECLARE(void) switch_core_session_run(switch_core_session_t *session)
 									  switch_channel_get_name(session->channel),
 									  switch_channel_state_name(switch_channel_get_running_state(session->channel)));
 					switch_thread_cond_wait(session->cond, session->mutex);
+					switch_core_session_account_wake(session);
 					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG1, "%s session thread wake state: %s!\n",
 									  switch_channel_get_name(session->channel),
 									  switch_channel_state_name(switch_channel_get_running_state(session->channel)));					
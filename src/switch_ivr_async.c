@@ -3487,6 +3487,7 @@ static switch_bool_t inband_dtmf_callback(switch_media_bug_t *bug, void *user_da
 	switch_frame_t *frame = NULL;
 	switch_channel_t *channel = switch_core_session_get_channel(pvt->session);
 	teletone_hit_type_t hit;
+	teletone_fax_tone_t fax_tone;
 
 	switch (type) {
 	case SWITCH_ABC_TYPE_INIT:
@@ -3504,6 +3505,22 @@ static switch_bool_t inband_dtmf_callback(switch_media_bug_t *bug, void *user_da
 				dtmf.source = SWITCH_DTMF_INBAND_AUDIO;
 				switch_channel_queue_dtmf(channel, &dtmf);
 			}
+
+			/* the fax tones come out of the same filter pass as the digits */
+			if ((fax_tone = teletone_dtmf_get_fax_tone(&pvt->dtmf_detect)) != TT_FAX_NONE) {
+				const char *tone = fax_tone == TT_FAX_CED ? "CED" : "CNG";
+				switch_event_t *event;
+
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(pvt->session), SWITCH_LOG_DEBUG, "FAX TONE DETECTED: [%s]\n", tone);
+				switch_channel_set_variable(channel, "inband_fax_tone", tone);
+
+				if (switch_event_create(&event, SWITCH_EVENT_DETECTED_TONE) == SWITCH_STATUS_SUCCESS) {
+					switch_channel_event_set_data(channel, event);
+					switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Detected-Tone", tone);
+					switch_event_fire(&event);
+				}
+			}
+
 			switch_core_media_bug_set_read_replace_frame(bug, frame);
 		}
 		break;
@@ -31,6 +31,7 @@
 
 #include <switch.h>
 #define DEFAULT_LEAD_FRAMES 10
+#define RELAY_RETRY_FRAMES 50
 
 static const switch_state_handler_table_t audio_bridge_peer_state_handlers;
 static void cleanup_proxy_mode_a(switch_core_session_t *session);
@@ -354,6 +355,29 @@ struct switch_ivr_bridge_data {
 };
 typedef struct switch_ivr_bridge_data switch_ivr_bridge_data_t;
 
+/* Conditions the RTP relay needs on top of the media checks done by switch_core_media_relay_start() */
+static switch_bool_t bridge_relay_ok(switch_core_session_t *session_a, switch_core_session_t *session_b)
+{
+	switch_channel_t *chan_a = switch_core_session_get_channel(session_a);
+	switch_channel_t *chan_b = switch_core_session_get_channel(session_b);
+
+	if (!switch_channel_test_flag(chan_a, CF_AUDIO) || !switch_channel_test_flag(chan_a, CF_ANSWERED) || !switch_channel_test_flag(chan_b, CF_ANSWERED) ||
+		switch_channel_test_flag(chan_a, CF_HOLD) || switch_channel_test_flag(chan_b, CF_LEG_HOLDING) ||
+		switch_channel_test_flag(chan_a, CF_SUSPEND) || switch_channel_test_flag(chan_b, CF_SUSPEND) ||
+		switch_channel_test_flag(chan_a, CF_BRIDGE_NOWRITE) || switch_channel_test_flag(chan_a, CF_TRANSFER) ||
+		switch_channel_has_dtmf(chan_a) || switch_core_session_private_event_count(session_a)) {
+		return SWITCH_FALSE;
+	}
+
+#ifndef SWITCH_VIDEO_IN_THREADS
+	if (switch_channel_test_flag(chan_a, CF_VIDEO) && switch_channel_test_flag(chan_b, CF_VIDEO)) {
+		return SWITCH_FALSE;
+	}
+#endif
+
+	return SWITCH_TRUE;
+}
+
 static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 {
 	switch_ivr_bridge_data_t *data = obj;
@@ -383,6 +407,8 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 	const char *banner_file = NULL;
 	int played_banner = 0, banner_counter = 0;
 	int pass_val = 0, last_pass_val = 0;
+	int rtp_relay = 0, relaying = 0;
+	uint32_t relay_after = RELAY_RETRY_FRAMES;
 
 #ifdef SWITCH_VIDEO_IN_THREADS
 	struct vid_helper vh = { 0 };
@@ -507,6 +533,7 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 	}
 
 	bridge_filter_dtmf = switch_true(switch_channel_get_variable(chan_a, "bridge_filter_dtmf"));
+	rtp_relay = !silence_val && switch_channel_var_true(chan_a, "bridge_rtp_relay");
 
 
 	for (;;) {
@@ -524,6 +551,13 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 			switch_core_session_passthru(session_a, SWITCH_MEDIA_TYPE_AUDIO, pass_val == 2 ? SWITCH_TRUE : SWITCH_FALSE);
 			last_pass_val = pass_val;
 		}
+
+		/* anything the relay can't do on its own puts this leg back on the frame path before it is touched below */
+		if (relaying && !(pass_val == 2 && switch_core_media_relay_running(session_a) && bridge_relay_ok(session_a, session_b))) {
+			switch_core_media_relay_stop(session_a);
+			relaying = 0;
+			relay_after = read_frame_count + RELAY_RETRY_FRAMES;
+		}
 		
 		if (switch_channel_test_flag(chan_a, CF_TRANSFER)) {
 			data->clean_exit = 1;
@@ -799,6 +833,19 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 		}
 
 
+		if (relaying) {
+			switch_core_media_relay_wait(session_a, 100);
+			continue;
+		}
+
+		if (rtp_relay && pass_val == 2 && read_frame_count > relay_after && bridge_relay_ok(session_a, session_b)) {
+			if (switch_core_media_relay_start(session_a, session_b) == SWITCH_STATUS_SUCCESS) {
+				relaying = 1;
+				continue;
+			}
+			relay_after = read_frame_count + RELAY_RETRY_FRAMES;
+		}
+
 		/* read audio from 1 channel and write it to the other */
 		status = switch_core_session_read_frame(session_a, &read_frame, SWITCH_IO_FLAG_NONE, stream_id);
 
@@ -833,6 +880,10 @@ static void *audio_bridge_thread(switch_thread_t *thread, void *obj)
 
   end_of_bridge_loop:
 
+	if (relaying) {
+		switch_core_media_relay_stop(session_a);
+	}
+
 	switch_core_session_passthru(session_a, SWITCH_MEDIA_TYPE_AUDIO, SWITCH_FALSE);
 
 
@@ -152,6 +152,7 @@ typedef struct {
 	switch_caller_profile_t *caller_profile_override;
 	switch_bool_t check_vars;
 	switch_memory_pool_t *pool;
+	switch_state_notify_t ring_notify;
 } originate_global_t;
 
 
@@ -407,6 +408,39 @@ static switch_bool_t monitor_callback(switch_core_session_t *session, const char
 	return SWITCH_FALSE;
 }
 
+/* Attach or detach every leg from the shared ring notifier so the wait loops can sleep until a leg changes state */
+static void originate_watch_legs(originate_global_t *oglobals, originate_status_t *originate_status, int len, switch_bool_t on)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (originate_status[i].peer_channel) {
+			switch_channel_set_state_notify(originate_status[i].peer_channel, on ? &oglobals->ring_notify : NULL);
+		}
+	}
+}
+
+static uint32_t originate_ring_seq(originate_global_t *oglobals)
+{
+	uint32_t seq;
+
+	switch_mutex_lock(oglobals->ring_notify.mutex);
+	seq = oglobals->ring_notify.seq;
+	switch_mutex_unlock(oglobals->ring_notify.mutex);
+
+	return seq;
+}
+
+/* Sleep until a leg changes state or the timeout passes, at once if one already did since seq was taken */
+static void originate_ring_wait(originate_global_t *oglobals, uint32_t seq, switch_interval_time_t timeout)
+{
+	switch_mutex_lock(oglobals->ring_notify.mutex);
+	if (oglobals->ring_notify.seq == seq) {
+		switch_thread_cond_timedwait(oglobals->ring_notify.cond, oglobals->ring_notify.mutex, timeout);
+	}
+	switch_mutex_unlock(oglobals->ring_notify.mutex);
+}
+
 static void inherit_codec(switch_channel_t *caller_channel, switch_core_session_t *session)
 {
 	const char *var = switch_channel_get_variable(caller_channel, "inherit_codec");
@@ -491,6 +525,10 @@ static uint8_t check_channel_status(originate_global_t *oglobals, originate_stat
 				originate_status[i].caller_profile = switch_channel_get_caller_profile(originate_status[i].peer_channel);
 				switch_channel_set_flag(originate_status[i].peer_channel, CF_ORIGINATING);
 
+				/* the ring wait now watches the swapped-in leg; the old one must not signal a notify it no longer owns */
+				switch_channel_set_state_notify(switch_core_session_get_channel(old_session), NULL);
+				switch_channel_set_state_notify(originate_status[i].peer_channel, &oglobals->ring_notify);
+
 				switch_channel_answer(originate_status[i].peer_channel);
 
 				switch_channel_set_variable(originate_status[i].peer_channel, "picked_up_uuid", switch_core_session_get_uuid(old_session));
@@ -2018,6 +2056,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 	const char *soft_holding = NULL;
 	early_state_t early_state = { 0 };
 	int read_packet = 0;
+	uint32_t ring_seq = 0;
 	int check_reject = 1;
 	switch_codec_implementation_t read_impl = { 0 };
 	const char *ani_override = NULL;
@@ -2051,6 +2090,8 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 	oglobals.file = NULL;
 	oglobals.error_file = NULL;
 	switch_core_new_memory_pool(&oglobals.pool);
+	switch_mutex_init(&oglobals.ring_notify.mutex, SWITCH_MUTEX_NESTED, oglobals.pool);
+	switch_thread_cond_create(&oglobals.ring_notify.cond, oglobals.pool);
 
 	if (caller_profile_override) {
 		oglobals.caller_profile_override = switch_caller_profile_dup(oglobals.pool, caller_profile_override);
@@ -3151,9 +3192,13 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 			}
 
 			switch_epoch_time_now(&start);
+			originate_watch_legs(&oglobals, originate_status, and_argc, SWITCH_TRUE);
 
 			for (;;) {
 				uint32_t valid_channels = 0;
+
+				ring_seq = originate_ring_seq(&oglobals);
+
 				for (i = 0; i < and_argc; i++) {
 					int state;
 					time_t elapsed;
@@ -3195,8 +3240,6 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 						}
 						goto notready;
 					}
-
-					switch_cond_next();
 				}
 
 				check_per_channel_timeouts(&oglobals, originate_status, and_argc, start, &force_reason);
@@ -3207,6 +3250,7 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 					goto done;
 				}
 
+				originate_ring_wait(&oglobals, ring_seq, 20000);
 			}
 
 		  endfor1:
@@ -3236,6 +3280,8 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 				soft_holding = switch_channel_get_variable(caller_channel, SWITCH_SOFT_HOLDING_UUID_VARIABLE);
 			}
 
+			ring_seq = originate_ring_seq(&oglobals);
+
 			while ((!caller_channel || switch_channel_ready(caller_channel) || switch_channel_test_flag(caller_channel, CF_XFER_ZOMBIE)) &&
 				   check_channel_status(&oglobals, originate_status, and_argc, &force_reason)) {
 				time_t elapsed = switch_epoch_time_now(NULL) - start;
@@ -3482,12 +3528,16 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 			do_continue:
 
 				if (!read_packet) {
-					switch_yield(20000);
+					originate_ring_wait(&oglobals, ring_seq, 20000);
 				}
+
+				ring_seq = originate_ring_seq(&oglobals);
 			}
 
 		  notready:
 
+			originate_watch_legs(&oglobals, originate_status, and_argc, SWITCH_FALSE);
+
 			if (caller_channel) {
 				holding = switch_channel_get_variable(caller_channel, SWITCH_HOLDING_UUID_VARIABLE);
 				switch_channel_set_variable(caller_channel, SWITCH_HOLDING_UUID_VARIABLE, NULL);
@@ -3786,6 +3836,8 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 
 		  done:
 
+			originate_watch_legs(&oglobals, originate_status, and_argc, SWITCH_FALSE);
+
 			*cause = SWITCH_CAUSE_NONE;
 
 			if (caller_channel && !switch_channel_ready(caller_channel)) {
@@ -4115,7 +4167,6 @@ SWITCH_DECLARE(switch_status_t) switch_ivr_originate(switch_core_session_t *sess
 
 	if (bleg && *bleg) {
 		switch_channel_t *bchan = switch_core_session_get_channel(*bleg);
-
 		if (session && caller_channel) {
 			switch_caller_profile_t *cloned_profile, *peer_profile = switch_channel_get_caller_profile(switch_core_session_get_channel(*bleg));
 
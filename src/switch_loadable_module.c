@@ -98,11 +98,16 @@ struct switch_loadable_module_container {
 	switch_hash_t *limit_hash;
 	switch_hash_t *database_hash;
 	switch_hash_t *secondary_recover_hash;
+	switch_hash_t *codec_pref_hash;
+	switch_thread_rwlock_t *codec_pref_rwlock;
+	uint32_t codec_pref_count;
+	uint32_t codec_pref_gen;
 	switch_mutex_t *mutex;
 	switch_memory_pool_t *pool;
 };
 
 static struct switch_loadable_module_container loadable_modules;
+static void codec_pref_cache_flush(void);
 static switch_status_t do_shutdown(switch_loadable_module_t *module, switch_bool_t shutdown, switch_bool_t unload, switch_bool_t fail_if_busy,
 								   const char **err);
 static switch_status_t switch_loadable_module_load_module_ex(const char *dir, const char *fname, switch_bool_t runtime, switch_bool_t global, const char **err, switch_loadable_module_type_t type, switch_hash_t *event_hash);
@@ -260,6 +265,8 @@ static switch_status_t switch_loadable_module_process(char *key, switch_loadable
 						switch_core_hash_insert(loadable_modules.codec_hash, impl->iananame, (const void *) node);
 					}
 
+					codec_pref_cache_flush();
+
 					if (switch_event_create(&event, SWITCH_EVENT_MODULE_LOAD) == SWITCH_STATUS_SUCCESS) {
 						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "type", "codec");
 						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "name", ptr->interface_name);
@@ -1210,6 +1217,8 @@ static switch_status_t switch_loadable_module_unprocess(switch_loadable_module_t
 							}
 						}
 					}
+
+					codec_pref_cache_flush();
 					if (switch_event_create(&event, SWITCH_EVENT_MODULE_UNLOAD) == SWITCH_STATUS_SUCCESS) {
 						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "type", "codec");
 						switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "name", ptr->interface_name);
@@ -2167,6 +2176,8 @@ SWITCH_DECLARE(switch_status_t) switch_loadable_module_init(switch_bool_t autolo
 	switch_core_hash_init_nocase(&loadable_modules.database_hash);
 	switch_core_hash_init_nocase(&loadable_modules.dialplan_hash);
 	switch_core_hash_init(&loadable_modules.secondary_recover_hash);
+	switch_core_hash_init(&loadable_modules.codec_pref_hash);
+	switch_thread_rwlock_create(&loadable_modules.codec_pref_rwlock, loadable_modules.pool);
 	switch_mutex_init(&loadable_modules.mutex, SWITCH_MUTEX_NESTED, loadable_modules.pool);
 
 	if (!autoload) return SWITCH_STATUS_SUCCESS;
@@ -2516,6 +2527,8 @@ SWITCH_DECLARE(void) switch_loadable_module_shutdown(void)
 	switch_core_hash_destroy(&loadable_modules.database_hash);
 	switch_core_hash_destroy(&loadable_modules.dialplan_hash);
 	switch_core_hash_destroy(&loadable_modules.secondary_recover_hash);
+	codec_pref_cache_flush();
+	switch_core_hash_destroy(&loadable_modules.codec_pref_hash);
 
 	switch_core_destroy_memory_pool(&loadable_modules.pool);
 }
@@ -2968,6 +2981,139 @@ SWITCH_DECLARE(int) switch_loadable_module_get_codecs_sorted(const switch_codec_
 	return i;
 }
 
+/* A codec string resolved against the loaded codecs. Entries are immutable once
+   inserted and the whole cache is dropped whenever a codec is added or removed. */
+typedef struct codec_pref_list_s {
+	int num;
+	const switch_codec_implementation_t *codecs[SWITCH_MAX_CODECS];
+	char *fmtp[SWITCH_MAX_CODECS];
+	/* name_mask[i] has bit j set when codecs[i] and codecs[j] share an iana name */
+	uint64_t name_mask[SWITCH_MAX_CODECS];
+} codec_pref_list_t;
+
+#define CODEC_PREF_CACHE_MAX 1024
+
+static void codec_pref_list_free(codec_pref_list_t *list)
+{
+	int i;
+
+	for (i = 0; i < list->num; i++) {
+		switch_safe_free(list->fmtp[i]);
+	}
+
+	free(list);
+}
+
+static void codec_pref_cache_flush(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!loadable_modules.codec_pref_rwlock) {
+		return;
+	}
+
+	switch_thread_rwlock_wrlock(loadable_modules.codec_pref_rwlock);
+	while ((hi = switch_core_hash_first(loadable_modules.codec_pref_hash))) {
+		const void *key;
+
+		switch_core_hash_this(hi, &key, NULL, &val);
+		switch_core_hash_delete(loadable_modules.codec_pref_hash, (const char *) key);
+		switch_safe_free(hi);
+		codec_pref_list_free((codec_pref_list_t *) val);
+	}
+	loadable_modules.codec_pref_count = 0;
+	loadable_modules.codec_pref_gen++;
+	switch_thread_rwlock_unlock(loadable_modules.codec_pref_rwlock);
+}
+
+static codec_pref_list_t *codec_pref_list_compile(const char *codec_string)
+{
+	codec_pref_list_t *list;
+	char fmtp[SWITCH_MAX_CODECS][MAX_FMTP_LEN];
+	char *prefs[SWITCH_MAX_CODECS];
+	char *tmp;
+	int preflen, i, j;
+
+	switch_zmalloc(list, sizeof(*list));
+	tmp = strdup(codec_string);
+	switch_assert(tmp);
+	memset(fmtp, 0, sizeof(fmtp));
+
+	preflen = switch_separate_string(tmp, ',', prefs, SWITCH_MAX_CODECS);
+	list->num = switch_loadable_module_get_codecs_sorted(list->codecs, fmtp, SWITCH_MAX_CODECS, prefs, preflen);
+	free(tmp);
+
+	for (i = 0; i < list->num; i++) {
+		if (*fmtp[i]) {
+			list->fmtp[i] = strdup(fmtp[i]);
+		}
+
+		for (j = 0; j < list->num; j++) {
+			if (!strcasecmp(list->codecs[i]->iananame, list->codecs[j]->iananame)) {
+				list->name_mask[i] |= (uint64_t) 1 << j;
+			}
+		}
+	}
+
+	return list;
+}
+
+SWITCH_DECLARE(int) switch_loadable_module_get_codecs_cached(const char *codec_string, const switch_codec_implementation_t **array,
+															 char fmtp_array[SWITCH_MAX_CODECS][MAX_FMTP_LEN], uint64_t *name_mask, int arraylen)
+{
+	codec_pref_list_t *list, *new_list = NULL;
+	uint32_t gen;
+	int i, num;
+
+	switch_assert(codec_string);
+
+	switch_thread_rwlock_rdlock(loadable_modules.codec_pref_rwlock);
+	list = (codec_pref_list_t *) switch_core_hash_find(loadable_modules.codec_pref_hash, codec_string);
+
+	if (!list) {
+		gen = loadable_modules.codec_pref_gen;
+		switch_thread_rwlock_unlock(loadable_modules.codec_pref_rwlock);
+
+		new_list = codec_pref_list_compile(codec_string);
+
+		switch_thread_rwlock_wrlock(loadable_modules.codec_pref_rwlock);
+		if (!(list = (codec_pref_list_t *) switch_core_hash_find(loadable_modules.codec_pref_hash, codec_string))) {
+			/* a codec came or went while compiling, the result is still right for this call but may not be kept */
+			if (gen == loadable_modules.codec_pref_gen && loadable_modules.codec_pref_count < CODEC_PREF_CACHE_MAX) {
+				switch_core_hash_insert(loadable_modules.codec_pref_hash, codec_string, new_list);
+				loadable_modules.codec_pref_count++;
+				list = new_list;
+				new_list = NULL;
+			} else {
+				list = new_list;
+			}
+		}
+	}
+
+	num = list->num < arraylen ? list->num : arraylen;
+
+	for (i = 0; i < num; i++) {
+		array[i] = list->codecs[i];
+
+		if (list->fmtp[i] && fmtp_array) {
+			switch_set_string(fmtp_array[i], list->fmtp[i]);
+		}
+
+		if (name_mask) {
+			name_mask[i] = list->name_mask[i];
+		}
+	}
+
+	switch_thread_rwlock_unlock(loadable_modules.codec_pref_rwlock);
+
+	if (new_list) {
+		codec_pref_list_free(new_list);
+	}
+
+	return num;
+}
+
 SWITCH_DECLARE(switch_status_t) switch_api_execute(const char *cmd, const char *arg, switch_core_session_t *session, switch_stream_handle_t *stream)
 {
 	switch_api_interface_t *api;
@@ -59,6 +59,8 @@ struct switch_odbc_handle {
 	BOOL is_oracle;
 	int affected_rows;
 	int num_retries;
+	/* bumped on every (re)connect, statements prepared on an older connection are gone */
+	uint32_t generation;
 };
 #endif
 
@@ -396,6 +398,7 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_connect(switch_odbc_hand
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG1, "Connected to [%s]\n", handle->dsn);
 	handle->state = SWITCH_ODBC_STATE_CONNECTED;
+	handle->generation++;
 	return SWITCH_ODBC_SUCCESS;
 #else
 	return SWITCH_ODBC_FAIL;
@@ -537,51 +540,15 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_exec(switch_odbc_handle_
 	return SWITCH_ODBC_FAIL;
 }
 
-SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(const char *file, const char *func, int line,
-																			   switch_odbc_handle_t *handle,
-																			   const char *sql, switch_core_db_callback_func_t callback, void *pdata,
-																			   char **err)
-{
 #ifdef SWITCH_HAVE_ODBC
-	SQLHSTMT stmt = NULL;
-	SQLSMALLINT c = 0, x = 0;
-	SQLLEN m = 0;
-	char *x_err = NULL, *err_str = NULL;
+/* hand every row of an executed statement to the callback, returns the number of fetch errors */
+static int odbc_fetch_rows(SQLHSTMT stmt, SQLSMALLINT c, switch_core_db_callback_func_t callback, void *pdata)
+{
+	SQLSMALLINT x = 0;
 	int result;
 	int err_cnt = 0;
 	int done = 0;
 
-	handle->affected_rows = 0;
-
-	switch_assert(callback != NULL);
-
-	if (!db_is_up(handle)) {
-		x_err = "DB is not up!";
-		goto error;
-	}
-
-	if (SQLAllocHandle(SQL_HANDLE_STMT, handle->con, &stmt) != SQL_SUCCESS) {
-		x_err = "Unable to SQL allocate handle!";
-		goto error;
-	}
-
-	if (SQLPrepare(stmt, (unsigned char *) sql, SQL_NTS) != SQL_SUCCESS) {
-		x_err = "Unable to prepare SQL statement!";
-		goto error;
-	}
-
-	result = SQLExecute(stmt);
-
-	if (result != SQL_SUCCESS && result != SQL_SUCCESS_WITH_INFO && result != SQL_NO_DATA) {
-		x_err = "execute error!";
-		goto error;
-	}
-
-	SQLNumResultCols(stmt, &c);
-	SQLRowCount(stmt, &m);
-	handle->affected_rows = (int) m;
-
-
 	while (!done) {
 		int name_len = 256;
 		char **names;
@@ -639,6 +606,56 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(c
 		free(vals);
 	}
 
+	return err_cnt;
+}
+#endif
+
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(const char *file, const char *func, int line,
+																			   switch_odbc_handle_t *handle,
+																			   const char *sql, switch_core_db_callback_func_t callback, void *pdata,
+																			   char **err)
+{
+#ifdef SWITCH_HAVE_ODBC
+	SQLHSTMT stmt = NULL;
+	SQLSMALLINT c = 0;
+	SQLLEN m = 0;
+	char *x_err = NULL, *err_str = NULL;
+	int result;
+	int err_cnt = 0;
+
+	handle->affected_rows = 0;
+
+	switch_assert(callback != NULL);
+
+	if (!db_is_up(handle)) {
+		x_err = "DB is not up!";
+		goto error;
+	}
+
+	if (SQLAllocHandle(SQL_HANDLE_STMT, handle->con, &stmt) != SQL_SUCCESS) {
+		x_err = "Unable to SQL allocate handle!";
+		goto error;
+	}
+
+	if (SQLPrepare(stmt, (unsigned char *) sql, SQL_NTS) != SQL_SUCCESS) {
+		x_err = "Unable to prepare SQL statement!";
+		goto error;
+	}
+
+	result = SQLExecute(stmt);
+
+	if (result != SQL_SUCCESS && result != SQL_SUCCESS_WITH_INFO && result != SQL_NO_DATA) {
+		x_err = "execute error!";
+		goto error;
+	}
+
+	SQLNumResultCols(stmt, &c);
+	SQLRowCount(stmt, &m);
+	handle->affected_rows = (int) m;
+
+
+	err_cnt = odbc_fetch_rows(stmt, c, callback, pdata);
+
 	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
 	stmt = NULL; /* Make sure we don't try to free this handle again */
 
@@ -674,6 +691,143 @@ SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_callback_exec_detailed(c
 	return SWITCH_ODBC_FAIL;
 }
 
+SWITCH_DECLARE(void) switch_odbc_prepared_free(switch_odbc_handle_t *handle, switch_odbc_prepared_t *prepared)
+{
+#ifdef SWITCH_HAVE_ODBC
+	/* a reconnect already freed the statements of the old connection */
+	if (prepared->stmt && handle && prepared->generation == handle->generation) {
+		SQLFreeHandle(SQL_HANDLE_STMT, prepared->stmt);
+	}
+#endif
+	prepared->stmt = NULL;
+}
+
+SWITCH_DECLARE(switch_odbc_status_t) switch_odbc_handle_exec_params(switch_odbc_handle_t *handle, switch_odbc_prepared_t *prepared,
+																	const char *sql, int argc, char **argv,
+																	const switch_bool_t *is_int, switch_core_db_callback_func_t callback,
+																	void *pdata, char **err)
+{
+#ifdef SWITCH_HAVE_ODBC
+	SQLHSTMT stmt = NULL;
+	SQLSMALLINT c = 0;
+	SQLLEN m = 0;
+	SQLLEN *ind = NULL;
+	char *x_err = NULL, *err_str = NULL;
+	int result;
+	int err_cnt = 0;
+	int i;
+
+	handle->affected_rows = 0;
+
+	if (!db_is_up(handle)) {
+		x_err = "DB is not up!";
+		goto error;
+	}
+
+	if (prepared && prepared->stmt && prepared->generation == handle->generation) {
+		/* prepared on the server by an earlier execution, only the parameters change */
+		stmt = prepared->stmt;
+		SQLFreeStmt(stmt, SQL_CLOSE);
+		SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+	} else {
+		if (prepared) {
+			switch_odbc_prepared_free(handle, prepared);
+		}
+
+		if (SQLAllocHandle(SQL_HANDLE_STMT, handle->con, &stmt) != SQL_SUCCESS) {
+			x_err = "Unable to SQL allocate handle!";
+			goto error;
+		}
+
+		if (SQLPrepare(stmt, (unsigned char *) sql, SQL_NTS) != SQL_SUCCESS) {
+			x_err = "Unable to prepare SQL statement!";
+			goto error;
+		}
+
+		if (prepared) {
+			prepared->stmt = stmt;
+			prepared->generation = handle->generation;
+		}
+	}
+
+	if (argc > 0) {
+		ind = calloc(argc, sizeof(*ind));
+		switch_assert(ind);
+	}
+
+	for (i = 0; i < argc; i++) {
+		SQLULEN size = argv[i] ? (SQLULEN) strlen(argv[i]) : 0;
+
+		ind[i] = argv[i] ? SQL_NTS : SQL_NULL_DATA;
+
+		if (SQLBindParameter(stmt, (SQLUSMALLINT) (i + 1), SQL_PARAM_INPUT, SQL_C_CHAR, (is_int && is_int[i]) ? SQL_BIGINT : SQL_VARCHAR,
+							 size ? size : 1, 0, (SQLPOINTER) argv[i], 0, &ind[i]) != SQL_SUCCESS) {
+			x_err = "Unable to bind SQL parameter!";
+			goto error;
+		}
+	}
+
+	result = SQLExecute(stmt);
+
+	if (result != SQL_SUCCESS && result != SQL_SUCCESS_WITH_INFO && result != SQL_NO_DATA) {
+		x_err = "execute error!";
+		goto error;
+	}
+
+	SQLNumResultCols(stmt, &c);
+	SQLRowCount(stmt, &m);
+	handle->affected_rows = (int) m;
+
+	if (callback && c > 0) {
+		err_cnt = odbc_fetch_rows(stmt, c, callback, pdata);
+	}
+
+	if (prepared) {
+		/* keep it prepared, just let go of the cursor and the bound parameters */
+		SQLFreeStmt(stmt, SQL_CLOSE);
+		SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+	} else {
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	}
+	stmt = NULL;
+	switch_safe_free(ind);
+
+	if (!err_cnt) {
+		return SWITCH_ODBC_SUCCESS;
+	}
+
+  error:
+
+	if (stmt) {
+		err_str = switch_odbc_handle_get_error(handle, stmt);
+	}
+
+	if (zstr(err_str) && !zstr(x_err)) {
+		err_str = strdup(x_err);
+	}
+
+	if (err_str) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "ERR: [%s]\n[%s]\n", sql, switch_str_nil(err_str));
+		if (err) {
+			*err = err_str;
+		} else {
+			free(err_str);
+		}
+	}
+
+	if (stmt) {
+		/* a failed statement is prepared again on the next execution */
+		if (prepared && prepared->stmt == stmt) {
+			prepared->stmt = NULL;
+		}
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	}
+
+	switch_safe_free(ind);
+#endif
+	return SWITCH_ODBC_FAIL;
+}
+
 SWITCH_DECLARE(void) switch_odbc_handle_destroy(switch_odbc_handle_t **handlep)
 {
 #ifdef SWITCH_HAVE_ODBC
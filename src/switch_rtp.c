@@ -261,6 +261,8 @@ typedef struct {
 	int missed_count;
 	char last_sent_id[13];
 	switch_time_t last_ok;
+	switch_stun_hmac_t *hmac;
+	switch_stun_hmac_t *rhmac;
 } switch_rtp_ice_t;
 
 struct switch_rtp;
@@ -284,12 +286,12 @@ typedef struct switch_dtls_s {
 	void *data;
 	switch_socket_t *sock_output;
 	switch_sockaddr_t *remote_addr;
-	char *rsa;
-	char *pvt;
-	char *ca;
-	char *pem;
 	struct switch_rtp *rtp_session;
 	int mtu;
+	uint32_t id;
+	uint32_t pinned;
+	uint32_t jobs;
+	switch_time_t handshake_start;
 } switch_dtls_t;
 
 typedef int (*dtls_state_handler_t)(switch_rtp_t *, switch_dtls_t *);
@@ -482,6 +484,12 @@ struct switch_rtp {
 	uint32_t last_max_vb_frames;
 	int skip_timer;
 	uint32_t prev_nacks_inflight;
+	struct rtp_relay_s *relay;
+	struct rtp_relay_s *relay_in;
+	switch_mutex_t *relay_mutex;
+	switch_thread_cond_t *relay_cond;
+	switch_size_t relay_pending;
+	struct ice_sched_s *ice_sched;
 #ifdef ENABLE_ZRTP
 	zrtp_session_t *zrtp_session;
 	zrtp_profile_t *zrtp_profile;
@@ -799,6 +807,15 @@ static handle_rfc2833_result_t handle_rfc2833(switch_rtp_t *rtp_session, switch_
 
 static int rtp_write_ready(switch_rtp_t *rtp_session, uint32_t bytes, int line);
 static int global_init = 0;
+static void rtp_relay_init(void);
+static void rtp_relay_shutdown(void);
+static void rtp_relay_detach(switch_rtp_t *rtp_session);
+static void dtls_offload_init(void);
+static void dtls_offload_shutdown(void);
+static void ice_sched_init(void);
+static void ice_sched_shutdown(void);
+static void ice_sched_register(switch_rtp_t *rtp_session);
+static void ice_sched_unregister(switch_rtp_t *rtp_session);
 static int rtp_common_write(switch_rtp_t *rtp_session,
 							rtp_msg_t *send_msg, void *data, uint32_t datalen, switch_payload_t payload, uint32_t timestamp, switch_frame_flag_t *flags);
 
@@ -873,7 +890,11 @@ static switch_status_t ice_out(switch_rtp_t *rtp_session, switch_rtp_ice_t *ice)
 			switch_stun_packet_attribute_add_use_candidate(packet);
 		}
 
-		switch_stun_packet_attribute_add_integrity(packet, ice->rpass);
+		if (ice->rhmac) {
+			switch_stun_packet_attribute_add_integrity_hmac(packet, ice->rhmac);
+		} else {
+			switch_stun_packet_attribute_add_integrity(packet, ice->rpass);
+		}
 		switch_stun_packet_attribute_add_fingerprint(packet);
 	}
 
@@ -1234,7 +1255,11 @@ static void handle_ice(switch_rtp_t *rtp_session, switch_rtp_ice_t *ice, void *d
 			switch_stun_packet_attribute_add_xor_binded_address(rpacket, (char *) remote_ip, switch_sockaddr_get_port(from_addr), from_addr->family);
 
 			if ((ice->type & ICE_VANILLA)) {
-				switch_stun_packet_attribute_add_integrity(rpacket, ice->pass);
+				if (ice->hmac) {
+					switch_stun_packet_attribute_add_integrity_hmac(rpacket, ice->hmac);
+				} else {
+					switch_stun_packet_attribute_add_integrity(rpacket, ice->pass);
+				}
 				switch_stun_packet_attribute_add_fingerprint(rpacket);
 			}
 
@@ -1282,6 +1307,12 @@ static void handle_ice(switch_rtp_t *rtp_session, switch_rtp_ice_t *ice, void *d
 				}
 			}
 			
+			if (do_adj && (ice->type & ICE_VANILLA) && ice->hmac && switch_stun_packet_verify_integrity(data, len, ice->hmac) != 1) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING,
+								  "%s ignoring %s candidate change to %s:%u, missing or bad message integrity\n", rtp_session_name(rtp_session), rtp_type(rtp_session), host, port);
+				do_adj = 0;
+			}
+
 			if ((ice->type & ICE_VANILLA) && ice->ice_params && do_adj) {
 				ice->missed_count = 0;
 				ice->rready = 1;
@@ -1327,6 +1358,265 @@ static void handle_ice(switch_rtp_t *rtp_session, switch_rtp_ice_t *ice, void *d
 	READ_DEC(rtp_session);
 }
 
+#define ICE_WHEEL_SLOTS 64
+#define ICE_WHEEL_TICK_MS 20
+
+typedef struct ice_sched_s {
+	switch_rtp_t *rtp_session;
+	struct ice_sched_s *prev;
+	struct ice_sched_s *next;
+	int slot;
+	int pinned;
+	uint8_t kick;
+	uint8_t dead;
+} ice_sched_t;
+
+/* One thread sends the connectivity and consent checks for every ICE session off a timer
+   wheel, so the media threads no longer look at the stun schedule on every read */
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_thread_t *thread;
+	ice_sched_t *wheel[ICE_WHEEL_SLOTS];
+	uint32_t cursor;
+	int running;
+	int started;
+} ice_globals;
+
+static void ice_sched_init(void)
+{
+	switch_core_new_memory_pool(&ice_globals.pool);
+	switch_mutex_init(&ice_globals.mutex, SWITCH_MUTEX_NESTED, ice_globals.pool);
+	switch_thread_cond_create(&ice_globals.cond, ice_globals.pool);
+}
+
+/* callers hold ice_globals.mutex */
+static void ice_sched_link(ice_sched_t *entry, uint32_t ticks)
+{
+	int slot;
+
+	if (ticks < 1) {
+		ticks = 1;
+	} else if (ticks > ICE_WHEEL_SLOTS - 1) {
+		ticks = ICE_WHEEL_SLOTS - 1;
+	}
+
+	slot = (int) ((ice_globals.cursor + ticks) % ICE_WHEEL_SLOTS);
+
+	entry->prev = NULL;
+	entry->next = ice_globals.wheel[slot];
+	if (entry->next) {
+		entry->next->prev = entry;
+	}
+	ice_globals.wheel[slot] = entry;
+	entry->slot = slot;
+}
+
+static void ice_sched_unlink(ice_sched_t *entry)
+{
+	if (entry->slot < 0) {
+		return;
+	}
+
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		ice_globals.wheel[entry->slot] = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+	entry->slot = -1;
+}
+
+/* Send whatever checks are due for one session and return how many ticks until the next one */
+static uint32_t ice_sched_run(ice_sched_t *entry)
+{
+	switch_rtp_t *rtp_session = entry->rtp_session;
+	switch_time_t now, next = 0;
+	uint32_t ticks = ICE_WHEEL_SLOTS - 1;
+
+	/* whoever holds the session may be tearing it down, try again next tick */
+	if (switch_mutex_trylock(rtp_session->ice_mutex) != SWITCH_STATUS_SUCCESS) {
+		return 1;
+	}
+
+	if (switch_rtp_ready(rtp_session)) {
+		if (rtp_session->ice.ice_user) {
+			ice_out(rtp_session, &rtp_session->ice);
+			next = rtp_session->ice.next_run;
+		}
+
+		if (!rtp_session->flags[SWITCH_RTP_FLAG_RTCP_MUX] && rtp_session->rtcp_ice.ice_user) {
+			ice_out(rtp_session, &rtp_session->rtcp_ice);
+			if (!next || (rtp_session->rtcp_ice.next_run && rtp_session->rtcp_ice.next_run < next)) {
+				next = rtp_session->rtcp_ice.next_run;
+			}
+		}
+	}
+
+	switch_mutex_unlock(rtp_session->ice_mutex);
+
+	now = switch_micro_time_now();
+
+	if (next) {
+		ticks = next > now ? (uint32_t) ((next - now + ICE_WHEEL_TICK_MS * 1000 - 1) / (ICE_WHEEL_TICK_MS * 1000)) : 1;
+	}
+
+	return ticks;
+}
+
+static void *SWITCH_THREAD_FUNC ice_sched_thread(switch_thread_t *thread, void *obj)
+{
+	switch_time_t last = switch_micro_time_now();
+	ice_sched_t *entry;
+
+	while (ice_globals.running) {
+		switch_time_t now;
+		uint32_t due;
+
+		switch_yield(ICE_WHEEL_TICK_MS * 1000);
+
+		now = switch_micro_time_now();
+		due = (uint32_t) ((now - last) / (ICE_WHEEL_TICK_MS * 1000));
+
+		if (due > ICE_WHEEL_SLOTS) {
+			due = ICE_WHEEL_SLOTS;
+			last = now;
+		} else {
+			last += (switch_time_t) due * ICE_WHEEL_TICK_MS * 1000;
+		}
+
+		switch_mutex_lock(ice_globals.mutex);
+
+		while (due--) {
+			ice_globals.cursor = (ice_globals.cursor + 1) % ICE_WHEEL_SLOTS;
+
+			while ((entry = ice_globals.wheel[ice_globals.cursor])) {
+				uint32_t ticks;
+
+				ice_sched_unlink(entry);
+				entry->pinned++;
+				switch_mutex_unlock(ice_globals.mutex);
+
+				ticks = ice_sched_run(entry);
+
+				switch_mutex_lock(ice_globals.mutex);
+				entry->pinned--;
+
+				if (!entry->dead) {
+					if (entry->kick) {
+						entry->kick = 0;
+						ticks = 1;
+					}
+					ice_sched_link(entry, ticks);
+				}
+
+				switch_thread_cond_broadcast(ice_globals.cond);
+			}
+		}
+
+		switch_mutex_unlock(ice_globals.mutex);
+	}
+
+	return NULL;
+}
+
+/* Hand a session's checks to the scheduler, or just pull its next check forward if it is already there */
+static void ice_sched_register(switch_rtp_t *rtp_session)
+{
+	ice_sched_t *entry;
+
+	if (!ice_globals.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(ice_globals.mutex);
+
+	if (!ice_globals.started) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		ice_globals.running = 1;
+		switch_threadattr_create(&thd_attr, ice_globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+		if (switch_thread_create(&ice_globals.thread, thd_attr, ice_sched_thread, NULL, ice_globals.pool) == SWITCH_STATUS_SUCCESS) {
+			ice_globals.started = 1;
+		} else {
+			ice_globals.running = 0;
+			ice_globals.thread = NULL;
+		}
+	}
+
+	if (!ice_globals.started) {
+		goto end;
+	}
+
+	if ((entry = rtp_session->ice_sched)) {
+		if (entry->slot >= 0) {
+			ice_sched_unlink(entry);
+			ice_sched_link(entry, 1);
+		} else {
+			entry->kick = 1;
+		}
+	} else if ((entry = calloc(1, sizeof(*entry)))) {
+		entry->rtp_session = rtp_session;
+		ice_sched_link(entry, 1);
+		rtp_session->ice_sched = entry;
+	}
+
+ end:
+
+	switch_mutex_unlock(ice_globals.mutex);
+}
+
+/* Take a session off the wheel and wait out a check that is already in flight */
+static void ice_sched_unregister(switch_rtp_t *rtp_session)
+{
+	ice_sched_t *entry = rtp_session->ice_sched;
+
+	if (!entry) {
+		return;
+	}
+
+	if (ice_globals.mutex) {
+		switch_mutex_lock(ice_globals.mutex);
+		ice_sched_unlink(entry);
+		entry->dead = 1;
+		while (entry->pinned) {
+			switch_thread_cond_wait(ice_globals.cond, ice_globals.mutex);
+		}
+		rtp_session->ice_sched = NULL;
+		switch_mutex_unlock(ice_globals.mutex);
+	} else {
+		rtp_session->ice_sched = NULL;
+	}
+
+	free(entry);
+}
+
+static void ice_sched_shutdown(void)
+{
+	switch_status_t st;
+
+	ice_globals.running = 0;
+
+	if (ice_globals.started) {
+		switch_thread_join(&st, ice_globals.thread);
+		ice_globals.thread = NULL;
+		ice_globals.started = 0;
+	}
+
+	if (ice_globals.pool) {
+		ice_globals.mutex = NULL;
+		switch_core_destroy_memory_pool(&ice_globals.pool);
+	}
+}
+
 #ifdef ENABLE_ZRTP
 SWITCH_STANDARD_SCHED_FUNC(zrtp_cache_save_callback)
 {
@@ -1525,6 +1815,9 @@ SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 	srtp_init();
 #endif
 	switch_mutex_init(&port_lock, SWITCH_MUTEX_NESTED, pool);
+	rtp_relay_init();
+	dtls_offload_init();
+	ice_sched_init();
 	global_init = 1;
 }
 
@@ -2442,6 +2735,11 @@ static int check_rtcp_and_ice(switch_rtp_t *rtp_session)
 		}
 	}
 
+	if (rtp_session->ice_sched) {
+		/* the ice scheduler thread sends our checks */
+		goto end;
+	}
+
 	if (rtp_session->ice.ice_user) {
 		if (ice_out(rtp_session, &rtp_session->ice) == SWITCH_STATUS_GENERR) {
 			ret = -1;
@@ -2502,6 +2800,10 @@ SWITCH_DECLARE(void) switch_rtp_shutdown(void)
 	switch_core_hash_destroy(&alloc_hash);
 	switch_mutex_unlock(port_lock);
 
+	rtp_relay_shutdown();
+	dtls_offload_shutdown();
+	ice_sched_shutdown();
+
 #ifdef ENABLE_ZRTP
 	if (zrtp_on) {
 		zrtp_status_t status = zrtp_status_ok;
@@ -2893,6 +3195,10 @@ SWITCH_DECLARE(void) switch_rtp_set_media_timeout(switch_rtp_t *rtp_session, uin
 					  "%s MEDIA TIMEOUT %s set to %u", switch_core_session_get_name(rtp_session->session), rtp_type(rtp_session), ms);
 	rtp_session->media_timeout = ms;
 	switch_rtp_reset_media_timer(rtp_session);
+
+	if (ms) {
+		switch_rtp_relay_suspend(rtp_session);
+	}
 }
 
 SWITCH_DECLARE(void) switch_rtp_set_max_missed_packets(switch_rtp_t *rtp_session, uint32_t max)
@@ -3147,6 +3453,76 @@ static const char *dtls_state_names(dtls_state_t s)
 #define cr_saltlen 14
 #define cr_kslen 30
 
+#define DTLS_MAX_WORKERS 32
+#define DTLS_WORKER_QUEUE_LEN 1024
+#define DTLS_HS_BUCKETS 9
+
+static const uint32_t dtls_hs_bucket_ms[DTLS_HS_BUCKETS - 1] = { 10, 25, 50, 100, 250, 500, 1000, 2500 };
+
+typedef struct dtls_job_s {
+	uint32_t id;
+	switch_size_t bytes;
+	uint8_t data[1];
+} dtls_job_t;
+
+/* Handshakes run on a small worker pool so a burst of them can't stall the media threads */
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	switch_inthash_t *hash;
+	switch_queue_t *queue[DTLS_MAX_WORKERS];
+	switch_thread_t *thread[DTLS_MAX_WORKERS];
+	uint32_t workers;
+	uint32_t started;
+	uint32_t next_id;
+	int running;
+	uint64_t histogram[DTLS_HS_BUCKETS];
+	uint64_t handshakes;
+	uint64_t resumed;
+	uint64_t failed;
+	uint64_t offloaded;
+	switch_time_t total_us;
+	switch_time_t max_us;
+} dtls_globals = { NULL, NULL, NULL, NULL, { 0 }, { 0 }, 2 };
+
+static void *SWITCH_THREAD_FUNC dtls_worker_thread(switch_thread_t *thread, void *obj);
+
+static void dtls_offload_init(void)
+{
+	switch_core_new_memory_pool(&dtls_globals.pool);
+	switch_mutex_init(&dtls_globals.mutex, SWITCH_MUTEX_NESTED, dtls_globals.pool);
+	switch_thread_cond_create(&dtls_globals.cond, dtls_globals.pool);
+	switch_core_inthash_init(&dtls_globals.hash);
+}
+
+static void dtls_record_handshake(switch_dtls_t *dtls, int ok)
+{
+	switch_time_t us = dtls->handshake_start ? switch_micro_time_now() - dtls->handshake_start : 0;
+	int i;
+
+	if (!dtls_globals.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(dtls_globals.mutex);
+	if (!ok) {
+		dtls_globals.failed++;
+	} else {
+		for (i = 0; i < DTLS_HS_BUCKETS - 1 && us >= (switch_time_t) dtls_hs_bucket_ms[i] * 1000; i++);
+		dtls_globals.histogram[i]++;
+		dtls_globals.handshakes++;
+		dtls_globals.total_us += us;
+		if (us > dtls_globals.max_us) {
+			dtls_globals.max_us = us;
+		}
+		if (SSL_session_reused(dtls->ssl)) {
+			dtls_globals.resumed++;
+		}
+	}
+	switch_mutex_unlock(dtls_globals.mutex);
+}
+
 static int dtls_state_setup(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 {
 	X509 *cert;
@@ -3264,18 +3640,81 @@ static int dtls_state_handshake(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 			break;
 		default:
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s Handshake failure %d. This may happen when you use legacy DTLS v1.0 (legacyDTLS channel var is set) but endpoint requires DTLS v1.2.\n", rtp_type(rtp_session), ret);
+			dtls_record_handshake(dtls, 0);
 			dtls_set_state(dtls, DS_FAIL);
 			return -1;
 		}
 	}
 
 	if (SSL_is_init_finished(dtls->ssl)) {
+		dtls_record_handshake(dtls, 1);
 		dtls_set_state(dtls, DS_SETUP);
 	}
 
 	return 0;
 }
 
+/* Give a dtls an id the workers can look it up by, starting the workers the first time */
+static void dtls_offload_register(switch_dtls_t *dtls)
+{
+	uint32_t i;
+
+	if (!dtls_globals.mutex || !dtls_globals.workers) {
+		return;
+	}
+
+	switch_mutex_lock(dtls_globals.mutex);
+
+	if (!dtls_globals.started) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		dtls_globals.running = 1;
+		switch_threadattr_create(&thd_attr, dtls_globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+		for (i = 0; i < dtls_globals.workers && i < DTLS_MAX_WORKERS; i++) {
+			switch_queue_create(&dtls_globals.queue[i], DTLS_WORKER_QUEUE_LEN, dtls_globals.pool);
+
+			if (switch_thread_create(&dtls_globals.thread[i], thd_attr, dtls_worker_thread, dtls_globals.queue[i], dtls_globals.pool) != SWITCH_STATUS_SUCCESS) {
+				dtls_globals.thread[i] = NULL;
+				break;
+			}
+		}
+
+		dtls_globals.started = i;
+
+		if (i) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Started %u DTLS handshake worker%s\n", i, i == 1 ? "" : "s");
+		}
+	}
+
+	if (dtls_globals.started) {
+		if (!++dtls_globals.next_id) {
+			dtls_globals.next_id++;
+		}
+		dtls->id = dtls_globals.next_id;
+		switch_core_inthash_insert(dtls_globals.hash, dtls->id, dtls);
+	}
+
+	switch_mutex_unlock(dtls_globals.mutex);
+}
+
+/* Make sure no worker is, or will be, using a dtls that is about to be freed */
+static void dtls_offload_unregister(switch_dtls_t *dtls)
+{
+	if (!dtls->id || !dtls_globals.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(dtls_globals.mutex);
+	switch_core_inthash_delete(dtls_globals.hash, dtls->id);
+	while (dtls->pinned) {
+		switch_thread_cond_wait(dtls_globals.cond, dtls_globals.mutex);
+	}
+	dtls->id = 0;
+	switch_mutex_unlock(dtls_globals.mutex);
+}
+
 static void free_dtls(switch_dtls_t **dtlsp)
 {
 	switch_dtls_t *dtls;
@@ -3287,6 +3726,8 @@ static void free_dtls(switch_dtls_t **dtlsp)
 	dtls = *dtlsp;
 	*dtlsp = NULL;
 
+	dtls_offload_unregister(dtls);
+
 	if (dtls->ssl) {
 		SSL_free(dtls->ssl);
 	}
@@ -3296,25 +3737,20 @@ static void free_dtls(switch_dtls_t **dtlsp)
 	}
 }
 
-static int do_dtls(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
+static int dtls_process(switch_rtp_t *rtp_session, switch_dtls_t *dtls, void *data, switch_size_t data_bytes)
 {
 	int r = 0, ret = 0, len;
 	switch_size_t bytes;
 	unsigned char buf[MAX_DTLS_MTU] = "";
-	int ready = rtp_session->ice.ice_user ? (rtp_session->ice.rready && rtp_session->ice.ready) : 1;
 	int pending;
 
-	if (!dtls->bytes && !ready) {
-		return 0;
-	}
-
-	if (dtls->bytes > 0 && dtls->data) {
-		ret = BIO_write(dtls->read_bio, dtls->data, (int)dtls->bytes);
+	if (data_bytes > 0 && data) {
+		ret = BIO_write(dtls->read_bio, data, (int)data_bytes);
 		if (ret <= 0) {
 			ret = SSL_get_error(dtls->ssl, ret);
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS packet decode err: SSL err %d\n", rtp_type(rtp_session), ret);
-		} else if (ret != (int)dtls->bytes) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS packet decode err: read %d bytes instead of %d\n", rtp_type(rtp_session), ret, (int)dtls->bytes);
+		} else if (ret != (int)data_bytes) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS packet decode err: read %d bytes instead of %d\n", rtp_type(rtp_session), ret, (int)data_bytes);
 		}
 	}
 
@@ -3344,6 +3780,161 @@ static int do_dtls(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
 	return r;
 }
 
+/* Queue the current packet (or a nudge to drive timers) for the worker that owns this dtls, called with ice_mutex held */
+static switch_status_t dtls_offload(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
+{
+	dtls_job_t *job;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (!dtls->id || dtls->state != DS_HANDSHAKE) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_mutex_lock(dtls_globals.mutex);
+
+	if (!dtls->bytes && dtls->jobs) {
+		/* the worker will look at the handshake timers anyway */
+		status = SWITCH_STATUS_SUCCESS;
+		goto end;
+	}
+
+	job = malloc(sizeof(*job) + dtls->bytes);
+	switch_assert(job);
+	job->id = dtls->id;
+	job->bytes = dtls->data ? dtls->bytes : 0;
+	if (job->bytes) {
+		memcpy(job->data, dtls->data, job->bytes);
+	}
+
+	if (switch_queue_trypush(dtls_globals.queue[dtls->id % dtls_globals.started], job) == SWITCH_STATUS_SUCCESS) {
+		dtls->jobs++;
+		dtls_globals.offloaded++;
+		status = SWITCH_STATUS_SUCCESS;
+	} else {
+		free(job);
+	}
+
+ end:
+
+	switch_mutex_unlock(dtls_globals.mutex);
+
+	return status;
+}
+
+static void dtls_worker_run(dtls_job_t *job)
+{
+	switch_dtls_t *dtls;
+
+	switch_mutex_lock(dtls_globals.mutex);
+	if ((dtls = switch_core_inthash_find(dtls_globals.hash, job->id))) {
+		dtls->pinned++;
+		dtls->jobs--;
+	}
+	switch_mutex_unlock(dtls_globals.mutex);
+
+	while (dtls) {
+		switch_rtp_t *rtp_session = dtls->rtp_session;
+
+		if (switch_mutex_trylock(rtp_session->ice_mutex) == SWITCH_STATUS_SUCCESS) {
+			if (dtls->state == DS_HANDSHAKE) {
+				dtls_process(rtp_session, dtls, job->data, job->bytes);
+			} else if (job->bytes) {
+				/* setup and key export stay on the media thread, just hand it the data */
+				BIO_write(dtls->read_bio, job->data, (int) job->bytes);
+			}
+			switch_mutex_unlock(rtp_session->ice_mutex);
+			break;
+		}
+
+		/* whoever holds the session may be freeing this dtls, step aside until it is done */
+		switch_mutex_lock(dtls_globals.mutex);
+		dtls->pinned--;
+		switch_thread_cond_broadcast(dtls_globals.cond);
+		switch_mutex_unlock(dtls_globals.mutex);
+
+		switch_cond_next();
+
+		switch_mutex_lock(dtls_globals.mutex);
+		if ((dtls = switch_core_inthash_find(dtls_globals.hash, job->id))) {
+			dtls->pinned++;
+		}
+		switch_mutex_unlock(dtls_globals.mutex);
+	}
+
+	if (dtls) {
+		switch_mutex_lock(dtls_globals.mutex);
+		dtls->pinned--;
+		switch_thread_cond_broadcast(dtls_globals.cond);
+		switch_mutex_unlock(dtls_globals.mutex);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC dtls_worker_thread(switch_thread_t *thread, void *obj)
+{
+	switch_queue_t *queue = (switch_queue_t *) obj;
+	void *pop = NULL;
+
+	while (dtls_globals.running) {
+		if (switch_queue_pop_timeout(queue, &pop, 100000) != SWITCH_STATUS_SUCCESS || !pop) {
+			continue;
+		}
+
+		dtls_worker_run((dtls_job_t *) pop);
+		free(pop);
+		pop = NULL;
+	}
+
+	while (switch_queue_trypop(queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		free(pop);
+	}
+
+	return NULL;
+}
+
+static void dtls_offload_shutdown(void)
+{
+	switch_status_t st;
+	uint32_t i;
+
+	dtls_globals.running = 0;
+
+	for (i = 0; i < dtls_globals.started; i++) {
+		switch_queue_interrupt_all(dtls_globals.queue[i]);
+		switch_thread_join(&st, dtls_globals.thread[i]);
+		dtls_globals.thread[i] = NULL;
+	}
+
+	dtls_globals.started = 0;
+
+	if (dtls_globals.hash) {
+		switch_core_inthash_destroy(&dtls_globals.hash);
+	}
+
+	if (dtls_globals.pool) {
+		dtls_globals.mutex = NULL;
+		switch_core_destroy_memory_pool(&dtls_globals.pool);
+	}
+}
+
+static int do_dtls(switch_rtp_t *rtp_session, switch_dtls_t *dtls)
+{
+	int ready = rtp_session->ice.ice_user ? (rtp_session->ice.rready && rtp_session->ice.ready) : 1;
+
+	if (!dtls->bytes && !ready) {
+		return 0;
+	}
+
+	if (!dtls->handshake_start) {
+		dtls->handshake_start = switch_micro_time_now();
+	}
+
+	if (dtls_offload(rtp_session, dtls) == SWITCH_STATUS_SUCCESS) {
+		return 0;
+	}
+
+	return dtls_process(rtp_session, dtls, dtls->data, dtls->bytes);
+}
+
 #if VERIFY
 static int cb_verify_peer(int preverify_ok, X509_STORE_CTX *ctx)
 {
@@ -3588,6 +4179,57 @@ static BIO_METHOD *dtls_bio_filter_methods = NULL;
 
 
 
+SWITCH_DECLARE(void) switch_rtp_set_dtls_workers(uint32_t workers)
+{
+	if (workers > DTLS_MAX_WORKERS) {
+		workers = DTLS_MAX_WORKERS;
+	}
+
+	/* takes effect when the workers start with the first DTLS session */
+	dtls_globals.workers = workers;
+}
+
+SWITCH_DECLARE(void) switch_rtp_dtls_stats(switch_stream_handle_t *stream)
+{
+	uint64_t histogram[DTLS_HS_BUCKETS];
+	uint64_t handshakes, resumed, failed, offloaded;
+	switch_time_t total_us, max_us;
+	uint32_t workers;
+	int i;
+
+	if (!dtls_globals.mutex) {
+		stream->write_function(stream, "-ERR DTLS is not initialized\n");
+		return;
+	}
+
+	switch_mutex_lock(dtls_globals.mutex);
+	memcpy(histogram, dtls_globals.histogram, sizeof(histogram));
+	handshakes = dtls_globals.handshakes;
+	resumed = dtls_globals.resumed;
+	failed = dtls_globals.failed;
+	offloaded = dtls_globals.offloaded;
+	total_us = dtls_globals.total_us;
+	max_us = dtls_globals.max_us;
+	workers = dtls_globals.started;
+	switch_mutex_unlock(dtls_globals.mutex);
+
+	stream->write_function(stream, "workers: %u\n", workers);
+	stream->write_function(stream, "handshakes: %" SWITCH_UINT64_T_FMT "\n", handshakes);
+	stream->write_function(stream, "resumed: %" SWITCH_UINT64_T_FMT "\n", resumed);
+	stream->write_function(stream, "failed: %" SWITCH_UINT64_T_FMT "\n", failed);
+	stream->write_function(stream, "offloaded packets: %" SWITCH_UINT64_T_FMT "\n", offloaded);
+	stream->write_function(stream, "avg ms: %.1f\n", handshakes ? (double) total_us / handshakes / 1000.0 : 0.0);
+	stream->write_function(stream, "max ms: %.1f\n", (double) max_us / 1000.0);
+
+	for (i = 0; i < DTLS_HS_BUCKETS; i++) {
+		if (i < DTLS_HS_BUCKETS - 1) {
+			stream->write_function(stream, "< %ums: %" SWITCH_UINT64_T_FMT "\n", dtls_hs_bucket_ms[i], histogram[i]);
+		} else {
+			stream->write_function(stream, ">= %ums: %" SWITCH_UINT64_T_FMT "\n", dtls_hs_bucket_ms[i - 1], histogram[i]);
+		}
+	}
+}
+
 SWITCH_DECLARE(int) switch_rtp_has_dtls(void) {
 #ifdef HAVE_OPENSSL_DTLS_SRTP
 	return 1;
@@ -3700,14 +4342,8 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 {
 	switch_dtls_t *dtls;
 	const char *var;
-	int ret;
 	const char *kind = "";
-	BIO *bio;
-	DH *dh;
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
-#ifndef OPENSSL_NO_EC
-	EC_KEY* ecdh;
-#endif
 
 #ifndef HAVE_OPENSSL_DTLS_SRTP
 	return SWITCH_STATUS_FALSE;
@@ -3734,59 +4370,19 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 	}
 
 	switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_INFO,
-					  "Activate %s %s DTLS %s\n", kind, rtp_type(rtp_session), (type & DTLS_TYPE_SERVER) ? "server" : "client");
-
-	if (((type & DTLS_TYPE_RTP) && rtp_session->dtls) || ((type & DTLS_TYPE_RTCP) && rtp_session->rtcp_dtls)) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING, "DTLS ALREADY INIT\n");
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-
-	dtls = switch_core_alloc(rtp_session->pool, sizeof(*dtls));
-
-	dtls->pem = switch_core_sprintf(rtp_session->pool, "%s%s%s.pem", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, DTLS_SRTP_FNAME);
-
-	if (switch_file_exists(dtls->pem, rtp_session->pool) == SWITCH_STATUS_SUCCESS) {
-		dtls->pvt = dtls->rsa = dtls->pem;
-	} else {
-		dtls->pvt = switch_core_sprintf(rtp_session->pool, "%s%s%s.key", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, DTLS_SRTP_FNAME);
-		dtls->rsa = switch_core_sprintf(rtp_session->pool, "%s%s%s.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR, DTLS_SRTP_FNAME);
-	}
-
-	dtls->ca = switch_core_sprintf(rtp_session->pool, "%s%sca-bundle.crt", SWITCH_GLOBAL_dirs.certs_dir, SWITCH_PATH_SEPARATOR);
-
-#if OPENSSL_VERSION_NUMBER >= 0x10100000
-	dtls->ssl_ctx = SSL_CTX_new((type & DTLS_TYPE_SERVER) ? DTLS_server_method() : DTLS_client_method());
-#else
-    #ifdef HAVE_OPENSSL_DTLSv1_2_method
-	        dtls->ssl_ctx = SSL_CTX_new((type & DTLS_TYPE_SERVER) ? (want_DTLSv1_2 ? DTLSv1_2_server_method() : DTLSv1_server_method()) : (want_DTLSv1_2 ? DTLSv1_2_client_method() : DTLSv1_client_method()));
-    #else
-            dtls->ssl_ctx = SSL_CTX_new((type & DTLS_TYPE_SERVER) ? DTLSv1_server_method() : DTLSv1_client_method());
-    #endif // HAVE_OPENSSL_DTLSv1_2_method
-#endif
-	switch_assert(dtls->ssl_ctx);
+					  "Activate %s %s DTLS %s\n", kind, rtp_type(rtp_session), (type & DTLS_TYPE_SERVER) ? "server" : "client");
 
-	bio = BIO_new_file(dtls->pem, "r");
-	dh = PEM_read_bio_DHparams(bio, NULL, NULL, NULL);
-	BIO_free(bio);
-	if (dh) {
-		SSL_CTX_set_tmp_dh(dtls->ssl_ctx, dh);
-		DH_free(dh);
+	if (((type & DTLS_TYPE_RTP) && rtp_session->dtls) || ((type & DTLS_TYPE_RTCP) && rtp_session->rtcp_dtls)) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_WARNING, "DTLS ALREADY INIT\n");
+		switch_goto_status(SWITCH_STATUS_FALSE, done);
 	}
 
-	SSL_CTX_set_mode(dtls->ssl_ctx, SSL_MODE_AUTO_RETRY);
-
-	//SSL_CTX_set_verify(dtls->ssl_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
-	SSL_CTX_set_verify(dtls->ssl_ctx, SSL_VERIFY_NONE, NULL);
+	dtls = switch_core_alloc(rtp_session->pool, sizeof(*dtls));
 
-	//SSL_CTX_set_cipher_list(dtls->ssl_ctx, "ECDH:!RC4:!SSLv3:RSA_WITH_AES_128_CBC_SHA");
-	//SSL_CTX_set_cipher_list(dtls->ssl_ctx, "ECDHE-RSA-AES256-GCM-SHA384");
-	SSL_CTX_set_cipher_list(dtls->ssl_ctx, "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH");
-	//SSL_CTX_set_cipher_list(dtls->ssl_ctx, "SUITEB128");
-	SSL_CTX_set_read_ahead(dtls->ssl_ctx, 1);
-#ifdef HAVE_OPENSSL_DTLS_SRTP
-	//SSL_CTX_set_tlsext_use_srtp(dtls->ssl_ctx, "SRTP_AES128_CM_SHA1_80:SRTP_AES128_CM_SHA1_32");
-	SSL_CTX_set_tlsext_use_srtp(dtls->ssl_ctx, "SRTP_AES128_CM_SHA1_80");
-#endif
+	if (!(dtls->ssl_ctx = switch_core_cert_dtls_ctx(DTLS_SRTP_FNAME, (type & DTLS_TYPE_SERVER), want_DTLSv1_2))) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS context err\n", rtp_type(rtp_session));
+		switch_goto_status(SWITCH_STATUS_FALSE, done);
+	}
 
 	dtls->type = type;
 	dtls->read_bio = BIO_new(BIO_s_mem());
@@ -3798,29 +4394,6 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 	BIO_set_mem_eof_return(dtls->read_bio, -1);
 	BIO_set_mem_eof_return(dtls->write_bio, -1);
 
-	if ((ret=SSL_CTX_use_certificate_file(dtls->ssl_ctx, dtls->rsa, SSL_FILETYPE_PEM)) != 1) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS cert err [%d]\n", rtp_type(rtp_session), SSL_get_error(dtls->ssl, ret));
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-
-	if ((ret=SSL_CTX_use_PrivateKey_file(dtls->ssl_ctx, dtls->pvt, SSL_FILETYPE_PEM)) != 1) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS key err [%d]\n", rtp_type(rtp_session), SSL_get_error(dtls->ssl, ret));
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-
-	if (SSL_CTX_check_private_key(dtls->ssl_ctx) == 0) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS check key failed\n", rtp_type(rtp_session));
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-
-	if (!zstr(dtls->ca) && switch_file_exists(dtls->ca, rtp_session->pool) == SWITCH_STATUS_SUCCESS
-		&& (ret = SSL_CTX_load_verify_locations(dtls->ssl_ctx, dtls->ca, NULL)) != 1) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(rtp_session->session), SWITCH_LOG_ERROR, "%s DTLS check chain cert failed [%d]\n",
-						  rtp_type(rtp_session) ,
-						  SSL_get_error(dtls->ssl, ret));
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-
 	dtls->ssl = SSL_new(dtls->ssl_ctx);
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
@@ -3846,16 +4419,6 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 
 	//SSL_set_verify(dtls->ssl, (SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT), cb_verify_peer);
 
-#ifndef OPENSSL_NO_EC
-	ecdh = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
-	if (!ecdh) {
-		switch_goto_status(SWITCH_STATUS_FALSE, done);
-	}
-	SSL_set_options(dtls->ssl, SSL_OP_SINGLE_ECDH_USE);
-	SSL_set_tmp_ecdh(dtls->ssl, ecdh);
-	EC_KEY_free(ecdh);
-#endif
-
 	SSL_set_verify(dtls->ssl, SSL_VERIFY_NONE, NULL);
 	SSL_set_app_data(dtls->ssl, dtls);
 
@@ -3900,6 +4463,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_add_dtls(switch_rtp_t *rtp_session, d
 		SSL_set_connect_state(dtls->ssl);
 	}
 
+	dtls_offload_register(dtls);
 	dtls_set_state(dtls, DS_HANDSHAKE);
 
 	rtp_session->flags[SWITCH_RTP_FLAG_VIDEO_BREAK] = 1;
@@ -4788,6 +5352,7 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_rtcp(switch_rtp_t *rtp_sessi
 	}
 
 	rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP] = 1;
+	switch_rtp_relay_suspend(rtp_session);
 
 	if (!(rtp_session->remote_rtcp_port = remote_port)) {
 		rtp_session->remote_rtcp_port = rtp_session->remote_port + 1;
@@ -4887,6 +5452,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_ice(switch_rtp_t *rtp_sessio
 		ice->rpass = switch_core_strdup(rtp_session->pool, rpassword);
 	}
 
+	ice->hmac = switch_stun_hmac_create(ice->pass, rtp_session->pool);
+	ice->rhmac = switch_stun_hmac_create(ice->rpass, rtp_session->pool);
+
 	if ((ice->type & ICE_VANILLA) && ice->ice_params) {
 		host = ice->ice_params->cands[ice->ice_params->chosen[ice->proto]][ice->proto].con_addr;
 		port = ice->ice_params->cands[ice->ice_params->chosen[ice->proto]][ice->proto].con_port;
@@ -4919,6 +5487,10 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_activate_ice(switch_rtp_t *rtp_sessio
 		switch_rtp_break(rtp_session);
 	}
 
+	if (!(ice->type & ICE_LITE)) {
+		ice_sched_register(rtp_session);
+	}
+
 	switch_mutex_unlock(rtp_session->ice_mutex);
 
 	return SWITCH_STATUS_SUCCESS;
@@ -5105,6 +5677,9 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 				"NACK: Added to JB: [%u]\n", nack_jb_ok);
 	}
 
+	rtp_relay_detach(*rtp_session);
+	ice_sched_unregister(*rtp_session);
+
 	(*rtp_session)->flags[SWITCH_RTP_FLAG_SHUTDOWN] = 1;
 
 	READ_INC((*rtp_session));
@@ -5829,7 +6404,12 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	}
 	memset(&rtp_session->last_rtp_hdr, 0, sizeof(rtp_session->last_rtp_hdr));
 
-	if (poll_status == SWITCH_STATUS_SUCCESS) {
+	if (rtp_session->relay_pending) {
+		/* the relay thread already read this one into recv_msg and handed it back to us */
+		*bytes = rtp_session->relay_pending;
+		rtp_session->relay_pending = 0;
+		status = SWITCH_STATUS_SUCCESS;
+	} else if (poll_status == SWITCH_STATUS_SUCCESS) {
 		status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
 	} else {
 		*bytes = 0;
@@ -7992,6 +8572,9 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_queue_rfc2833(switch_rtp_t *rtp_sessi
 		abort();
 	}
 
+	/* digits are clocked out from the read path so it has to run again */
+	switch_rtp_relay_suspend(rtp_session);
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
@@ -9223,6 +9806,518 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_write_raw(switch_rtp_t *rtp_session,
 	return status;
 }
 
+#define RTP_RELAY_MAX_SESSIONS 4096
+#define RTP_RELAY_MAX_THREADS 8
+#ifdef MSG_DONTWAIT
+#define RTP_RELAY_BATCH 16
+#else
+#define RTP_RELAY_BATCH 1
+#endif
+
+/* Locking: relay_globals.mutex guards the relay hash, creating and freeing relays and starting
+   the threads. Each relay is guarded by the mutex of the session it reads from, held by its I/O
+   thread for a whole batch, so suspending or stopping a relay waits for the packets already read
+   to go out. Lock relay_globals.mutex first when both are needed. */
+
+typedef struct rtp_relay_shard_s {
+	switch_pollset_t *pollset;
+	switch_thread_t *thread;
+	rtp_msg_t *batch;
+	int running;
+} rtp_relay_shard_t;
+
+typedef struct rtp_relay_s {
+	uint32_t id;
+	switch_rtp_t *rtp_session;
+	switch_rtp_t *peer;
+	switch_mutex_t *mutex;
+	rtp_relay_shard_t *shard;
+	switch_payload_t recv_pt;
+	switch_pollfd_t pfd;
+	uint8_t running;
+	uint8_t ts_set;
+	uint32_t ts_offset;
+	uint32_t packets;
+} rtp_relay_t;
+
+static struct {
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_inthash_t *hash;
+	rtp_relay_shard_t shards[RTP_RELAY_MAX_THREADS];
+	int shard_count;
+	uint32_t next_id;
+	uint32_t count;
+} relay_globals;
+
+static void rtp_relay_init(void)
+{
+	int i, threads = (int) switch_core_cpu_count();
+
+	switch_core_new_memory_pool(&relay_globals.pool);
+	switch_mutex_init(&relay_globals.mutex, SWITCH_MUTEX_NESTED, relay_globals.pool);
+	switch_core_inthash_init(&relay_globals.hash);
+
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > RTP_RELAY_MAX_THREADS) {
+		threads = RTP_RELAY_MAX_THREADS;
+	}
+
+	/* one pollset and I/O thread per shard, the threads start with their first relay */
+	for (i = 0; i < threads; i++) {
+		rtp_relay_shard_t *shard = &relay_globals.shards[i];
+
+		if (switch_pollset_create(&shard->pollset, RTP_RELAY_MAX_SESSIONS / threads, relay_globals.pool, SWITCH_POLLSET_THREADSAFE) != SWITCH_STATUS_SUCCESS) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Thread safe pollsets are not supported here, RTP relay disabled.\n");
+			relay_globals.shard_count = 0;
+			return;
+		}
+
+		shard->batch = switch_core_alloc(relay_globals.pool, sizeof(rtp_msg_t) * RTP_RELAY_BATCH);
+		relay_globals.shard_count++;
+	}
+}
+
+/* must be called with relay->mutex held */
+static void rtp_relay_suspend(rtp_relay_t *relay)
+{
+	if (!relay->running) {
+		return;
+	}
+
+	relay->running = 0;
+	switch_pollset_remove(relay->shard->pollset, &relay->pfd);
+	relay->peer->need_mark = 1;
+
+	if (relay->rtp_session->relay_cond) {
+		switch_thread_cond_signal(relay->rtp_session->relay_cond);
+	}
+}
+
+/* must be called with relay_globals.mutex held */
+static void rtp_relay_destroy(rtp_relay_t *relay)
+{
+	switch_mutex_t *mutex = relay->mutex;
+
+	/* waits for a batch in flight on the I/O thread */
+	switch_mutex_lock(mutex);
+	rtp_relay_suspend(relay);
+	switch_core_inthash_delete(relay_globals.hash, relay->id);
+	relay->rtp_session->relay = NULL;
+	relay->peer->relay_in = NULL;
+	relay_globals.count--;
+	free(relay);
+	switch_mutex_unlock(mutex);
+}
+
+/* Give the packet sitting in recv_msg back to the normal read path and stop relaying */
+static void rtp_relay_hand_off(rtp_relay_t *relay, switch_size_t bytes)
+{
+	relay->rtp_session->relay_pending = bytes;
+	rtp_relay_suspend(relay);
+}
+
+/* Tear down any relay reading from or writing to a session that is going away */
+static void rtp_relay_detach(switch_rtp_t *rtp_session)
+{
+	if (!relay_globals.mutex || (!rtp_session->relay && !rtp_session->relay_in)) {
+		return;
+	}
+
+	switch_mutex_lock(relay_globals.mutex);
+	if (rtp_session->relay) {
+		rtp_relay_destroy(rtp_session->relay);
+	}
+	if (rtp_session->relay_in) {
+		rtp_relay_destroy(rtp_session->relay_in);
+	}
+	switch_mutex_unlock(relay_globals.mutex);
+}
+
+/* Forward one received and already unprotected packet to the peer */
+static switch_status_t rtp_relay_forward(rtp_relay_t *relay, rtp_msg_t *msg, int len)
+{
+	switch_rtp_t *rtp_session = relay->rtp_session, *peer = relay->peer;
+	switch_frame_flag_t frame_flags = SFF_RTP_HEADER;
+	switch_payload_t out_pt;
+	uint32_t ts, hlen;
+	uint8_t *body;
+	uint8_t m;
+
+	body = (uint8_t *) msg->body + (msg->header.cc * 4);
+	hlen = rtp_header_len + (msg->header.cc * 4);
+
+	if (msg->header.x && (int) hlen + 4 <= len) {
+		switch_rtp_hdr_ext_t *ext = (switch_rtp_hdr_ext_t *) body;
+		uint32_t elen = (ntohs((uint16_t) ext->length) * 4) + 4;
+
+		body += elen;
+		hlen += elen;
+	}
+
+	if ((int) hlen > len) {
+		rtp_session->stats.inbound.flaws++;
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	len -= hlen;
+
+	if (msg->header.p && len > 0) {
+		len -= body[len - 1];
+	}
+
+	if (len <= 0) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	rtp_session->stats.inbound.media_bytes += len;
+	rtp_session->stats.inbound.media_packet_count++;
+
+	if (msg->header.pt == relay->recv_pt) {
+		out_pt = peer->payload;
+	} else if ((out_pt = peer->cng_pt) == INVALID_PT) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	ts = ntohl(msg->header.ts);
+	m = (uint8_t) msg->header.m;
+
+	if (!relay->ts_set) {
+		/* carry on from the last timestamp the peer sent so the far end sees one stream */
+		relay->ts_offset = peer->last_write_ts + peer->samples_per_interval - ts;
+		relay->ts_set = 1;
+		m = 1;
+	}
+
+	if (switch_rtp_write_manual(peer, body, (uint32_t) len, m, out_pt, ts + relay->ts_offset, &frame_flags) < 0) {
+		rtp_relay_suspend(relay);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	peer->stats.outbound.raw_bytes += len + rtp_header_len;
+	peer->stats.outbound.media_bytes += len;
+	peer->stats.outbound.packet_count++;
+	peer->stats.outbound.media_packet_count++;
+	relay->packets++;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* Drain up to RTP_RELAY_BATCH packets from the socket per wakeup, unprotect and forward them in order, called with relay->mutex held */
+static void rtp_relay_packets(rtp_relay_t *relay)
+{
+	switch_rtp_t *rtp_session = relay->rtp_session;
+	rtp_msg_t *batch = relay->shard->batch;
+	void *hdrs[RTP_RELAY_BATCH];
+	int lens[RTP_RELAY_BATCH];
+	int32_t flags = 0;
+	int n, i;
+
+	READ_INC(rtp_session);
+
+#ifdef ENABLE_SRTP
+	/* key changes are handled by the normal read path, checked once per batch rather than per packet */
+	if (rtp_session->flags[SWITCH_RTP_FLAG_SECURE_RECV] &&
+		(rtp_session->flags[SWITCH_RTP_FLAG_SECURE_RECV_RESET] || !rtp_session->recv_ctx[rtp_session->srtp_idx_rtp])) {
+		rtp_relay_suspend(relay);
+		goto end;
+	}
+#endif
+
+	for (n = 0; n < RTP_RELAY_BATCH; n++) {
+		rtp_msg_t *msg = &batch[n];
+		switch_size_t bytes = sizeof(*msg);
+
+		if (switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, flags, (void *) msg, &bytes) != SWITCH_STATUS_SUCCESS || !bytes) {
+			if (!n) {
+				rtp_relay_suspend(relay);
+			}
+			break;
+		}
+
+#ifdef MSG_DONTWAIT
+		/* only the first read may block, the rest of the batch is whatever is already queued */
+		flags = MSG_DONTWAIT;
+#endif
+
+		/* stun, dtls, rtcp, pings, dtmf and payload changes all belong to the normal read path */
+		if (bytes < rtp_header_len || msg->header.version != 2 ||
+			(msg->header.pt != relay->recv_pt && (rtp_session->cng_pt == INVALID_PT || msg->header.pt != rtp_session->cng_pt))) {
+			memcpy(&rtp_session->recv_msg, msg, bytes);
+			rtp_relay_hand_off(relay, bytes);
+			break;
+		}
+
+		rtp_session->stats.inbound.raw_bytes += bytes;
+		rtp_session->stats.inbound.packet_count++;
+
+		hdrs[n] = &msg->header;
+		lens[n] = (int) bytes;
+	}
+
+#ifdef ENABLE_SRTP
+	if (n && rtp_session->flags[SWITCH_RTP_FLAG_SECURE_RECV]) {
+		srtp_err_status_t stat[RTP_RELAY_BATCH];
+		int ok;
+
+		ok = srtp_unprotect_batch(rtp_session->recv_ctx[rtp_session->srtp_idx_rtp], hdrs, lens, stat, n,
+								  rtp_session->flags[SWITCH_RTP_FLAG_SECURE_RECV_MKI] ? 1 : 0);
+
+		if (ok < n) {
+			for (i = 0; i < n; i++) {
+				if (stat[i]) {
+					rtp_session->srtp_errs[rtp_session->srtp_idx_rtp]++;
+					rtp_session->stats.inbound.flaws++;
+					lens[i] = 0;
+				}
+			}
+		}
+	}
+#endif
+
+	/* packets read ahead of a hand off were relayable and still go out, in order */
+	for (i = 0; i < n; i++) {
+		if (lens[i] > 0 && rtp_relay_forward(relay, &batch[i], lens[i]) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+	}
+
+ end:
+
+	READ_DEC(rtp_session);
+}
+
+static void *SWITCH_THREAD_FUNC rtp_relay_thread(switch_thread_t *thread, void *obj)
+{
+	rtp_relay_shard_t *shard = (rtp_relay_shard_t *) obj;
+
+	while (shard->running) {
+		const switch_pollfd_t *fds = NULL;
+		int32_t num = 0, i;
+
+		if (switch_pollset_poll(shard->pollset, 100000, &num, &fds) != SWITCH_STATUS_SUCCESS) {
+			continue;
+		}
+
+		for (i = 0; i < num; i++) {
+			rtp_relay_t *relay;
+			switch_mutex_t *mutex = NULL;
+
+			/* the global lock is only held for the lookup, the relay's own lock covers the crypto and the sends */
+			switch_mutex_lock(relay_globals.mutex);
+			if ((relay = switch_core_inthash_find(relay_globals.hash, (uint32_t) (intptr_t) fds[i].client_data))) {
+				mutex = relay->mutex;
+				switch_mutex_lock(mutex);
+			}
+			switch_mutex_unlock(relay_globals.mutex);
+
+			if (!relay) {
+				continue;
+			}
+
+			if (relay->running) {
+				rtp_relay_packets(relay);
+			}
+
+			switch_mutex_unlock(mutex);
+		}
+	}
+
+	return NULL;
+}
+
+static void rtp_relay_shutdown(void)
+{
+	switch_status_t st;
+	int i;
+
+	for (i = 0; i < relay_globals.shard_count; i++) {
+		rtp_relay_shard_t *shard = &relay_globals.shards[i];
+
+		if (shard->thread) {
+			shard->running = 0;
+			switch_thread_join(&st, shard->thread);
+			shard->thread = NULL;
+		}
+	}
+
+	if (relay_globals.hash) {
+		switch_core_inthash_destroy(&relay_globals.hash);
+	}
+
+	if (relay_globals.pool) {
+		switch_core_destroy_memory_pool(&relay_globals.pool);
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rtp_relay_start(switch_rtp_t *rtp_session, switch_rtp_t *peer_rtp_session, switch_payload_t recv_pt)
+{
+	rtp_relay_t *relay;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (!relay_globals.shard_count || !switch_rtp_ready(rtp_session) || !switch_rtp_ready(peer_rtp_session) || rtp_session == peer_rtp_session) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* only plain audio is relayed, anything that needs the read path to run keeps using it */
+	if (rtp_session->flags[SWITCH_RTP_FLAG_VIDEO] || rtp_session->flags[SWITCH_RTP_FLAG_TEXT] || rtp_session->flags[SWITCH_RTP_FLAG_UDPTL] ||
+		rtp_session->flags[SWITCH_RTP_FLAG_PROXY_MEDIA] || rtp_session->flags[SWITCH_RTP_FLAG_RTCP_MUX] ||
+		peer_rtp_session->flags[SWITCH_RTP_FLAG_PROXY_MEDIA] || peer_rtp_session->flags[SWITCH_RTP_FLAG_UDPTL] ||
+		rtp_session->ice.ice_user || peer_rtp_session->ice.ice_user || rtp_session->dtls || peer_rtp_session->dtls ||
+		rtp_session->jb || rtp_session->flags[SWITCH_RTP_FLAG_PAUSE] || peer_rtp_session->flags[SWITCH_RTP_FLAG_PAUSE] ||
+		rtp_session->relay_pending || peer_rtp_session->sending_dtmf || switch_queue_size(peer_rtp_session->dtmf_data.dtmf_queue) ||
+		rtp_session->dtmf_data.in_digit_ts || switch_queue_size(rtp_session->dtmf_data.dtmf_inqueue)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* media timeouts and rtcp reports are driven from the read path, a relayed leg would silently lose both */
+	if (rtp_session->media_timeout || peer_rtp_session->media_timeout ||
+		rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP] || peer_rtp_session->flags[SWITCH_RTP_FLAG_ENABLE_RTCP]) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+#ifdef ENABLE_ZRTP
+	if (zrtp_on) {
+		return SWITCH_STATUS_FALSE;
+	}
+#endif
+
+	switch_mutex_lock(relay_globals.mutex);
+
+	if (rtp_session->relay) {
+		rtp_relay_destroy(rtp_session->relay);
+	}
+
+	if (peer_rtp_session->relay_in || relay_globals.count >= RTP_RELAY_MAX_SESSIONS) {
+		goto end;
+	}
+
+	if (!rtp_session->relay_mutex) {
+		switch_mutex_init(&rtp_session->relay_mutex, SWITCH_MUTEX_NESTED, rtp_session->pool);
+		switch_thread_cond_create(&rtp_session->relay_cond, rtp_session->pool);
+	}
+
+	switch_zmalloc(relay, sizeof(*relay));
+	relay->id = ++relay_globals.next_id;
+	relay->rtp_session = rtp_session;
+	relay->peer = peer_rtp_session;
+	relay->mutex = rtp_session->relay_mutex;
+	relay->shard = &relay_globals.shards[relay->id % relay_globals.shard_count];
+	relay->recv_pt = recv_pt;
+	relay->pfd.desc_type = SWITCH_POLL_SOCKET;
+	relay->pfd.reqevents = SWITCH_POLLIN | SWITCH_POLLERR;
+	relay->pfd.desc.s = rtp_session->sock_input;
+	relay->pfd.client_data = (void *) (intptr_t) relay->id;
+
+	if (!relay->shard->thread) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		relay->shard->running = 1;
+		switch_threadattr_create(&thd_attr, relay_globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_set(thd_attr, SWITCH_PRI_REALTIME);
+
+		if (switch_thread_create(&relay->shard->thread, thd_attr, rtp_relay_thread, relay->shard, relay_globals.pool) != SWITCH_STATUS_SUCCESS) {
+			relay->shard->running = 0;
+			relay->shard->thread = NULL;
+			free(relay);
+			goto end;
+		}
+	}
+
+	switch_core_inthash_insert(relay_globals.hash, relay->id, relay);
+	rtp_session->relay = relay;
+	peer_rtp_session->relay_in = relay;
+	relay_globals.count++;
+
+	switch_mutex_lock(relay->mutex);
+	relay->running = 1;
+
+	if (switch_pollset_add(relay->shard->pollset, &relay->pfd) != SWITCH_STATUS_SUCCESS) {
+		relay->running = 0;
+		switch_mutex_unlock(relay->mutex);
+		rtp_relay_destroy(relay);
+		goto end;
+	}
+
+	switch_mutex_unlock(relay->mutex);
+	status = SWITCH_STATUS_SUCCESS;
+
+ end:
+
+	switch_mutex_unlock(relay_globals.mutex);
+
+	return status;
+}
+
+SWITCH_DECLARE(void) switch_rtp_relay_stop(switch_rtp_t *rtp_session)
+{
+	if (!rtp_session || !relay_globals.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(relay_globals.mutex);
+	if (rtp_session->relay) {
+		rtp_relay_destroy(rtp_session->relay);
+	}
+	switch_mutex_unlock(relay_globals.mutex);
+}
+
+SWITCH_DECLARE(void) switch_rtp_relay_suspend(switch_rtp_t *rtp_session)
+{
+	if (!rtp_session || !relay_globals.mutex || (!rtp_session->relay && !rtp_session->relay_in)) {
+		return;
+	}
+
+	switch_mutex_lock(relay_globals.mutex);
+	if (rtp_session->relay) {
+		switch_mutex_lock(rtp_session->relay->mutex);
+		rtp_relay_suspend(rtp_session->relay);
+		switch_mutex_unlock(rtp_session->relay->mutex);
+	}
+	if (rtp_session->relay_in) {
+		switch_mutex_lock(rtp_session->relay_in->mutex);
+		rtp_relay_suspend(rtp_session->relay_in);
+		switch_mutex_unlock(rtp_session->relay_in->mutex);
+	}
+	switch_mutex_unlock(relay_globals.mutex);
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_rtp_relay_running(switch_rtp_t *rtp_session)
+{
+	switch_bool_t r = SWITCH_FALSE;
+
+	if (!rtp_session || !rtp_session->relay) {
+		return SWITCH_FALSE;
+	}
+
+	switch_mutex_lock(relay_globals.mutex);
+	r = (rtp_session->relay && rtp_session->relay->running) ? SWITCH_TRUE : SWITCH_FALSE;
+	switch_mutex_unlock(relay_globals.mutex);
+
+	return r;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_rtp_relay_wait(switch_rtp_t *rtp_session, uint32_t ms)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	if (!rtp_session || !rtp_session->relay_mutex) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* a relay reading from this session is only freed with this lock held */
+	switch_mutex_lock(rtp_session->relay_mutex);
+	if (rtp_session->relay && rtp_session->relay->running) {
+		switch_thread_cond_timedwait(rtp_session->relay_cond, rtp_session->relay_mutex, ms * 1000);
+		status = (rtp_session->relay && rtp_session->relay->running) ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+	}
+	switch_mutex_unlock(rtp_session->relay_mutex);
+
+	return status;
+}
+
 SWITCH_DECLARE(uint32_t) switch_rtp_get_ssrc(switch_rtp_t *rtp_session)
 {
 	return rtp_session->ssrc;
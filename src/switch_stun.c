@@ -556,6 +556,122 @@ SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_integrity(switch_stun_p
 	return 1;
 }
 
+/* HMAC-SHA1 with the key schedule done once: both pads are hashed up front and the
+   per message work is two SHA1 continuations from those saved states */
+struct switch_stun_hmac_s {
+	SHA_CTX inner;
+	SHA_CTX outer;
+};
+
+SWITCH_DECLARE(switch_stun_hmac_t *) switch_stun_hmac_create(const char *key, switch_memory_pool_t *pool)
+{
+	switch_stun_hmac_t *hmac;
+	unsigned char block[SHA_CBLOCK] = { 0 };
+	unsigned char pad[SHA_CBLOCK];
+	size_t klen = key ? strlen(key) : 0;
+	int i;
+
+	if (!(hmac = switch_core_alloc(pool, sizeof(*hmac)))) {
+		return NULL;
+	}
+
+	if (klen > SHA_CBLOCK) {
+		SHA1((const unsigned char *) key, klen, block);
+	} else if (klen) {
+		memcpy(block, key, klen);
+	}
+
+	for (i = 0; i < SHA_CBLOCK; i++) {
+		pad[i] = block[i] ^ 0x36;
+	}
+	SHA1_Init(&hmac->inner);
+	SHA1_Update(&hmac->inner, pad, SHA_CBLOCK);
+
+	for (i = 0; i < SHA_CBLOCK; i++) {
+		pad[i] = block[i] ^ 0x5c;
+	}
+	SHA1_Init(&hmac->outer);
+	SHA1_Update(&hmac->outer, pad, SHA_CBLOCK);
+
+	return hmac;
+}
+
+SWITCH_DECLARE(void) switch_stun_hmac_digest(switch_stun_hmac_t *hmac, const void *data, switch_size_t len, uint8_t digest[20])
+{
+	SHA_CTX ctx;
+
+	ctx = hmac->inner;
+	SHA1_Update(&ctx, data, len);
+	SHA1_Final(digest, &ctx);
+
+	ctx = hmac->outer;
+	SHA1_Update(&ctx, digest, SHA_DIGEST_LENGTH);
+	SHA1_Final(digest, &ctx);
+}
+
+SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_integrity_hmac(switch_stun_packet_t *packet, switch_stun_hmac_t *hmac)
+{
+	switch_stun_packet_attribute_t *attribute;
+	uint16_t xlen;
+
+	attribute = (switch_stun_packet_attribute_t *) ((uint8_t *) & packet->first_attribute + ntohs(packet->header.length));
+	attribute->type = htons(SWITCH_STUN_ATTR_MESSAGE_INTEGRITY);
+	attribute->length = htons(20);
+
+	xlen = ntohs(packet->header.length) + sizeof(switch_stun_packet_header_t);
+	packet->header.length += htons(sizeof(switch_stun_packet_attribute_t)) + attribute->length;
+
+	switch_stun_hmac_digest(hmac, packet, xlen, (uint8_t *) attribute->value);
+
+	return 1;
+}
+
+SWITCH_DECLARE(int) switch_stun_packet_verify_integrity(const uint8_t *buf, switch_size_t len, switch_stun_hmac_t *hmac)
+{
+	switch_stun_packet_header_t header;
+	const switch_stun_packet_attribute_t *attr;
+	uint8_t digest[SHA_DIGEST_LENGTH];
+	switch_size_t off = sizeof(switch_stun_packet_header_t);
+	SHA_CTX ctx;
+
+	if (len < off || len > 0xffff) {
+		return -1;
+	}
+
+	while (off + 4 <= len) {
+		uint16_t atype, alen;
+
+		attr = (const switch_stun_packet_attribute_t *) (buf + off);
+		atype = ntohs(attr->type);
+		alen = ntohs(attr->length);
+
+		if (atype == SWITCH_STUN_ATTR_MESSAGE_INTEGRITY) {
+			if (alen != SHA_DIGEST_LENGTH || off + 4 + alen > len) {
+				return 0;
+			}
+
+			/* the length field covers up to and including the integrity attribute itself */
+			memcpy(&header, buf, sizeof(header));
+			header.length = htons((uint16_t) (off + 4 + alen - sizeof(switch_stun_packet_header_t)));
+
+			ctx = hmac->inner;
+			SHA1_Update(&ctx, &header, sizeof(header));
+			SHA1_Update(&ctx, buf + sizeof(header), off - sizeof(header));
+			SHA1_Final(digest, &ctx);
+
+			ctx = hmac->outer;
+			SHA1_Update(&ctx, digest, SHA_DIGEST_LENGTH);
+			SHA1_Final(digest, &ctx);
+
+			return !memcmp(digest, attr->value, SHA_DIGEST_LENGTH);
+		}
+
+		off += 4 + ((alen + 3) & ~3);
+	}
+
+	return -1;
+}
+
 SWITCH_DECLARE(uint8_t) switch_stun_packet_attribute_add_fingerprint(switch_stun_packet_t *packet)
 {
 	switch_stun_packet_attribute_t *attribute;
@@ -55,15 +55,33 @@ struct switch_network_node {
 	char *token;
 	char *str;
 	switch_network_port_range_t port_range;
+	uint32_t seq;
 	struct switch_network_node *next;
+	struct switch_network_node *trie_next;
+	struct switch_network_node *irregular_next;
 };
 typedef struct switch_network_node switch_network_node_t;
 
+/* Path compressed binary trie keyed by the masked network address, most significant bit first.
+   Every prefix holds the nodes added with exactly that prefix, oldest first. */
+struct switch_network_trie {
+	uint8_t key[16];
+	uint32_t bits;
+	switch_network_node_t *nodes;
+	struct switch_network_trie *child[2];
+};
+typedef struct switch_network_trie switch_network_trie_t;
+
 struct switch_network_list {
 	struct switch_network_node *node_head;
 	switch_bool_t default_type;
 	switch_memory_pool_t *pool;
 	char *name;
+	switch_network_trie_t *v4_root;
+	switch_network_trie_t *v6_root;
+	/* nodes whose mask is not a plain prefix, matched by scanning */
+	switch_network_node_t *irregular;
+	uint32_t seq;
 };
 
 #ifndef WIN32
@@ -103,6 +121,7 @@ SWITCH_DECLARE(switch_status_t) switch_frame_alloc(switch_frame_t **frame, switc
 
 typedef struct switch_frame_node_s {
 	switch_frame_t *frame;
+	switch_image_t *img;
 	int inuse;
 	struct switch_frame_node_s *prev;
 	struct switch_frame_node_s *next;
@@ -110,41 +129,59 @@ typedef struct switch_frame_node_s {
 
 struct switch_frame_buffer_s {
 	switch_frame_node_t *head;
+	switch_frame_node_t *packet_head;
 	switch_memory_pool_t *pool;
 	switch_queue_t *queue;
 	switch_mutex_t *mutex;
 	uint32_t total;
+	uint32_t nodes[2];
+	uint32_t cached_imgs;
 };
 
+/* idle nodes may keep their last image for reuse, but only this many per buffer so a burst
+   of queued video frames does not stay resident once the stream drains */
+#define FRAME_BUFFER_MAX_CACHED_IMAGES 2
+
+/* packet and data frames are kept on separate free lists so taking one is O(1) */
+#define frame_node_head(fb, packet) ((packet) ? &(fb)->packet_head : &(fb)->head)
+
+/* usage of the free lists across every frame buffer, indexed by kind: 0 data, 1 packet */
+static struct {
+	switch_atomic_t nodes[2];
+	switch_atomic_t idle[2];
+	switch_atomic_t created[2];
+	switch_atomic_t reused[2];
+	switch_atomic_t img_reused;
+	switch_atomic_t img_copied;
+	switch_atomic_t img_cached;
+} frame_buffer_stats;
+
 static switch_frame_t *find_free_frame(switch_frame_buffer_t *fb, switch_frame_t *orig)
 {
-	switch_frame_node_t *np;
-	int x = 0;
+	switch_frame_node_t *np, **head;
+	int kind = orig->packet ? 1 : 0;
 
 	switch_mutex_lock(fb->mutex);
 
-	for (np = fb->head; np; np = np->next) {
-		x++;
+	head = frame_node_head(fb, orig->packet);
 
-		if (!np->inuse && ((orig->packet && np->frame->packet) || (!orig->packet && !np->frame->packet))) {
+	if ((np = *head)) {
+		*head = np->next;
 
-			if (np == fb->head) {
-				fb->head = np->next;
-			} else if (np->prev) {
-				np->prev->next = np->next;
-			}
-
-			if (np->next) {
-				np->next->prev = np->prev;
-			}
-
-			fb->total--;
-			np->prev = np->next = NULL;
-			break;
+		if (np->next) {
+			np->next->prev = NULL;
 		}
+
+		fb->total--;
+		np->prev = np->next = NULL;
+		switch_atomic_dec(&frame_buffer_stats.idle[kind]);
+		switch_atomic_inc(&frame_buffer_stats.reused[kind]);
 	}
 
 	if (!np) {
+		fb->nodes[kind]++;
+		switch_atomic_inc(&frame_buffer_stats.nodes[kind]);
+		switch_atomic_inc(&frame_buffer_stats.created[kind]);
 		np = switch_core_alloc(fb->pool, sizeof(*np));
 		np->frame = switch_core_alloc(fb->pool, sizeof(*np->frame));
 
@@ -187,7 +224,22 @@ static switch_frame_t *find_free_frame(switch_frame_buffer_t *fb, switch_frame_t
 	}
 
 	if (orig->img && !switch_test_flag(orig, SFF_ENCODED)) {
+		/* reuse the image this node carried last time when it has the same geometry, video frames
+		   in a stream rarely change size so this saves an image alloc/free per frame */
+		if (np->img) {
+			if (np->img->fmt == orig->img->fmt && np->img->d_w == orig->img->d_w && np->img->d_h == orig->img->d_h) {
+				np->frame->img = np->img;
+				switch_atomic_inc(&frame_buffer_stats.img_reused);
+			} else {
+				switch_img_free(&np->img);
+			}
+			np->img = NULL;
+			fb->cached_imgs--;
+			switch_atomic_dec(&frame_buffer_stats.img_cached);
+		}
+
 		switch_img_copy(orig->img, &np->frame->img);
+		switch_atomic_inc(&frame_buffer_stats.img_copied);
 	}
 
 	switch_mutex_unlock(fb->mutex);
@@ -198,7 +250,7 @@ static switch_frame_t *find_free_frame(switch_frame_buffer_t *fb, switch_frame_t
 SWITCH_DECLARE(switch_status_t) switch_frame_buffer_free(switch_frame_buffer_t *fb, switch_frame_t **frameP)
 {
 	switch_frame_t *old_frame;
-	switch_frame_node_t *node;
+	switch_frame_node_t *node, **head;
 
 	switch_mutex_lock(fb->mutex);
 
@@ -207,17 +259,30 @@ SWITCH_DECLARE(switch_status_t) switch_frame_buffer_free(switch_frame_buffer_t *
 
 	node = (switch_frame_node_t *) old_frame->extra_data;
 	node->inuse = 0;
-	switch_img_free(&node->frame->img);
+
+	if (node->frame->img) {
+		if (!node->img && fb->cached_imgs < FRAME_BUFFER_MAX_CACHED_IMAGES) {
+			node->img = node->frame->img;
+			node->frame->img = NULL;
+			fb->cached_imgs++;
+			switch_atomic_inc(&frame_buffer_stats.img_cached);
+		} else {
+			switch_img_free(&node->frame->img);
+		}
+	}
 
 	fb->total++;
+	switch_atomic_inc(&frame_buffer_stats.idle[node->frame->packet ? 1 : 0]);
+
+	head = frame_node_head(fb, node->frame->packet);
 
-	if (fb->head) {
-		fb->head->prev = node;
+	if (*head) {
+		(*head)->prev = node;
 	}
 
-	node->next = fb->head;
+	node->next = *head;
 	node->prev = NULL;
-	fb->head = node;
+	*head = node;
 
 	switch_assert(node->next != node);
 	switch_assert(node->prev != node);
@@ -273,14 +338,49 @@ SWITCH_DECLARE(int) switch_frame_buffer_size(switch_frame_buffer_t *fb)
 SWITCH_DECLARE(switch_status_t) switch_frame_buffer_destroy(switch_frame_buffer_t **fbP)
 {
 	switch_frame_buffer_t *fb = *fbP;
+	switch_frame_node_t *np;
 	switch_memory_pool_t *pool;
 	*fbP = NULL;
+
+	for (np = fb->head; np; np = np->next) {
+		switch_img_free(&np->img);
+		switch_atomic_dec(&frame_buffer_stats.idle[0]);
+	}
+
+	for (np = fb->packet_head; np; np = np->next) {
+		switch_img_free(&np->img);
+		switch_atomic_dec(&frame_buffer_stats.idle[1]);
+	}
+
+	switch_atomic_add(&frame_buffer_stats.img_cached, 0 - fb->cached_imgs);
+
+	switch_atomic_add(&frame_buffer_stats.nodes[0], 0 - fb->nodes[0]);
+	switch_atomic_add(&frame_buffer_stats.nodes[1], 0 - fb->nodes[1]);
+
 	pool = fb->pool;
 	switch_core_destroy_memory_pool(&pool);
 
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(void) switch_frame_buffer_stats(switch_stream_handle_t *stream)
+{
+	const char *kinds[2] = { "data", "packet" };
+	int i;
+
+	stream->write_function(stream, "%-32s %8s %8s %12s %12s\n", "frame buffer", "nodes", "idle", "created", "reused");
+
+	for (i = 0; i < 2; i++) {
+		stream->write_function(stream, "%-32s %8u %8u %12u %12u\n", kinds[i],
+							   switch_atomic_read(&frame_buffer_stats.nodes[i]), switch_atomic_read(&frame_buffer_stats.idle[i]),
+							   switch_atomic_read(&frame_buffer_stats.created[i]), switch_atomic_read(&frame_buffer_stats.reused[i]));
+	}
+
+	stream->write_function(stream, "frame buffer images copied %u, into a reused image %u, cached on idle nodes %u\n",
+						   switch_atomic_read(&frame_buffer_stats.img_copied), switch_atomic_read(&frame_buffer_stats.img_reused),
+						   switch_atomic_read(&frame_buffer_stats.img_cached));
+}
+
 SWITCH_DECLARE(switch_status_t) switch_frame_buffer_create(switch_frame_buffer_t **fbP, switch_size_t qlen)
 {
 	switch_frame_buffer_t *fb;
@@ -475,31 +575,193 @@ SWITCH_DECLARE(switch_bool_t) switch_testv6_subnet(ip_t _ip, ip_t _net, ip_t _ma
 		}
 }
 
-SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip6_port_token(switch_network_list_t *list, ip_t ip, int port, const char **token)
+SWITCH_DECLARE(switch_bool_t) is_port_in_node(int port, switch_network_node_t *node);
+
+#define NETWORK_TRIE_BIT(_k, _i) (((_k)[(_i) >> 3] >> (7 - ((_i) & 7))) & 1)
+
+static void network_key_v4(uint8_t *key, uint32_t ip)
 {
-	switch_network_node_t *node;
-	switch_bool_t ok = list->default_type;
-	uint32_t bits = 0;
+	key[0] = (uint8_t) (ip >> 24);
+	key[1] = (uint8_t) (ip >> 16);
+	key[2] = (uint8_t) (ip >> 8);
+	key[3] = (uint8_t) ip;
+}
 
-	for (node = list->node_head; node; node = node->next) {
-		if (node->family == AF_INET) continue;
+/* do the first bits of key and net agree */
+static int network_key_match(const uint8_t *key, const uint8_t *net, uint32_t bits)
+{
+	uint32_t bytes = bits >> 3, rest = bits & 7;
+
+	if (bytes && memcmp(key, net, bytes)) {
+		return 0;
+	}
+
+	return !rest || !((key[bytes] ^ net[bytes]) & (0xFF << (8 - rest)));
+}
+
+/* number of leading bits key and net share, at most max */
+static uint32_t network_key_common(const uint8_t *key, const uint8_t *net, uint32_t max)
+{
+	uint32_t i = 0;
+
+	while (i + 8 <= max && key[i >> 3] == net[i >> 3]) {
+		i += 8;
+	}
+
+	while (i < max && NETWORK_TRIE_BIT(key, i) == NETWORK_TRIE_BIT(net, i)) {
+		i++;
+	}
+
+	return i;
+}
+
+static switch_network_trie_t *network_trie_new(switch_memory_pool_t *pool, const uint8_t *key, uint32_t bits)
+{
+	switch_network_trie_t *trie = switch_core_alloc(pool, sizeof(*trie));
+	uint32_t bytes = bits >> 3, rest = bits & 7;
+
+	memcpy(trie->key, key, bytes);
+	if (rest) {
+		trie->key[bytes] = key[bytes] & (0xFF << (8 - rest));
+	}
+	trie->bits = bits;
 
-		if (node->bits >= bits && switch_testv6_subnet(ip, node->ip, node->mask)) {
-			if (node->ok) {
-				ok = SWITCH_TRUE;
+	return trie;
+}
+
+static void network_trie_insert(switch_network_list_t *list, switch_network_trie_t **root, const uint8_t *key, uint32_t bits, switch_network_node_t *node)
+{
+	switch_network_trie_t **cur = root, *trie;
+	switch_network_node_t **np;
+
+	while ((trie = *cur)) {
+		uint32_t common = network_key_common(key, trie->key, bits < trie->bits ? bits : trie->bits);
+
+		if (common < trie->bits) {
+			switch_network_trie_t *leaf = network_trie_new(list->pool, key, bits);
+
+			if (common == bits) {
+				/* the new prefix sits above the existing one */
+				leaf->child[NETWORK_TRIE_BIT(trie->key, bits)] = trie;
+				*cur = leaf;
 			} else {
-				ok = SWITCH_FALSE;
+				switch_network_trie_t *fork = network_trie_new(list->pool, key, common);
+
+				fork->child[NETWORK_TRIE_BIT(trie->key, common)] = trie;
+				fork->child[NETWORK_TRIE_BIT(key, common)] = leaf;
+				*cur = fork;
+			}
+
+			trie = leaf;
+			break;
+		}
+
+		if (trie->bits == bits) {
+			break;
+		}
+
+		cur = &trie->child[NETWORK_TRIE_BIT(key, trie->bits)];
+	}
+
+	if (!trie) {
+		trie = *cur = network_trie_new(list->pool, key, bits);
+	}
+
+	for (np = &trie->nodes; *np; np = &(*np)->trie_next);
+	*np = node;
+}
+
+/* The longest matching prefix wins; between nodes of the same prefix the one added first does */
+static switch_network_node_t *network_trie_lookup(switch_network_trie_t *trie, const uint8_t *key, uint32_t max_bits, int port, switch_bool_t check_port)
+{
+	switch_network_node_t *best = NULL, *node;
+
+	while (trie && network_key_match(key, trie->key, trie->bits)) {
+		for (node = trie->nodes; node; node = node->trie_next) {
+			if (!check_port || is_port_in_node(port, node)) {
+				best = node;
+				break;
 			}
+		}
 
-			bits = node->bits;
+		if (trie->bits >= max_bits) {
+			break;
+		}
+
+		trie = trie->child[NETWORK_TRIE_BIT(key, trie->bits)];
+	}
+
+	return best;
+}
 
-			if (token) {
-				*token = node->token;
+static switch_bool_t network_node_better(switch_network_node_t *node, switch_network_node_t *best)
+{
+	return !best || node->bits > best->bits || (node->bits == best->bits && node->seq < best->seq);
+}
+
+/* File a node in the trie of its family, or in the irregular list when its mask is not a plain prefix */
+static void network_list_index_node(switch_network_list_t *list, switch_network_node_t *node)
+{
+	uint8_t key[16] = { 0 };
+
+	node->seq = list->seq++;
+
+	if (node->family == AF_INET6) {
+		uint8_t prefix[16] = { 0 };
+		uint32_t i;
+
+		for (i = 0; i < node->bits && i < 128; i++) {
+			prefix[i >> 3] |= 0x80 >> (i & 7);
+		}
+
+		if (node->bits <= 128 && !memcmp(prefix, node->mask.v6.s6_addr, sizeof(prefix)) &&
+			(node->bits || IN6_IS_ADDR_UNSPECIFIED(&node->ip.v6))) {
+			for (i = 0; i < 16; i++) {
+				key[i] = node->ip.v6.s6_addr[i] & prefix[i];
 			}
+			network_trie_insert(list, &list->v6_root, key, node->bits, node);
+			return;
+		}
+	} else {
+		uint32_t mask = node->mask.v4, prefix = node->bits ? 0xFFFFFFFF << (32 - node->bits) : 0;
+
+		/* switch_parse_cidr() can leave a /32 with an empty mask, which switch_test_subnet() treats as exact match */
+		if (node->bits == 32 && !mask && node->ip.v4) {
+			mask = prefix;
+		}
+
+		if (node->bits <= 32 && mask == prefix && (mask || !node->ip.v4)) {
+			network_key_v4(key, node->ip.v4 & mask);
+			network_trie_insert(list, &list->v4_root, key, node->bits, node);
+			return;
 		}
 	}
 
-	return ok;
+	node->irregular_next = list->irregular;
+	list->irregular = node;
+}
+
+SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip6_port_token(switch_network_list_t *list, ip_t ip, int port, const char **token)
+{
+	switch_network_node_t *node, *best;
+
+	best = network_trie_lookup(list->v6_root, ip.v6.s6_addr, 128, port, SWITCH_FALSE);
+
+	for (node = list->irregular; node; node = node->irregular_next) {
+		if (node->family == AF_INET6 && network_node_better(node, best) && switch_testv6_subnet(ip, node->ip, node->mask)) {
+			best = node;
+		}
+	}
+
+	if (!best) {
+		return list->default_type;
+	}
+
+	if (token) {
+		*token = best->token;
+	}
+
+	return best->ok ? SWITCH_TRUE : SWITCH_FALSE;
 }
 
 SWITCH_DECLARE(switch_bool_t) is_port_in_node(int port, switch_network_node_t *node)
@@ -526,28 +788,28 @@ SWITCH_DECLARE(switch_bool_t) is_port_in_node(int port, switch_network_node_t *n
 
 SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip_port_token(switch_network_list_t *list, uint32_t ip, int port, const char **token)
 {
-	switch_network_node_t *node;
-	switch_bool_t ok = list->default_type;
-	uint32_t bits = 0;
-
-	for (node = list->node_head; node; node = node->next) {
-		if (node->family == AF_INET6) continue; /* want AF_INET */
-		if (node->bits >= bits && switch_test_subnet(ip, node->ip.v4, node->mask.v4) && is_port_in_node(port, node)) {
-			if (node->ok) {
-				ok = SWITCH_TRUE;
-			} else {
-				ok = SWITCH_FALSE;
-			}
+	switch_network_node_t *node, *best;
+	uint8_t key[4];
 
-			bits = node->bits;
+	network_key_v4(key, ip);
+	best = network_trie_lookup(list->v4_root, key, 32, port, SWITCH_TRUE);
 
-			if (token) {
-				*token = node->token;
-			}
+	for (node = list->irregular; node; node = node->irregular_next) {
+		if (node->family == AF_INET && network_node_better(node, best) &&
+			switch_test_subnet(ip, node->ip.v4, node->mask.v4) && is_port_in_node(port, node)) {
+			best = node;
 		}
 	}
 
-	return ok;
+	if (!best) {
+		return list->default_type;
+	}
+
+	if (token) {
+		*token = best->token;
+	}
+
+	return best->ok ? SWITCH_TRUE : SWITCH_FALSE;
 }
 
 SWITCH_DECLARE(switch_bool_t) switch_network_list_validate_ip6_token(switch_network_list_t *list, ip_t ip, const char **token)
@@ -644,6 +906,7 @@ SWITCH_DECLARE(switch_status_t) switch_network_list_perform_add_cidr_token(switc
 
 	node->next = list->node_head;
 	list->node_head = node;
+	network_list_index_node(list, node);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Adding %s %s(%s) [%s] to list %s\n",
 					  cidr_str, ports ? ports : "", ok ? "allow" : "deny", switch_str_nil(token), list->name);
@@ -697,6 +960,7 @@ SWITCH_DECLARE(switch_status_t) switch_network_list_add_host_port_mask(switch_ne
 
 	node->ip.v4 = ntohl(ip.v4);
 	node->mask.v4 = ntohl(mask.v4);
+	node->family = AF_INET;
 	node->ok = ok;
 	if(port) {
 		memcpy(&node->port_range, port, sizeof(switch_network_port_range_t));
@@ -711,6 +975,7 @@ SWITCH_DECLARE(switch_status_t) switch_network_list_add_host_port_mask(switch_ne
 
 	node->next = list->node_head;
 	list->node_head = node;
+	network_list_index_node(list, node);
 
 	return SWITCH_STATUS_SUCCESS;
 }
@@ -775,6 +1040,82 @@ SWITCH_DECLARE(int) switch_parse_cidr(const char *string, ip_t *ip, ip_t *mask,
 }
 
 
+SWITCH_DECLARE(uint32_t) switch_spool_replay(const char *dir_path, const char *suffix, uint32_t max, uint32_t min_age,
+											 switch_spool_callback_t callback, void *pdata, switch_bool_t *failed)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_dir_t *dir = NULL;
+	char buf[256] = "";
+	const char *fname;
+	switch_size_t slen = strlen(suffix);
+	uint32_t sent = 0;
+
+	*failed = SWITCH_FALSE;
+
+	if (zstr(dir_path) || switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+		return 0;
+	}
+
+	if (switch_dir_open(&dir, dir_path, pool) != SWITCH_STATUS_SUCCESS) {
+		switch_core_destroy_memory_pool(&pool);
+		return 0;
+	}
+
+	while (sent < max && !*failed && (fname = switch_dir_next_file(dir, buf, sizeof(buf)))) {
+		switch_file_t *fd = NULL;
+		struct stat st;
+		char *path, *data, *name;
+		switch_size_t len, flen = strlen(fname);
+
+		if (flen <= slen || strcmp(fname + flen - slen, suffix)) {
+			continue;
+		}
+
+		path = switch_core_sprintf(pool, "%s%s%s", dir_path, SWITCH_PATH_SEPARATOR, fname);
+
+		if (stat(path, &st) || st.st_mtime + min_age > switch_epoch_time_now(NULL)) {
+			continue;
+		}
+
+		if (switch_file_open(&fd, path, SWITCH_FOPEN_READ, SWITCH_FPROT_OS_DEFAULT, pool) != SWITCH_STATUS_SUCCESS) {
+			continue;
+		}
+
+		len = switch_file_get_size(fd);
+		data = switch_core_alloc(pool, len + 1);
+		if (len && switch_file_read(fd, data, &len) != SWITCH_STATUS_SUCCESS) {
+			len = 0;
+		}
+		switch_file_close(fd);
+
+		data[len] = '\0';
+		while (len && (data[len - 1] == '\n' || data[len - 1] == '\r')) {
+			data[--len] = '\0';
+		}
+
+		if (!len) {
+			continue;
+		}
+
+		name = switch_core_strdup(pool, fname);
+		name[flen - slen] = '\0';
+
+		if (callback(name, data, len, pdata)) {
+			if (unlink(path) < 0) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error unlinking [%s]\n", path);
+			}
+			sent++;
+		} else {
+			*failed = SWITCH_TRUE;
+		}
+	}
+
+	switch_dir_close(dir);
+	switch_core_destroy_memory_pool(&pool);
+
+	return sent;
+}
+
 SWITCH_DECLARE(char *) switch_find_end_paren(const char *s, char open, char close)
 {
 	const char *e = NULL;
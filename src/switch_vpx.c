@@ -51,6 +51,12 @@
 #define SLICE_SIZE SWITCH_DEFAULT_VIDEO_SIZE
 #define KEY_FRAME_MIN_FREQ 250000
 
+/* encoded pictures the async encoder may run ahead of the caller */
+#define VPX_ASYNC_OUT_FRAMES 4
+/* picture area one encoder thread is expected to keep up with, about 640x360 */
+#define VPX_THREAD_AREA (640 * 360)
+#define VPX_MAX_ENC_THREADS 16
+
 #define CODEC_TYPE_ANY 0
 #define CODEC_TYPE_VP8 8
 #define CODEC_TYPE_VP9 9
@@ -64,6 +70,8 @@ typedef struct my_vpx_cfg_s {
 	int noise_sensitivity;
 	int max_intra_bitrate_pct;
 	vp9e_tune_content tune_content;
+	int async_encode;
+	int enc_threads_scale;
 
 	vpx_codec_enc_cfg_t enc_cfg;
 	vpx_codec_dec_cfg_t dec_cfg;
@@ -84,6 +92,8 @@ static void show_config(my_vpx_cfg_t *my_cfg, vpx_codec_enc_cfg_t *cfg)
 	SHOW(my_cfg, noise_sensitivity);
 	SHOW(my_cfg, max_intra_bitrate_pct);
 	SHOW(my_cfg, tune_content);
+	SHOW(my_cfg, async_encode);
+	SHOW(my_cfg, enc_threads_scale);
 
 	SHOW(cfg, g_usage);
 	SHOW(cfg, g_threads);
@@ -372,6 +382,33 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_vpx_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_vpx_shutdown);
 SWITCH_MODULE_DEFINITION(CORE_VPX_MODULE, mod_vpx_load, mod_vpx_shutdown, NULL);
 
+typedef struct vpx_async_frame_s {
+	uint8_t *buf;
+	switch_size_t len;
+	switch_size_t alloc;
+	int key;
+} vpx_async_frame_t;
+
+/* Frame in, packets out: the caller hands over the newest picture and takes whatever the
+   encoder thread has finished, a picture still waiting when the next one arrives is dropped */
+typedef struct vpx_async_s {
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	switch_mutex_t *enc_mutex;
+	switch_thread_cond_t *cond;
+	switch_image_t *pending;
+	switch_image_t *spare;
+	vpx_enc_frame_flags_t pending_flags;
+	int64_t pending_pts;
+	uint32_t pending_dur;
+	vpx_async_frame_t out[VPX_ASYNC_OUT_FRAMES];
+	uint32_t out_head;
+	uint32_t out_count;
+	vpx_async_frame_t cur;
+	vpx_codec_cx_pkt_t pkt;
+	int running;
+} vpx_async_t;
+
 struct vpx_context {
 	int debug;
 	switch_codec_t *codec;
@@ -419,6 +456,13 @@ struct vpx_context {
 	switch_time_t start_time;
 	switch_image_t *patch_img;
 	int16_t picture_id;
+	int async_encode;
+	vpx_async_t *async;
+	uint64_t encoded_frames;
+	uint64_t dropped_frames;
+	switch_time_t encode_usec;
+	switch_time_t max_encode_usec;
+	char stats_str[256];
 };
 typedef struct vpx_context vpx_context_t;
 
@@ -610,6 +654,22 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 	config->g_h = context->codec_settings.video.height;
 	config->rc_target_bitrate = context->bandwidth;
 
+	if (my_cfg->enc_threads_scale) {
+		/* one thread per VPX_THREAD_AREA of picture, bounded by the cores we have */
+		uint32_t threads = (config->g_w * config->g_h + VPX_THREAD_AREA - 1) / VPX_THREAD_AREA;
+		uint32_t cpus = switch_core_cpu_count();
+
+		if (threads > cpus) threads = cpus;
+		if (threads > VPX_MAX_ENC_THREADS) threads = VPX_MAX_ENC_THREADS;
+		if (threads < 1) threads = 1;
+
+		config->g_threads = threads;
+	}
+
+	if (my_cfg->async_encode) {
+		context->async_encode = 1;
+	}
+
 	if (context->is_vp9) {
 		if (my_cfg->lossless) {
 			config->rc_min_quantizer = 0;
@@ -651,6 +711,20 @@ static switch_status_t init_encoder(switch_codec_t *codec)
 			}
 
 			vpx_codec_control(&context->encoder, VP9E_SET_TUNE_CONTENT, my_cfg->tune_content);
+
+			if (config->g_threads > 1) {
+				int tile_cols = 0;
+
+				/* vp9 only runs tiles (and rows, with row-mt) in parallel, give it a column per thread */
+				while ((1U << (tile_cols + 1)) <= config->g_threads && (config->g_w >> (tile_cols + 1)) >= 256) {
+					tile_cols++;
+				}
+
+				vpx_codec_control(&context->encoder, VP9E_SET_TILE_COLUMNS, tile_cols);
+#ifdef VPX_CTRL_VP9E_SET_ROW_MT
+				vpx_codec_control(&context->encoder, VP9E_SET_ROW_MT, 1);
+#endif
+			}
 		} else {
 			vpx_codec_control(&context->encoder, VP8E_SET_NOISE_SENSITIVITY, my_cfg->noise_sensitivity);
 
@@ -712,6 +786,266 @@ static switch_status_t switch_vpx_init(switch_codec_t *codec, switch_codec_flag_
 	return SWITCH_STATUS_SUCCESS;
 }
 
+static void account_encode(vpx_context_t *context, switch_time_t start)
+{
+	switch_time_t spent = switch_time_ref() - start;
+
+	context->encoded_frames++;
+	context->encode_usec += spent;
+
+	if (spent > context->max_encode_usec) {
+		context->max_encode_usec = spent;
+	}
+}
+
+/* Take the oldest picture the encoder thread finished, swapping buffers so nothing is copied twice */
+static const vpx_codec_cx_pkt_t *async_pop(vpx_context_t *context)
+{
+	vpx_async_t *async = context->async;
+	vpx_async_frame_t tmp;
+	const vpx_codec_cx_pkt_t *pkt = NULL;
+
+	switch_mutex_lock(async->mutex);
+
+	if (async->out_count) {
+		tmp = async->cur;
+		async->cur = async->out[async->out_head];
+		async->out[async->out_head] = tmp;
+		async->out_head = (async->out_head + 1) % VPX_ASYNC_OUT_FRAMES;
+		async->out_count--;
+
+		memset(&async->pkt, 0, sizeof(async->pkt));
+		async->pkt.kind = VPX_CODEC_CX_FRAME_PKT;
+		async->pkt.data.frame.buf = async->cur.buf;
+		async->pkt.data.frame.sz = async->cur.len;
+		async->pkt.data.frame.flags = async->cur.key ? VPX_FRAME_IS_KEY : 0;
+		pkt = &async->pkt;
+	}
+
+	switch_mutex_unlock(async->mutex);
+
+	return pkt;
+}
+
+static const vpx_codec_cx_pkt_t *next_packet(vpx_context_t *context)
+{
+	if (context->async) {
+		return async_pop(context);
+	}
+
+	return vpx_codec_get_cx_data(&context->encoder, &context->enc_iter);
+}
+
+/* caller holds async->enc_mutex */
+static void async_push_output(vpx_context_t *context)
+{
+	vpx_async_t *async = context->async;
+	const vpx_codec_cx_pkt_t *pkt;
+	vpx_codec_iter_t iter = NULL;
+
+	while ((pkt = vpx_codec_get_cx_data(&context->encoder, &iter))) {
+		vpx_async_frame_t *out;
+
+		if (pkt->kind != VPX_CODEC_CX_FRAME_PKT) {
+			continue;
+		}
+
+		switch_mutex_lock(async->mutex);
+
+		if (async->out_count == VPX_ASYNC_OUT_FRAMES) {
+			/* the caller stopped taking packets; dropping only the oldest would leave frames that reference it,
+			   so flush the whole queue and start again from a key frame */
+			context->dropped_frames += async->out_count;
+			async->out_head = 0;
+			async->out_count = 0;
+			context->need_key_frame = 1;
+
+			if (!(pkt->data.frame.flags & VPX_FRAME_IS_KEY)) {
+				context->dropped_frames++;
+				switch_mutex_unlock(async->mutex);
+				continue;
+			}
+		}
+
+		out = &async->out[(async->out_head + async->out_count) % VPX_ASYNC_OUT_FRAMES];
+
+		if (out->alloc < pkt->data.frame.sz) {
+			switch_size_t alloc = pkt->data.frame.sz + 4096;
+			uint8_t *buf = realloc(out->buf, alloc);
+
+			if (!buf) {
+				switch_mutex_unlock(async->mutex);
+				continue;
+			}
+
+			out->buf = buf;
+			out->alloc = alloc;
+		}
+
+		memcpy(out->buf, pkt->data.frame.buf, pkt->data.frame.sz);
+		out->len = pkt->data.frame.sz;
+		out->key = !!(pkt->data.frame.flags & VPX_FRAME_IS_KEY);
+		async->out_count++;
+
+		switch_mutex_unlock(async->mutex);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC async_encode_thread(switch_thread_t *thread, void *obj)
+{
+	vpx_context_t *context = (vpx_context_t *) obj;
+	vpx_async_t *async = context->async;
+
+	for (;;) {
+		switch_image_t *img;
+		vpx_enc_frame_flags_t flags;
+		int64_t pts;
+		uint32_t dur;
+		switch_time_t start;
+		vpx_codec_err_t err;
+
+		switch_mutex_lock(async->mutex);
+		while (async->running && !async->pending) {
+			switch_thread_cond_wait(async->cond, async->mutex);
+		}
+
+		if (!async->running) {
+			switch_mutex_unlock(async->mutex);
+			break;
+		}
+
+		img = async->pending;
+		flags = async->pending_flags;
+		pts = async->pending_pts;
+		dur = async->pending_dur;
+		async->pending = NULL;
+		async->pending_flags = 0;
+		switch_mutex_unlock(async->mutex);
+
+		switch_mutex_lock(async->enc_mutex);
+
+		if (context->encoder_init) {
+			start = switch_time_ref();
+			err = vpx_codec_encode(&context->encoder, (vpx_image_t *) img, pts, dur, flags, VPX_DL_REALTIME);
+			account_encode(context, start);
+
+			if (err == VPX_CODEC_OK) {
+				async_push_output(context);
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(context->codec->session), SWITCH_LOG_ERROR, "VPX encode error [%d:%s:%s]\n",
+					err, vpx_codec_error(&context->encoder), vpx_codec_error_detail(&context->encoder));
+			}
+		}
+
+		switch_mutex_unlock(async->enc_mutex);
+
+		switch_mutex_lock(async->mutex);
+		if (!async->spare) {
+			async->spare = img;
+			img = NULL;
+		}
+		switch_mutex_unlock(async->mutex);
+
+		switch_img_free(&img);
+	}
+
+	return NULL;
+}
+
+static switch_status_t async_start(vpx_context_t *context)
+{
+	vpx_async_t *async;
+	switch_threadattr_t *thd_attr = NULL;
+
+	if (!(async = switch_core_alloc(context->pool, sizeof(*async)))) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	switch_mutex_init(&async->mutex, SWITCH_MUTEX_NESTED, context->pool);
+	switch_mutex_init(&async->enc_mutex, SWITCH_MUTEX_NESTED, context->pool);
+	switch_thread_cond_create(&async->cond, context->pool);
+	async->running = 1;
+	context->async = async;
+
+	switch_threadattr_create(&thd_attr, context->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	if (switch_thread_create(&async->thread, thd_attr, async_encode_thread, context, context->pool) != SWITCH_STATUS_SUCCESS) {
+		context->async = NULL;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void async_stop(vpx_context_t *context)
+{
+	vpx_async_t *async = context->async;
+	switch_status_t st;
+	int i;
+
+	if (!async) {
+		return;
+	}
+
+	switch_mutex_lock(async->mutex);
+	async->running = 0;
+	switch_thread_cond_broadcast(async->cond);
+	switch_mutex_unlock(async->mutex);
+
+	switch_thread_join(&st, async->thread);
+
+	switch_img_free(&async->pending);
+	switch_img_free(&async->spare);
+
+	for (i = 0; i < VPX_ASYNC_OUT_FRAMES; i++) {
+		switch_safe_free(async->out[i].buf);
+	}
+	switch_safe_free(async->cur.buf);
+
+	context->async = NULL;
+}
+
+/* Queue a copy of the picture for the encoder thread, replacing one it hasn't started on yet */
+static void async_submit(vpx_context_t *context, switch_image_t *src, vpx_enc_frame_flags_t flags, int64_t pts, uint32_t dur)
+{
+	vpx_async_t *async = context->async;
+	switch_image_t *img;
+
+	switch_mutex_lock(async->mutex);
+	img = async->spare;
+	async->spare = NULL;
+	switch_mutex_unlock(async->mutex);
+
+	switch_img_copy(src, &img);
+
+	if (!img) {
+		return;
+	}
+
+	switch_mutex_lock(async->mutex);
+
+	if (async->pending) {
+		context->dropped_frames++;
+		/* keep a key frame request that came with the frame we are dropping */
+		flags |= async->pending_flags;
+
+		if (!async->spare) {
+			async->spare = async->pending;
+		} else {
+			switch_img_free(&async->pending);
+		}
+	}
+
+	async->pending = img;
+	async->pending_flags = flags;
+	async->pending_pts = pts;
+	async->pending_dur = dur;
+	switch_thread_cond_signal(async->cond);
+
+	switch_mutex_unlock(async->mutex);
+}
+
 static switch_status_t consume_partition(vpx_context_t *context, switch_frame_t *frame)
 {
 	vpx_payload_descriptor_t *payload_descriptor;
@@ -721,7 +1055,7 @@ static switch_status_t consume_partition(vpx_context_t *context, switch_frame_t
 	switch_status_t status;
 
 	if (!context->pkt) {
-		if ((context->pkt = vpx_codec_get_cx_data(&context->encoder, &context->enc_iter))) {
+		if ((context->pkt = next_packet(context))) {
 			start = 1;
 			if (!context->pbuffer) {
 				switch_buffer_create_partition(context->pool, &context->pbuffer, context->pkt->data.frame.buf, context->pkt->data.frame.sz);
@@ -894,24 +1228,120 @@ static switch_status_t reset_codec_encoder(switch_codec_t *codec)
 	context->framecount = 0;
 	context->encoder_init = 0;
 	context->pkt = NULL;
+
+	if (context->async) {
+		/* pictures coded by the old encoder can't follow the new one's key frame */
+		switch_mutex_lock(context->async->mutex);
+		context->async->out_count = 0;
+		switch_img_free(&context->async->pending);
+		switch_mutex_unlock(context->async->mutex);
+	}
+
 	return init_encoder(codec);
 }
 
+static switch_status_t encoder_setup(switch_codec_t *codec, switch_frame_t *frame);
+
 static switch_status_t switch_vpx_encode(switch_codec_t *codec, switch_frame_t *frame)
 {
 	vpx_context_t *context = (vpx_context_t *)codec->private_info;
-	int width = 0;
-	int height = 0;
 	uint32_t dur;
 	int64_t pts;
 	vpx_enc_frame_flags_t vpx_flags = 0;
-	switch_time_t now;
+	switch_time_t now, start;
 	vpx_codec_err_t err;
+	switch_status_t status;
 
 	if (frame->flags & SFF_SAME_IMAGE) {
 		return consume_partition(context, frame);
 	}
 
+	if (context->async) {
+		/* the encoder thread must not be in the middle of a picture while we reconfigure */
+		switch_mutex_lock(context->async->enc_mutex);
+		status = encoder_setup(codec, frame);
+		switch_mutex_unlock(context->async->enc_mutex);
+	} else {
+		status = encoder_setup(codec, frame);
+	}
+
+	if (status != SWITCH_STATUS_SUCCESS) {
+		return status;
+	}
+
+	if (context->async_encode && !context->async && async_start(context) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_WARNING, "VPX async encoder thread failed to start, encoding inline\n");
+		context->async_encode = 0;
+	}
+
+	now = switch_time_now();
+
+	/* the encoder thread raises need_key_frame when it has to drop packets */
+	if (context->async) {
+		switch_mutex_lock(context->async->mutex);
+	}
+
+	if (context->need_key_frame > 0) {
+		// force generate a key frame
+		if (!context->last_key_frame || (now - context->last_key_frame) > vpx_globals.key_frame_min_freq) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), VPX_SWITCH_LOG_LEVEL,
+				"VPX encoder keyframe request\n");
+			vpx_flags |= VPX_EFLAG_FORCE_KF;
+			context->need_key_frame = 0;
+			context->last_key_frame = now;
+		}
+	}
+
+	if (context->async) {
+		switch_mutex_unlock(context->async->mutex);
+	}
+
+	context->framecount++;
+
+	pts = (now - context->start_time) / 1000;
+	//pts = frame->timestamp;
+
+	dur = context->last_ms ? (now - context->last_ms) / 1000 : pts;
+
+	context->last_ts = frame->timestamp;
+	context->last_ms = now;
+
+	if (context->async) {
+		async_submit(context, frame->img, vpx_flags, pts, dur);
+
+		if (!context->pkt && !context->async->out_count) {
+			/* nothing finished yet, the picture goes out on a later call */
+			frame->datalen = 0;
+			frame->m = 1;
+			return SWITCH_STATUS_SUCCESS;
+		}
+
+		return consume_partition(context, frame);
+	}
+
+	start = switch_time_ref();
+	err = vpx_codec_encode(&context->encoder, (vpx_image_t *) frame->img, pts, dur, vpx_flags, VPX_DL_REALTIME);
+	account_encode(context, start);
+
+	if (err != VPX_CODEC_OK) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_ERROR, "VPX encode error [%d:%s:%s]\n",
+			err, vpx_codec_error(&context->encoder), vpx_codec_error_detail(&context->encoder));
+		frame->datalen = 0;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	context->enc_iter = NULL;
+
+	return consume_partition(context, frame);
+}
+
+/* Bring the encoder in line with the picture size and any pending reset or bandwidth change */
+static switch_status_t encoder_setup(switch_codec_t *codec, switch_frame_t *frame)
+{
+	vpx_context_t *context = (vpx_context_t *)codec->private_info;
+	int width = 0;
+	int height = 0;
+
 	if (context->need_encoder_reset != 0) {
 		if (reset_codec_encoder(codec) != SWITCH_STATUS_SUCCESS) {
 			return SWITCH_STATUS_FALSE;
@@ -932,7 +1362,13 @@ static switch_status_t switch_vpx_encode(switch_codec_t *codec, switch_frame_t *
 		context->codec_settings.video.height = height;
 		reset_codec_encoder(codec);
 		frame->flags |= SFF_PICTURE_RESET;
+		if (context->async) {
+			switch_mutex_lock(context->async->mutex);
+		}
 		context->need_key_frame = 3;
+		if (context->async) {
+			switch_mutex_unlock(context->async->mutex);
+		}
 	}
 
 	if (!context->encoder_init) {
@@ -949,43 +1385,7 @@ static switch_status_t switch_vpx_encode(switch_codec_t *codec, switch_frame_t *
 		}
 	}
 
-	now = switch_time_now();
-
-	if (context->need_key_frame > 0) {
-		// force generate a key frame
-		if (!context->last_key_frame || (now - context->last_key_frame) > vpx_globals.key_frame_min_freq) {
-			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), VPX_SWITCH_LOG_LEVEL,
-				"VPX encoder keyframe request\n");
-			vpx_flags |= VPX_EFLAG_FORCE_KF;
-			context->need_key_frame = 0;
-			context->last_key_frame = now;
-		}
-	}
-
-	context->framecount++;
-
-	pts = (now - context->start_time) / 1000;
-	//pts = frame->timestamp;
-
-	dur = context->last_ms ? (now - context->last_ms) / 1000 : pts;
-
-	if ((err = vpx_codec_encode(&context->encoder,
-						 (vpx_image_t *) frame->img,
-						 pts,
-						 dur,
-						 vpx_flags,
-						 VPX_DL_REALTIME)) != VPX_CODEC_OK) {
-		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_ERROR, "VPX encode error [%d:%s:%s]\n",
-			err, vpx_codec_error(&context->encoder), vpx_codec_error_detail(&context->encoder));
-		frame->datalen = 0;
-		return SWITCH_STATUS_FALSE;
-	}
-
-	context->enc_iter = NULL;
-	context->last_ts = frame->timestamp;
-	context->last_ms = now;
-
-	return consume_partition(context, frame);
+	return SWITCH_STATUS_SUCCESS;
 }
 
 static switch_status_t buffer_vp8_packets(vpx_context_t *context, switch_frame_t *frame)
@@ -1432,7 +1832,13 @@ static switch_status_t switch_vpx_control(switch_codec_t *codec,
 		}
 		break;
 	case SCC_VIDEO_GEN_KEYFRAME:
+		if (context->async) {
+			switch_mutex_lock(context->async->mutex);
+		}
 		context->need_key_frame = 1;
+		if (context->async) {
+			switch_mutex_unlock(context->async->mutex);
+		}
 		break;
 	case SCC_VIDEO_BANDWIDTH:
 		{
@@ -1463,6 +1869,21 @@ static switch_status_t switch_vpx_control(switch_codec_t *codec,
 					vpx_codec_control(&context->encoder, VP8E_SET_TOKEN_PARTITIONS, *(int *)cmd_arg);
 				} else if (!strcasecmp(command, "VP8E_SET_NOISE_SENSITIVITY")) {
 					vpx_codec_control(&context->encoder, VP8E_SET_NOISE_SENSITIVITY, *(int *)cmd_arg);
+				} else if (!strcasecmp(command, "async-encode")) {
+					/* the worker starts with the next picture and stays for the life of the codec */
+					if (*(int *)cmd_arg) {
+						context->async_encode = 1;
+					}
+				} else if (!strcasecmp(command, "stats")) {
+					switch_snprintf(context->stats_str, sizeof(context->stats_str),
+									"encoded=%" SWITCH_UINT64_T_FMT " dropped=%" SWITCH_UINT64_T_FMT " encode_usec=%" SWITCH_TIME_T_FMT
+									" max_encode_usec=%" SWITCH_TIME_T_FMT " threads=%u async=%s",
+									context->encoded_frames, context->dropped_frames, context->encode_usec, context->max_encode_usec,
+									context->config.g_threads, context->async ? "true" : "false");
+					if (rtype) {
+						*rtype = SCCT_STRING;
+						*ret_data = (void *) context->stats_str;
+					}
 				}
 			}
 
@@ -1491,6 +1912,20 @@ static switch_status_t switch_vpx_destroy(switch_codec_t *codec)
 
 		switch_img_free(&context->patch_img);
 
+		async_stop(context);
+
+		if (context->encoded_frames && codec->session) {
+			switch_channel_t *channel = switch_core_session_get_channel(codec->session);
+
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(codec->session), SWITCH_LOG_DEBUG,
+							  "VPX encoder stats: Frames[%" SWITCH_UINT64_T_FMT "] Dropped[%" SWITCH_UINT64_T_FMT "] Avg usec[%" SWITCH_TIME_T_FMT "] Max usec[%" SWITCH_TIME_T_FMT "]\n",
+							  context->encoded_frames, context->dropped_frames,
+							  context->encode_usec / (switch_time_t) context->encoded_frames, context->max_encode_usec);
+			switch_channel_set_variable_printf(channel, "vpx_encode_frames", "%" SWITCH_UINT64_T_FMT, context->encoded_frames);
+			switch_channel_set_variable_printf(channel, "vpx_encode_dropped", "%" SWITCH_UINT64_T_FMT, context->dropped_frames);
+			switch_channel_set_variable_printf(channel, "vpx_encode_usec", "%" SWITCH_TIME_T_FMT, context->encode_usec);
+		}
+
 		if ((codec->flags & SWITCH_CODEC_FLAG_ENCODE)) {
 			vpx_codec_destroy(&context->encoder);
 		}
@@ -1634,6 +2069,10 @@ static void parse_profile(my_vpx_cfg_t *my_cfg, switch_xml_t profile, int codec_
 			_VPX_CHECK_MIN(dec_cfg->threads, switch_parse_cpu_string(value), 1);
 		} else if (!strcmp(name, "enc-threads")) {
 			_VPX_CHECK_MIN(enc_cfg->g_threads, switch_parse_cpu_string(value), 1);
+		} else if (!strcmp(name, "enc-threads-scale")) {
+			my_cfg->enc_threads_scale = switch_true(value);
+		} else if (!strcmp(name, "async-encode")) {
+			my_cfg->async_encode = switch_true(value);
 		} else if (!strcmp(name, "g-profile")) {
 			_VPX_CHECK_MIN_MAX(enc_cfg->g_profile, val, 0, 3);
 #if 0
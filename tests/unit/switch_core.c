@@ -82,6 +82,43 @@ FST_CORE_BEGIN("./conf")
 			switch_safe_free(var_default_password);
 		}
 		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_pool_stats)
+		{
+			switch_memory_pool_t *pool = NULL;
+			switch_stream_handle_t stream = { 0 };
+			int on = 1, off = 0;
+			char *line;
+			unsigned int pools = 0;
+			unsigned long long live = 0, peak_bytes = 0;
+
+			/* byte counts are only kept with accounting on, and only for pools created after that */
+			switch_core_session_ctl(SCSC_MEMORY_ACCOUNTING, &on);
+			fst_requires(on);
+
+			/* tag the pool with a file name of its own so no other pool shares its row */
+			switch_core_perform_new_memory_pool(&pool, "test_pool_stats.c", __SWITCH_FUNC__, __LINE__);
+			fst_requires(pool);
+			fst_requires(switch_core_alloc(pool, 1024));
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_core_pool_stats(&stream);
+			fst_requires(!zstr(stream.data));
+
+			line = strstr((char *)stream.data, "\ntest_pool_stats.c ");
+			fst_requires(line);
+			/* columns: tag, pools, peak, created, live_bytes, peak_bytes, largest_pool */
+			fst_requires(sscanf(line + 1, "test_pool_stats.c %u %*u %*u %llu %llu", &pools, &live, &peak_bytes) == 3);
+			fst_check_int_equals(pools, 1);
+			fst_check_int_equals((int) live, 1024);
+			fst_check_int_equals((int) peak_bytes, 1024);
+
+			switch_safe_free(stream.data);
+			switch_core_destroy_memory_pool(&pool);
+
+			switch_core_session_ctl(SCSC_MEMORY_ACCOUNTING, &off);
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
@@ -127,6 +127,58 @@ FST_CORE_BEGIN("./conf")
 
 		}
 		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_loadable_module_get_codecs_cached)
+		{
+			const char *codec_string = "OPUS,G722,PCMU@20i,PCMA@20i,PCMU@30i";
+			const switch_codec_implementation_t *sorted[SWITCH_MAX_CODECS] = { 0 }, *cached[SWITCH_MAX_CODECS] = { 0 };
+			char sorted_fmtp[SWITCH_MAX_CODECS][MAX_FMTP_LEN] = { { 0 } }, cached_fmtp[SWITCH_MAX_CODECS][MAX_FMTP_LEN] = { { 0 } };
+			uint64_t name_mask[SWITCH_MAX_CODECS] = { 0 };
+			char *prefs[SWITCH_MAX_CODECS], *tmp;
+			switch_time_t start_ts, sorted_us, cached_us;
+			int num_sorted, num_cached, i, j, loops = 10000;
+
+			tmp = switch_core_strdup(fst_pool, codec_string);
+			num_sorted = switch_separate_string(tmp, ',', prefs, SWITCH_MAX_CODECS);
+			num_sorted = switch_loadable_module_get_codecs_sorted(sorted, sorted_fmtp, SWITCH_MAX_CODECS, prefs, num_sorted);
+			fst_check(num_sorted == 5);
+
+			for (j = 0; j < 2; j++) {
+				num_cached = switch_loadable_module_get_codecs_cached(codec_string, cached, cached_fmtp, name_mask, SWITCH_MAX_CODECS);
+				fst_check(num_cached == num_sorted);
+
+				for (i = 0; i < num_sorted; i++) {
+					fst_check(cached[i] == sorted[i]);
+					fst_check_string_equals(cached_fmtp[i], sorted_fmtp[i]);
+				}
+			}
+
+			for (i = 0; i < num_cached; i++) {
+				for (j = 0; j < num_cached; j++) {
+					int same = !strcasecmp(cached[i]->iananame, cached[j]->iananame);
+					fst_check(!!(name_mask[i] & ((uint64_t) 1 << j)) == same);
+				}
+			}
+
+			start_ts = switch_time_now();
+			for (i = 0; i < loops; i++) {
+				tmp = strdup(codec_string);
+				num_sorted = switch_separate_string(tmp, ',', prefs, SWITCH_MAX_CODECS);
+				switch_loadable_module_get_codecs_sorted(sorted, sorted_fmtp, SWITCH_MAX_CODECS, prefs, num_sorted);
+				free(tmp);
+			}
+			sorted_us = switch_time_now() - start_ts;
+
+			start_ts = switch_time_now();
+			for (i = 0; i < loops; i++) {
+				switch_loadable_module_get_codecs_cached(codec_string, cached, cached_fmtp, NULL, SWITCH_MAX_CODECS);
+			}
+			cached_us = switch_time_now() - start_ts;
+
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%d resolutions of [%s]: sorted %" SWITCH_TIME_T_FMT "us, cached %" SWITCH_TIME_T_FMT "us\n",
+							  loops, codec_string, sorted_us, cached_us);
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
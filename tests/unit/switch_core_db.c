@@ -34,6 +34,127 @@
 
 #include <test/switch_test.h>
 
+static int wait_for_writers(switch_sql_queue_manager_t *qm)
+{
+	switch_stream_handle_t stream = { 0 };
+	int sanity;
+
+	for (sanity = 100; sanity; sanity--) {
+		int running;
+
+		SWITCH_STANDARD_STREAM(stream);
+		switch_sql_queue_manager_stats(qm, &stream);
+		running = !strstr((char *) stream.data, "Stopped");
+		switch_safe_free(stream.data);
+
+		if (running) {
+			return 1;
+		}
+
+		switch_yield(100000);
+	}
+
+	return 0;
+}
+
+static int count_rows_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	int *rows = (int *) pArg;
+
+	(*rows)++;
+
+	return 0;
+}
+
+static int statements_per_sec(int count, switch_time_t start)
+{
+	switch_time_t took = switch_micro_time_now() - start;
+
+	return took > 0 ? (int) (count * 1000000 / took) : count;
+}
+
+static int wait_for_count(switch_cache_db_handle_t *dbh, const char *sql, int count)
+{
+	char res[20] = "";
+	int sanity;
+
+	for (sanity = 100; sanity; sanity--) {
+		switch_cache_db_execute_sql2str(dbh, (char *) sql, res, sizeof(res), NULL);
+
+		if (atoi(res) == count) {
+			return 1;
+		}
+
+		switch_yield(100000);
+	}
+
+	return 0;
+}
+
+/* count the writers of qm that are running, or that have written something */
+static int count_writers(switch_sql_queue_manager_t *qm, switch_bool_t written)
+{
+	switch_stream_handle_t stream = { 0 };
+	char *line;
+	int count = 0;
+
+	SWITCH_STANDARD_STREAM(stream);
+	switch_sql_queue_manager_stats(qm, &stream);
+
+	for (line = strstr((char *) stream.data, "\tWriter "); line; line = strstr(line + 1, "\tWriter ")) {
+		char *eol = strchr(line, '\n'), *p;
+
+		if (eol) *eol = '\0';
+
+		if (written) {
+			if ((p = strstr(line, "Written: ")) && atoi(p + 9) > 0) {
+				count++;
+			}
+		} else if (strstr(line, ": Running,")) {
+			count++;
+		}
+
+		if (eol) *eol = '\n';
+	}
+
+	switch_safe_free(stream.data);
+
+	return count;
+}
+
+static int restart_core_writers(switch_sql_queue_manager_t *qm, uint32_t writers)
+{
+	int sanity;
+
+	switch_core_sqldb_pause();
+	switch_sql_queue_manager_stop(qm);
+	switch_sql_queue_manager_set_writers(qm, writers, 0, SWITCH_SQL_QUEUE_POLICY_BLOCK);
+	switch_sql_queue_manager_start(qm);
+	switch_core_sqldb_resume();
+
+	for (sanity = 100; sanity; sanity--) {
+		if (count_writers(qm, SWITCH_FALSE) == (int) writers) {
+			return 1;
+		}
+
+		switch_yield(100000);
+	}
+
+	return 0;
+}
+
+static void fire_bridge_event(switch_event_types_t event_id, switch_core_session_t *a, switch_core_session_t *b)
+{
+	switch_event_t *event;
+
+	if (switch_event_create(&event, event_id) == SWITCH_STATUS_SUCCESS) {
+		switch_channel_event_set_data(switch_core_session_get_channel(a), event);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Bridge-A-Unique-ID", switch_core_session_get_uuid(a));
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Bridge-B-Unique-ID", switch_core_session_get_uuid(b));
+		switch_event_fire(&event);
+	}
+}
+
 FST_CORE_BEGIN("./conf")
 {
 	FST_SUITE_BEGIN(switch_core_db)
@@ -69,6 +190,235 @@ FST_CORE_BEGIN("./conf")
 			fst_check_string_equals(res2, "");
 		}
 		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_cache_db_prepared_statements)
+		{
+			switch_cache_db_handle_t *dbh = NULL;
+			switch_cache_db_stmt_t *stmt = NULL, *stmt2 = NULL;
+			char *dsn = "test_switch_cache_db_prepared_statements.db";
+			const char *values[2000];
+			char keys[1000][16];
+			char res[20] = "";
+			switch_time_t start;
+			int i, rows;
+
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql(dbh, "drop table if exists prepared_test", NULL);
+			switch_cache_db_execute_sql(dbh, "create table prepared_test (k varchar(255), v integer)", NULL);
+
+			fst_requires(switch_cache_db_prepare(dbh, "insert into prepared_test values (?, ?)", &stmt) == SWITCH_STATUS_SUCCESS);
+			fst_requires(switch_cache_db_prepare(dbh, "insert into prepared_test values (?, ?)", &stmt2) == SWITCH_STATUS_SUCCESS);
+			fst_check(stmt == stmt2);
+
+			fst_check(switch_cache_db_stmt_bind_text(stmt, 1, "it's quoted") == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_bind_int(stmt, 2, 42) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_execute(stmt, NULL, NULL, NULL) == SWITCH_STATUS_SUCCESS);
+
+			switch_cache_db_execute_sql2str(dbh, "select v from prepared_test where k='it''s quoted'", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "42");
+
+			for (i = 0; i < 1000; i++) {
+				switch_snprintf(keys[i], sizeof(keys[i]), "key%d", i);
+				values[i * 2] = keys[i];
+				values[i * 2 + 1] = i % 2 ? "1" : NULL;
+			}
+
+			start = switch_micro_time_now();
+			fst_check(switch_cache_db_execute_batch(dbh, "insert into prepared_test values (?, ?)", values, 1000, NULL) == SWITCH_STATUS_SUCCESS);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "batch insert: %d statements/sec\n", statements_per_sec(1000, start));
+
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from prepared_test", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "1001");
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from prepared_test where v is null", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "500");
+
+			rows = 0;
+			start = switch_micro_time_now();
+			for (i = 0; i < 1000; i++) {
+				char *sql = switch_mprintf("select v from prepared_test where k='%q'", keys[i]);
+				switch_cache_db_execute_sql_callback(dbh, sql, count_rows_callback, &rows, NULL);
+				switch_safe_free(sql);
+			}
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "formatted selects: %d statements/sec\n", statements_per_sec(1000, start));
+			fst_check_int_equals(rows, 1000);
+
+			rows = 0;
+			start = switch_micro_time_now();
+			for (i = 0; i < 1000; i++) {
+				fst_requires(switch_cache_db_prepare(dbh, "select v from prepared_test where k=?", &stmt) == SWITCH_STATUS_SUCCESS);
+				switch_cache_db_stmt_bind_text(stmt, 1, keys[i]);
+				switch_cache_db_stmt_execute(stmt, count_rows_callback, &rows, NULL);
+			}
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "prepared selects: %d statements/sec\n", statements_per_sec(1000, start));
+			fst_check_int_equals(rows, 1000);
+
+			/* more distinct statements than the handle caches, all of them stay valid while the handle is held */
+			fst_requires(switch_cache_db_prepare(dbh, "insert into prepared_test values (?, ?)", &stmt2) == SWITCH_STATUS_SUCCESS);
+			for (i = 0; i < 200; i++) {
+				char *sql = switch_mprintf("select v from prepared_test where k=? and %d=%d", i, i);
+				fst_requires(switch_cache_db_prepare(dbh, sql, &stmt) == SWITCH_STATUS_SUCCESS);
+				switch_cache_db_stmt_bind_text(stmt, 1, keys[1]);
+				rows = 0;
+				fst_check(switch_cache_db_stmt_execute(stmt, count_rows_callback, &rows, NULL) == SWITCH_STATUS_SUCCESS);
+				fst_check_int_equals(rows, 1);
+				switch_safe_free(sql);
+			}
+
+			fst_check(switch_cache_db_stmt_bind_text(stmt2, 1, "held") == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_bind_int(stmt2, 2, 5) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_execute(stmt2, NULL, NULL, NULL) == SWITCH_STATUS_SUCCESS);
+			switch_cache_db_execute_sql2str(dbh, "select v from prepared_test where k='held'", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "5");
+
+			/* releasing the handle trims the cache, trimmed statements are prepared again on demand */
+			switch_cache_db_release_db_handle(&dbh);
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+
+			fst_requires(switch_cache_db_prepare(dbh, "insert into prepared_test values (?, ?)", &stmt) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_bind_text(stmt, 1, "after eviction") == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_bind_int(stmt, 2, 7) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_cache_db_stmt_execute(stmt, NULL, NULL, NULL) == SWITCH_STATUS_SUCCESS);
+			switch_cache_db_execute_sql2str(dbh, "select v from prepared_test where k='after eviction'", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "7");
+
+			switch_cache_db_execute_sql(dbh, "drop table prepared_test", NULL);
+			switch_cache_db_release_db_handle(&dbh);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_switch_sql_queue_manager_writers)
+		{
+			switch_cache_db_handle_t *dbh = NULL;
+			switch_sql_queue_manager_t *qm = NULL;
+			switch_stream_handle_t stream = { 0 };
+			char *dsn = "test_switch_sql_queue_manager_writers.db";
+			char res[20] = "";
+			int i, sanity, dropped = 0;
+
+			fst_requires(switch_cache_db_get_db_handle_dsn(&dbh, dsn) == SWITCH_STATUS_SUCCESS);
+			switch_cache_db_execute_sql(dbh, "drop table if exists qm_test", NULL);
+			switch_cache_db_execute_sql(dbh, "create table qm_test (k varchar(255), v integer)", NULL);
+
+			switch_sql_queue_manager_init_name("TEST", &qm, 2, dsn, SWITCH_MAX_TRANS, NULL, NULL, NULL, NULL);
+			fst_requires(qm);
+			fst_check(switch_sql_queue_manager_set_writers(qm, 4, 0, SWITCH_SQL_QUEUE_POLICY_BLOCK) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_sql_queue_manager_start(qm) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_sql_queue_manager_set_writers(qm, 2, 0, SWITCH_SQL_QUEUE_POLICY_BLOCK) == SWITCH_STATUS_FALSE);
+
+			fst_requires(wait_for_writers(qm));
+
+			for (i = 0; i < 1000; i++) {
+				char key[16];
+
+				switch_snprintf(key, sizeof(key), "key%d", i % 10);
+				switch_sql_queue_manager_push_key(qm, key, switch_mprintf("insert into qm_test values ('%q', %d)", key, i), i % 2, SWITCH_FALSE);
+			}
+
+			for (sanity = 100; sanity && (switch_sql_queue_manager_size(qm, 0) || switch_sql_queue_manager_size(qm, 1)); sanity--) {
+				switch_yield(100000);
+			}
+
+			switch_sql_queue_manager_stop(qm);
+
+			switch_cache_db_execute_sql2str(dbh, "select count(*) from qm_test", res, sizeof(res), NULL);
+			fst_check_string_equals(res, "1000");
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_sql_queue_manager_stats(qm, &stream);
+			fst_check(strstr((char *) stream.data, "Writers: 4") != NULL);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s", (char *) stream.data);
+			switch_safe_free(stream.data);
+
+			/* a paused manager with a tiny drop queue must refuse the overflow instead of blocking */
+			fst_check(switch_sql_queue_manager_set_writers(qm, 1, 10, SWITCH_SQL_QUEUE_POLICY_DROP) == SWITCH_STATUS_SUCCESS);
+			fst_check(switch_sql_queue_manager_start(qm) == SWITCH_STATUS_SUCCESS);
+
+			fst_requires(wait_for_writers(qm));
+
+			switch_sql_queue_manager_pause(qm, SWITCH_TRUE);
+
+			for (i = 0; i < 20; i++) {
+				if (switch_sql_queue_manager_push(qm, "select 1", 0, SWITCH_TRUE) != SWITCH_STATUS_SUCCESS) {
+					dropped++;
+				}
+			}
+			fst_check_int_equals(dropped, 10);
+
+			switch_sql_queue_manager_destroy(&qm);
+
+			switch_cache_db_execute_sql(dbh, "drop table qm_test", NULL);
+			switch_cache_db_release_db_handle(&dbh);
+		}
+		FST_TEST_END()
+
+		FST_TEST_BEGIN(test_core_db_bridge_writers)
+		{
+			switch_core_session_t *sessions[20] = { 0 };
+			char uuids[20][SWITCH_UUID_FORMATTED_LENGTH + 1];
+			switch_cache_db_handle_t *dbh = NULL;
+			switch_sql_queue_manager_t *qm = switch_core_sqldb_queue_manager();
+			switch_call_cause_t cause;
+			char *sql;
+			int i;
+
+			/* run the core db on 4 writers, the legs of each call have to stay in order across them */
+			fst_requires(qm);
+			fst_requires(restart_core_writers(qm, 4));
+			fst_requires(switch_core_db_handle(&dbh) == SWITCH_STATUS_SUCCESS);
+
+			for (i = 0; i < 20; i++) {
+				fst_requires(switch_ivr_originate(NULL, &sessions[i], &cause, "null/+15553334444", 2, NULL, NULL, NULL, NULL, NULL, SOF_NONE, NULL, NULL) == SWITCH_STATUS_SUCCESS);
+				switch_copy_string(uuids[i], switch_core_session_get_uuid(sessions[i]), sizeof(uuids[i]));
+				sql = switch_mprintf("select count(*) from channels where uuid='%q'", uuids[i]);
+				fst_check(wait_for_count(dbh, sql, 1));
+				switch_safe_free(sql);
+			}
+
+			for (i = 0; i < 20; i += 2) {
+				fire_bridge_event(SWITCH_EVENT_CHANNEL_BRIDGE, sessions[i], sessions[i + 1]);
+			}
+
+			for (i = 0; i < 20; i += 2) {
+				sql = switch_mprintf("select count(*) from calls where caller_uuid='%q' and callee_uuid='%q'", uuids[i], uuids[i + 1]);
+				fst_check(wait_for_count(dbh, sql, 1));
+				switch_safe_free(sql);
+
+				sql = switch_mprintf("select count(*) from channels where call_uuid='%q'", uuids[i]);
+				fst_check(wait_for_count(dbh, sql, 2));
+				switch_safe_free(sql);
+			}
+
+			/* unbridge half of the calls, hang everything up and nothing may be left behind */
+			for (i = 0; i < 10; i += 2) {
+				fire_bridge_event(SWITCH_EVENT_CHANNEL_UNBRIDGE, sessions[i], sessions[i + 1]);
+			}
+
+			for (i = 0; i < 20; i++) {
+				switch_channel_hangup(switch_core_session_get_channel(sessions[i]), SWITCH_CAUSE_NORMAL_CLEARING);
+				switch_core_session_rwunlock(sessions[i]);
+			}
+
+			for (i = 0; i < 20; i += 2) {
+				sql = switch_mprintf("select count(*) from calls where caller_uuid='%q' or callee_uuid='%q'", uuids[i], uuids[i]);
+				fst_check(wait_for_count(dbh, sql, 0));
+				switch_safe_free(sql);
+			}
+
+			for (i = 0; i < 20; i++) {
+				sql = switch_mprintf("select count(*) from channels where uuid='%q'", uuids[i]);
+				fst_check(wait_for_count(dbh, sql, 0));
+				switch_safe_free(sql);
+			}
+
+			/* ten calls spread over 4 writers, more than one of them has to have done the work */
+			fst_check(count_writers(qm, SWITCH_TRUE) > 1);
+
+			switch_cache_db_release_db_handle(&dbh);
+
+			fst_check(restart_core_writers(qm, 1));
+		}
+		FST_TEST_END()
 	}
 	FST_SUITE_END()
 }
@@ -126,6 +126,72 @@ FST_CORE_BEGIN("./conf")
 			unlink(filename);
 		}
 		FST_TEST_END()
+		FST_TEST_BEGIN(test_switch_core_prompt_cache)
+		{
+			switch_file_handle_t fh = { 0 };
+			switch_status_t status = SWITCH_STATUS_FALSE;
+			switch_stream_handle_t stream = { 0 };
+			static char filename[] = "/tmp/fs_unit_test_prompt.wav";
+			int16_t samples[800], buf[800];
+			switch_size_t len;
+			unsigned int pos = 0;
+			int i;
+
+			for (i = 0; i < 800; i++) {
+				samples[i] = (int16_t) (i * 8);
+			}
+
+			status = switch_core_file_open(&fh, filename, 1, 8000, SWITCH_FILE_FLAG_WRITE | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+			len = 800;
+			switch_core_file_write(&fh, samples, &len);
+			switch_core_file_close(&fh);
+
+			switch_core_prompt_cache_set_size(1024 * 1024);
+			fst_check(switch_core_prompt_cache_preload(filename, 8000, 1) == SWITCH_STATUS_SUCCESS);
+
+			memset(&fh, 0, sizeof(fh));
+			status = switch_core_file_open(&fh, filename, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+			fst_check(fh.prompt_cache != NULL);
+
+			len = 800;
+			status = switch_core_file_read(&fh, buf, &len);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+			fst_check(len == 800);
+			fst_check(!memcmp(buf, samples, sizeof(samples)));
+
+			len = 800;
+			status = switch_core_file_read(&fh, buf, &len);
+			fst_check(status == SWITCH_STATUS_FALSE);
+			fst_check(len == 0);
+
+			status = switch_core_file_seek(&fh, &pos, 400, SEEK_SET);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+			fst_check(pos == 400);
+			len = 800;
+			status = switch_core_file_read(&fh, buf, &len);
+			fst_check(len == 400);
+			fst_check(!memcmp(buf, samples + 400, 400 * sizeof(int16_t)));
+			switch_core_file_close(&fh);
+
+			SWITCH_STANDARD_STREAM(stream);
+			switch_core_prompt_cache_stats(&stream);
+			fst_check(strstr((char *) stream.data, "Hits: 1, Misses: 1, Loads: 1") != NULL);
+			switch_safe_free(stream.data);
+
+			fst_check(switch_core_prompt_cache_flush(filename) == 1);
+			switch_core_prompt_cache_set_size(0);
+
+			memset(&fh, 0, sizeof(fh));
+			status = switch_core_file_open(&fh, filename, 1, 8000, SWITCH_FILE_FLAG_READ | SWITCH_FILE_DATA_SHORT, NULL);
+			fst_requires(status == SWITCH_STATUS_SUCCESS);
+			fst_check(fh.prompt_cache == NULL);
+			switch_core_file_close(&fh);
+
+			unlink(filename);
+		}
+		FST_TEST_END()
 
 	}
 	FST_SUITE_END()
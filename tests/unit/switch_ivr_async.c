@@ -0,0 +1,327 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2018, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ *
+ * switch_ivr_async.c -- tests the inband tone detectors used by the async media bugs
+ *
+ */
+
+#include <math.h>
+#include <switch.h>
+#include <test/switch_test.h>
+
+#define RATE 8000
+#define FRAME_SAMPLES 160
+#define DETECT_CHANNELS 50
+#define BENCH_CHANNELS 50
+#define BENCH_SECONDS 10
+
+static const float dtmf_row_hz[] = { 697.0f, 770.0f, 852.0f, 941.0f };
+static const float dtmf_col_hz[] = { 1209.0f, 1336.0f, 1477.0f, 1633.0f };
+static const char *dtmf_digits = "123A456B789C*0#D";
+
+/* Fill one frame with a dual tone, or silence when both frequencies are zero */
+static void gen_frame(int16_t *data, float f1, float f2, uint32_t *t)
+{
+	int i;
+
+	for (i = 0; i < FRAME_SAMPLES; i++, (*t)++) {
+		double v = 0;
+
+		if (f1) v += 6000.0 * sin(2.0 * M_PI * f1 * *t / RATE);
+		if (f2) v += 6000.0 * sin(2.0 * M_PI * f2 * *t / RATE);
+		data[i] = (int16_t) v;
+	}
+}
+
+/* Play a digit string through a detector as 120ms of tone and 120ms of silence per digit */
+static int detect_digits(teletone_dtmf_detect_state_t *dtmf, const char *digits, char *out, int max, uint32_t *t)
+{
+	int16_t data[FRAME_SAMPLES];
+	const char *p;
+	int n = 0, f;
+
+	for (p = digits; *p; p++) {
+		int k = (int) (strchr(dtmf_digits, *p) - dtmf_digits);
+
+		for (f = 0; f < 12; f++) {
+			if (f < 6) {
+				gen_frame(data, dtmf_row_hz[k >> 2], dtmf_col_hz[k & 3], t);
+			} else {
+				gen_frame(data, 0, 0, t);
+			}
+
+			if (teletone_dtmf_detect(dtmf, data, FRAME_SAMPLES) == TT_HIT_END) {
+				unsigned int dur = 0;
+				char digit = 0;
+
+				teletone_dtmf_get(dtmf, &digit, &dur);
+				if (out && n < max - 1) {
+					out[n++] = digit;
+				}
+			}
+		}
+	}
+
+	if (out) {
+		out[n] = '\0';
+	}
+
+	return n;
+}
+
+FST_MINCORE_BEGIN("./conf")
+
+FST_SUITE_BEGIN(switch_ivr_async)
+
+FST_SETUP_BEGIN()
+{
+}
+FST_SETUP_END()
+
+FST_TEARDOWN_BEGIN()
+{
+}
+FST_TEARDOWN_END()
+
+FST_TEST_BEGIN(goertzel_bank)
+{
+	teletone_goertzel_bank_t bank;
+	int16_t data[FRAME_SAMPLES];
+	uint32_t t = 0;
+	int x;
+
+	teletone_goertzel_bank_init(&bank);
+	fst_check_int_equals(teletone_goertzel_bank_add(&bank, 697.0f, RATE), 0);
+	fst_check_int_equals(teletone_goertzel_bank_add(&bank, 1209.0f, RATE), 1);
+	fst_check_int_equals(teletone_goertzel_bank_add(&bank, 1477.0f, RATE), 2);
+
+	gen_frame(data, 697.0f, 1209.0f, &t);
+	teletone_goertzel_bank_update(&bank, data, FRAME_SAMPLES);
+
+	fst_check(teletone_goertzel_bank_result(&bank, 0) > 100 * teletone_goertzel_bank_result(&bank, 2));
+	fst_check(teletone_goertzel_bank_result(&bank, 1) > 100 * teletone_goertzel_bank_result(&bank, 2));
+	fst_check(teletone_goertzel_bank_result(&bank, 3) == 0.0);
+
+	teletone_goertzel_bank_reset(&bank);
+	fst_check(teletone_goertzel_bank_result(&bank, 0) == 0.0);
+
+	for (x = bank.bins; x < TELETONE_MAX_BANK_BINS; x++) {
+		fst_check(teletone_goertzel_bank_add(&bank, 1000.0f, RATE) == x);
+	}
+	fst_check_int_equals(teletone_goertzel_bank_add(&bank, 1000.0f, RATE), -1);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(dtmf_detect)
+{
+	teletone_dtmf_detect_state_t dtmf;
+	char out[32] = "";
+	uint32_t t = 0;
+
+	teletone_dtmf_detect_init(&dtmf, RATE);
+	detect_digits(&dtmf, "159D*0#A", out, sizeof(out), &t);
+	fst_check_string_equals(out, "159D*0#A");
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(dtmf_detect_channels)
+{
+	teletone_dtmf_detect_state_t *dtmf;
+	char out[32] = "";
+	uint32_t t;
+	int c;
+
+	dtmf = calloc(DETECT_CHANNELS, sizeof(*dtmf));
+	fst_requires(dtmf);
+
+	/* every detector keeps its own bank, so running many side by side must not change what each one hears */
+	for (c = 0; c < DETECT_CHANNELS; c++) {
+		teletone_dtmf_detect_init(&dtmf[c], RATE);
+	}
+
+	for (c = 0; c < DETECT_CHANNELS; c++) {
+		t = 0;
+		detect_digits(&dtmf[c], "5", NULL, 0, &t);
+		t = (uint32_t) c * 7;
+		detect_digits(&dtmf[c], "2468", out, sizeof(out), &t);
+		fst_check_string_equals(out, "2468");
+	}
+
+	free(dtmf);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(dtmf_detect_silence)
+{
+	teletone_dtmf_detect_state_t dtmf;
+	int16_t data[FRAME_SAMPLES];
+	uint32_t t = 0;
+	int f, hits = 0;
+
+	teletone_dtmf_detect_init(&dtmf, RATE);
+
+	/* a single row tone is not a digit */
+	for (f = 0; f < 50; f++) {
+		gen_frame(data, f < 25 ? 852.0f : 0, 0, &t);
+		if (teletone_dtmf_detect(&dtmf, data, FRAME_SAMPLES) != TT_HIT_NONE) {
+			hits++;
+		}
+	}
+
+	fst_check_int_equals(hits, 0);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(fax_tone_detect)
+{
+	teletone_dtmf_detect_state_t dtmf;
+	int16_t data[FRAME_SAMPLES];
+	uint32_t t = 0;
+	int f, cng = 0, ced = 0, hits = 0;
+
+	teletone_dtmf_detect_init(&dtmf, RATE);
+
+	/* two CNG cadences, 500ms of 1100Hz and 3s of silence, then 3s of CED */
+	for (f = 0; f < 2 * 175 + 150; f++) {
+		float hz = 0;
+
+		if (f < 350) {
+			hz = (f % 175) < 25 ? 1100.0f : 0;
+		} else {
+			hz = 2100.0f;
+		}
+
+		gen_frame(data, hz, 0, &t);
+		if (teletone_dtmf_detect(&dtmf, data, FRAME_SAMPLES) != TT_HIT_NONE) {
+			hits++;
+		}
+
+		switch (teletone_dtmf_get_fax_tone(&dtmf)) {
+		case TT_FAX_CNG:
+			cng++;
+			/* reported after the minimum duration, inside the burst */
+			fst_check((f % 175) >= TELETONE_FAX_TONE_MS * RATE / 1000 / FRAME_SAMPLES - 1 && (f % 175) < 25);
+			break;
+		case TT_FAX_CED:
+			ced++;
+			fst_check(f >= 350);
+			break;
+		default:
+			break;
+		}
+	}
+
+	fst_check_int_equals(cng, 2);
+	fst_check_int_equals(ced, 1);
+	fst_check_int_equals(hits, 0);
+
+	/* a short 1100Hz blip is no fax */
+	teletone_dtmf_detect_init(&dtmf, RATE);
+	for (f = 0; f < 50; f++) {
+		gen_frame(data, f < 10 ? 1100.0f : 0, 0, &t);
+		teletone_dtmf_detect(&dtmf, data, FRAME_SAMPLES);
+		fst_check(teletone_dtmf_get_fax_tone(&dtmf) == TT_FAX_NONE);
+	}
+
+	/* digits still decode with the fax bins in the bank */
+	{
+		char out[32] = "";
+
+		detect_digits(&dtmf, "0123456789", out, sizeof(out), &t);
+		fst_check_string_equals(out, "0123456789");
+		fst_check(teletone_dtmf_get_fax_tone(&dtmf) == TT_FAX_NONE);
+	}
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(benchmark)
+{
+	teletone_dtmf_detect_state_t *dtmf;
+	int16_t data[FRAME_SAMPLES * 12];
+	switch_time_t start_ts, end_ts;
+	uint32_t t = 0;
+	int frames = BENCH_SECONDS * RATE / FRAME_SAMPLES;
+	int c, f, *hits;
+	double seconds;
+
+	dtmf = calloc(BENCH_CHANNELS, sizeof(*dtmf));
+	hits = calloc(BENCH_CHANNELS, sizeof(*hits));
+	fst_requires(dtmf && hits);
+
+	for (c = 0; c < BENCH_CHANNELS; c++) {
+		teletone_dtmf_detect_init(&dtmf[c], RATE);
+	}
+
+	/* one digit per 240ms, 120ms of tone then 120ms of silence */
+	for (f = 0; f < 12; f++) {
+		gen_frame(data + f * FRAME_SAMPLES, f < 6 ? 770.0f : 0, f < 6 ? 1336.0f : 0, &t);
+	}
+
+	start_ts = switch_time_now();
+	for (f = 0; f < frames; f++) {
+		for (c = 0; c < BENCH_CHANNELS; c++) {
+			if (teletone_dtmf_detect(&dtmf[c], data + (f % 12) * FRAME_SAMPLES, FRAME_SAMPLES) == TT_HIT_END) {
+				char digit = 0;
+				unsigned int dur = 0;
+
+				teletone_dtmf_get(&dtmf[c], &digit, &dur);
+				if (digit == '5') {
+					hits[c]++;
+				}
+			}
+		}
+	}
+	end_ts = switch_time_now();
+
+	for (c = 0; c < BENCH_CHANNELS; c++) {
+		fst_check_int_equals(hits[c], frames / 12);
+	}
+
+	seconds = (end_ts - start_ts) / 1000000.0;
+	if (seconds <= 0) seconds = 0.000001;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "teletone_dtmf_detect: %d channels x %ds of audio in %.3fs, %.0f channels per core\n",
+					  BENCH_CHANNELS, BENCH_SECONDS, seconds, BENCH_CHANNELS * BENCH_SECONDS / seconds);
+
+	free(hits);
+	free(dtmf);
+}
+FST_TEST_END()
+
+FST_SUITE_END()
+
+FST_MINCORE_END()
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4 noet:
+ */
@@ -138,6 +138,41 @@ FST_CORE_BEGIN("./conf")
 		}
 		FST_TEST_END()
 
+		FST_TEST_BEGIN(originate_test_fork)
+		{
+			switch_core_session_t *session = NULL;
+			switch_channel_t *channel = NULL;
+			switch_status_t status;
+			switch_call_cause_t cause;
+			switch_stream_handle_t stream = { 0 };
+			switch_time_t start;
+			int i;
+
+			SWITCH_STANDARD_STREAM(stream);
+			for (i = 0; i < 20; i++) {
+				stream.write_function(&stream, "%snull/+1555333%04d", i ? "," : "", i);
+			}
+
+			start = switch_time_now();
+			status = switch_ivr_originate(NULL, &session, &cause, (char *) stream.data, 2, NULL, NULL, NULL, NULL, NULL, SOF_NONE, NULL, NULL);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "20 way fork answered in %" SWITCH_TIME_T_FMT "us\n", switch_time_now() - start);
+			switch_safe_free(stream.data);
+
+			fst_requires(session);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+
+			channel = switch_core_session_get_channel(session);
+			fst_requires(channel);
+			/* the answer to bridge latency is recorded when the winner is bridged */
+			fst_check(switch_channel_get_variable(channel, "originate_answer_latency_usec") == NULL);
+			switch_channel_set_bridge_time(channel);
+			fst_check(switch_channel_get_variable(channel, "originate_answer_latency_usec") != NULL);
+
+			switch_channel_hangup(channel, SWITCH_CAUSE_NORMAL_CLEARING);
+			switch_core_session_rwunlock(session);
+		}
+		FST_TEST_END()
+
 		FST_TEST_BEGIN(dial_handle_create_json)
 		{
 			const char *dh_str = "{\n"
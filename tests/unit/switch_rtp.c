@@ -1,6 +1,9 @@
 
 #include <switch.h>
 #include <test/switch_test.h>
+#include <switch_ssl.h>
+#include <switch_stun.h>
+#include <srtp.h>
 
 static const char *rx_host = "127.0.0.1";
 static switch_port_t rx_port = 12346;
@@ -17,6 +20,25 @@ switch_io_flag_t io_flags;
 switch_payload_t read_pt;
 uint datalen;
 
+#define SRTP_BENCH_BATCH 16
+#define SRTP_BENCH_PACKETS 200000
+#define SRTP_BENCH_PAYLOAD 160
+
+typedef struct {
+	const char *name;
+	void (*set_policy)(srtp_crypto_policy_t *p);
+} srtp_bench_suite_t;
+
+static const srtp_bench_suite_t srtp_bench_suites[] = {
+	{ "AES_CM_128_HMAC_SHA1_80", srtp_crypto_policy_set_rtp_default },
+	{ "AES_CM_128_HMAC_SHA1_32", srtp_crypto_policy_set_aes_cm_128_hmac_sha1_32 },
+	{ "AES_CM_256_HMAC_SHA1_80", srtp_crypto_policy_set_aes_cm_256_hmac_sha1_80 },
+	{ "AES_CM_256_HMAC_SHA1_32", srtp_crypto_policy_set_aes_cm_256_hmac_sha1_32 },
+	{ "AEAD_AES_128_GCM_8", srtp_crypto_policy_set_aes_gcm_128_8_auth },
+	{ "AEAD_AES_256_GCM_8", srtp_crypto_policy_set_aes_gcm_256_8_auth },
+	{ NULL, NULL }
+};
+
 FST_CORE_BEGIN("./conf")
 {
 FST_SUITE_BEGIN(switch_rtp)
@@ -52,6 +74,262 @@ FST_TEST_BEGIN(test_rtp)
 	switch_core_destroy_memory_pool(&pool);
 }
 FST_TEST_END()
+
+FST_TEST_BEGIN(test_rtp_relay)
+{
+	switch_rtp_t *rtp_a = NULL, *rtp_b = NULL;
+	switch_socket_t *sender = NULL, *receiver = NULL;
+	switch_sockaddr_t *a_addr = NULL, *sender_addr = NULL, *receiver_addr = NULL, *from_addr = NULL;
+	switch_rtp_hdr_t *hdr;
+	unsigned char out[172] = { 0 }, in[1500] = { 0 };
+	switch_size_t len;
+	int i;
+
+	switch_core_new_memory_pool(&pool);
+
+	rtp_a = switch_rtp_new(rx_host, 12350, tx_host, 12360, TEST_PT, 8000, 20 * 1000, flags, "soft", &err, pool, 0, 0);
+	rtp_b = switch_rtp_new(rx_host, 12352, tx_host, 12362, TEST_PT, 8000, 20 * 1000, flags, "soft", &err, pool, 0, 0);
+	fst_requires(switch_rtp_ready(rtp_a));
+	fst_requires(switch_rtp_ready(rtp_b));
+	switch_rtp_set_ssrc(rtp_b, 0xbbbb);
+
+	fst_requires(switch_sockaddr_info_get(&a_addr, rx_host, SWITCH_UNSPEC, 12350, 0, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_sockaddr_info_get(&sender_addr, tx_host, SWITCH_UNSPEC, 12360, 0, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_sockaddr_info_get(&receiver_addr, tx_host, SWITCH_UNSPEC, 12362, 0, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_sockaddr_create(&from_addr, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_socket_create(&sender, switch_sockaddr_get_family(sender_addr), SOCK_DGRAM, 0, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_socket_bind(sender, sender_addr) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_socket_create(&receiver, switch_sockaddr_get_family(receiver_addr), SOCK_DGRAM, 0, pool) == SWITCH_STATUS_SUCCESS);
+	fst_requires(switch_socket_bind(receiver, receiver_addr) == SWITCH_STATUS_SUCCESS);
+	switch_socket_timeout_set(receiver, 1000000);
+
+	fst_requires(switch_rtp_relay_start(rtp_a, rtp_b, TEST_PT) == SWITCH_STATUS_SUCCESS);
+	fst_check(switch_rtp_relay_running(rtp_a));
+
+	hdr = (switch_rtp_hdr_t *) out;
+	hdr->version = 2;
+	hdr->pt = TEST_PT;
+	hdr->seq = htons(100);
+	hdr->ts = htonl(16000);
+	hdr->ssrc = htonl(0xaaaa);
+	for (i = 12; i < (int) sizeof(out); i++) {
+		out[i] = (unsigned char) i;
+	}
+
+	len = sizeof(out);
+	fst_requires(switch_socket_sendto(sender, a_addr, 0, (void *) out, &len) == SWITCH_STATUS_SUCCESS);
+
+	/* the packet leaves rtp_b with its ssrc and payload type and the body untouched */
+	len = sizeof(in);
+	fst_requires(switch_socket_recvfrom(from_addr, receiver, 0, (void *) in, &len) == SWITCH_STATUS_SUCCESS);
+	fst_check_int_equals((int) len, (int) sizeof(out));
+	hdr = (switch_rtp_hdr_t *) in;
+	fst_check_int_equals(hdr->pt, TEST_PT);
+	fst_check(ntohl(hdr->ssrc) == 0xbbbb);
+	fst_check(hdr->m == 1);
+	fst_check(!memcmp(in + 12, out + 12, sizeof(out) - 12));
+
+	/* a telephone-event packet is not relayed, it suspends the relay and is left for the read path */
+	hdr = (switch_rtp_hdr_t *) out;
+	hdr->pt = 101;
+	len = sizeof(out);
+	fst_requires(switch_socket_sendto(sender, a_addr, 0, (void *) out, &len) == SWITCH_STATUS_SUCCESS);
+	switch_rtp_relay_wait(rtp_a, 1000);
+	fst_check(!switch_rtp_relay_running(rtp_a));
+
+	switch_rtp_relay_stop(rtp_a);
+	switch_socket_close(sender);
+	switch_socket_close(receiver);
+	switch_rtp_destroy(&rtp_a);
+	switch_rtp_destroy(&rtp_b);
+
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_dtls_shared_ctx)
+{
+	dtls_fingerprint_t fp1 = { 0 }, fp2 = { 0 };
+	switch_stream_handle_t stream = { 0 };
+	SSL_CTX *a, *b, *c;
+
+	fp1.type = fp2.type = "sha-256";
+	fst_check_int_equals(switch_core_cert_gen_fingerprint(DTLS_SRTP_FNAME, &fp1), 1);
+	fst_check_int_equals(switch_core_cert_gen_fingerprint(DTLS_SRTP_FNAME, &fp2), 1);
+	fst_check(fp1.len > 0);
+	fst_check_int_equals(fp1.len, fp2.len);
+	fst_check_string_equals(fp1.str, fp2.str);
+
+	a = switch_core_cert_dtls_ctx(DTLS_SRTP_FNAME, 1, 1);
+	b = switch_core_cert_dtls_ctx(DTLS_SRTP_FNAME, 1, 1);
+	c = switch_core_cert_dtls_ctx(DTLS_SRTP_FNAME, 0, 1);
+	fst_requires(a && b && c);
+	fst_check(a == b);
+	fst_check(a != c);
+	SSL_CTX_free(a);
+	SSL_CTX_free(b);
+	SSL_CTX_free(c);
+
+	SWITCH_STANDARD_STREAM(stream);
+	switch_rtp_dtls_stats(&stream);
+	fst_check(strstr((char *) stream.data, "handshakes: ") != NULL);
+	fst_check(strstr((char *) stream.data, ">= 2500ms: ") != NULL);
+	switch_safe_free(stream.data);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_stun_integrity)
+{
+	uint8_t buf1[256] = { 0 }, buf2[256] = { 0 };
+	switch_stun_packet_t *p1, *p2;
+	switch_stun_hmac_t *hmac, *bad;
+	char id[12] = "abcdefghijkl";
+	char user[] = "remote:local";
+
+	hmac = switch_stun_hmac_create("icepassword0123456789012", fst_pool);
+	bad = switch_stun_hmac_create("someotherpassword", fst_pool);
+	fst_requires(hmac && bad);
+
+	p1 = switch_stun_packet_build_header(SWITCH_STUN_BINDING_REQUEST, id, buf1);
+	switch_stun_packet_attribute_add_username(p1, user, (uint16_t)strlen(user));
+	p2 = switch_stun_packet_build_header(SWITCH_STUN_BINDING_REQUEST, id, buf2);
+	switch_stun_packet_attribute_add_username(p2, user, (uint16_t)strlen(user));
+
+	fst_check_int_equals(switch_stun_packet_verify_integrity(buf1, switch_stun_packet_length(p1), hmac), -1);
+
+	switch_stun_packet_attribute_add_integrity(p1, "icepassword0123456789012");
+	switch_stun_packet_attribute_add_integrity_hmac(p2, hmac);
+	switch_stun_packet_attribute_add_fingerprint(p1);
+	switch_stun_packet_attribute_add_fingerprint(p2);
+
+	fst_check_int_equals(switch_stun_packet_length(p1), switch_stun_packet_length(p2));
+	fst_check(!memcmp(buf1, buf2, switch_stun_packet_length(p1)));
+
+	fst_check_int_equals(switch_stun_packet_verify_integrity(buf2, switch_stun_packet_length(p2), hmac), 1);
+	fst_check_int_equals(switch_stun_packet_verify_integrity(buf2, switch_stun_packet_length(p2), bad), 0);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_stun_integrity_required)
+{
+	uint8_t buf[1024] = { 0 };
+	char software[600];
+	switch_stun_packet_t *p;
+	switch_stun_hmac_t *hmac;
+	char id[12] = "abcdefghijkl";
+	char user[] = "remote:local";
+	switch_size_t len;
+
+	hmac = switch_stun_hmac_create("icepassword0123456789012", fst_pool);
+	fst_requires(hmac);
+
+	memset(software, 'x', sizeof(software));
+	p = switch_stun_packet_build_header(SWITCH_STUN_BINDING_REQUEST, id, buf);
+	switch_stun_packet_attribute_add_username(p, user, (uint16_t)strlen(user));
+	switch_stun_packet_attribute_add_software(p, software, (uint16_t)sizeof(software));
+
+	/* an unsigned binding request must not be accepted for a candidate change */
+	fst_check(switch_stun_packet_verify_integrity(buf, switch_stun_packet_length(p), hmac) != 1);
+
+	switch_stun_packet_attribute_add_integrity_hmac(p, hmac);
+	switch_stun_packet_attribute_add_fingerprint(p);
+	len = switch_stun_packet_length(p);
+
+	/* requests over 512 bytes verify too */
+	fst_check(len > 512);
+	fst_check_int_equals(switch_stun_packet_verify_integrity(buf, len, hmac), 1);
+
+	/* cut into the integrity attribute */
+	fst_check(switch_stun_packet_verify_integrity(buf, len - 30, hmac) != 1);
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(test_srtp_benchmark)
+{
+	static uint32_t pkt[SRTP_BENCH_BATCH][(12 + SRTP_BENCH_PAYLOAD + SRTP_MAX_TRAILER_LEN) / 4 + 1];
+	unsigned char key[SRTP_AES_ICM_256_KEY_LEN_WSALT];
+	unsigned char payload[SRTP_BENCH_PAYLOAD];
+	const srtp_bench_suite_t *suite;
+	int x;
+
+	for (x = 0; x < (int) sizeof(key); x++) {
+		key[x] = (unsigned char) (x * 7 + 1);
+	}
+
+	memset(payload, 0x55, sizeof(payload));
+
+	for (suite = srtp_bench_suites; suite->name; suite++) {
+		srtp_policy_t policy;
+		srtp_t tx = NULL, rx = NULL;
+		void *hdrs[SRTP_BENCH_BATCH];
+		int lens[SRTP_BENCH_BATCH];
+		srtp_err_status_t stat[SRTP_BENCH_BATCH];
+		switch_time_t protect_us = 0, unprotect_us = 0, ts;
+		uint16_t seq = 1;
+		int sent = 0, protected_ok = 0, unprotected_ok = 0, intact = 0, i;
+
+		memset(&policy, 0, sizeof(policy));
+		suite->set_policy(&policy.rtp);
+		suite->set_policy(&policy.rtcp);
+		policy.ssrc.type = ssrc_specific;
+		policy.ssrc.value = 0xabcd;
+		policy.key = key;
+
+		if (srtp_create(&tx, &policy) != srtp_err_status_ok || srtp_create(&rx, &policy) != srtp_err_status_ok) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s: not available in this libsrtp build\n", suite->name);
+			if (tx) srtp_dealloc(tx);
+			continue;
+		}
+
+		while (sent < SRTP_BENCH_PACKETS) {
+			for (i = 0; i < SRTP_BENCH_BATCH; i++) {
+				switch_rtp_hdr_t *hdr = (switch_rtp_hdr_t *) pkt[i];
+
+				memset(pkt[i], 0x55, 12 + SRTP_BENCH_PAYLOAD);
+				memset(hdr, 0, 12);
+				hdr->version = 2;
+				hdr->pt = TEST_PT;
+				hdr->seq = htons(seq++);
+				hdr->ts = htonl((uint32_t) sent * SRTP_BENCH_PAYLOAD);
+				hdr->ssrc = htonl(0xabcd);
+				hdrs[i] = pkt[i];
+				lens[i] = 12 + SRTP_BENCH_PAYLOAD;
+			}
+
+			ts = switch_time_now();
+			protected_ok += srtp_protect_batch(tx, hdrs, lens, stat, SRTP_BENCH_BATCH, 0, 0);
+			protect_us += switch_time_now() - ts;
+
+			ts = switch_time_now();
+			unprotected_ok += srtp_unprotect_batch(rx, hdrs, lens, stat, SRTP_BENCH_BATCH, 0);
+			unprotect_us += switch_time_now() - ts;
+
+			/* every packet must come back out exactly as it went in */
+			for (i = 0; i < SRTP_BENCH_BATCH; i++) {
+				if (stat[i] == srtp_err_status_ok && lens[i] == 12 + SRTP_BENCH_PAYLOAD &&
+					!memcmp((unsigned char *) pkt[i] + 12, payload, SRTP_BENCH_PAYLOAD)) {
+					intact++;
+				}
+			}
+
+			sent += SRTP_BENCH_BATCH;
+		}
+
+		if (!protect_us) protect_us = 1;
+		if (!unprotect_us) unprotect_us = 1;
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s: %d packets, protect %.0f pps, unprotect %.0f pps per core\n",
+						  suite->name, sent, sent * 1000000.0 / protect_us, sent * 1000000.0 / unprotect_us);
+
+		fst_check_int_equals(protected_ok, sent);
+		fst_check_int_equals(unprotected_ok, sent);
+		fst_check_int_equals(intact, sent);
+
+		srtp_dealloc(tx);
+		srtp_dealloc(rx);
+	}
+}
+FST_TEST_END()
 }
 FST_SUITE_END()
 }
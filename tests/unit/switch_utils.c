@@ -63,6 +63,147 @@ FST_TEST_BEGIN(benchmark)
 }
 FST_TEST_END()
 
+FST_TEST_BEGIN(network_list)
+{
+	switch_memory_pool_t *pool = NULL;
+	switch_network_list_t *list = NULL;
+	switch_network_port_range_t sip = { 0 };
+	const char *token = NULL;
+	ip_t ip;
+
+	switch_core_new_memory_pool(&pool);
+	switch_network_list_create(&list, "test", SWITCH_FALSE, pool);
+
+	switch_network_list_add_cidr_token(list, "10.0.0.0/8", SWITCH_TRUE, "wide");
+	switch_network_list_add_cidr_token(list, "10.1.0.0/16", SWITCH_FALSE, "narrow");
+	switch_network_list_add_cidr_token(list, "10.1.0.0/16", SWITCH_TRUE, "later");
+	sip.port = 5060;
+	switch_network_list_add_cidr_port_token(list, "10.1.2.0/24", SWITCH_TRUE, "sip", &sip);
+	switch_network_list_add_host_mask(list, "192.168.0.1", "255.255.0.255", SWITCH_TRUE);
+	switch_network_list_add_cidr_token(list, "2001:db8::/32", SWITCH_TRUE, "v6");
+
+	/* the longest prefix wins, and of two equal ones the first added */
+	fst_check(switch_network_list_validate_ip_token(list, 0x0A020304, &token));
+	fst_check_string_equals(token, "wide");
+	fst_check(!switch_network_list_validate_ip_token(list, 0x0A010304, &token));
+	fst_check_string_equals(token, "narrow");
+
+	/* port ranges only narrow the match */
+	fst_check(switch_network_list_validate_ip_port_token(list, 0x0A010203, 5060, &token));
+	fst_check_string_equals(token, "sip");
+	fst_check(!switch_network_list_validate_ip_port_token(list, 0x0A010203, 5080, &token));
+	fst_check_string_equals(token, "narrow");
+
+	/* masks that are not a prefix still match */
+	fst_check(switch_network_list_validate_ip_token(list, 0xC0A87701, NULL));
+	fst_check(!switch_network_list_validate_ip_token(list, 0xC0A87702, NULL));
+	fst_check(!switch_network_list_validate_ip_token(list, 0x0B000001, NULL));
+
+	switch_inet_pton(AF_INET6, "2001:db8:1::1", &ip);
+	fst_check(switch_network_list_validate_ip6_token(list, ip, &token));
+	fst_check_string_equals(token, "v6");
+	switch_inet_pton(AF_INET6, "2001:db9::1", &ip);
+	fst_check(!switch_network_list_validate_ip6_token(list, ip, NULL));
+
+	switch_core_destroy_memory_pool(&pool);
+}
+FST_TEST_END()
+
+/* rand() only guarantees 15 bits, stitch two calls together to reach the top of the address space */
+#define BENCH_RAND32() (((uint32_t) rand() << 16) ^ (uint32_t) rand())
+
+FST_TEST_BEGIN(network_list_benchmark)
+{
+	int sizes[] = { 1000, 10000, 100000 };
+	int i, n, x;
+
+	srand((unsigned) switch_micro_time_now());
+
+	for (i = 0; i < 3; i++) {
+		switch_memory_pool_t *pool = NULL;
+		switch_network_list_t *list = NULL;
+		switch_time_t start, end;
+		int lookups = 1000000, hits = 0;
+		char host[16], mask[16];
+
+		switch_core_new_memory_pool(&pool);
+		switch_network_list_create(&list, "bench", SWITCH_FALSE, pool);
+
+		for (n = 0; n < sizes[i]; n++) {
+			uint32_t bits = 16 + rand() % 17;
+			uint32_t m = 0xFFFFFFFF << (32 - bits);
+			uint32_t net = BENCH_RAND32() & m;
+
+			/* host/mask adds do not log, unlike the cidr ones */
+			switch_snprintf(host, sizeof(host), "%u.%u.%u.%u", net >> 24, (net >> 16) & 0xFF, (net >> 8) & 0xFF, net & 0xFF);
+			switch_snprintf(mask, sizeof(mask), "%u.%u.%u.%u", m >> 24, (m >> 16) & 0xFF, (m >> 8) & 0xFF, m & 0xFF);
+			switch_network_list_add_host_mask(list, host, mask, n & 1);
+		}
+
+		start = switch_time_now();
+		for (x = 0; x < lookups; x++) {
+			hits += switch_network_list_validate_ip(list, BENCH_RAND32());
+		}
+		end = switch_time_now();
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "network list with %d entries: %d lookups in %" SWITCH_TIME_T_FMT "us, %.0f lookups/sec (%d allowed)\n",
+						  sizes[i], lookups, end - start, lookups * 1000000.0 / (end - start ? end - start : 1), hits);
+
+		switch_core_destroy_memory_pool(&pool);
+	}
+}
+FST_TEST_END()
+
+FST_TEST_BEGIN(frame_buffer_reuse)
+{
+	switch_frame_buffer_t *fb = NULL;
+	switch_frame_t frame = { 0 }, pframe = { 0 };
+	switch_frame_t *a = NULL, *b = NULL, *p = NULL, *first;
+	unsigned char data[160] = { 0 };
+	unsigned char packet[172] = { 0 };
+	switch_stream_handle_t stream = { 0 };
+
+	frame.data = data;
+	frame.datalen = sizeof(data);
+	frame.buflen = sizeof(data);
+
+	pframe.packet = packet;
+	pframe.packetlen = sizeof(packet);
+	pframe.data = packet + 12;
+	pframe.datalen = sizeof(data);
+	pframe.buflen = sizeof(packet);
+
+	fst_requires(switch_frame_buffer_create(&fb, 0) == SWITCH_STATUS_SUCCESS);
+
+	fst_requires(switch_frame_buffer_dup(fb, &frame, &a) == SWITCH_STATUS_SUCCESS);
+	fst_check(a->packet == NULL);
+	first = a;
+	switch_frame_buffer_free(fb, &a);
+	fst_check(a == NULL);
+
+	/* a packet frame never takes a freed data frame */
+	fst_requires(switch_frame_buffer_dup(fb, &pframe, &p) == SWITCH_STATUS_SUCCESS);
+	fst_check(p->packet != NULL);
+	fst_check_int_equals(p->packetlen, sizeof(packet));
+
+	fst_requires(switch_frame_buffer_dup(fb, &frame, &b) == SWITCH_STATUS_SUCCESS);
+	fst_check(b->packet == NULL);
+	fst_check(b == first);
+
+	switch_frame_buffer_free(fb, &p);
+	switch_frame_buffer_free(fb, &b);
+	switch_frame_buffer_destroy(&fb);
+	fst_check(fb == NULL);
+
+	SWITCH_STANDARD_STREAM(stream);
+	switch_frame_buffer_stats(&stream);
+	fst_requires(!zstr(stream.data));
+	fst_check(strstr((char *) stream.data, "packet") != NULL);
+	fst_check(strstr((char *) stream.data, "reused") != NULL);
+	switch_safe_free(stream.data);
+}
+FST_TEST_END()
+
 FST_SUITE_END()
 
 FST_MINCORE_END()
@@ -87,6 +87,79 @@ FST_CORE_BEGIN("./conf")
 		}
 		FST_TEST_END()
 
+		FST_TEST_BEGIN(vp8_async_test)
+		{
+			switch_status_t status;
+			switch_codec_t codec = { 0 };
+			switch_codec_settings_t codec_settings = {{ 0 }};
+			switch_codec_control_type_t rtype = SCCT_NONE;
+			void *reply = NULL;
+			int i, packets = 0, pictures = 0, on = 1;
+
+			codec_settings.video.width = 1280;
+			codec_settings.video.height = 720;
+
+			status = switch_core_codec_init(&codec,
+							   "VP8",
+							   NULL,
+							   NULL,
+							   0,
+							   0,
+							   1, SWITCH_CODEC_FLAG_ENCODE | SWITCH_CODEC_FLAG_DECODE,
+							   &codec_settings, fst_pool);
+			fst_check(status == SWITCH_STATUS_SUCCESS);
+
+			switch_core_codec_control(&codec, SCC_CODEC_SPECIFIC, SCCT_STRING, "async-encode", SCCT_INT, &on, NULL, NULL);
+
+			switch_image_t *img = switch_img_alloc(NULL, SWITCH_IMG_FMT_I420, 1280, 720, 1);
+			fst_requires(img);
+
+			uint8_t buf[SWITCH_DEFAULT_VIDEO_SIZE + 12];
+			switch_frame_t frame = { 0 };
+
+			frame.packet = buf;
+			frame.data = buf + 12;
+			frame.payload = 96;
+			frame.img = img;
+
+			for (i = 0; i < 30; i++) {
+				switch_status_t encode_status;
+
+				switch_img_fill(img, 0, 0, img->d_w, img->d_h, &(switch_rgb_color_t){ i * 8, 0, 255 - i * 8 });
+				frame.flags &= ~SFF_SAME_IMAGE;
+
+				do {
+					frame.datalen = SWITCH_DEFAULT_VIDEO_SIZE;
+					encode_status = switch_core_codec_encode_video(&codec, &frame);
+
+					if (encode_status == SWITCH_STATUS_SUCCESS || encode_status == SWITCH_STATUS_MORE_DATA) {
+						switch_assert((encode_status == SWITCH_STATUS_SUCCESS && frame.m) || !frame.m);
+						frame.flags &= ~SFF_PICTURE_RESET;
+
+						if (frame.datalen == 0) break;
+
+						packets++;
+						if (frame.m) pictures++;
+					}
+				} while (encode_status == SWITCH_STATUS_MORE_DATA);
+
+				switch_sleep(40000);
+			}
+
+			/* the encoder runs behind the caller, but it has to keep delivering */
+			fst_check(pictures > 0);
+			fst_check(packets >= pictures);
+
+			switch_core_codec_control(&codec, SCC_CODEC_SPECIFIC, SCCT_STRING, "stats", SCCT_NONE, NULL, &rtype, &reply);
+			fst_requires(reply);
+			fst_check(strstr((char *) reply, "async=true") != NULL);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "%s\n", (char *) reply);
+
+			switch_img_free(&img);
+			switch_core_codec_destroy(&codec);
+		}
+		FST_TEST_END()
+
 		FST_TEARDOWN_BEGIN()
 		{
 			switch_sleep(1000000);